@@ -90,6 +90,7 @@ if ENABLE_ZMQ:
 testScripts = [
     'bip68-112-113-p2p.py',
     'wallet.py',
+    'walletbalances.py',
     'listtransactions.py',
     'receivedby.py',
     'mempool_resurrect_test.py',
@@ -101,6 +102,7 @@ testScripts = [
     'mempool_spendcoinbase.py',
     'mempool_reorg.py',
     'mempool_limit.py',
+    'mempool_persist.py',
     'httpbasics.py',
     'multi_rpc.py',
     'zapwallettxes.py',
@@ -0,0 +1,74 @@
+#!/usr/bin/env python2
+# Copyright (c) 2018 The LINC Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test that the mempool survives a restart: transactions keep their entry
+# time, chains of unconfirmed transactions are accepted back in order and
+# fee deltas from prioritisetransaction are restored. With -persistmempool=0
+# nothing is saved or loaded.
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+class MempoolPersistTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self):
+        self.nodes = []
+        self.nodes.append(start_node(0, self.options.tmpdir))
+        self.is_network_split = False
+
+    def restart_node(self, extra_args=[]):
+        # keep the wallet from putting its own transactions back into the mempool
+        stop_node(self.nodes[0], 0)
+        self.nodes[0] = start_node(0, self.options.tmpdir, ["-walletbroadcast=0"] + extra_args)
+
+    def wait_for_mempool(self, count):
+        # the saved mempool is loaded in the background
+        for i in range(100):
+            if len(self.nodes[0].getrawmempool()) == count:
+                return
+            time.sleep(0.1)
+        assert_equal(len(self.nodes[0].getrawmempool()), count)
+
+    def run_test(self):
+        self.nodes[0].generate(101)
+
+        # a chain of transactions, each one spending the change of the one before
+        txids = []
+        for i in range(5):
+            txids.append(self.nodes[0].sendtoaddress(self.nodes[0].getnewaddress(), 1))
+        self.nodes[0].prioritisetransaction(txids[0], 0, 12345)
+        mempool = self.nodes[0].getrawmempool(True)
+        assert_equal(len(mempool), 5)
+
+        self.restart_node()
+        self.wait_for_mempool(5)
+        reloaded = self.nodes[0].getrawmempool(True)
+        for txid in txids:
+            assert_equal(reloaded[txid]['time'], mempool[txid]['time'])
+            assert_equal(reloaded[txid]['modifiedfee'], mempool[txid]['modifiedfee'])
+        assert(reloaded[txids[0]]['modifiedfee'] > reloaded[txids[0]]['fee'])
+
+        # without -persistmempool the saved mempool is neither loaded nor
+        # overwritten on shutdown, so it comes back on the next restart
+        self.restart_node(["-persistmempool=0"])
+        time.sleep(1)
+        assert_equal(len(self.nodes[0].getrawmempool()), 0)
+        self.restart_node()
+        self.wait_for_mempool(5)
+
+        # savemempool writes the file on request
+        mempooldat = os.path.join(self.options.tmpdir, "node0", "regtest", "mempool.dat")
+        os.remove(mempooldat)
+        self.nodes[0].savemempool()
+        assert(os.path.isfile(mempooldat))
+
+if __name__ == '__main__':
+    MempoolPersistTest().main()
@@ -337,5 +337,26 @@ class RESTTest (BitcoinTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        #test rest masternode and governance delta queries, both lists are empty on regtest
+        json_string = http_get_call(url.hostname, url.port, '/rest/masternodes'+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(len(json_obj['masternodes']), 0)
+        assert_equal(len(json_obj['removed']), 0)
+        # a query without since always needs a full resync, one from the reply time doesn't
+        assert_equal(json_obj['fullresync'], True)
+        json_string = http_get_call(url.hostname, url.port, '/rest/masternodes/since/'+str(json_obj['time'])+self.FORMAT_SEPARATOR+'json')
+        assert_equal(json.loads(json_string)['fullresync'], False)
+
+        json_string = http_get_call(url.hostname, url.port, '/rest/governance/objects/since/1'+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(len(json_obj['objects']), 0)
+        assert_equal(len(json_obj['removed']), 0)
+        assert_equal(json_obj['fullresync'], True)
+        json_string = http_get_call(url.hostname, url.port, '/rest/governance/objects/since/'+str(json_obj['time'])+self.FORMAT_SEPARATOR+'json')
+        assert_equal(json.loads(json_string)['fullresync'], False)
+
+        response = http_get_call(url.hostname, url.port, '/rest/masternodes/since/abc'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
 if __name__ == '__main__':
     RESTTest ().main ()
@@ -0,0 +1,93 @@
+#!/usr/bin/env python2
+# Copyright (c) 2018 The LINC Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Exercise the cached wallet balances with -checkwalletbalances, which
+# recounts the whole wallet on every balance query and asserts that the
+# cache matches. Covers the transactions that change without the wallet
+# being told: immature, unconfirmed and conflicted ones.
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+try:
+    import urllib.parse as urlparse
+except ImportError:
+    import urlparse
+
+class WalletBalancesTest (BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 2)
+
+    def setup_network(self, split=False):
+        self.nodes = start_nodes(2, self.options.tmpdir, [["-checkwalletbalances"]] * 2)
+        connect_nodes(self.nodes[0], 1)
+        self.is_network_split=False
+        self.sync_all()
+
+    def check_balances(self, node, balance, unconfirmed, immature):
+        info = node.getwalletinfo()
+        assert_equal(info["balance"], balance)
+        assert_equal(info["unconfirmed_balance"], unconfirmed)
+        assert_equal(info["immature_balance"], immature)
+        assert_equal(node.getbalance(), balance)
+        assert_equal(node.getunconfirmedbalance(), unconfirmed)
+
+    def run_test (self):
+        # a new coinbase is immature, it matures by tip changes alone
+        self.nodes[0].generate(1)
+        self.sync_all()
+        reward = self.nodes[0].getwalletinfo()["immature_balance"]
+        assert(reward > 0)
+        self.check_balances(self.nodes[0], 0, 0, reward)
+
+        self.nodes[1].generate(100)
+        self.sync_all()
+        self.check_balances(self.nodes[0], reward, 0, 0)
+
+        # unconfirmed until mined, change to ourselves counts right away
+        txid = self.nodes[0].sendtoaddress(self.nodes[1].getnewaddress(), 10)
+        self.sync_all()
+        fee = self.nodes[0].gettransaction(txid)["fee"]
+        self.check_balances(self.nodes[0], reward - 10 + fee, 0, 0)
+        assert_equal(self.nodes[1].getwalletinfo()["unconfirmed_balance"], 10)
+
+        self.nodes[1].generate(1)
+        self.sync_all()
+        self.check_balances(self.nodes[0], reward - 10 + fee, 0, 0)
+        assert_equal(self.nodes[1].getwalletinfo()["unconfirmed_balance"], 0)
+
+        # a transaction of ours that gets conflicted by a block
+        balance = self.nodes[0].getbalance()
+        url = urlparse.urlparse(self.nodes[1].url)
+        self.nodes[0].disconnectnode(url.hostname+":"+str(p2p_port(1)))
+
+        utxo = self.nodes[0].listunspent()[0]
+        inputs = [{"txid":utxo["txid"], "vout":utxo["vout"]}]
+        outputs = {self.nodes[0].getnewaddress(): utxo["amount"] - Decimal("0.001")}
+        signed1 = self.nodes[0].signrawtransaction(self.nodes[0].createrawtransaction(inputs, outputs))
+        txid1 = self.nodes[0].sendrawtransaction(signed1["hex"])
+        self.check_balances(self.nodes[0], balance - Decimal("0.001"), 0, 0)
+
+        outputs = {self.nodes[1].getnewaddress(): utxo["amount"] - Decimal("0.001")}
+        signed2 = self.nodes[0].signrawtransaction(self.nodes[0].createrawtransaction(inputs, outputs))
+        self.nodes[1].sendrawtransaction(signed2["hex"])
+        self.nodes[1].generate(1)
+
+        connect_nodes(self.nodes[0], 1)
+        sync_blocks(self.nodes)
+        assert(self.nodes[0].gettransaction(txid1)["confirmations"] < 0)
+        self.check_balances(self.nodes[0], balance - utxo["amount"], 0, 0)
+
+        # the winning spend is confirmed on the other side
+        info = self.nodes[1].getwalletinfo()
+        assert_equal(info["unconfirmed_balance"], 0)
+        assert_equal(info["balance"], self.nodes[1].getbalance())
+        assert_equal(self.nodes[1].getreceivedbyaddress(list(outputs.keys())[0]), utxo["amount"] - Decimal("0.001"))
+
+if __name__ == '__main__':
+    WalletBalancesTest().main()
@@ -0,0 +1,130 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "chainparams.h"
+#include "coins.h"
+#include "main.h"
+#include "masternode-payments.h"
+#include "miner.h"
+#include "random.h"
+#include "txdb.h"
+#include "txmempool.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+
+static const int ASSEMBLER_BENCH_MEMPOOL_TXS = 50000;
+// One in five transactions is in a chain of this many, the others stand alone
+static const int ASSEMBLER_BENCH_CHAIN_LENGTH = 5;
+static const int ASSEMBLER_BENCH_SPARE_COINS = 10000;
+
+/** Regtest chain at genesis with a mempool of ASSEMBLER_BENCH_MEMPOOL_TXS
+ *  transactions, far more than fit in a block, and spare coins to add more */
+class BlockAssemblerBenchSetup
+{
+public:
+    boost::filesystem::path pathTemp;
+    CCoinsViewDB *pcoinsdbview;
+    std::vector<COutPoint> vSpareCoins;
+    size_t nNextSpareCoin;
+
+    BlockAssemblerBenchSetup() : nNextSpareCoin(0)
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        pathTemp = boost::filesystem::temp_directory_path() / strprintf("bench_linc_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+        boost::filesystem::create_directories(pathTemp);
+        mapArgs["-datadir"] = pathTemp.string();
+        ClearDatadirCache();
+        pblocktree = new CBlockTreeDB(1 << 20, true);
+        pcoinsdbview = new CCoinsViewDB(1 << 23, true);
+        pcoinsTip = new CCoinsViewCache(pcoinsdbview);
+        if (!InitBlockIndex(Params()))
+            throw std::runtime_error("BlockAssemblerBenchSetup: InitBlockIndex failed");
+
+        LOCK(cs_main);
+        mnpayments.UpdatedBlockTip(chainActive.Tip());
+
+        int nTxs = 0;
+        while (nTxs < ASSEMBLER_BENCH_MEMPOOL_TXS) {
+            int nChainLength = (nTxs % (5 * ASSEMBLER_BENCH_CHAIN_LENGTH)) == 0 ? ASSEMBLER_BENCH_CHAIN_LENGTH : 1;
+            COutPoint prevout = NewCoin();
+            CAmount nValue = COIN;
+            for (int i = 0; i < nChainLength && nTxs < ASSEMBLER_BENCH_MEMPOOL_TXS; i++, nTxs++) {
+                CTransaction tx = AddToMempool(prevout, nValue);
+                prevout = COutPoint(tx.GetHash(), 0);
+                nValue = tx.vout[0].nValue;
+            }
+        }
+
+        for (int i = 0; i < ASSEMBLER_BENCH_SPARE_COINS; i++)
+            vSpareCoins.push_back(NewCoin());
+    }
+
+    ~BlockAssemblerBenchSetup()
+    {
+        mempool.clear();
+        UnloadBlockIndex();
+        delete pcoinsTip;
+        delete pcoinsdbview;
+        delete pblocktree;
+        mapArgs.erase("-datadir");
+        ClearDatadirCache();
+        boost::filesystem::remove_all(pathTemp);
+    }
+
+    /** A confirmed output anyone can spend */
+    COutPoint NewCoin()
+    {
+        uint256 hash = GetRandHash();
+        CCoinsModifier coins = pcoinsTip->ModifyCoins(hash);
+        coins->fCoinBase = false;
+        coins->nVersion = 1;
+        coins->nHeight = 0;
+        coins->vout.push_back(CTxOut(COIN, CScript() << OP_TRUE));
+        return COutPoint(hash, 0);
+    }
+
+    /** Spend prevout to a new mempool transaction with a random fee */
+    CTransaction AddToMempool(const COutPoint& prevout, CAmount nValueIn)
+    {
+        CAmount nFee = 1000 + GetRand(100000);
+        CMutableTransaction txNew;
+        txNew.vin.push_back(CTxIn(prevout));
+        txNew.vout.push_back(CTxOut(nValueIn - nFee, CScript() << OP_TRUE));
+        CTransaction tx(txNew);
+        bool fHasParent = mempool.exists(prevout.hash);
+        CTxMemPoolEntry entry(tx, nFee, GetTime(), 0, chainActive.Height(), !fHasParent, fHasParent ? 0 : nValueIn, false, 0, LockPoints());
+        mempool.addUnchecked(tx.GetHash(), entry);
+        return tx;
+    }
+};
+
+// What a getblocktemplate poll used to cost: selecting from the whole mempool
+static void BlockAssemblerFull(benchmark::State& state)
+{
+    BlockAssemblerBenchSetup setup;
+    CScript scriptPubKey = CScript() << OP_TRUE;
+    while (state.KeepRunning()) {
+        delete CreateNewBlock(Params(), scriptPubKey);
+    }
+}
+
+// A poll after one more transaction arrived, patching the previous template
+static void BlockAssemblerIncremental(benchmark::State& state)
+{
+    BlockAssemblerBenchSetup setup;
+    CScript scriptPubKey = CScript() << OP_TRUE;
+    delete CreateNewBlockIncremental(Params(), scriptPubKey);
+    while (state.KeepRunning()) {
+        if (setup.nNextSpareCoin < setup.vSpareCoins.size()) {
+            LOCK(cs_main);
+            setup.AddToMempool(setup.vSpareCoins[setup.nNextSpareCoin++], COIN);
+        }
+        delete CreateNewBlockIncremental(Params(), scriptPubKey);
+    }
+}
+
+BENCHMARK(BlockAssemblerFull);
+BENCHMARK(BlockAssemblerIncremental);
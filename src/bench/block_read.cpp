@@ -0,0 +1,97 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "main.h"
+#include "random.h"
+#include "streams.h"
+#include "util.h"
+
+#include <univalue.h>
+
+#include <boost/filesystem.hpp>
+
+extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+
+/** Regtest genesis block written to a block file in a throwaway datadir */
+class BlockReadBenchSetup
+{
+public:
+    boost::filesystem::path pathTemp;
+    uint256 hashBlock;
+    CBlockIndex index;
+
+    BlockReadBenchSetup()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        pathTemp = boost::filesystem::temp_directory_path() / strprintf("bench_linc_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+        boost::filesystem::create_directories(pathTemp);
+        mapArgs["-datadir"] = pathTemp.string();
+        ClearDatadirCache();
+
+        const CBlock& block = Params().GenesisBlock();
+        CDiskBlockPos pos(0, 0);
+        if (!WriteBlockToDisk(block, pos, Params().MessageStart()))
+            throw std::runtime_error("BlockReadBenchSetup: WriteBlockToDisk failed");
+
+        hashBlock = block.GetHash();
+        index = CBlockIndex(block);
+        index.phashBlock = &hashBlock;
+        index.nFile = pos.nFile;
+        index.nDataPos = pos.nPos;
+        index.nStatus |= BLOCK_HAVE_DATA;
+    }
+
+    ~BlockReadBenchSetup()
+    {
+        mapArgs.erase("-datadir");
+        ClearDatadirCache();
+        boost::filesystem::remove_all(pathTemp);
+    }
+};
+
+// Reading by position has to run NeoScrypt over the header to check proof of work
+static void ReadBlockFromDiskByPos(benchmark::State& state)
+{
+    BlockReadBenchSetup setup;
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    while (state.KeepRunning()) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, setup.index.GetBlockPos(), consensusParams))
+            assert(false);
+    }
+}
+
+// What getblock does: read an indexed block and report it, including its hash
+static void GetBlockToJSON(benchmark::State& state)
+{
+    BlockReadBenchSetup setup;
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    while (state.KeepRunning()) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, &setup.index, consensusParams))
+            assert(false);
+        blockToJSON(block, &setup.index).write();
+    }
+}
+
+// What ProcessGetData does for MSG_BLOCK: read an indexed block and serialize it
+static void ProcessGetDataBlock(benchmark::State& state)
+{
+    BlockReadBenchSetup setup;
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    while (state.KeepRunning()) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, &setup.index, consensusParams))
+            assert(false);
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << block;
+    }
+}
+
+BENCHMARK(ReadBlockFromDiskByPos);
+BENCHMARK(GetBlockToJSON);
+BENCHMARK(ProcessGetDataBlock);
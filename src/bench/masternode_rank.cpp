@@ -0,0 +1,71 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "chain.h"
+#include "main.h"
+#include "masternodeman.h"
+#include "random.h"
+
+static const int RANK_BENCH_MASTERNODES = 5000;
+static const int RANK_BENCH_BLOCKS = 100;
+
+/** Fake active chain and masternode list to rank against */
+class RankBenchSetup
+{
+public:
+    CMasternodeMan mnman;
+    std::vector<CTxIn> vecVins;
+    std::vector<uint256> vecBlockHashes;
+    std::vector<CBlockIndex> vecBlocks;
+
+    RankBenchSetup() : vecBlockHashes(RANK_BENCH_BLOCKS), vecBlocks(RANK_BENCH_BLOCKS)
+    {
+        LOCK(cs_main);
+        for(int i = 0; i < RANK_BENCH_BLOCKS; i++) {
+            vecBlockHashes[i] = GetRandHash();
+            vecBlocks[i].phashBlock = &vecBlockHashes[i];
+            vecBlocks[i].nHeight = i;
+            vecBlocks[i].pprev = i ? &vecBlocks[i - 1] : NULL;
+        }
+        chainActive.SetTip(&vecBlocks.back());
+
+        for(int i = 0; i < RANK_BENCH_MASTERNODES; i++) {
+            CTxIn vin(GetRandHash(), 0);
+            CMasternode mn(CService("1.2.3.4", 9999), vin, CPubKey(), CPubKey(), PROTOCOL_VERSION);
+            mnman.Add(mn);
+            vecVins.push_back(vin);
+        }
+    }
+
+    ~RankBenchSetup()
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(NULL);
+    }
+};
+
+// Many rank lookups for the same block, this is what InstantSend and payment voting do
+static void MasternodeRankSameBlock(benchmark::State& state)
+{
+    RankBenchSetup setup;
+    int i = 0;
+    while (state.KeepRunning()) {
+        setup.mnman.GetMasternodeRank(setup.vecVins[i++ % RANK_BENCH_MASTERNODES], RANK_BENCH_BLOCKS - 1);
+    }
+}
+
+// Every lookup is for a different block so scores have to be calculated and sorted each time
+static void MasternodeRankNewBlock(benchmark::State& state)
+{
+    RankBenchSetup setup;
+    int i = 0;
+    while (state.KeepRunning()) {
+        setup.mnman.GetMasternodeRank(setup.vecVins[i % RANK_BENCH_MASTERNODES], i % RANK_BENCH_BLOCKS);
+        i++;
+    }
+}
+
+BENCHMARK(MasternodeRankSameBlock);
+BENCHMARK(MasternodeRankNewBlock);
@@ -0,0 +1,92 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "crypto/neoscrypt.h"
+#include "random.h"
+
+#include <vector>
+
+// Every iteration hashes the same number of headers, so the averages of all
+// engines compare directly and hashes/sec is NEOSCRYPT_BENCH_HEADERS / average
+static const unsigned int NEOSCRYPT_BENCH_HEADERS = 8;
+
+static std::vector<unsigned char> RandomHeaders()
+{
+    std::vector<unsigned char> vHeaders(NEOSCRYPT_BENCH_HEADERS * 80);
+    GetRandBytes(&vHeaders[0], vHeaders.size());
+    return vHeaders;
+}
+
+// One header at a time, the assembly engine when built with ASM
+static void NeoScrypt(benchmark::State& state)
+{
+    std::vector<unsigned char> vHeaders = RandomHeaders();
+    unsigned char output[NEOSCRYPT_BENCH_HEADERS * 32];
+    while (state.KeepRunning()) {
+        for (unsigned int i = 0; i < NEOSCRYPT_BENCH_HEADERS; i++)
+            neoscrypt(&vHeaders[i * 80], &output[i * 32], 0);
+    }
+}
+
+// Whatever engine the node picks at run time for batched header hashing
+static void NeoScryptMulti(benchmark::State& state)
+{
+    std::vector<unsigned char> vHeaders = RandomHeaders();
+    unsigned char output[NEOSCRYPT_BENCH_HEADERS * 32];
+    while (state.KeepRunning()) {
+        neoscrypt_multi(&vHeaders[0], output, NEOSCRYPT_BENCH_HEADERS);
+    }
+}
+
+#if defined(ASM) && defined(MINER_4WAY)
+// The assembly miner engine hashes four consecutive nonces of one header
+static void NeoScrypt4WayASM(benchmark::State& state)
+{
+    std::vector<unsigned char> vHeaders = RandomHeaders();
+    std::vector<unsigned char> vScratchpad(4 * ((128 + 3) * 2 * 128 + 80));
+    unsigned char output[NEOSCRYPT_BENCH_HEADERS * 32];
+    while (state.KeepRunning()) {
+        for (unsigned int i = 0; i < NEOSCRYPT_BENCH_HEADERS; i += 4)
+            neoscrypt_4way(&vHeaders[i * 80], &output[i * 32], &vScratchpad[0]);
+    }
+}
+
+BENCHMARK(NeoScrypt4WayASM);
+#endif
+
+#ifdef NEOSCRYPT_SIMD
+static void NeoScrypt4WaySSE2(benchmark::State& state)
+{
+    if (!(cpu_vec_exts() & 0x00000020))
+        return;
+    std::vector<unsigned char> vHeaders = RandomHeaders();
+    std::vector<unsigned char> vScratchpad(NEOSCRYPT_NWAY_SCRATCHPAD_SIZE(4));
+    unsigned char output[NEOSCRYPT_BENCH_HEADERS * 32];
+    while (state.KeepRunning()) {
+        for (unsigned int i = 0; i < NEOSCRYPT_BENCH_HEADERS; i += 4)
+            neoscrypt_sse2_4way(&vHeaders[i * 80], &output[i * 32], &vScratchpad[0]);
+    }
+}
+
+// Not reported on processors without AVX2
+static void NeoScrypt8WayAVX2(benchmark::State& state)
+{
+    if (!(cpu_vec_exts() & 0x00010000))
+        return;
+    std::vector<unsigned char> vHeaders = RandomHeaders();
+    std::vector<unsigned char> vScratchpad(NEOSCRYPT_NWAY_SCRATCHPAD_SIZE(8));
+    unsigned char output[NEOSCRYPT_BENCH_HEADERS * 32];
+    while (state.KeepRunning()) {
+        for (unsigned int i = 0; i < NEOSCRYPT_BENCH_HEADERS; i += 8)
+            neoscrypt_avx2_8way(&vHeaders[i * 80], &output[i * 32], &vScratchpad[0]);
+    }
+}
+
+BENCHMARK(NeoScrypt4WaySSE2);
+BENCHMARK(NeoScrypt8WayAVX2);
+#endif
+
+BENCHMARK(NeoScrypt);
+BENCHMARK(NeoScryptMulti);
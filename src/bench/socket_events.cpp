@@ -0,0 +1,204 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "chainparams.h"
+#include "net.h"
+#include "netbase.h"
+#include "protocol.h"
+#include "random.h"
+#include "streams.h"
+#include "util.h"
+
+#include <boost/thread.hpp>
+
+#ifndef WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#if !defined(HAVE_MSG_NOSIGNAL) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+// Received messages are thrown away this often, there is no message handler
+static const int SOCKET_EVENTS_BENCH_CLEAR_INTERVAL = 1000;
+
+/**
+ * ThreadSocketHandler serving nIdlePeers inbound loopback peers that never send
+ * anything and one that does. The idle ends live in a child process, so only
+ * our own ends count against FD_SETSIZE and 800 peers still work with select.
+ */
+class SocketEventsBenchSetup
+{
+public:
+    SOCKET hActiveSocket;
+    std::vector<char> vchMessage;
+    boost::thread *pthreadSocketHandler;
+#ifndef WIN32
+    pid_t pidIdlePeers;
+    int hIdlePeersPipe;
+#else
+    std::vector<SOCKET> vIdleSockets;
+#endif
+
+    SocketEventsBenchSetup(SocketEventsMode mode, int nIdlePeers)
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        nSocketEventsMode = mode;
+        nMaxConnections = (nIdlePeers + 1) * 2;
+
+        CService addrBind;
+        std::string strError;
+        bool fBound = false;
+        for (int i = 0; i < 10 && !fBound; i++) {
+            addrBind = CService("127.0.0.1", (int)(20000 + GetRand(20000)));
+            fBound = BindListenPort(addrBind, strError);
+        }
+        if (!fBound)
+            throw std::runtime_error("SocketEventsBenchSetup: " + strError);
+
+#ifndef WIN32
+        // fork before any thread is started, the child only connects and waits for us to go away
+        int hPipe[2];
+        if (pipe(hPipe) != 0)
+            throw std::runtime_error("SocketEventsBenchSetup: pipe() failed");
+        pidIdlePeers = fork();
+        if (pidIdlePeers == -1)
+            throw std::runtime_error("SocketEventsBenchSetup: fork() failed");
+        if (pidIdlePeers == 0) {
+            close(hPipe[1]);
+            for (int i = 0; i < nIdlePeers; i++) {
+                SOCKET hSocket;
+                if (!ConnectSocket(addrBind, hSocket, 5000))
+                    _exit(1);
+            }
+            char c;
+            while (read(hPipe[0], &c, 1) != 0) {}
+            _exit(0);
+        }
+        close(hPipe[0]);
+        hIdlePeersPipe = hPipe[1];
+#endif
+        InitSocketEvents();
+        pthreadSocketHandler = new boost::thread(&ThreadSocketHandler);
+
+#ifdef WIN32
+        for (int i = 0; i < nIdlePeers; i++) {
+            SOCKET hSocket;
+            if (!ConnectSocket(addrBind, hSocket, 5000))
+                throw std::runtime_error("SocketEventsBenchSetup: connecting to ourselves failed");
+            vIdleSockets.push_back(hSocket);
+        }
+#endif
+        WaitForPeers(nIdlePeers);
+        if (!ConnectSocket(addrBind, hActiveSocket, 5000))
+            throw std::runtime_error("SocketEventsBenchSetup: connecting to ourselves failed");
+        WaitForPeers(nIdlePeers + 1);
+
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << CMessageHeader(Params().MessageStart(), NetMsgType::PING, 0);
+        vchMessage.assign(ss.begin(), ss.end());
+    }
+
+    ~SocketEventsBenchSetup()
+    {
+        pthreadSocketHandler->interrupt();
+        pthreadSocketHandler->join();
+        delete pthreadSocketHandler;
+        CloseSocket(hActiveSocket);
+#ifndef WIN32
+        close(hIdlePeersPipe);
+        waitpid(pidIdlePeers, NULL, 0);
+#else
+        BOOST_FOREACH(SOCKET& hSocket, vIdleSockets)
+            CloseSocket(hSocket);
+#endif
+        CExplicitNetCleanup::callCleanup();
+    }
+
+    void WaitForPeers(size_t nPeers)
+    {
+        while (true) {
+            {
+                LOCK(cs_vNodes);
+                if (vNodes.size() == nPeers)
+                    break;
+            }
+#ifndef WIN32
+            if (waitpid(pidIdlePeers, NULL, WNOHANG) != 0)
+                throw std::runtime_error("SocketEventsBenchSetup: connecting to ourselves failed");
+#endif
+            MilliSleep(10);
+        }
+    }
+
+    void ClearReceived()
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes) {
+            LOCK(pnode->cs_vRecvMsg);
+            pnode->vRecvMsg.clear();
+        }
+    }
+};
+
+// Every iteration is one pass of the event loop: the active peer sends a message
+// and we wait until it was read. The time per iteration grows with the number of
+// idle peers only where each wakeup costs something per connection.
+static void SocketEvents(benchmark::State& state, SocketEventsMode mode, int nIdlePeers)
+{
+    SocketEventsBenchSetup setup(mode, nIdlePeers);
+    uint64_t nExpectedBytes = CNode::GetTotalBytesRecv();
+    size_t nMessages = 0;
+    while (state.KeepRunning()) {
+        if (send(setup.hActiveSocket, &setup.vchMessage[0], setup.vchMessage.size(), MSG_NOSIGNAL) != (int)setup.vchMessage.size())
+            throw std::runtime_error("SocketEvents: send() failed");
+        nExpectedBytes += setup.vchMessage.size();
+        while (CNode::GetTotalBytesRecv() < nExpectedBytes)
+            boost::this_thread::yield();
+        if (++nMessages % SOCKET_EVENTS_BENCH_CLEAR_INTERVAL == 0)
+            setup.ClearReceived();
+    }
+}
+
+static void SocketEventsSelect50(benchmark::State& state)
+{
+    SocketEvents(state, SOCKETEVENTS_SELECT, 50);
+}
+
+static void SocketEventsSelect200(benchmark::State& state)
+{
+    SocketEvents(state, SOCKETEVENTS_SELECT, 200);
+}
+
+static void SocketEventsSelect800(benchmark::State& state)
+{
+    SocketEvents(state, SOCKETEVENTS_SELECT, 800);
+}
+
+BENCHMARK(SocketEventsSelect50);
+BENCHMARK(SocketEventsSelect200);
+BENCHMARK(SocketEventsSelect800);
+
+#ifdef HAVE_SYS_EPOLL_H
+static void SocketEventsEpoll50(benchmark::State& state)
+{
+    SocketEvents(state, SOCKETEVENTS_EPOLL, 50);
+}
+
+static void SocketEventsEpoll200(benchmark::State& state)
+{
+    SocketEvents(state, SOCKETEVENTS_EPOLL, 200);
+}
+
+static void SocketEventsEpoll800(benchmark::State& state)
+{
+    SocketEvents(state, SOCKETEVENTS_EPOLL, 800);
+}
+
+BENCHMARK(SocketEventsEpoll50);
+BENCHMARK(SocketEventsEpoll200);
+BENCHMARK(SocketEventsEpoll800);
+#endif
@@ -53,11 +53,14 @@ private:
 
     unsigned int Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const;
 
-    // Private constructor for CRollingBloomFilter, no restrictions on size
+public:
+    /**
+     * Creates a bloom filter without the protocol limits on size and number of hash
+     * functions, for filters that are only used locally and never sent to peers
+     * (CRollingBloomFilter, the wallet rescan filter).
+     */
     CBloomFilter(unsigned int nElements, double nFPRate, unsigned int nTweak);
-    friend class CRollingBloomFilter;
 
-public:
     /**
      * Creates a new bloom filter which will provide the given fp rate when filled with the given number of elements
      * Note that if the given parameters will result in a filter outside the bounds of the protocol limits,
@@ -2715,6 +2715,108 @@ void neoscrypt(const uchar *password, uchar *output, uint profile) {
 #endif /* !(ASM) */
 
 
+#ifdef NEOSCRYPT_SIMD
+
+typedef uint neoscrypt_vec4 __attribute__ ((vector_size (16)));
+typedef uint neoscrypt_vec8 __attribute__ ((vector_size (32)));
+
+/* SSE2 4-way NeoScrypt(128, 2, 1) */
+#define NWAY_LANES 4
+#define NWAY_VEC neoscrypt_vec4
+#define NWAY_TARGET __attribute__ ((target ("sse2")))
+#define NWAY(name) neoscrypt_##name##_sse2_4way
+#define NWAY_ENTRY neoscrypt_sse2_4way
+#include "neoscrypt_nway.h"
+#undef NWAY_LANES
+#undef NWAY_VEC
+#undef NWAY_TARGET
+#undef NWAY
+#undef NWAY_ENTRY
+
+/* AVX2 8-way NeoScrypt(128, 2, 1) */
+#define NWAY_LANES 8
+#define NWAY_VEC neoscrypt_vec8
+#define NWAY_TARGET __attribute__ ((target ("avx2")))
+#define NWAY(name) neoscrypt_##name##_avx2_8way
+#define NWAY_ENTRY neoscrypt_avx2_8way
+#include "neoscrypt_nway.h"
+#undef NWAY_LANES
+#undef NWAY_VEC
+#undef NWAY_TARGET
+#undef NWAY
+#undef NWAY_ENTRY
+
+static void neoscrypt_nway(uint lanes, const uchar *password, uchar *output,
+  uchar *scratchpad) {
+    if(lanes == 8)
+      neoscrypt_avx2_8way(password, output, scratchpad);
+    else
+      neoscrypt_sse2_4way(password, output, scratchpad);
+}
+
+#endif /* NEOSCRYPT_SIMD */
+
+uint neoscrypt_simd_lanes() {
+#ifdef NEOSCRYPT_SIMD
+    static int lanes = -1;
+
+    if(lanes < 0) {
+        uint exts = cpu_vec_exts();
+
+        if(exts & 0x00010000)
+          lanes = 8;
+        else if(exts & 0x00000020)
+          lanes = 4;
+        else
+          lanes = 1;
+    }
+
+    return((uint)lanes);
+#else
+    return(1);
+#endif
+}
+
+void neoscrypt_multi(const uchar *password, uchar *output, uint count) {
+    uint i = 0;
+#ifdef NEOSCRYPT_SIMD
+    const uint lanes = neoscrypt_simd_lanes();
+    uchar pad_password[8 * 80], pad_output[8 * 32];
+    uchar *scratchpad;
+    uint width, n, k;
+
+    if((lanes > 1) && (count > 1)) {
+        scratchpad = (uchar *) malloc(NEOSCRYPT_NWAY_SCRATCHPAD_SIZE(lanes));
+        if(scratchpad) {
+            while((count - i) > 1) {
+                n = count - i;
+                width = ((lanes == 8) && (n > 4)) ? 8 : 4;
+                if(n >= width) {
+                    neoscrypt_nway(width, &password[i * 80], &output[i * 32],
+                      scratchpad);
+                    i += width;
+                } else {
+                    /* Pad a partial batch with copies of its last password */
+                    neoscrypt_copy(&pad_password[0], &password[i * 80], n * 80);
+                    for(k = n; k < width; k++)
+                      neoscrypt_copy(&pad_password[k * 80],
+                        &password[(count - 1) * 80], 80);
+                    neoscrypt_nway(width, &pad_password[0], &pad_output[0],
+                      scratchpad);
+                    neoscrypt_copy(&output[i * 32], &pad_output[0], n * 32);
+                    i += n;
+                }
+            }
+            free(scratchpad);
+        }
+    }
+#endif
+
+    for(; i < count; i++)
+      neoscrypt(&password[i * 80], &output[i * 32], 0);
+}
+
+
 #if defined(ASM) && defined(MINER_4WAY)
 
 extern void neoscrypt_xor_salsa_4way(uint *X, uint *X0, uint *Y, uint double_rounds);
@@ -3254,10 +3356,26 @@ void neoscrypt_fastkdf_4way(const uchar *password, const uchar *salt,
 #endif /* (ASM) && (MINER_4WAY) */
 
 #ifndef ASM
+/* Same bit layout as the assembly version, see neoscrypt_asm.S;
+ * bit 16 reports AVX2 for the multi-lane engine */
 uint cpu_vec_exts() {
+#ifdef NEOSCRYPT_SIMD
+    uint exts = 0;
+
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2"))
+      exts |= 0x00000030;
+    if(__builtin_cpu_supports("avx"))
+      exts |= 0x00002000;
+    if(__builtin_cpu_supports("avx2"))
+      exts |= 0x00010000;
+
+    return(exts);
+#else
 
     /* No assembly, no extensions */
 
     return(0);
+#endif
 }
 #endif
@@ -32,6 +32,28 @@ void neoscrypt_fastkdf_4way(const unsigned char *password,
 
 unsigned int cpu_vec_exts(void);
 
+/* Multi-lane NeoScrypt(128, 2, 1) for the portable build, built from
+ * compiler vector extensions and selected at run time */
+#if !defined(ASM) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NEOSCRYPT_SIMD
+
+/* Scratchpad bytes needed to hash the given number of lanes at once */
+#define NEOSCRYPT_NWAY_SCRATCHPAD_SIZE(lanes) ((128 + 2) * 64 * 4 * (lanes) + 64)
+
+void neoscrypt_sse2_4way(const unsigned char *password, unsigned char *output,
+  unsigned char *scratchpad);
+void neoscrypt_avx2_8way(const unsigned char *password, unsigned char *output,
+  unsigned char *scratchpad);
+#endif
+
+/* Number of hashes neoscrypt_multi() computes at once on this processor */
+unsigned int neoscrypt_simd_lanes(void);
+
+/* NeoScrypt(128, 2, 1) of count 80 byte passwords stored back to back
+ * into count 32 byte outputs, using the widest engine available */
+void neoscrypt_multi(const unsigned char *password, unsigned char *output,
+  unsigned int count);
+
 #if (__cplusplus)
 }
 #else
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2014-2016 John Doering <ghostlander@phoenixcoin.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/* Multi-lane NeoScrypt(128, 2, 1) with Salsa20/20 and ChaCha20/20;
+ * this file is included by neoscrypt.c once per vector width with
+ * the following defined:
+ *   NWAY_LANES  : number of hashes processed at once;
+ *   NWAY_VEC    : vector type of NWAY_LANES 32-bit words;
+ *   NWAY_TARGET : function attributes enabling the instruction set;
+ *   NWAY(name)  : name mangling for the internal functions;
+ *   NWAY_ENTRY  : name of the public entry point.
+ * Word k of lane l lives in element l of vector k, so every Salsa / ChaCha
+ * operation runs on all lanes at once. Only FastKDF and the data dependent
+ * V lookups are done lane by lane. */
+
+/* Salsa20, rounds must be a multiple of 2 */
+static NWAY_TARGET void NWAY(salsa)(NWAY_VEC *X, uint rounds) {
+    NWAY_VEC x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15, t;
+
+    x0 = X[0];   x1 = X[1];   x2 = X[2];   x3 = X[3];
+    x4 = X[4];   x5 = X[5];   x6 = X[6];   x7 = X[7];
+    x8 = X[8];   x9 = X[9];  x10 = X[10]; x11 = X[11];
+   x12 = X[12]; x13 = X[13]; x14 = X[14]; x15 = X[15];
+
+#define quarter(a, b, c, d) \
+    t = a + d; t = ROTL32(t,  7); b ^= t; \
+    t = b + a; t = ROTL32(t,  9); c ^= t; \
+    t = c + b; t = ROTL32(t, 13); d ^= t; \
+    t = d + c; t = ROTL32(t, 18); a ^= t;
+
+    for(; rounds; rounds -= 2) {
+        quarter( x0,  x4,  x8, x12);
+        quarter( x5,  x9, x13,  x1);
+        quarter(x10, x14,  x2,  x6);
+        quarter(x15,  x3,  x7, x11);
+        quarter( x0,  x1,  x2,  x3);
+        quarter( x5,  x6,  x7,  x4);
+        quarter(x10, x11,  x8,  x9);
+        quarter(x15, x12, x13, x14);
+    }
+
+    X[0] += x0;   X[1] += x1;   X[2] += x2;   X[3] += x3;
+    X[4] += x4;   X[5] += x5;   X[6] += x6;   X[7] += x7;
+    X[8] += x8;   X[9] += x9;  X[10] += x10; X[11] += x11;
+   X[12] += x12; X[13] += x13; X[14] += x14; X[15] += x15;
+
+#undef quarter
+}
+
+/* ChaCha20, rounds must be a multiple of 2 */
+static NWAY_TARGET void NWAY(chacha)(NWAY_VEC *X, uint rounds) {
+    NWAY_VEC x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15, t;
+
+    x0 = X[0];   x1 = X[1];   x2 = X[2];   x3 = X[3];
+    x4 = X[4];   x5 = X[5];   x6 = X[6];   x7 = X[7];
+    x8 = X[8];   x9 = X[9];  x10 = X[10]; x11 = X[11];
+   x12 = X[12]; x13 = X[13]; x14 = X[14]; x15 = X[15];
+
+#define quarter(a,b,c,d) \
+    a += b; t = d ^ a; d = ROTL32(t, 16); \
+    c += d; t = b ^ c; b = ROTL32(t, 12); \
+    a += b; t = d ^ a; d = ROTL32(t,  8); \
+    c += d; t = b ^ c; b = ROTL32(t,  7);
+
+    for(; rounds; rounds -= 2) {
+        quarter( x0,  x4,  x8, x12);
+        quarter( x1,  x5,  x9, x13);
+        quarter( x2,  x6, x10, x14);
+        quarter( x3,  x7, x11, x15);
+        quarter( x0,  x5, x10, x15);
+        quarter( x1,  x6, x11, x12);
+        quarter( x2,  x7,  x8, x13);
+        quarter( x3,  x4,  x9, x14);
+    }
+
+    X[0] += x0;   X[1] += x1;   X[2] += x2;   X[3] += x3;
+    X[4] += x4;   X[5] += x5;   X[6] += x6;   X[7] += x7;
+    X[8] += x8;   X[9] += x9;  X[10] += x10; X[11] += x11;
+   X[12] += x12; X[13] += x13; X[14] += x14; X[15] += x15;
+
+#undef quarter
+}
+
+/* Vector block XOR engine, len is in vectors */
+static NWAY_TARGET void NWAY(blkxor)(NWAY_VEC *dst, const NWAY_VEC *src, uint len) {
+    uint i;
+
+    for(i = 0; i < len; i++)
+      dst[i] ^= src[i];
+}
+
+/* Vector block swapper, len is in vectors */
+static NWAY_TARGET void NWAY(blkswp)(NWAY_VEC *blkA, NWAY_VEC *blkB, uint len) {
+    NWAY_VEC t;
+    uint i;
+
+    for(i = 0; i < len; i++) {
+        t       = blkA[i];
+        blkA[i] = blkB[i];
+        blkB[i] = t;
+    }
+}
+
+/* Block mixer for r = 2, see neoscrypt_blkmix() */
+static NWAY_TARGET void NWAY(blkmix)(NWAY_VEC *X, uint mixer) {
+
+    if(mixer) {
+        NWAY(blkxor)(&X[0], &X[48], 16);
+        NWAY(chacha)(&X[0], 20);
+        NWAY(blkxor)(&X[16], &X[0], 16);
+        NWAY(chacha)(&X[16], 20);
+        NWAY(blkxor)(&X[32], &X[16], 16);
+        NWAY(chacha)(&X[32], 20);
+        NWAY(blkxor)(&X[48], &X[32], 16);
+        NWAY(chacha)(&X[48], 20);
+    } else {
+        NWAY(blkxor)(&X[0], &X[48], 16);
+        NWAY(salsa)(&X[0], 20);
+        NWAY(blkxor)(&X[16], &X[0], 16);
+        NWAY(salsa)(&X[16], 20);
+        NWAY(blkxor)(&X[32], &X[16], 16);
+        NWAY(salsa)(&X[32], 20);
+        NWAY(blkxor)(&X[48], &X[32], 16);
+        NWAY(salsa)(&X[48], 20);
+    }
+    NWAY(blkswp)(&X[16], &X[32], 16);
+}
+
+/* SMix with V lookups done lane by lane */
+static NWAY_TARGET void NWAY(smix)(NWAY_VEC *X, NWAY_VEC *V, uint mixer) {
+    const uint N = 128;
+    const uint *v;
+    uint *x, i, j[NWAY_LANES], k, l;
+
+    for(i = 0; i < N; i++) {
+        for(k = 0; k < 64; k++)
+          V[i * 64 + k] = X[k];
+        NWAY(blkmix)(&X[0], mixer);
+    }
+
+    for(i = 0; i < N; i++) {
+        /* integerify(X) mod N */
+        for(l = 0; l < NWAY_LANES; l++)
+          j[l] = 64 * (X[48][l] & (N - 1));
+        /* blkxor(X, V) */
+        for(l = 0; l < NWAY_LANES; l++) {
+            x = (uint *) X + l;
+            v = (const uint *) &V[j[l]] + l;
+            for(k = 0; k < 64 * NWAY_LANES; k += NWAY_LANES)
+              x[k] ^= v[k];
+        }
+        NWAY(blkmix)(&X[0], mixer);
+    }
+}
+
+/* NWAY_LANES 80 byte passwords in, NWAY_LANES 32 byte hashes out;
+ * scratchpad size is NEOSCRYPT_NWAY_SCRATCHPAD_SIZE(NWAY_LANES) bytes */
+NWAY_TARGET void NWAY_ENTRY(const uchar *password, uchar *output,
+  uchar *scratchpad) {
+    const size_t align = 0x40;
+    uint lanebuf[64];
+    NWAY_VEC *X, *Z, *V;
+    uint k, l;
+
+    /* X and Z are 64 vectors each, V is N * 64 vectors */
+    X = (NWAY_VEC *) (((size_t)scratchpad + align - 1) & ~(align - 1));
+    Z = &X[64];
+    V = &X[128];
+
+    /* X = KDF(password, salt) */
+    for(l = 0; l < NWAY_LANES; l++) {
+        neoscrypt_fastkdf(&password[l * 80], 80, &password[l * 80], 80, 32,
+          (uchar *) lanebuf, sizeof(lanebuf));
+        for(k = 0; k < 64; k++)
+          X[k][l] = lanebuf[k];
+    }
+
+    /* Process ChaCha 1st, Salsa 2nd and XOR them into FastKDF */
+    for(k = 0; k < 64; k++)
+      Z[k] = X[k];
+    NWAY(smix)(Z, V, 1);
+    NWAY(smix)(X, V, 0);
+    NWAY(blkxor)(X, Z, 64);
+
+    /* output = KDF(password, X) */
+    for(l = 0; l < NWAY_LANES; l++) {
+        for(k = 0; k < 64; k++)
+          lanebuf[k] = X[k][l];
+        neoscrypt_fastkdf(&password[l * 80], 80, (uchar *) lanebuf,
+          sizeof(lanebuf), 32, &output[l * 32], 32);
+    }
+}
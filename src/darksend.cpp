@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "activemasternode.h"
+#include "checkqueue.h"
 #include "coincontrol.h"
 #include "consensus/validation.h"
 #include "darksend.h"
@@ -13,12 +14,15 @@
 #include "masternode-payments.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
+#include "memusage.h"
 #include "script/sign.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilmoneystr.h"
 
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <boost/unordered_set.hpp>
 
 int nPrivateSendRounds = DEFAULT_PRIVATESEND_ROUNDS;
 int nPrivateSendAmount = DEFAULT_PRIVATESEND_AMOUNT;
@@ -31,6 +35,85 @@ CDarkSendSigner darkSendSigner;
 std::map<uint256, CDarksendBroadcastTx> mapDarksendBroadcastTxes;
 std::vector<CAmount> vecPrivateSendDenominations;
 
+namespace {
+
+class CMessageSignatureCacheHasher
+{
+public:
+    size_t operator()(const uint256& key) const {
+        return key.GetCheapHash();
+    }
+};
+
+/**
+ * Valid message signature cache, to avoid recovering the public key of the same
+ * masternode message twice (e.g. when it's relayed to us by several peers or
+ * when it was already verified by VerifyMessageBatch)
+ */
+class CMessageSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || message hash || key id || signature)
+    uint256 nonce;
+    typedef boost::unordered_set<uint256, CMessageSignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_sigcache;
+
+public:
+    CMessageSignatureCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyID)
+    {
+        CSHA256 sha;
+        sha.Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(keyID.begin(), keyID.size());
+        if(!vchSig.empty()) {
+            sha.Write(&vchSig[0], vchSig.size());
+        }
+        sha.Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.count(entry);
+    }
+
+    void Set(const uint256& entry)
+    {
+        size_t nMaxCacheSize = GetArg("-maxmsgsigcachesize", DEFAULT_MAX_MSG_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+        if (nMaxCacheSize <= 0) return;
+
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        while (memusage::DynamicUsage(setValid) > nMaxCacheSize)
+        {
+            map_type::size_type s = GetRand(setValid.bucket_count());
+            map_type::local_iterator it = setValid.begin(s);
+            if (it != setValid.end(s)) {
+                setValid.erase(*it);
+            }
+        }
+
+        setValid.insert(entry);
+    }
+};
+
+CMessageSignatureCache messageSignatureCache;
+
+CCheckQueue<CSignedMessageCheck> messagecheckqueue(128);
+// only one batch can be verified at a time
+CCriticalSection cs_messagecheckqueue;
+
+}
+
+void ThreadMessageSigCheck()
+{
+    RenameThread("linc-msgsigch");
+    messagecheckqueue.Thread();
+}
+
 void CDarksendPool::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
 {
     if(fLiteMode) return; // ignore all LINC related functionality
@@ -2302,9 +2385,16 @@ bool CDarkSendSigner::VerifyMessage(CPubKey pubkey, const std::vector<unsigned c
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
+    uint256 hash = ss.GetHash();
+
+    uint256 entry;
+    messageSignatureCache.ComputeEntry(entry, hash, vchSig, pubkey.GetID());
+    if(messageSignatureCache.Get(entry)) {
+        return true;
+    }
 
     CPubKey pubkeyFromSig;
-    if(!pubkeyFromSig.RecoverCompact(ss.GetHash(), vchSig)) {
+    if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
         return false;
     }
@@ -2316,6 +2406,31 @@ bool CDarkSendSigner::VerifyMessage(CPubKey pubkey, const std::vector<unsigned c
         return false;
     }
 
+    messageSignatureCache.Set(entry);
+    return true;
+}
+
+void CDarkSendSigner::VerifyMessageBatch(std::vector<CSignedMessageCheck>& vChecks)
+{
+    if(vChecks.empty()) return;
+
+    if(!nMessageCheckThreads || vChecks.size() == 1) {
+        BOOST_FOREACH(CSignedMessageCheck& check, vChecks) {
+            check();
+        }
+        return;
+    }
+
+    LOCK(cs_messagecheckqueue);
+    CCheckQueueControl<CSignedMessageCheck> control(&messagecheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
+bool CSignedMessageCheck::operator()()
+{
+    std::string strError;
+    darkSendSigner.VerifyMessage(pubkey, vchSig, strMessage, strError);
     return true;
 }
 
@@ -2336,11 +2451,16 @@ bool CDarkSendEntry::AddScriptSig(const CTxIn& txin)
     return false;
 }
 
+std::string CDarksendQueue::GetSignatureMessage() const
+{
+    return vin.ToString() + boost::lexical_cast<std::string>(nDenom) + boost::lexical_cast<std::string>(nTime) + boost::lexical_cast<std::string>(fReady);
+}
+
 bool CDarksendQueue::Sign()
 {
     if(!fMasterNode) return false;
 
-    std::string strMessage = vin.ToString() + boost::lexical_cast<std::string>(nDenom) + boost::lexical_cast<std::string>(nTime) + boost::lexical_cast<std::string>(fReady);
+    std::string strMessage = GetSignatureMessage();
 
     if(!darkSendSigner.SignMessage(strMessage, vchSig, activeMasternode.keyMasternode)) {
         LogPrintf("CDarksendQueue::Sign -- SignMessage() failed, %s\n", ToString());
@@ -2352,7 +2472,7 @@ bool CDarksendQueue::Sign()
 
 bool CDarksendQueue::CheckSignature(const CPubKey& pubKeyMasternode)
 {
-    std::string strMessage = vin.ToString() + boost::lexical_cast<std::string>(nDenom) + boost::lexical_cast<std::string>(nTime) + boost::lexical_cast<std::string>(fReady);
+    std::string strMessage = GetSignatureMessage();
     std::string strError = "";
 
     if(!darkSendSigner.VerifyMessage(pubKeyMasternode, vchSig, strMessage, strError)) {
@@ -26,6 +26,9 @@ static const CAmount PRIVATESEND_COLLATERAL         = 0.001 * COIN;
 static const CAmount PRIVATESEND_POOL_MAX           = 999.999 * COIN;
 static const int DENOMS_COUNT_MAX                   = 100;
 
+//! Default for -maxmsgsigcachesize, in MiB
+static const unsigned int DEFAULT_MAX_MSG_SIG_CACHE_SIZE = 10;
+
 static const int DEFAULT_PRIVATESEND_ROUNDS         = 2;
 static const int DEFAULT_PRIVATESEND_AMOUNT         = 1000;
 static const int DEFAULT_PRIVATESEND_LIQUIDITY      = 0;
@@ -179,6 +182,7 @@ public:
     bool Sign();
     /// Check if we have a valid Masternode address
     bool CheckSignature(const CPubKey& pubKeyMasternode);
+    std::string GetSignatureMessage() const;
 
     bool Relay();
 
@@ -235,6 +239,30 @@ public:
     bool CheckSignature(const CPubKey& pubKeyMasternode);
 };
 
+/** A pending message signature check, see CDarkSendSigner::VerifyMessageBatch()
+ */
+class CSignedMessageCheck
+{
+private:
+    CPubKey pubkey;
+    std::vector<unsigned char> vchSig;
+    std::string strMessage;
+
+public:
+    CSignedMessageCheck() {}
+    CSignedMessageCheck(const CPubKey& pubkeyIn, const std::vector<unsigned char>& vchSigIn, const std::string& strMessageIn) :
+        pubkey(pubkeyIn), vchSig(vchSigIn), strMessage(strMessageIn) {}
+
+    /// Always succeeds, the result only ends up in the signature cache
+    bool operator()();
+
+    void swap(CSignedMessageCheck& check) {
+        std::swap(pubkey, check.pubkey);
+        vchSig.swap(check.vchSig);
+        strMessage.swap(check.strMessage);
+    }
+};
+
 /** Helper object for signing and checking signatures
  */
 class CDarkSendSigner
@@ -248,6 +276,9 @@ public:
     bool SignMessage(std::string strMessage, std::vector<unsigned char>& vchSigRet, CKey key);
     /// Verify the message, returns true if succcessful
     bool VerifyMessage(CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string strMessage, std::string& strErrorRet);
+    /// Verify many messages in parallel using the message check threads.
+    /// Valid signatures are cached, so following VerifyMessage() calls for the same messages are cheap.
+    void VerifyMessageBatch(std::vector<CSignedMessageCheck>& vChecks);
 };
 
 /** Used to keep track of current status of mixing pool
@@ -480,5 +511,6 @@ public:
 };
 
 void ThreadCheckDarkSendPool();
+void ThreadMessageSigCheck();
 
 #endif
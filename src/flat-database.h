@@ -10,11 +10,95 @@
 #include "clientversion.h"
 #include "hash.h"
 #include "streams.h"
+#include "sync.h"
 #include "util.h"
 
 #include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
 
-/** 
+/** One change made since the last snapshot, replayed on top of it on load */
+struct CFlatDBJournalRecord
+{
+    unsigned char nType;
+    std::vector<unsigned char> vchData;
+
+    CFlatDBJournalRecord() : nType(0), vchData() {}
+
+    template<typename T>
+    CFlatDBJournalRecord(unsigned char nTypeIn, const T& obj) : nType(nTypeIn), vchData()
+    {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << obj;
+        vchData.assign(ss.begin(), ss.end());
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(this->nType);
+        READWRITE(vchData);
+    }
+};
+
+/**
+ * Changes a manager made since CJournaledFlatDB last took them.
+ * If nobody takes them for too long they are dropped and the next dump
+ * writes a full snapshot instead.
+ */
+class CFlatDBJournal
+{
+private:
+    static const size_t MAX_PENDING_RECORDS = 200000;
+
+    CCriticalSection cs;
+    std::vector<CFlatDBJournalRecord> vecRecords;
+    bool fOverflow;
+
+public:
+    CFlatDBJournal() : vecRecords(), fOverflow(false) {}
+
+    template<typename T>
+    void Add(unsigned char nType, const T& obj)
+    {
+        LOCK(cs);
+        if(fOverflow) return;
+        if(vecRecords.size() >= MAX_PENDING_RECORDS) {
+            vecRecords.clear();
+            fOverflow = true;
+            return;
+        }
+        vecRecords.push_back(CFlatDBJournalRecord(nType, obj));
+    }
+
+    /// Move the pending records out, false if some were dropped and a snapshot is needed
+    bool Take(std::vector<CFlatDBJournalRecord>& vecRecordsRet)
+    {
+        LOCK(cs);
+        vecRecordsRet.clear();
+        vecRecordsRet.swap(vecRecords);
+        bool fComplete = !fOverflow;
+        fOverflow = false;
+        return fComplete;
+    }
+
+    /// Put records taken by Take() back in front of the newer ones, after they failed to be written
+    void Restore(std::vector<CFlatDBJournalRecord>& vecRecordsIn, bool fComplete)
+    {
+        LOCK(cs);
+        if(fOverflow) return;
+        if(!fComplete || vecRecordsIn.size() + vecRecords.size() > MAX_PENDING_RECORDS) {
+            vecRecords.clear();
+            fOverflow = true;
+            return;
+        }
+        vecRecordsIn.insert(vecRecordsIn.end(), vecRecords.begin(), vecRecords.end());
+        vecRecords.swap(vecRecordsIn);
+    }
+};
+
+/**
 *   Generic Dumping and Loading
 *   ---------------------------
 */
@@ -22,7 +106,7 @@
 template<typename T>
 class CFlatDB
 {
-private:
+protected:
 
     enum ReadResult {
         Ok,
@@ -34,14 +118,24 @@ private:
         IncorrectFormat
     };
 
+    /// Serializes writers of the same file, i.e. the scheduler thread and shutdown
+    static CCriticalSection csWrite;
+
     boost::filesystem::path pathDB;
     std::string strFilename;
     std::string strMagicMessage;
 
-    bool Write(const T& objToSave)
-    {
-        // LOCK(objToSave.cs);
+    /// Outcome and checksum of the last ReadSnapshot, used by FinishLoad
+    ReadResult readResult;
+    uint256 hashSnapshot;
 
+    /**
+     * Write a snapshot next to the old file and move it into place, so a crash
+     * leaves either the old or the new snapshot. The object's own lock is only
+     * held while serializing into memory, not during the disk write.
+     */
+    bool Write(const T& objToSave, uint256& hashRet)
+    {
         int64_t nStart = GetTimeMillis();
 
         // serialize, checksum data up to that point, then append checksum
@@ -49,14 +143,15 @@ private:
         ssObj << strMagicMessage; // specific magic message for this type of object
         ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
         ssObj << objToSave;
-        uint256 hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
+        hashRet = Hash(ssObj.begin(), ssObj.end());
+        ssObj << hashRet;
 
-        // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        // open temporary output file, and associate with CAutoFile
+        boost::filesystem::path pathTmp(pathDB.string() + ".new");
+        FILE *file = fopen(pathTmp.string().c_str(), "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
         // Write and commit header, data
         try {
@@ -65,15 +160,20 @@ private:
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
 
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Failed to move %s into place", __func__, pathTmp.string());
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
-    ReadResult Read(T& objToLoad, bool fDryRun = false)
+    /// Deserialize straight from the file while hashing it, the checksum is compared at the end
+    ReadResult Read(T& objToLoad, uint256& hashRet)
     {
         //LOCK(objToLoad.cs);
 
@@ -87,43 +187,12 @@ private:
             return FileError;
         }
 
-        // use file size to size memory buffer
-        int fileSize = boost::filesystem::file_size(pathDB);
-        int dataSize = fileSize - sizeof(uint256);
-        // Don't try to resize to a negative number if file is small
-        if (dataSize < 0)
-            dataSize = 0;
-        std::vector<unsigned char> vchData;
-        vchData.resize(dataSize);
-        uint256 hashIn;
-
-        // read data and checksum from file
-        try {
-            filein.read((char *)&vchData[0], dataSize);
-            filein >> hashIn;
-        }
-        catch (std::exception &e) {
-            error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            return HashReadError;
-        }
-        filein.fclose();
-
-        CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
-        // verify stored checksum matches input data
-        uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-        if (hashIn != hashTmp)
-        {
-            error("%s: Checksum mismatch, data corrupted", __func__);
-            return IncorrectHash;
-        }
-
-
+        CHashVerifier<CAutoFile> verifier(&filein);
         unsigned char pchMsgTmp[4];
         std::string strMagicMessageTmp;
         try {
             // de-serialize file header (file specific magic message) and ..
-            ssObj >> strMagicMessageTmp;
+            verifier >> strMagicMessageTmp;
 
             // ... verify the message matches predefined one
             if (strMagicMessage != strMagicMessageTmp)
@@ -134,7 +203,7 @@ private:
 
 
             // de-serialize file header (network specific magic number) and ..
-            ssObj >> FLATDATA(pchMsgTmp);
+            verifier >> FLATDATA(pchMsgTmp);
 
             // ... verify the network matches ours
             if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
@@ -144,7 +213,7 @@ private:
             }
 
             // de-serialize data into T object
-            ssObj >> objToLoad;
+            verifier >> objToLoad;
         }
         catch (std::exception &e) {
             objToLoad.Clear();
@@ -152,30 +221,36 @@ private:
             return IncorrectFormat;
         }
 
-        LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
-        LogPrintf("     %s\n", objToLoad.ToString());
-        if(!fDryRun) {
-            LogPrintf("%s: Cleaning....\n", __func__);
-            objToLoad.CheckAndRemove();
-            LogPrintf("     %s\n", objToLoad.ToString());
+        // read checksum from file
+        uint256 hashIn;
+        try {
+            filein >> hashIn;
+        }
+        catch (std::exception &e) {
+            objToLoad.Clear();
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return HashReadError;
         }
+        filein.fclose();
 
-        return Ok;
-    }
+        // verify stored checksum matches input data
+        hashRet = verifier.GetHash();
+        if (hashIn != hashRet)
+        {
+            objToLoad.Clear();
+            error("%s: Checksum mismatch, data corrupted", __func__);
+            return IncorrectHash;
+        }
 
+        LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrintf("     %s\n", objToLoad.ToString());
 
-public:
-    CFlatDB(std::string strFilenameIn, std::string strMagicMessageIn)
-    {
-        pathDB = GetDataDir() / strFilenameIn;
-        strFilename = strFilenameIn;
-        strMagicMessage = strMagicMessageIn;
+        return Ok;
     }
 
-    bool Load(T& objToLoad)
+    /// Log the outcome of Read, false if the node should not start
+    bool CheckReadResult(ReadResult readResult)
     {
-        LogPrintf("Reading info from %s...\n", strFilename);
-        ReadResult readResult = Read(objToLoad);
         if (readResult == FileError)
             LogPrintf("Missing file %s, will try to recreate\n", strFilename);
         else if (readResult != Ok)
@@ -194,37 +269,298 @@ public:
         return true;
     }
 
+    void Clean(T& objToLoad)
+    {
+        LogPrintf("%s: Cleaning....\n", __func__);
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
+    }
+
+public:
+    CFlatDB(std::string strFilenameIn, std::string strMagicMessageIn)
+        : readResult(FileError)
+    {
+        pathDB = GetDataDir() / strFilenameIn;
+        strFilename = strFilenameIn;
+        strMagicMessage = strMagicMessageIn;
+    }
+
+    /**
+     * Loading is split in two so that files can be read concurrently:
+     * ReadSnapshot only deserializes and verifies the file, FinishLoad
+     * cleans the object up and may depend on other managers being loaded.
+     */
+    bool ReadSnapshot(T& objToLoad)
+    {
+        LogPrintf("Reading info from %s...\n", strFilename);
+        readResult = Read(objToLoad, hashSnapshot);
+        return CheckReadResult(readResult);
+    }
+
+    void FinishLoad(T& objToLoad)
+    {
+        if (readResult == Ok)
+            Clean(objToLoad);
+    }
+
+    bool Load(T& objToLoad)
+    {
+        if (!ReadSnapshot(objToLoad))
+            return false;
+        FinishLoad(objToLoad);
+        return true;
+    }
+
     bool Dump(T& objToSave)
     {
+        LOCK(csWrite);
         int64_t nStart = GetTimeMillis();
 
-        LogPrintf("Verifying %s format...\n", strFilename);
-        T tmpObjToLoad;
-        ReadResult readResult = Read(tmpObjToLoad, true);
+        LogPrintf("Writting info to %s...\n", strFilename);
+        uint256 hashSnapshot;
+        if (!Write(objToSave, hashSnapshot))
+            return false;
+        LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
 
-        // there was an error and it was not an error on file opening => do not proceed
-        if (readResult == FileError)
-            LogPrintf("Missing file %s, will try to recreate\n", strFilename);
-        else if (readResult != Ok)
-        {
-            LogPrintf("Error reading %s: ", strFilename);
-            if(readResult == IncorrectFormat)
-                LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
-            else
-            {
-                LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
-                return false;
+        return true;
+    }
+
+};
+
+template<typename T>
+CCriticalSection CFlatDB<T>::csWrite;
+
+/**
+ *   Snapshot plus append-only journal
+ *   ---------------------------------
+ *
+ *   For managers too large to rewrite on every dump. Dump() appends the
+ *   records collected since the last dump to <file>.journal and only writes
+ *   a new snapshot once the journal has grown to half the snapshot size.
+ *   The journal starts with the checksum of the snapshot it follows, so a
+ *   journal left over from an older snapshot is ignored. Load() replays the
+ *   journal up to the first incomplete record and cuts that tail off.
+ *
+ *   T has to provide, in addition to what CFlatDB needs:
+ *     bool TakeJournal(std::vector<CFlatDBJournalRecord>& vecRecordsRet);
+ *     void RestoreJournal(std::vector<CFlatDBJournalRecord>& vecRecords, bool fComplete);
+ *     void ApplyJournalRecord(const CFlatDBJournalRecord& record);
+ *   Applying a record that is already part of the snapshot must be harmless.
+ */
+template<typename T>
+class CJournaledFlatDB : public CFlatDB<T>
+{
+private:
+    /// Journals smaller than this are never compacted
+    static const uint64_t MIN_COMPACT_SIZE = 16 * 1024 * 1024;
+
+    boost::filesystem::path pathJournal;
+
+    bool WriteJournalHeader(const uint256& hashSnapshot)
+    {
+        FILE *file = fopen(pathJournal.string().c_str(), "wb");
+        CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+        if (fileout.IsNull())
+            return error("%s: Failed to open file %s", __func__, pathJournal.string());
+
+        try {
+            fileout << this->strMagicMessage;
+            fileout << FLATDATA(Params().MessageStart());
+            fileout << hashSnapshot;
+        }
+        catch (std::exception &e) {
+            return error("%s: Serialize or I/O error - %s", __func__, e.what());
+        }
+        FileCommit(fileout.Get());
+        return true;
+    }
+
+    /// Write a full snapshot and start an empty journal after it
+    bool Compact(T& objToSave, std::vector<CFlatDBJournalRecord>& vecRecords, bool fComplete)
+    {
+        // Records taken before are part of the snapshot, records added while
+        // serializing may end up in both, which replay tolerates
+        uint256 hashSnapshot;
+        if (!this->Write(objToSave, hashSnapshot)) {
+            // The old snapshot and journal are still in place, keep the records for the next dump
+            objToSave.RestoreJournal(vecRecords, fComplete);
+            return false;
+        }
+        return WriteJournalHeader(hashSnapshot);
+    }
+
+    bool AppendJournal(const std::vector<CFlatDBJournalRecord>& vecRecords)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        FILE *file = fopen(pathJournal.string().c_str(), "ab");
+        CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+        if (fileout.IsNull())
+            return error("%s: Failed to open file %s", __func__, pathJournal.string());
+
+        try {
+            BOOST_FOREACH(const CFlatDBJournalRecord& record, vecRecords) {
+                fileout << record;
+                fileout << SerializeHash(record, SER_DISK, CLIENT_VERSION);
             }
         }
+        catch (std::exception &e) {
+            // A partial record would hide everything appended after it, start over on the next dump
+            fileout.fclose();
+            boost::filesystem::remove(pathJournal);
+            return error("%s: Serialize or I/O error - %s", __func__, e.what());
+        }
+        FileCommit(fileout.Get());
 
-        LogPrintf("Writting info to %s...\n", strFilename);
-        Write(objToSave);
-        LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrintf("Appended %u records to %s journal  %dms\n", vecRecords.size(), this->strFilename, GetTimeMillis() - nStart);
+        return true;
+    }
 
+    void ReplayJournal(T& objToLoad, const uint256& hashSnapshot)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        FILE *file = fopen(pathJournal.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return;
+
+        std::string strMagicMessageTmp;
+        unsigned char pchMsgTmp[4];
+        uint256 hashSnapshotTmp;
+        try {
+            filein >> strMagicMessageTmp;
+            filein >> FLATDATA(pchMsgTmp);
+            filein >> hashSnapshotTmp;
+        }
+        catch (std::exception &e) {
+            strMagicMessageTmp.clear();
+        }
+        if (strMagicMessageTmp != this->strMagicMessage || memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)) ||
+            hashSnapshotTmp != hashSnapshot) {
+            LogPrintf("%s: Journal for %s does not follow the snapshot, ignoring it\n", __func__, this->strFilename);
+            filein.fclose();
+            boost::filesystem::remove(pathJournal);
+            return;
+        }
+
+        long nGoodSize = ftell(filein.Get());
+        int nRecords = 0;
+        while (true) {
+            CFlatDBJournalRecord record;
+            uint256 hashRecord;
+            try {
+                filein >> record;
+                filein >> hashRecord;
+            }
+            catch (std::exception &e) {
+                break;
+            }
+            if (hashRecord != SerializeHash(record, SER_DISK, CLIENT_VERSION))
+                break;
+
+            try {
+                objToLoad.ApplyJournalRecord(record);
+            }
+            catch (std::exception &e) {
+                error("%s: Failed to apply journal record of type %d - %s", __func__, record.nType, e.what());
+            }
+            nGoodSize = ftell(filein.Get());
+            nRecords++;
+        }
+        filein.fclose();
+
+        uint64_t nFileSize = boost::filesystem::file_size(pathJournal);
+        if (nGoodSize >= 0 && nFileSize > (uint64_t)nGoodSize) {
+            LogPrintf("%s: Dropping %d bytes of incomplete records from %s journal\n", __func__, nFileSize - nGoodSize, this->strFilename);
+            boost::filesystem::resize_file(pathJournal, nGoodSize);
+        }
+
+        LogPrintf("Replayed %d records from %s journal  %dms\n", nRecords, this->strFilename, GetTimeMillis() - nStart);
+    }
+
+public:
+    CJournaledFlatDB(std::string strFilenameIn, std::string strMagicMessageIn)
+        : CFlatDB<T>(strFilenameIn, strMagicMessageIn)
+    {
+        pathJournal = GetDataDir() / (strFilenameIn + ".journal");
+    }
+
+    void FinishLoad(T& objToLoad)
+    {
+        if (this->readResult == CFlatDB<T>::Ok) {
+            ReplayJournal(objToLoad, this->hashSnapshot);
+            this->Clean(objToLoad);
+        } else {
+            boost::filesystem::remove(pathJournal);
+        }
+
+        // Replay goes through the same code paths that record changes, those are on disk already
+        std::vector<CFlatDBJournalRecord> vecRecords;
+        objToLoad.TakeJournal(vecRecords);
+    }
+
+    bool Load(T& objToLoad)
+    {
+        if (!this->ReadSnapshot(objToLoad))
+            return false;
+        FinishLoad(objToLoad);
+        return true;
+    }
+
+    /**
+     * Clear the object and what is stored of it. A snapshot of the empty object
+     * replaces the old one right away, so neither it nor its journal comes back.
+     */
+    bool Reset(T& objToReset)
+    {
+        LOCK(CFlatDB<T>::csWrite);
+
+        objToReset.Clear();
+        std::vector<CFlatDBJournalRecord> vecRecords;
+        objToReset.TakeJournal(vecRecords);
+        vecRecords.clear();
+
+        LogPrintf("Resetting %s...\n", this->strFilename);
+        if (!Compact(objToReset, vecRecords, true)) {
+            // at least don't append to a journal that belongs to the dropped state
+            boost::filesystem::remove(pathJournal);
+            return false;
+        }
         return true;
     }
 
+    bool Dump(T& objToSave)
+    {
+        LOCK(CFlatDB<T>::csWrite);
+
+        std::vector<CFlatDBJournalRecord> vecRecords;
+        bool fComplete = objToSave.TakeJournal(vecRecords);
+
+        bool fCompact = !fComplete || !boost::filesystem::exists(this->pathDB) || !boost::filesystem::exists(pathJournal);
+        if (!fCompact) {
+            uint64_t nSnapshotSize = boost::filesystem::file_size(this->pathDB);
+            fCompact = boost::filesystem::file_size(pathJournal) > std::max(nSnapshotSize / 2, (uint64_t)MIN_COMPACT_SIZE);
+        }
+
+        if (fCompact) {
+            int64_t nStart = GetTimeMillis();
+            LogPrintf("Writting info to %s...\n", this->strFilename);
+            if (!Compact(objToSave, vecRecords, fComplete))
+                return false;
+            LogPrintf("%s dump finished  %dms\n", this->strFilename, GetTimeMillis() - nStart);
+            return true;
+        }
+
+        if (vecRecords.empty())
+            return true;
+        if (!AppendJournal(vecRecords)) {
+            objToSave.RestoreJournal(vecRecords, fComplete);
+            return false;
+        }
+        return true;
+    }
 };
 
 
-#endif
\ No newline at end of file
+#endif
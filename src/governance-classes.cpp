@@ -210,6 +210,7 @@ void CGovernanceTriggerManager::CleanAndRemove()
                             LogPrint("gobject", "CGovernanceTriggerManager::CleanAndRemove -- Expiring outdated object: %s\n", pgovobj->GetHash().ToString());
                             pgovobj->fExpired = true;
                             pgovobj->nDeletionTime = GetAdjustedTime();
+                            governance.JournalObjectState(*pgovobj);
                         }
                     }
                 }
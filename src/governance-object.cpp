@@ -21,6 +21,7 @@ CGovernanceObject::CGovernanceObject()
   nRevision(0),
   nTime(0),
   nDeletionTime(0),
+  nTimeLastChanged(0),
   nCollateralHash(),
   strData(),
   vinMasternode(),
@@ -35,6 +36,7 @@ CGovernanceObject::CGovernanceObject()
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  tallyCurrentVotes(),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -49,6 +51,7 @@ CGovernanceObject::CGovernanceObject(uint256 nHashParentIn, int nRevisionIn, int
   nRevision(nRevisionIn),
   nTime(nTimeIn),
   nDeletionTime(0),
+  nTimeLastChanged(0),
   nCollateralHash(nCollateralHashIn),
   strData(strDataIn),
   vinMasternode(),
@@ -63,6 +66,7 @@ CGovernanceObject::CGovernanceObject(uint256 nHashParentIn, int nRevisionIn, int
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  tallyCurrentVotes(),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -77,6 +81,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other)
   nRevision(other.nRevision),
   nTime(other.nTime),
   nDeletionTime(other.nDeletionTime),
+  nTimeLastChanged(other.nTimeLastChanged),
   nCollateralHash(other.nCollateralHash),
   strData(other.strData),
   vinMasternode(other.vinMasternode),
@@ -91,6 +96,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other)
   fExpired(other.fExpired),
   fUnparsable(other.fUnparsable),
   mapCurrentMNVotes(other.mapCurrentMNVotes),
+  tallyCurrentVotes(other.tallyCurrentVotes),
   mapOrphanVotes(other.mapOrphanVotes),
   fileVotes(other.fileVotes)
 {}
@@ -168,7 +174,8 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         }
     }
     // Finally check that the vote is actually valid (done last because of cost of signature verification)
-    if(!vote.IsValid(true)) {
+    CKeyID keyIDVerified;
+    if(!vote.IsValid(true, &keyIDVerified)) {
         std::ostringstream ostr;
         ostr << "CGovernanceObject::ProcessVote -- Invalid vote "
                 << ", MN outpoint = " << vote.GetVinMasternode().prevout.ToStringShort()
@@ -188,11 +195,13 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         exception = CGovernanceException(ostr.str(), GOVERNANCE_EXCEPTION_PERMANENT_ERROR);
         return false;
     }
-    voteInstance = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
+    SetVoteInstance(int(eSignal), voteInstance, vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp()));
     if(!fileVotes.HasVote(vote.GetHash())) {
-        fileVotes.AddVote(vote);
+        fileVotes.AddVote(vote, keyIDVerified);
     }
     fDirtyCache = true;
+    nTimeLastChanged = GetAdjustedTime();
+    governance.journal.Add(GOVERNANCE_JOURNAL_VOTE, vote);
     return true;
 }
 
@@ -209,6 +218,47 @@ void CGovernanceObject::RebuildVoteMap()
         }
     }
     mapCurrentMNVotes = mapMNVotesNew;
+    RecalculateVoteTally();
+}
+
+void CGovernanceObject::SetVoteInstance(int nSignal, vote_instance_t& voteInstance, const vote_instance_t& voteInstanceNew)
+{
+    tallyCurrentVotes.Add(nSignal, voteInstance.eOutcome, -1);
+    tallyCurrentVotes.Add(nSignal, voteInstanceNew.eOutcome, 1);
+    voteInstance = voteInstanceNew;
+}
+
+void CGovernanceObject::RecalculateVoteTally()
+{
+    tallyCurrentVotes.Clear();
+    for(vote_m_cit it = mapCurrentMNVotes.begin(); it != mapCurrentMNVotes.end(); ++it) {
+        const vote_instance_m_t& mapInstances = it->second.mapInstances;
+        for(vote_instance_m_cit it2 = mapInstances.begin(); it2 != mapInstances.end(); ++it2) {
+            tallyCurrentVotes.Add(it2->first, it2->second.eOutcome, 1);
+        }
+    }
+}
+
+void CGovernanceObject::RestoreVote(const CGovernanceVote& vote, bool fStored)
+{
+    vote_signal_enum_t eSignal = vote.GetSignal();
+    if(eSignal == VOTE_SIGNAL_NONE || eSignal > MAX_SUPPORTED_VOTE_SIGNAL) return;
+    if(fileVotes.HasVote(vote.GetHash())) return;
+
+    if(fStored) {
+        fileVotes.AddVoteKey(CGovernanceVoteKey(vote));
+    }
+    else {
+        fileVotes.AddVote(vote);
+    }
+    int nMNIndex = governance.GetMasternodeIndex(vote.GetVinMasternode());
+    if(nMNIndex >= 0) {
+        vote_instance_t& voteInstance = mapCurrentMNVotes[nMNIndex].mapInstances[int(eSignal)];
+        if(vote.GetTimestamp() >= voteInstance.nCreationTime) {
+            SetVoteInstance(int(eSignal), voteInstance, vote_instance_t(vote.GetOutcome(), vote.GetTimestamp(), vote.GetTimestamp()));
+        }
+    }
+    fDirtyCache = true;
 }
 
 void CGovernanceObject::ClearMasternodeVotes()
@@ -228,6 +278,10 @@ void CGovernanceObject::ClearMasternodeVotes()
         }
 
         if(fRemove) {
+            const vote_instance_m_t& mapInstances = it->second.mapInstances;
+            for(vote_instance_m_cit it2 = mapInstances.begin(); it2 != mapInstances.end(); ++it2) {
+                tallyCurrentVotes.Add(it2->first, it2->second.eOutcome, -1);
+            }
             mapCurrentMNVotes.erase(it++);
         }
         else {
@@ -605,19 +659,7 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError)
 
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
-    int nCount = 0;
-    for(vote_m_cit it = mapCurrentMNVotes.begin(); it != mapCurrentMNVotes.end(); ++it) {
-        const vote_rec_t& recVote = it->second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if(it2 == recVote.mapInstances.end()) {
-            continue;
-        }
-        const vote_instance_t& voteInstance = it2->second;
-        if(voteInstance.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
-        }
-    }
-    return nCount;
+    return tallyCurrentVotes.Get(eVoteSignalIn, eVoteOutcomeIn);
 }
 
 /**
@@ -714,6 +756,7 @@ void CGovernanceObject::swap(CGovernanceObject& first, CGovernanceObject& second
     swap(first.nRevision, second.nRevision);
     swap(first.nTime, second.nTime);
     swap(first.nDeletionTime, second.nDeletionTime);
+    swap(first.nTimeLastChanged, second.nTimeLastChanged);
     swap(first.nCollateralHash, second.nCollateralHash);
     swap(first.strData, second.strData);
     swap(first.nObjectType, second.nObjectType);
@@ -731,6 +774,16 @@ void CGovernanceObject::CheckOrphanVotes()
 {
     int64_t nNow = GetAdjustedTime();
     const vote_mcache_t::list_t& listVotes = mapOrphanVotes.GetItemList();
+
+    // verify signatures of votes we can process now at once, ProcessVote() hits the signature cache
+    std::vector<CGovernanceVote> vecVotesToVerify;
+    for(vote_mcache_t::list_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
+        if(it->value.second >= nNow) {
+            vecVotesToVerify.push_back(it->value.first);
+        }
+    }
+    CGovernanceVote::VerifySignatureBatch(vecVotesToVerify);
+
     vote_mcache_t::list_cit it = listVotes.begin();
     while(it != listVotes.end()) {
         bool fRemove = false;
@@ -104,6 +104,38 @@ struct vote_rec_t {
      }
 };
 
+/**
+ * Number of current masternode votes for each outcome of each signal, kept in
+ * step with the vote records so counting votes doesn't walk all of them
+ */
+struct vote_tally_t {
+    int anCount[MAX_SUPPORTED_VOTE_SIGNAL + 1][VOTE_OUTCOME_ABSTAIN + 1];
+
+    vote_tally_t()
+    {
+        Clear();
+    }
+
+    void Clear()
+    {
+        memset(anCount, 0, sizeof(anCount));
+    }
+
+    void Add(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
+    {
+        if(nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL) return;
+        if(eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) return;
+        anCount[nSignal][eOutcome] += nDelta;
+    }
+
+    int Get(int nSignal, vote_outcome_enum_t eOutcome) const
+    {
+        if(nSignal <= VOTE_SIGNAL_NONE || nSignal > MAX_SUPPORTED_VOTE_SIGNAL) return 0;
+        if(eOutcome <= VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) return 0;
+        return anCount[nSignal][eOutcome];
+    }
+};
+
 /**
 * Governance Object
 *
@@ -115,6 +147,9 @@ class CGovernanceObject
 
     friend class CGovernanceTriggerManager;
 
+    /// unit tests, see test/governance_tests.cpp
+    friend struct CGovernanceObjectTestAccess;
+
 public: // Types
     typedef std::map<int, vote_rec_t> vote_m_t;
 
@@ -143,6 +178,9 @@ private:
     /// time this object was marked for deletion
     int64_t nDeletionTime;
 
+    /// local time this object was added or last accepted a vote, not serialized
+    int64_t nTimeLastChanged;
+
     /// fee-tx
     uint256 nCollateralHash;
 
@@ -184,6 +222,9 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Outcomes of mapCurrentMNVotes by signal
+    vote_tally_t tallyCurrentVotes;
+
     /// Limited map of votes orphaned by MN
     vote_mcache_t mapOrphanVotes;
 
@@ -200,6 +241,14 @@ public:
 
     // Public Getter methods
 
+    const uint256& GetParentHash() const {
+        return nHashParent;
+    }
+
+    int GetRevision() const {
+        return nRevision;
+    }
+
     int64_t GetCreationTime() const {
         return nTime;
     }
@@ -208,6 +257,11 @@ public:
         return nDeletionTime;
     }
 
+    /// Latest of creation, deletion and last local change, for delta queries
+    int64_t GetLastChangeTime() const {
+        return std::max(std::max(nTime, nDeletionTime), nTimeLastChanged);
+    }
+
     int GetObjectType() const {
         return nObjectType;
     }
@@ -220,6 +274,14 @@ public:
         return vinMasternode;
     }
 
+    const std::vector<unsigned char>& GetSignature() const {
+        return vchSig;
+    }
+
+    const std::string& GetDataString() const {
+        return strData;
+    }
+
     bool IsSetCachedFunding() const {
         return fCachedFunding;
     }
@@ -252,6 +314,10 @@ public:
         return fileVotes;
     }
 
+    const CGovernanceObjectVoteFile& GetVoteFile() const {
+        return fileVotes;
+    }
+
     // Signature related functions
 
     void SetMasternodeInfo(const CTxIn& vin);
@@ -321,10 +387,13 @@ public:
             // Only include these for the disk file format
             LogPrint("gobject", "CGovernanceObject::SerializationOp Reading/writing votes from/to disk\n");
             READWRITE(nDeletionTime);
+            READWRITE(nTimeLastChanged);
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
-            READWRITE(fileVotes);
-            LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
+            if(ser_action.ForRead()) {
+                RecalculateVoteTally();
+            }
+            // the votes themselves are in pgovernancevotedb, see CGovernanceManager::InitOnLoad
         }
 
         // AFTER DESERIALIZATION OCCURS, CACHED VARIABLES MUST BE CALCULATED MANUALLY
@@ -347,6 +416,16 @@ private:
 
     void RebuildVoteMap();
 
+    /// Replace a masternode's vote on a signal, keeping tallyCurrentVotes in step
+    void SetVoteInstance(int nSignal, vote_instance_t& voteInstance, const vote_instance_t& voteInstanceNew);
+
+    /// Recount tallyCurrentVotes from mapCurrentMNVotes
+    void RecalculateVoteTally();
+
+    /// Re-apply a vote accepted before a restart, without the checks ProcessVote does.
+    /// fStored means the vote is already in the vote store and isn't written again.
+    void RestoreVote(const CGovernanceVote& vote, bool fStored = false);
+
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
 
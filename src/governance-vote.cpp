@@ -230,6 +230,12 @@ void CGovernanceVote::Relay() const
     RelayInv(inv, PROTOCOL_VERSION);
 }
 
+std::string CGovernanceVote::GetSignatureMessage() const
+{
+    return vinMasternode.prevout.ToStringShort() + "|" + nParentHash.ToString() + "|" +
+        boost::lexical_cast<std::string>(nVoteSignal) + "|" + boost::lexical_cast<std::string>(nVoteOutcome) + "|" + boost::lexical_cast<std::string>(nTime);
+}
+
 bool CGovernanceVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
 {
     // Choose coins to use
@@ -237,8 +243,7 @@ bool CGovernanceVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
     CKey keyCollateralAddress;
 
     std::string strError;
-    std::string strMessage = vinMasternode.prevout.ToStringShort() + "|" + nParentHash.ToString() + "|" +
-        boost::lexical_cast<std::string>(nVoteSignal) + "|" + boost::lexical_cast<std::string>(nVoteOutcome) + "|" + boost::lexical_cast<std::string>(nTime);
+    std::string strMessage = GetSignatureMessage();
 
     if(!darkSendSigner.SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrintf("CGovernanceVote::Sign -- SignMessage() failed\n");
@@ -253,7 +258,7 @@ bool CGovernanceVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
     return true;
 }
 
-bool CGovernanceVote::IsValid(bool fSignatureCheck) const
+bool CGovernanceVote::IsValid(bool fSignatureCheck, CKeyID* pkeyIDVerifiedRet) const
 {
     if(nTime > GetTime() + (60*60)) {
         LogPrint("gobject", "CGovernanceVote::IsValid -- vote is too far ahead of current time - %s - nTime %lli - Max Time %lli\n", GetHash().ToString(), nTime, GetTime() + (60*60));
@@ -283,17 +288,32 @@ bool CGovernanceVote::IsValid(bool fSignatureCheck) const
     if(!fSignatureCheck) return true;
 
     std::string strError;
-    std::string strMessage = vinMasternode.prevout.ToStringShort() + "|" + nParentHash.ToString() + "|" +
-        boost::lexical_cast<std::string>(nVoteSignal) + "|" + boost::lexical_cast<std::string>(nVoteOutcome) + "|" + boost::lexical_cast<std::string>(nTime);
+    std::string strMessage = GetSignatureMessage();
 
     if(!darkSendSigner.VerifyMessage(infoMn.pubKeyMasternode, vchSig, strMessage, strError)) {
         LogPrintf("CGovernanceVote::IsValid -- VerifyMessage() failed, error: %s\n", strError);
         return false;
     }
 
+    if(pkeyIDVerifiedRet) {
+        *pkeyIDVerifiedRet = infoMn.pubKeyMasternode.GetID();
+    }
+
     return true;
 }
 
+void CGovernanceVote::VerifySignatureBatch(const std::vector<CGovernanceVote>& vecVotes)
+{
+    std::vector<CSignedMessageCheck> vChecks;
+    vChecks.reserve(vecVotes.size());
+    for(size_t i = 0; i < vecVotes.size(); ++i) {
+        masternode_info_t infoMn = mnodeman.GetMasternodeInfo(vecVotes[i].vinMasternode);
+        if(!infoMn.fInfoValid) continue;
+        vChecks.push_back(CSignedMessageCheck(infoMn.pubKeyMasternode, vecVotes[i].vchSig, vecVotes[i].GetSignatureMessage()));
+    }
+    darkSendSigner.VerifyMessageBatch(vChecks);
+}
+
 bool operator==(const CGovernanceVote& vote1, const CGovernanceVote& vote2)
 {
     bool fResult = ((vote1.vinMasternode == vote2.vinMasternode) &&
@@ -117,12 +117,18 @@ public:
 
     const uint256& GetParentHash() const { return nParentHash; }
 
+    const std::vector<unsigned char>& GetSignature() const { return vchSig; }
+
     void SetTime(int64_t nTimeIn) { nTime = nTimeIn; }
 
     void SetSignature(const std::vector<unsigned char>& vchSigIn) { vchSig = vchSigIn; }
 
+    std::string GetSignatureMessage() const;
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
-    bool IsValid(bool fSignatureCheck) const;
+    /// pkeyIDVerifiedRet is set to the masternode key the signature was verified with
+    bool IsValid(bool fSignatureCheck, CKeyID* pkeyIDVerifiedRet = NULL) const;
+    /// Verify signatures of many votes at once, valid ones end up in the message signature cache
+    static void VerifySignatureBatch(const std::vector<CGovernanceVote>& vecVotes);
     void Relay() const;
 
     std::string GetVoteString() const {
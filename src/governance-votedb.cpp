@@ -5,34 +5,188 @@
 
 #include "governance-votedb.h"
 
+#include "memusage.h"
+#include "util.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+static const char DB_GOVERNANCE_VOTE = 'v';
+
+CGovernanceVoteDB *pgovernancevotedb = NULL;
+
+CGovernanceVoteDB::CGovernanceVoteDB(size_t nCacheSize, bool fMemory, bool fWipe)
+    : CDBWrapper(GetDataDir() / "governance", nCacheSize, fMemory, fWipe),
+      mapMemoryVotes(MAX_MEMORY_VOTES)
+{}
+
+bool CGovernanceVoteDB::WriteVote(const CGovernanceVote& vote)
+{
+    {
+        LOCK(cs);
+        mapMemoryVotes.Insert(vote.GetHash(), vote);
+    }
+    return Write(std::make_pair(DB_GOVERNANCE_VOTE, CGovernanceVoteKey(vote)), vote);
+}
+
+bool CGovernanceVoteDB::ReadVote(const CGovernanceVoteKey& key, CGovernanceVote& voteRet)
+{
+    {
+        LOCK(cs);
+        if(mapMemoryVotes.Get(key.nVoteHash, voteRet)) {
+            // move it to the front, so the least recently used votes are dropped first
+            mapMemoryVotes.Erase(key.nVoteHash);
+            mapMemoryVotes.Insert(key.nVoteHash, voteRet);
+            return true;
+        }
+    }
+    if(!Read(std::make_pair(DB_GOVERNANCE_VOTE, key), voteRet)) {
+        return false;
+    }
+    LOCK(cs);
+    mapMemoryVotes.Insert(key.nVoteHash, voteRet);
+    return true;
+}
+
+bool CGovernanceVoteDB::HasVote(const CGovernanceVoteKey& key)
+{
+    {
+        LOCK(cs);
+        if(mapMemoryVotes.HasKey(key.nVoteHash)) {
+            return true;
+        }
+    }
+    return Exists(std::make_pair(DB_GOVERNANCE_VOTE, key));
+}
+
+template<typename K>
+bool CGovernanceVoteDB::ReadVotesWithPrefix(const K& prefix, const uint256& nParentHash, const COutPoint* poutpointMasternode,
+                                            std::vector<CGovernanceVote>* pvecVotesRet, std::vector<CGovernanceVoteKey>* pvecKeysRet)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(prefix);
+
+    while(pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CGovernanceVoteKey> key;
+        if(!pcursor->GetKey(key) || key.first != DB_GOVERNANCE_VOTE) {
+            break;
+        }
+        if(!nParentHash.IsNull() && key.second.nParentHash != nParentHash) {
+            break;
+        }
+        if(poutpointMasternode && key.second.outpointMasternode != *poutpointMasternode) {
+            break;
+        }
+        if(pvecVotesRet) {
+            CGovernanceVote vote;
+            if(!pcursor->GetValue(vote)) {
+                return error("CGovernanceVoteDB::ReadVotesWithPrefix -- failed to read vote %s", key.second.nVoteHash.ToString());
+            }
+            pvecVotesRet->push_back(vote);
+        }
+        if(pvecKeysRet) {
+            pvecKeysRet->push_back(key.second);
+        }
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+bool CGovernanceVoteDB::ReadVotes(const uint256& nParentHash, std::vector<CGovernanceVote>& vecVotesRet)
+{
+    return ReadVotesWithPrefix(std::make_pair(DB_GOVERNANCE_VOTE, nParentHash), nParentHash, NULL, &vecVotesRet, NULL);
+}
+
+bool CGovernanceVoteDB::ReadVotes(const uint256& nParentHash, const COutPoint& outpointMasternode, std::vector<CGovernanceVote>& vecVotesRet)
+{
+    return ReadVotesWithPrefix(std::make_pair(DB_GOVERNANCE_VOTE, std::make_pair(nParentHash, outpointMasternode)),
+                               nParentHash, &outpointMasternode, &vecVotesRet, NULL);
+}
+
+bool CGovernanceVoteDB::ReadAllKeys(std::vector<CGovernanceVoteKey>& vecKeysRet)
+{
+    return ReadVotesWithPrefix(DB_GOVERNANCE_VOTE, uint256(), NULL, NULL, &vecKeysRet);
+}
+
+bool CGovernanceVoteDB::EraseVotes(const uint256& nParentHash)
+{
+    std::vector<CGovernanceVoteKey> vecKeys;
+    if(!ReadVotesWithPrefix(std::make_pair(DB_GOVERNANCE_VOTE, nParentHash), nParentHash, NULL, NULL, &vecKeys)) {
+        return false;
+    }
+
+    CDBBatch batch(&GetObfuscateKey());
+    LOCK(cs);
+    for(size_t i = 0; i < vecKeys.size(); ++i) {
+        mapMemoryVotes.Erase(vecKeys[i].nVoteHash);
+        batch.Erase(std::make_pair(DB_GOVERNANCE_VOTE, vecKeys[i]));
+    }
+    return WriteBatch(batch);
+}
+
+bool CGovernanceVoteDB::EraseVotes(const uint256& nParentHash, const COutPoint& outpointMasternode)
+{
+    std::vector<CGovernanceVoteKey> vecKeys;
+    if(!ReadVotesWithPrefix(std::make_pair(DB_GOVERNANCE_VOTE, std::make_pair(nParentHash, outpointMasternode)),
+                            nParentHash, &outpointMasternode, NULL, &vecKeys)) {
+        return false;
+    }
+
+    CDBBatch batch(&GetObfuscateKey());
+    LOCK(cs);
+    for(size_t i = 0; i < vecKeys.size(); ++i) {
+        mapMemoryVotes.Erase(vecKeys[i].nVoteHash);
+        batch.Erase(std::make_pair(DB_GOVERNANCE_VOTE, vecKeys[i]));
+    }
+    return WriteBatch(batch);
+}
+
+int CGovernanceVoteDB::GetMemoryVoteCount() const
+{
+    LOCK(cs);
+    return (int)mapMemoryVotes.GetSize();
+}
+
+size_t CGovernanceVoteDB::GetMemoryUsage() const
+{
+    LOCK(cs);
+    typedef CacheMap<uint256, CGovernanceVote>::list_t list_t;
+    const list_t& listItems = mapMemoryVotes.GetItemList();
+    // a list node and a map node per vote, plus the signature
+    size_t nUsage = listItems.size() * (memusage::MallocUsage(sizeof(list_t::value_type) + 2 * sizeof(void*)) +
+                                        memusage::MallocUsage(sizeof(uint256) + 5 * sizeof(void*)));
+    for(list_t::const_iterator it = listItems.begin(); it != listItems.end(); ++it) {
+        nUsage += memusage::DynamicUsage(it->value.GetSignature());
+    }
+    return nUsage;
+}
+
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile()
-    : nMemoryVotes(0),
-      listVotes(),
+    : nParentHash(),
       mapVoteIndex()
 {}
 
-CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other)
-    : nMemoryVotes(other.nMemoryVotes),
-      listVotes(other.listVotes),
-      mapVoteIndex()
+void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote, const CKeyID& keyIDVerified)
 {
-    RebuildIndex();
+    nParentHash = vote.GetParentHash();
+    mapVoteIndex[vote.GetHash()] = vote_file_entry_t(vote.GetVinMasternode().prevout, keyIDVerified);
+    if(!pgovernancevotedb->WriteVote(vote)) {
+        LogPrintf("CGovernanceObjectVoteFile::AddVote -- failed to write vote %s\n", vote.GetHash().ToString());
+    }
 }
 
-void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
+void CGovernanceObjectVoteFile::AddVoteKey(const CGovernanceVoteKey& key)
 {
-    listVotes.push_front(vote);
-    mapVoteIndex[vote.GetHash()] = listVotes.begin();
-    ++nMemoryVotes;
+    nParentHash = key.nParentHash;
+    mapVoteIndex[key.nVoteHash] = vote_file_entry_t(key.outpointMasternode, CKeyID());
 }
 
 bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
 {
-    vote_m_cit it = mapVoteIndex.find(nHash);
-    if(it == mapVoteIndex.end()) {
-        return false;
-    }
-    return true;
+    return mapVoteIndex.count(nHash) > 0;
 }
 
 bool CGovernanceObjectVoteFile::GetVote(const uint256& nHash, CGovernanceVote& vote) const
@@ -41,57 +195,79 @@ bool CGovernanceObjectVoteFile::GetVote(const uint256& nHash, CGovernanceVote& v
     if(it == mapVoteIndex.end()) {
         return false;
     }
-    vote = *(it->second);
-    return true;
+    return pgovernancevotedb->ReadVote(CGovernanceVoteKey(nParentHash, it->second.outpointMasternode, nHash), vote);
+}
+
+void CGovernanceObjectVoteFile::SetVoteVerified(const uint256& nHash, const CKeyID& keyIDVerified)
+{
+    vote_m_it it = mapVoteIndex.find(nHash);
+    if(it != mapVoteIndex.end()) {
+        it->second.keyIDVerified = keyIDVerified;
+    }
 }
 
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 {
     std::vector<CGovernanceVote> vecResult;
-    for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
-        vecResult.push_back(*it);
+    if(mapVoteIndex.empty()) {
+        return vecResult;
+    }
+
+    std::vector<CGovernanceVote> vecStored;
+    pgovernancevotedb->ReadVotes(nParentHash, vecStored);
+    for(size_t i = 0; i < vecStored.size(); ++i) {
+        // the store may still hold votes of a masternode being removed
+        if(HasVote(vecStored[i].GetHash())) {
+            vecResult.push_back(vecStored[i]);
+        }
     }
     return vecResult;
 }
 
+std::vector<uint256> CGovernanceObjectVoteFile::GetVoteHashes() const
+{
+    std::vector<uint256> vecResult;
+    vecResult.reserve(mapVoteIndex.size());
+    for(vote_m_cit it = mapVoteIndex.begin(); it != mapVoteIndex.end(); ++it) {
+        vecResult.push_back(it->first);
+    }
+    return vecResult;
+}
+
+std::set<COutPoint> CGovernanceObjectVoteFile::GetMasternodeOutpoints() const
+{
+    std::set<COutPoint> setResult;
+    for(vote_m_cit it = mapVoteIndex.begin(); it != mapVoteIndex.end(); ++it) {
+        setResult.insert(it->second.outpointMasternode);
+    }
+    return setResult;
+}
+
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const CTxIn& vinMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        if(it->GetVinMasternode() == vinMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
+    vote_m_it it = mapVoteIndex.begin();
+    while(it != mapVoteIndex.end()) {
+        if(it->second.outpointMasternode == vinMasternode.prevout) {
+            mapVoteIndex.erase(it++);
         }
         else {
             ++it;
         }
     }
+    if(!nParentHash.IsNull()) {
+        pgovernancevotedb->EraseVotes(nParentHash, vinMasternode.prevout);
+    }
 }
 
-CGovernanceObjectVoteFile& CGovernanceObjectVoteFile::operator=(const CGovernanceObjectVoteFile& other)
+void CGovernanceObjectVoteFile::RemoveAllVotes()
 {
-    nMemoryVotes = other.nMemoryVotes;
-    listVotes = other.listVotes;
-    RebuildIndex();
-    return *this;
+    mapVoteIndex.clear();
+    if(!nParentHash.IsNull()) {
+        pgovernancevotedb->EraseVotes(nParentHash);
+    }
 }
 
-void CGovernanceObjectVoteFile::RebuildIndex()
+size_t CGovernanceObjectVoteFile::GetMemoryUsage() const
 {
-    mapVoteIndex.clear();
-    nMemoryVotes = 0;
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        CGovernanceVote& vote = *it;
-        uint256 nHash = vote.GetHash();
-        if(mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
-            mapVoteIndex[nHash] = it;
-            ++nMemoryVotes;
-            ++it;
-        }
-        else {
-            listVotes.erase(it++);
-        }
-    }
+    return memusage::DynamicUsage(mapVoteIndex);
 }
@@ -6,89 +6,204 @@
 #ifndef GOVERNANCE_VOTEDB_H
 #define GOVERNANCE_VOTEDB_H
 
-#include <list>
 #include <map>
+#include <set>
+#include <vector>
 
+#include "cachemap.h"
+#include "dbwrapper.h"
 #include "governance-vote.h"
 #include "serialize.h"
+#include "sync.h"
 #include "uint256.h"
 
+class CGovernanceVoteDB;
+
+/** Global store of all governance votes, see CGovernanceVoteDB */
+extern CGovernanceVoteDB *pgovernancevotedb;
+
+/** LevelDB cache of the vote store */
+static const size_t GOVERNANCE_VOTE_DB_CACHE = 4 << 20;
+
 /**
- * Represents the collection of votes associated with a given CGovernanceObject
- * Recently received votes are held in memory until a maximum size is reached after
- * which older votes a flushed to a disk file.
- *
- * Note: This is a stub implementation that doesn't limit the number of votes held
- * in memory and doesn't flush to disk.
+ * Database key of a vote. Votes of an object and of a masternode for an object
+ * are next to each other, so both are read with one seek.
  */
-class CGovernanceObjectVoteFile
+struct CGovernanceVoteKey
 {
-public: // Types
-    typedef std::list<CGovernanceVote> vote_l_t;
+    uint256 nParentHash;
+    COutPoint outpointMasternode;
+    uint256 nVoteHash;
 
-    typedef vote_l_t::iterator vote_l_it;
+    CGovernanceVoteKey() : nParentHash(), outpointMasternode(), nVoteHash() {}
 
-    typedef vote_l_t::const_iterator vote_l_cit;
+    CGovernanceVoteKey(const uint256& nParentHashIn, const COutPoint& outpointMasternodeIn, const uint256& nVoteHashIn)
+        : nParentHash(nParentHashIn),
+          outpointMasternode(outpointMasternodeIn),
+          nVoteHash(nVoteHashIn)
+    {}
 
-    typedef std::map<uint256,vote_l_it> vote_m_t;
+    explicit CGovernanceVoteKey(const CGovernanceVote& vote)
+        : nParentHash(vote.GetParentHash()),
+          outpointMasternode(vote.GetVinMasternode().prevout),
+          nVoteHash(vote.GetHash())
+    {}
 
-    typedef vote_m_t::iterator vote_m_it;
+    ADD_SERIALIZE_METHODS;
 
-    typedef vote_m_t::const_iterator vote_m_cit;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(nParentHash);
+        READWRITE(outpointMasternode);
+        READWRITE(nVoteHash);
+    }
+};
 
+/**
+ * Governance votes on disk, keyed by object hash and masternode outpoint.
+ * The most recently written or read votes are also kept in memory.
+ */
+class CGovernanceVoteDB : public CDBWrapper
+{
 private:
-    static const int MAX_MEMORY_VOTES = -1;
+    /// Votes kept in memory, the least recently used are dropped first
+    static const int MAX_MEMORY_VOTES = 10000;
+
+    mutable CCriticalSection cs;
+
+    CacheMap<uint256, CGovernanceVote> mapMemoryVotes;
+
+    CGovernanceVoteDB(const CGovernanceVoteDB&);
+    void operator=(const CGovernanceVoteDB&);
 
-    int nMemoryVotes;
+public:
+    CGovernanceVoteDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool WriteVote(const CGovernanceVote& vote);
+
+    bool ReadVote(const CGovernanceVoteKey& key, CGovernanceVote& voteRet);
+
+    bool HasVote(const CGovernanceVoteKey& key);
+
+    /**
+     * Read all votes for an object, or only the ones of one masternode
+     */
+    bool ReadVotes(const uint256& nParentHash, std::vector<CGovernanceVote>& vecVotesRet);
+    bool ReadVotes(const uint256& nParentHash, const COutPoint& outpointMasternode, std::vector<CGovernanceVote>& vecVotesRet);
 
-    vote_l_t listVotes;
+    /**
+     * Erase all votes for an object, or only the ones of one masternode
+     */
+    bool EraseVotes(const uint256& nParentHash);
+    bool EraseVotes(const uint256& nParentHash, const COutPoint& outpointMasternode);
+
+    /**
+     * Keys of all votes, to index them after loading the governance objects
+     */
+    bool ReadAllKeys(std::vector<CGovernanceVoteKey>& vecKeysRet);
+
+    int GetMemoryVoteCount() const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    template<typename K>
+    bool ReadVotesWithPrefix(const K& prefix, const uint256& nParentHash, const COutPoint* poutpointMasternode,
+                             std::vector<CGovernanceVote>* pvecVotesRet, std::vector<CGovernanceVoteKey>* pvecKeysRet);
+};
+
+/**
+ * Index entry of a vote in CGovernanceObjectVoteFile
+ */
+struct vote_file_entry_t
+{
+    COutPoint outpointMasternode;
+
+    /// Masternode key the signature was verified with, null if it wasn't verified since loading
+    CKeyID keyIDVerified;
+
+    vote_file_entry_t() : outpointMasternode(), keyIDVerified() {}
+
+    vote_file_entry_t(const COutPoint& outpointMasternodeIn, const CKeyID& keyIDVerifiedIn)
+        : outpointMasternode(outpointMasternodeIn),
+          keyIDVerified(keyIDVerifiedIn)
+    {}
+};
+
+/**
+ * Represents the collection of votes associated with a given CGovernanceObject.
+ * The votes themselves are in pgovernancevotedb, only which ones belong to the
+ * object is held here, along with whether they were verified.
+ */
+class CGovernanceObjectVoteFile
+{
+public: // Types
+    typedef std::map<uint256, vote_file_entry_t> vote_m_t;
+
+    typedef vote_m_t::iterator vote_m_it;
+
+    typedef vote_m_t::const_iterator vote_m_cit;
+
+private:
+    uint256 nParentHash;
 
     vote_m_t mapVoteIndex;
 
 public:
     CGovernanceObjectVoteFile();
 
-    CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other);
+    /**
+     * Add a vote to the file, keyIDVerified is the key its signature was verified with
+     */
+    void AddVote(const CGovernanceVote& vote, const CKeyID& keyIDVerified = CKeyID());
 
     /**
-     * Add a vote to the file
+     * Add a vote that is already in the store to the index
      */
-    void AddVote(const CGovernanceVote& vote);
+    void AddVoteKey(const CGovernanceVoteKey& key);
 
     /**
-     * Return true if the vote with this hash is currently cached in memory
+     * Return true if the vote with this hash belongs to the object
      */
     bool HasVote(const uint256& nHash) const;
 
     /**
-     * Retrieve a vote cached in memory
+     * Retrieve a vote from memory or disk
      */
     bool GetVote(const uint256& nHash, CGovernanceVote& vote) const;
 
-    int GetVoteCount() {
-        return nMemoryVotes;
+    /**
+     * Remember that the signature of a vote was verified with this masternode key
+     */
+    void SetVoteVerified(const uint256& nHash, const CKeyID& keyIDVerified);
+
+    const uint256& GetParentHash() const {
+        return nParentHash;
+    }
+
+    const vote_m_t& GetVoteIndex() const {
+        return mapVoteIndex;
+    }
+
+    int GetVoteCount() const {
+        return (int)mapVoteIndex.size();
     }
 
     std::vector<CGovernanceVote> GetVotes() const;
 
-    CGovernanceObjectVoteFile& operator=(const CGovernanceObjectVoteFile& other);
+    std::vector<uint256> GetVoteHashes() const;
 
-    void RemoveVotesFromMasternode(const CTxIn& vinMasternode);
+    std::set<COutPoint> GetMasternodeOutpoints() const;
 
-    ADD_SERIALIZE_METHODS;
+    void RemoveVotesFromMasternode(const CTxIn& vinMasternode);
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
-    {
-        READWRITE(nMemoryVotes);
-        READWRITE(listVotes);
-        if(ser_action.ForRead()) {
-            RebuildIndex();
-        }
-    }
-private:
-    void RebuildIndex();
+    /**
+     * Remove all votes from the store when the object is deleted
+     */
+    void RemoveAllVotes();
 
+    size_t GetMemoryUsage() const;
 };
 
 #endif
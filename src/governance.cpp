@@ -19,7 +19,7 @@ CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-11";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-13";
 
 CGovernanceManager::CGovernanceManager()
     : pCurrentBlockIndex(NULL),
@@ -35,6 +35,8 @@ CGovernanceManager::CGovernanceManager()
       mapInvalidVotes(MAX_CACHE_SIZE),
       mapOrphanVotes(MAX_CACHE_SIZE),
       mapLastMasternodeObject(),
+      mapErasedTime(),
+      nErasedHistoryStart(GetAdjustedTime()),
       setRequestedObjects(),
       fRateChecksEnabled(true),
       cs()
@@ -100,6 +102,7 @@ void CGovernanceManager::AddSeenGovernanceObject(uint256 nHash, int status)
 {
     LOCK(cs);
     mapSeenGovernanceObjects[nHash] = status;
+    journal.Add(GOVERNANCE_JOURNAL_SEEN, std::make_pair(nHash, status));
 }
 
 void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
@@ -169,7 +172,10 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
         uint256 nHash = govobj.GetHash();
         std::string strHash = nHash.ToString();
 
-        pfrom->setAskFor.erase(nHash);
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(nHash);
+        }
 
         LogPrint("gobject", "MNGOVERNANCEOBJECT -- Received object: %s\n", strHash);
 
@@ -204,7 +210,9 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
             // fIsValid must also be false here so we will return early in the next if block
         }
         if(!fIsValid) {
-            mapSeenGovernanceObjects.insert(std::make_pair(nHash, SEEN_OBJECT_ERROR_INVALID));
+            if(mapSeenGovernanceObjects.insert(std::make_pair(nHash, SEEN_OBJECT_ERROR_INVALID)).second) {
+                journal.Add(GOVERNANCE_JOURNAL_SEEN, std::make_pair(nHash, (int)SEEN_OBJECT_ERROR_INVALID));
+            }
             LogPrintf("MNGOVERNANCEOBJECT -- Governance object is invalid - %s\n", strError);
             return;
         }
@@ -229,7 +237,9 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
 
         if(fAddToSeen) {
             // UPDATE THAT WE'VE SEEN THIS OBJECT
-            mapSeenGovernanceObjects.insert(std::make_pair(nHash, SEEN_OBJECT_IS_VALID));
+            if(mapSeenGovernanceObjects.insert(std::make_pair(nHash, SEEN_OBJECT_IS_VALID)).second) {
+                journal.Add(GOVERNANCE_JOURNAL_SEEN, std::make_pair(nHash, (int)SEEN_OBJECT_IS_VALID));
+            }
             // Update the rate buffer
             MasternodeRateCheck(govobj, UPDATE_TRUE, true, fRateCheckBypassed);
         }
@@ -260,7 +270,10 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, std::string& strCommand, C
         uint256 nHash = vote.GetHash();
         std::string strHash = nHash.ToString();
 
-        pfrom->setAskFor.erase(nHash);
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(nHash);
+        }
 
         if(!AcceptVoteMessage(nHash)) {
             LogPrint("gobject", "MNGOVERNANCEOBJECTVOTE -- Received unrequested vote object: %s, hash: %s, peer = %d\n",
@@ -361,7 +374,9 @@ bool CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, bool& fA
     }
 
     // INSERT INTO OUR GOVERNANCE OBJECT MEMORY
+    govobj.nTimeLastChanged = GetAdjustedTime();
     mapObjects.insert(std::make_pair(nHash, govobj));
+    journal.Add(GOVERNANCE_JOURNAL_OBJECT, govobj);
 
     // SHOULD WE ADD THIS OBJECT TO ANY OTHER MANANGERS?
 
@@ -412,6 +427,7 @@ bool CGovernanceManager::UpdateCurrentWatchdog(CGovernanceObject& watchdogNew)
             if(it->second.nDeletionTime == 0) {
                 it->second.nDeletionTime = nNow;
             }
+            JournalObjectState(it->second);
         }
         nHashWatchdogCurrent = watchdogNew.GetHash();
         nTimeWatchdogCurrent = watchdogNew.GetCreationTime();
@@ -447,6 +463,7 @@ void CGovernanceManager::UpdateCachesAndClean()
                     if(it2->second.nDeletionTime == 0) {
                         it2->second.nDeletionTime = nNow;
                     }
+                    JournalObjectState(it2->second);
                 }
                 if(it->first == nHashWatchdogCurrent) {
                     nHashWatchdogCurrent = uint256();
@@ -501,7 +518,11 @@ void CGovernanceManager::UpdateCachesAndClean()
             pObj->UpdateLocalValidity();
 
             // UPDATE SENTINEL SIGNALING VARIABLES
+            int64_t nDeletionTimePrev = pObj->GetDeletionTime();
             pObj->UpdateSentinelVariables();
+            if(pObj->GetDeletionTime() != nDeletionTimePrev) {
+                JournalObjectState(*pObj);
+            }
         }
 
         if(pObj->IsSetCachedDelete() && (nHash == nHashWatchdogCurrent)) {
@@ -536,12 +557,27 @@ void CGovernanceManager::UpdateCachesAndClean()
             if(pObj->nObjectType == GOVERNANCE_OBJECT_WATCHDOG) {
                 mapWatchdogObjects.erase(it->first);
             }
+            pObj->GetVoteFile().RemoveAllVotes();
+            journal.Add(GOVERNANCE_JOURNAL_ERASE, it->first);
+            mapErasedTime[it->first] = GetAdjustedTime();
             mapObjects.erase(it++);
         } else {
             ++it;
         }
     }
 
+    // forget erasures no delta query is expected to ask for anymore
+    nErasedHistoryStart = std::max(nErasedHistoryStart, nNow - ERASED_HISTORY_SECONDS);
+    hash_time_m_it itErased = mapErasedTime.begin();
+    while(itErased != mapErasedTime.end()) {
+        if(itErased->second < nNow - ERASED_HISTORY_SECONDS) {
+            mapErasedTime.erase(itErased++);
+        }
+        else {
+            ++itErased;
+        }
+    }
+
     fRateChecksEnabled = true;
 }
 
@@ -579,13 +615,14 @@ std::vector<CGovernanceVote> CGovernanceManager::GetCurrentVotes(const uint256&
     if(it == mapObjects.end()) return vecResult;
     CGovernanceObject& govobj = it->second;
 
-    // Compile a list of Masternode collateral outpoints for which to get votes
+    // Compile a list of Masternode collateral outpoints for which to get votes,
+    // only the masternodes that voted on this object can have current votes
     std::vector<CTxIn> vecMNTxIn;
     if (mnCollateralOutpointFilter == CTxIn()) {
-        std::vector<CMasternode> mnlist = mnodeman.GetFullMasternodeVector();
-        for (std::vector<CMasternode>::iterator it = mnlist.begin(); it != mnlist.end(); ++it)
+        std::set<COutPoint> setVoters = govobj.GetVoteFile().GetMasternodeOutpoints();
+        for (std::set<COutPoint>::iterator it = setVoters.begin(); it != setVoters.end(); ++it)
         {
-            vecMNTxIn.push_back(it->vin);
+            vecMNTxIn.push_back(CTxIn(*it));
         }
     }
     else {
@@ -616,6 +653,20 @@ std::vector<CGovernanceVote> CGovernanceManager::GetCurrentVotes(const uint256&
     return vecResult;
 }
 
+bool CGovernanceManager::GetObjectsErasedSince(int64_t nTime, std::vector<uint256>& vecErased)
+{
+    LOCK(cs);
+
+    if(nTime < nErasedHistoryStart) return false;
+
+    for(hash_time_m_it it = mapErasedTime.begin(); it != mapErasedTime.end(); ++it) {
+        if(it->second >= nTime) {
+            vecErased.push_back(it->first);
+        }
+    }
+    return true;
+}
+
 std::vector<CGovernanceObject*> CGovernanceManager::GetAllNewerThan(int64_t nMoreThanTime)
 {
     LOCK(cs);
@@ -753,8 +804,11 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
 
     LogPrint("gobject", "CGovernanceManager::Sync -- syncing to peer=%d, nProp = %s\n", pfrom->id, nProp.ToString());
 
+    // votes the peer doesn't have yet, with their index entries
+    std::vector<std::pair<uint256, vote_file_entry_t> > vecVoteEntries;
+
     {
-        LOCK2(cs_main, cs);
+        LOCK(cs);
 
         if(nProp == uint256()) {
             // all valid objects, no votes
@@ -798,16 +852,64 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
             pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
             ++nObjCount;
 
-            std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                if(!vecVotes[i].IsValid(true)) {
-                    continue;
-                }
-                if(filter.contains(vecVotes[i].GetHash())) {
-                    continue;
+            const CGovernanceObjectVoteFile::vote_m_t& mapVoteIndex = govobj.GetVoteFile().GetVoteIndex();
+            for(CGovernanceObjectVoteFile::vote_m_cit it2 = mapVoteIndex.begin(); it2 != mapVoteIndex.end(); ++it2) {
+                if(!filter.contains(it2->first)) {
+                    vecVoteEntries.push_back(*it2);
                 }
-                pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, vecVotes[i].GetHash()));
-                ++nVoteCount;
+            }
+        }
+    }
+
+    // Votes were verified when we accepted them, only ones loaded from disk or
+    // from a masternode which changed its key since need their signature checked
+    std::map<COutPoint, CKeyID> mapMasternodeKeys;
+    std::vector<CGovernanceVote> vecVotesToVerify;
+    for(size_t i = 0; i < vecVoteEntries.size(); ++i) {
+        const uint256& nVoteHash = vecVoteEntries[i].first;
+        const vote_file_entry_t& entry = vecVoteEntries[i].second;
+
+        std::map<COutPoint, CKeyID>::iterator itKey = mapMasternodeKeys.find(entry.outpointMasternode);
+        if(itKey == mapMasternodeKeys.end()) {
+            masternode_info_t infoMn = mnodeman.GetMasternodeInfo(CTxIn(entry.outpointMasternode));
+            CKeyID keyID = infoMn.fInfoValid ? infoMn.pubKeyMasternode.GetID() : CKeyID();
+            itKey = mapMasternodeKeys.insert(std::make_pair(entry.outpointMasternode, keyID)).first;
+        }
+        // unknown masternode
+        if(itKey->second.IsNull()) continue;
+
+        if(entry.keyIDVerified == itKey->second) {
+            pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, nVoteHash));
+            ++nVoteCount;
+            continue;
+        }
+
+        CGovernanceVote vote;
+        if(pgovernancevotedb->ReadVote(CGovernanceVoteKey(nProp, entry.outpointMasternode, nVoteHash), vote)) {
+            vecVotesToVerify.push_back(vote);
+        }
+    }
+
+    if(!vecVotesToVerify.empty()) {
+        // verify all signatures at once, IsValid() below hits the signature cache
+        CGovernanceVote::VerifySignatureBatch(vecVotesToVerify);
+        std::vector<std::pair<uint256, CKeyID> > vecVerified;
+        for(size_t i = 0; i < vecVotesToVerify.size(); ++i) {
+            CKeyID keyIDVerified;
+            if(!vecVotesToVerify[i].IsValid(true, &keyIDVerified)) {
+                continue;
+            }
+            pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, vecVotesToVerify[i].GetHash()));
+            ++nVoteCount;
+            vecVerified.push_back(std::make_pair(vecVotesToVerify[i].GetHash(), keyIDVerified));
+        }
+
+        // so the next peer asking for these is served without signature checks
+        LOCK(cs);
+        object_m_it it = mapObjects.find(nProp);
+        if(it != mapObjects.end()) {
+            for(size_t i = 0; i < vecVerified.size(); ++i) {
+                it->second.GetVoteFile().SetVoteVerified(vecVerified[i].first, vecVerified[i].second);
             }
         }
     }
@@ -863,6 +965,7 @@ bool CGovernanceManager::MasternodeRateCheck(const CGovernanceObject& govobj, up
             default:
                 break;
             }
+            journal.Add(GOVERNANCE_JOURNAL_RATE, *it);
         }
         return true;
     }
@@ -920,11 +1023,13 @@ bool CGovernanceManager::MasternodeRateCheck(const CGovernanceObject& govobj, up
     case UPDATE_TRUE:
         pBuffer->AddTimestamp(nTimestamp);
         it->second.fStatusOK = fRateOK;
+        journal.Add(GOVERNANCE_JOURNAL_RATE, *it);
         break;
     case UPDATE_FAIL_ONLY:
         if(!fRateOK) {
             pBuffer->AddTimestamp(nTimestamp);
             it->second.fStatusOK = false;
+            journal.Add(GOVERNANCE_JOURNAL_RATE, *it);
         }
     default:
         return true;
@@ -1063,9 +1168,9 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
 
         if(pObj) {
             filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
-            std::vector<CGovernanceVote> vecVotes = pObj->GetVoteFile().GetVotes();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                filter.insert(vecVotes[i].GetHash());
+            std::vector<uint256> vecVoteHashes = pObj->GetVoteFile().GetVoteHashes();
+            for(size_t i = 0; i < vecVoteHashes.size(); ++i) {
+                filter.insert(vecVoteHashes[i]);
             }
         }
     }
@@ -1212,9 +1317,9 @@ void CGovernanceManager::RebuildIndexes()
     mapVoteToObject.Clear();
     for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
         CGovernanceObject& govobj = it->second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for(size_t i = 0; i < vecVotes.size(); ++i) {
-            mapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
+        std::vector<uint256> vecVoteHashes = govobj.GetVoteFile().GetVoteHashes();
+        for(size_t i = 0; i < vecVoteHashes.size(); ++i) {
+            mapVoteToObject.Insert(vecVoteHashes[i], &govobj);
         }
     }
 }
@@ -1257,11 +1362,147 @@ void CGovernanceManager::AddCachedTriggers()
     }
 }
 
+void CGovernanceManager::JournalObjectState(const CGovernanceObject& govobj)
+{
+    AssertLockHeld(cs);
+    journal.Add(GOVERNANCE_JOURNAL_STATE, std::make_pair(govobj.GetHash(), std::make_pair(govobj.nDeletionTime, govobj.fExpired)));
+}
+
+void CGovernanceManager::ApplyJournalRecord(const CFlatDBJournalRecord& record)
+{
+    LOCK(cs);
+    CDataStream ss(record.vchData, SER_DISK, CLIENT_VERSION);
+
+    switch(record.nType) {
+    case GOVERNANCE_JOURNAL_OBJECT: {
+        CGovernanceObject govobj;
+        ss >> govobj;
+        uint256 nHash = govobj.GetHash();
+        if(mapObjects.count(nHash)) break;
+        if(govobj.nObjectType == GOVERNANCE_OBJECT_WATCHDOG) {
+            mapWatchdogObjects[nHash] = govobj.GetCreationTime() + GOVERNANCE_WATCHDOG_EXPIRATION_TIME;
+        }
+        mapObjects.insert(std::make_pair(nHash, govobj));
+        break;
+    }
+    case GOVERNANCE_JOURNAL_VOTE: {
+        CGovernanceVote vote;
+        ss >> vote;
+        object_m_it it = mapObjects.find(vote.GetParentHash());
+        if(it != mapObjects.end()) {
+            // the vote went to the store when it was accepted, unless writing it failed
+            it->second.RestoreVote(vote, pgovernancevotedb->HasVote(CGovernanceVoteKey(vote)));
+        }
+        break;
+    }
+    case GOVERNANCE_JOURNAL_STATE: {
+        std::pair<uint256, std::pair<int64_t, bool> > state;
+        ss >> state;
+        object_m_it it = mapObjects.find(state.first);
+        if(it != mapObjects.end()) {
+            it->second.nDeletionTime = state.second.first;
+            it->second.fExpired = state.second.second;
+        }
+        break;
+    }
+    case GOVERNANCE_JOURNAL_SEEN: {
+        std::pair<uint256, int> seen;
+        ss >> seen;
+        mapSeenGovernanceObjects[seen.first] = seen.second;
+        break;
+    }
+    case GOVERNANCE_JOURNAL_RATE: {
+        std::pair<COutPoint, last_object_rec> rate;
+        ss >> rate;
+        mapLastMasternodeObject[rate.first] = rate.second;
+        break;
+    }
+    case GOVERNANCE_JOURNAL_ERASE: {
+        uint256 nHash;
+        ss >> nHash;
+        mapWatchdogObjects.erase(nHash);
+        if(mapObjects.erase(nHash)) {
+            // the erase time itself wasn't journaled, replaying is the latest it can have happened
+            mapErasedTime[nHash] = GetAdjustedTime();
+        }
+        break;
+    }
+    default:
+        LogPrintf("CGovernanceManager::ApplyJournalRecord -- unknown record type %d\n", record.nType);
+        break;
+    }
+}
+
+void CGovernanceManager::LoadVotes()
+{
+    std::vector<CGovernanceVoteKey> vecKeys;
+    if(!pgovernancevotedb->ReadAllKeys(vecKeys)) {
+        LogPrintf("CGovernanceManager::LoadVotes -- failed to read the vote store\n");
+        return;
+    }
+
+    // Votes are written to the store as they are accepted, governance.dat and its journal
+    // later. The keys are indexed as they are, only the votes of masternodes the loaded
+    // current votes don't account for at all (e.g. after a crash) are read and applied.
+    // Votes of objects deleted while governance.dat wasn't written yet are dropped.
+    std::set<uint256> setOrphanedParents;
+    std::set<std::pair<uint256, COutPoint> > setUnappliedVoters;
+    for(size_t i = 0; i < vecKeys.size(); ++i) {
+        const CGovernanceVoteKey& key = vecKeys[i];
+        object_m_it it = mapObjects.find(key.nParentHash);
+        if(it == mapObjects.end()) {
+            setOrphanedParents.insert(key.nParentHash);
+            continue;
+        }
+        CGovernanceObject& govobj = it->second;
+        if(govobj.GetVoteFile().HasVote(key.nVoteHash)) continue;
+        int nMNIndex = GetMasternodeIndex(CTxIn(key.outpointMasternode));
+        if(nMNIndex >= 0 && !govobj.mapCurrentMNVotes.count(nMNIndex)) {
+            setUnappliedVoters.insert(std::make_pair(key.nParentHash, key.outpointMasternode));
+            continue;
+        }
+        govobj.GetVoteFile().AddVoteKey(key);
+    }
+    BOOST_FOREACH(const uint256& nParentHash, setOrphanedParents) {
+        pgovernancevotedb->EraseVotes(nParentHash);
+    }
+
+    int nApplied = 0;
+    std::set<std::pair<uint256, COutPoint> >::iterator it = setUnappliedVoters.begin();
+    for(; it != setUnappliedVoters.end(); ++it) {
+        std::vector<CGovernanceVote> vecVotes;
+        if(!pgovernancevotedb->ReadVotes(it->first, it->second, vecVotes)) {
+            LogPrintf("CGovernanceManager::LoadVotes -- failed to read the votes of %s for %s\n",
+                      it->second.ToStringShort(), it->first.ToString());
+            continue;
+        }
+        CGovernanceObject& govobj = mapObjects.find(it->first)->second;
+        for(size_t i = 0; i < vecVotes.size(); ++i) {
+            if(govobj.GetVoteFile().HasVote(vecVotes[i].GetHash())) continue;
+            govobj.RestoreVote(vecVotes[i], true);
+            ++nApplied;
+        }
+    }
+    LogPrintf("CGovernanceManager::LoadVotes -- %d votes, %d applied from the store, removed the votes of %d deleted objects\n",
+              vecKeys.size(), nApplied, setOrphanedParents.size());
+}
+
+size_t CGovernanceManager::GetVoteMemoryUsage() const
+{
+    LOCK(cs);
+    size_t nUsage = pgovernancevotedb->GetMemoryUsage();
+    for(object_m_cit it = mapObjects.begin(); it != mapObjects.end(); ++it) {
+        nUsage += it->second.GetVoteFile().GetMemoryUsage();
+    }
+    return nUsage;
+}
+
 void CGovernanceManager::InitOnLoad()
 {
     LOCK(cs);
     int64_t nStart = GetTimeMillis();
     LogPrintf("Preparing masternode indexes and governance triggers...\n");
+    LoadVotes();
     RebuildIndexes();
     AddCachedTriggers();
     LogPrintf("Masternode indexes and governance triggers prepared  %dms\n", GetTimeMillis() - nStart);
@@ -12,6 +12,7 @@
 #include "cachemap.h"
 #include "cachemultimap.h"
 #include "chain.h"
+#include "flat-database.h"
 #include "governance-exceptions.h"
 #include "governance-object.h"
 #include "governance-vote.h"
@@ -141,6 +142,16 @@ enum update_mode_enum_t {
     UPDATE_FAIL_ONLY
 };
 
+/// Types of the records CGovernanceManager adds to its journal
+enum governance_journal_enum_t {
+    GOVERNANCE_JOURNAL_OBJECT = 1,
+    GOVERNANCE_JOURNAL_VOTE   = 2,
+    GOVERNANCE_JOURNAL_ERASE  = 3,
+    GOVERNANCE_JOURNAL_STATE  = 4, // deletion time and expiry of an object
+    GOVERNANCE_JOURNAL_SEEN   = 5, // mapSeenGovernanceObjects entry
+    GOVERNANCE_JOURNAL_RATE   = 6  // mapLastMasternodeObject entry
+};
+
 //
 // Governance Manager : Contains all proposals for the budget
 //
@@ -225,6 +236,9 @@ public: // Types
 private:
     static const int MAX_CACHE_SIZE = 1000000;
 
+    /// How long erased objects are remembered for delta queries
+    static const int ERASED_HISTORY_SECONDS = 24 * 60 * 60;
+
     static const std::string SERIALIZATION_VERSION_STRING;
 
     // Keep track of current block index
@@ -254,12 +268,22 @@ private:
 
     txout_m_t mapLastMasternodeObject;
 
+    /// Objects erased within the last ERASED_HISTORY_SECONDS and when, local adjusted time
+    hash_time_m_t mapErasedTime;
+
+    /// mapErasedTime holds every erasure since this time. It is not saved, so a
+    /// restart makes clients resync even though governance.dat keeps the erasures
+    int64_t nErasedHistoryStart;
+
     hash_s_t setRequestedObjects;
 
     hash_s_t setRequestedVotes;
 
     bool fRateChecksEnabled;
 
+    /// Objects, votes and erasures since the last dump, see CJournaledFlatDB
+    CFlatDBJournal journal;
+
 public:
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -294,6 +318,11 @@ public:
     std::vector<CGovernanceVote> GetCurrentVotes(const uint256& nParentHash, const CTxIn& mnCollateralOutpointFilter);
     std::vector<CGovernanceObject*> GetAllNewerThan(int64_t nMoreThanTime);
 
+    /// Hashes of objects erased at or after nTime. Returns false, with vecErased left
+    /// empty, if erasures from before nTime have been forgotten (after
+    /// ERASED_HISTORY_SECONDS or a restart); the caller then has to resync all objects.
+    bool GetObjectsErasedSince(int64_t nTime, std::vector<uint256>& vecErased);
+
     bool IsBudgetPaymentBlock(int nBlockHeight);
     bool AddGovernanceObject(CGovernanceObject& govobj, bool& fAddToSeen, CNode* pfrom = NULL);
 
@@ -317,6 +346,8 @@ public:
         mapInvalidVotes.Clear();
         mapOrphanVotes.Clear();
         mapLastMasternodeObject.clear();
+        mapErasedTime.clear();
+        nErasedHistoryStart = GetAdjustedTime();
     }
 
     std::string ToString() const;
@@ -342,6 +373,7 @@ public:
         READWRITE(nHashWatchdogCurrent);
         READWRITE(nTimeWatchdogCurrent);
         READWRITE(mapLastMasternodeObject);
+        READWRITE(mapErasedTime);
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
             return;
@@ -361,6 +393,9 @@ public:
 
     int GetVoteCount() const;
 
+    /// Memory held by the vote indexes and the votes cached by pgovernancevotedb
+    size_t GetVoteMemoryUsage() const;
+
     bool SerializeObjectForHash(uint256 nHash, CDataStream& ss);
 
     bool SerializeVoteForHash(uint256 nHash, CDataStream& ss);
@@ -392,6 +427,15 @@ public:
 
     void InitOnLoad();
 
+    bool TakeJournal(std::vector<CFlatDBJournalRecord>& vecRecordsRet) { return journal.Take(vecRecordsRet); }
+
+    void RestoreJournal(std::vector<CFlatDBJournalRecord>& vecRecords, bool fComplete) { journal.Restore(vecRecords, fComplete); }
+
+    /// Journal the deletion time and expiry of an object after they were changed
+    void JournalObjectState(const CGovernanceObject& govobj);
+
+    void ApplyJournalRecord(const CFlatDBJournalRecord& record);
+
     int RequestGovernanceObjectVotes(CNode* pnode);
     int RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy);
 
@@ -420,6 +464,9 @@ private:
 
     void CheckOrphanVotes(CGovernanceObject& govobj, CGovernanceException& exception);
 
+    /// Index the votes in pgovernancevotedb by object after loading governance.dat
+    void LoadVotes();
+
     void RebuildIndexes();
 
     /// Returns MN index, handling the case of index rebuilds
@@ -140,6 +140,54 @@ static bool RPCAuthorized(const std::string& strAuth)
     return multiUserAuthorized(strUserPass);
 }
 
+/** Size of the pieces a JSON-RPC reply is handed to the HTTP server in */
+static const size_t JSONRPC_REPLY_PART_SIZE = 64 * 1024;
+
+/** Serialize val like UniValue::write() does, passing full parts on to req */
+static void JSONRPCWriteValue(HTTPRequest* req, const UniValue& val, std::string& strPart)
+{
+    if (val.isArray()) {
+        strPart += "[";
+        for (unsigned int i = 0; i < val.size(); i++) {
+            if (i > 0)
+                strPart += ",";
+            JSONRPCWriteValue(req, val[i], strPart);
+        }
+        strPart += "]";
+    } else if (val.isObject()) {
+        std::vector<std::string> keys = val.getKeys();
+        strPart += "{";
+        for (unsigned int i = 0; i < keys.size(); i++) {
+            if (i > 0)
+                strPart += ",";
+            strPart += UniValue(keys[i]).write() + ":";
+            JSONRPCWriteValue(req, val[i], strPart);
+        }
+        strPart += "}";
+    } else {
+        strPart += val.write();
+    }
+
+    if (strPart.size() >= JSONRPC_REPLY_PART_SIZE) {
+        req->WriteReplyPart(strPart);
+        strPart.clear();
+    }
+}
+
+/**
+ * Send the reply to a single request. The result is written element by element,
+ * so long address histories and the like never exist as one string next to the
+ * UniValue they were built from. The output is identical to JSONRPCReply().
+ */
+static void JSONRPCWriteReply(HTTPRequest* req, const UniValue& result, const UniValue& id)
+{
+    std::string strPart = "{\"result\":";
+    JSONRPCWriteValue(req, result, strPart);
+    strPart += ",\"error\":null,\"id\":" + id.write() + "}\n";
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteReply(HTTP_OK, strPart);
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -183,7 +231,8 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            JSONRPCWriteReply(req, result, jreq.id);
+            return true;
 
         // array of requests
         } else if (valRequest.isArray())
@@ -221,13 +270,46 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+/** How much of a request body is looked at to find the method it calls */
+static const size_t JSONRPC_METHOD_PEEK_SIZE = 1024;
+
+/**
+ * Queue calls by the cost marked in the RPC table. Only the start of the body is
+ * scanned for the method name; batches and requests whose method is not found
+ * there go to the expensive lane.
+ */
+static HTTPWorkLane JSONRPCRequestLane(HTTPRequest* req, const std::string &)
+{
+    std::string strBody = req->PeekBody(JSONRPC_METHOD_PEEK_SIZE);
+    size_t pos = strBody.find_first_not_of(" \t\r\n");
+    if (pos == std::string::npos || strBody[pos] == '[')
+        return HTTP_LANE_EXPENSIVE;
+    pos = strBody.find("\"method\"");
+    if (pos == std::string::npos)
+        return HTTP_LANE_EXPENSIVE;
+    pos = strBody.find_first_not_of(" \t\r\n", pos + 8);
+    if (pos == std::string::npos || strBody[pos] != ':')
+        return HTTP_LANE_EXPENSIVE;
+    pos = strBody.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos || strBody[pos] != '"')
+        return HTTP_LANE_EXPENSIVE;
+    size_t end = strBody.find('"', pos + 1);
+    if (end == std::string::npos)
+        return HTTP_LANE_EXPENSIVE;
+
+    const CRPCCommand* pcmd = tableRPC[strBody.substr(pos + 1, end - pos - 1)];
+    if (pcmd && !pcmd->expensive)
+        return HTTP_LANE_CHEAP;
+    return HTTP_LANE_EXPENSIVE;
+}
+
 bool StartHTTPRPC()
 {
     LogPrint("rpc", "Starting HTTP RPC server\n");
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, HTTP_LANE_EXPENSIVE, JSONRPCRequestLane);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
@@ -61,18 +61,24 @@ private:
     HTTPRequestHandler func;
 };
 
-/** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+/** Work queue for distributing work over multiple threads, in lanes of
+ * different priority. Work items are simply callable objects.
  */
 template <typename WorkItem>
 class WorkQueue
 {
 private:
+    struct QueuedItem
+    {
+        WorkItem* item;
+        int64_t nTimeQueued;
+    };
+
     /** Mutex protects entire object */
     CWaitableCriticalSection cs;
     CConditionVariable cond;
-    /* XXX in C++11 we can use std::unique_ptr here and avoid manual cleanup */
-    std::deque<WorkItem*> queue;
+    std::deque<QueuedItem> queue[HTTP_LANE_COUNT];
+    HTTPWorkLaneStats stats[HTTP_LANE_COUNT];
     bool running;
     size_t maxDepth;
     int numThreads;
@@ -95,30 +101,54 @@ private:
         }
     };
 
+    /** Expensive items that may run at once, leaving a thread for cheap ones */
+    int MaxExpensiveRunning() const
+    {
+        return std::max(numThreads - 1, 1);
+    }
+
+    /** Lane a worker may claim an item from, or HTTP_LANE_COUNT if none. Requires cs. */
+    HTTPWorkLane ClaimableLane() const
+    {
+        if (!queue[HTTP_LANE_CHEAP].empty())
+            return HTTP_LANE_CHEAP;
+        if (!queue[HTTP_LANE_EXPENSIVE].empty() && stats[HTTP_LANE_EXPENSIVE].nRunning < MaxExpensiveRunning())
+            return HTTP_LANE_EXPENSIVE;
+        return HTTP_LANE_COUNT;
+    }
+
 public:
     WorkQueue(size_t maxDepth) : running(true),
                                  maxDepth(maxDepth),
                                  numThreads(0)
     {
+        for (int lane = 0; lane < HTTP_LANE_COUNT; lane++)
+            stats[lane].nMaxDepth = maxDepth;
     }
     /*( Precondition: worker threads have all stopped
      * (call WaitExit)
      */
     ~WorkQueue()
     {
-        while (!queue.empty()) {
-            delete queue.front();
-            queue.pop_front();
+        for (int lane = 0; lane < HTTP_LANE_COUNT; lane++) {
+            while (!queue[lane].empty()) {
+                delete queue[lane].front().item;
+                queue[lane].pop_front();
+            }
         }
     }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    bool Enqueue(WorkItem* item, HTTPWorkLane lane)
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        if (queue[lane].size() >= maxDepth) {
+            stats[lane].nRejected++;
             return false;
         }
-        queue.push_back(item);
+        QueuedItem queued;
+        queued.item = item;
+        queued.nTimeQueued = GetTimeMicros();
+        queue[lane].push_back(queued);
         cond.notify_one();
         return true;
     }
@@ -127,18 +157,35 @@ public:
     {
         ThreadCounter count(*this);
         while (running) {
-            WorkItem* i = 0;
+            HTTPWorkLane lane;
+            QueuedItem queued;
             {
                 boost::unique_lock<boost::mutex> lock(cs);
-                while (running && queue.empty())
+                while (running && (lane = ClaimableLane()) == HTTP_LANE_COUNT)
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = queue.front();
-                queue.pop_front();
+                queued = queue[lane].front();
+                queue[lane].pop_front();
+                stats[lane].nRunning++;
+            }
+            int64_t nTimeStart = GetTimeMicros();
+            (*queued.item)();
+            delete queued.item;
+            int64_t nTimeEnd = GetTimeMicros();
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                HTTPWorkLaneStats& laneStats = stats[lane];
+                laneStats.nRunning--;
+                laneStats.nProcessed++;
+                laneStats.nWaitMicros += nTimeStart - queued.nTimeQueued;
+                laneStats.nMaxWaitMicros = std::max(laneStats.nMaxWaitMicros, nTimeStart - queued.nTimeQueued);
+                laneStats.nRunMicros += nTimeEnd - nTimeStart;
+                laneStats.nMaxRunMicros = std::max(laneStats.nMaxRunMicros, nTimeEnd - nTimeStart);
+                // A slot for expensive items may have opened up
+                if (lane == HTTP_LANE_EXPENSIVE && !queue[lane].empty())
+                    cond.notify_one();
             }
-            (*i)();
-            delete i;
         }
     }
     /** Interrupt and exit loops */
@@ -157,24 +204,28 @@ public:
         }
     }
 
-    /** Return current depth of queue */
-    size_t Depth()
+    /** Return the statistics of all lanes */
+    void GetStats(std::vector<HTTPWorkLaneStats> &vStats)
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        return queue.size();
+        vStats.assign(stats, stats + HTTP_LANE_COUNT);
+        for (int lane = 0; lane < HTTP_LANE_COUNT; lane++)
+            vStats[lane].nDepth = queue[lane].size();
     }
 };
 
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler):
-        prefix(prefix), exactMatch(exactMatch), handler(handler)
+    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler, HTTPWorkLane lane, HTTPLaneSelector selector):
+        prefix(prefix), exactMatch(exactMatch), handler(handler), lane(lane), selector(selector)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPWorkLane lane;
+    HTTPLaneSelector selector;
 };
 
 /** HTTP module state */
@@ -289,12 +340,13 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPWorkLane lane = i->selector ? i->selector(hreq.get(), path) : i->lane;
         std::auto_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        if (workQueue->Enqueue(item.get(), lane))
             item.release(); /* if true, queue took ownership */
         else
-            item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
+            item->req->WriteReply(HTTP_INTERNAL, strprintf("Work queue depth exceeded (%s lane)", HTTPWorkLaneName(lane)));
     } else {
         hreq->WriteReply(HTTP_NOTFOUND);
     }
@@ -435,7 +487,7 @@ bool InitHTTPServer()
 
     LogPrint("http", "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    LogPrintf("HTTP: creating work queue of depth %d per lane\n", workQueueDepth);
 
     workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
     eventBase = base;
@@ -515,6 +567,26 @@ void StopHTTPServer()
     LogPrint("http", "Stopped HTTP server\n");
 }
 
+std::string HTTPWorkLaneName(HTTPWorkLane lane)
+{
+    switch (lane) {
+    case HTTP_LANE_CHEAP:
+        return "cheap";
+    case HTTP_LANE_EXPENSIVE:
+        return "expensive";
+    default:
+        return "unknown";
+    }
+}
+
+bool GetHTTPWorkQueueStats(std::vector<HTTPWorkLaneStats> &stats)
+{
+    if (!workQueue)
+        return false;
+    workQueue->GetStats(stats);
+    return true;
+}
+
 struct event_base* EventBase()
 {
     return eventBase;
@@ -591,6 +663,18 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxSize)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    size_t size = std::min(evbuffer_get_length(buf), nMaxSize);
+    std::string rv(size, '\0');
+    if (size > 0)
+        evbuffer_copyout(buf, &rv[0], size);
+    return rv;
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
@@ -598,6 +682,14 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+void HTTPRequest::WriteReplyPart(const std::string& strPart)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_add(evb, strPart.data(), strPart.size());
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -657,10 +749,12 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         HTTPWorkLane lane, const HTTPLaneSelector &selector)
 {
-    LogPrint("http", "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    LogPrint("http", "Registering HTTP handler for %s (exactmatch %d, lane %s)\n", prefix, exactMatch,
+             selector ? "per request" : HTTPWorkLaneName(lane));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, lane, selector));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -6,6 +6,7 @@
 #define BITCOIN_HTTPSERVER_H
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -34,16 +35,54 @@ void InterruptHTTPServer();
 /** Stop HTTP server */
 void StopHTTPServer();
 
+/** Work queue lanes. Requests in the cheap lane are picked first, and expensive
+ * requests never occupy all worker threads at once, so quick calls are answered
+ * while slow ones are being worked on.
+ */
+enum HTTPWorkLane
+{
+    HTTP_LANE_CHEAP,
+    HTTP_LANE_EXPENSIVE,
+    HTTP_LANE_COUNT
+};
+
+/** Name of a lane, for logging and statistics */
+std::string HTTPWorkLaneName(HTTPWorkLane lane);
+
 /** Handler for requests to a certain HTTP path */
 typedef boost::function<void(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Picks the lane of a request from what it asks for, called on the HTTP event thread */
+typedef boost::function<HTTPWorkLane(HTTPRequest* req, const std::string &)> HTTPLaneSelector;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Requests are queued in lane, or in the lane chosen by
+ * selector if one is given.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         HTTPWorkLane lane = HTTP_LANE_CHEAP, const HTTPLaneSelector &selector = HTTPLaneSelector());
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Statistics of one work queue lane */
+struct HTTPWorkLaneStats
+{
+    size_t nDepth;              //!< Requests waiting for a worker
+    size_t nMaxDepth;           //!< Waiting requests beyond which new ones are rejected
+    int nRunning;               //!< Requests being handled
+    uint64_t nProcessed;        //!< Requests handled since startup
+    uint64_t nRejected;         //!< Requests rejected because the lane was full
+    int64_t nWaitMicros;        //!< Total time handled requests spent waiting
+    int64_t nMaxWaitMicros;
+    int64_t nRunMicros;         //!< Total time spent handling requests
+    int64_t nMaxRunMicros;
+
+    HTTPWorkLaneStats() : nDepth(0), nMaxDepth(0), nRunning(0), nProcessed(0), nRejected(0),
+                          nWaitMicros(0), nMaxWaitMicros(0), nRunMicros(0), nMaxRunMicros(0) {}
+};
+
+/** Get the statistics of all lanes, indexed by HTTPWorkLane. Returns false if the server is not running */
+bool GetHTTPWorkQueueStats(std::vector<HTTPWorkLaneStats> &stats);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -96,6 +135,11 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Return up to nMaxSize bytes of the request body without consuming it.
+     */
+    std::string PeekBody(size_t nMaxSize);
+
     /**
      * Write output header.
      *
@@ -103,6 +147,13 @@ public:
      */
     void WriteHeader(const std::string& hdr, const std::string& value);
 
+    /**
+     * Append a piece of the reply body, sent along with a later WriteReply.
+     * Large replies can be handed over as they are produced instead of
+     * being assembled into a single string first.
+     */
+    void WriteReplyPart(const std::string& strPart);
+
     /**
      * Write HTTP reply.
      * nStatus is the HTTP status code to send.
@@ -49,6 +49,7 @@
 #include "dsnotificationinterface.h"
 #include "flat-database.h"
 #include "governance.h"
+#include "governance-votedb.h"
 #include "instantx.h"
 #ifdef ENABLE_WALLET
 #include "keepass.h"
@@ -90,6 +91,7 @@ extern void ThreadSendAlert();
 CWallet* pwalletMain = NULL;
 #endif
 bool fFeeEstimatesInitialized = false;
+static bool fDumpMempoolLater = false;
 bool fRestartRequested = false;  // true: restart false: shutdown
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
@@ -120,6 +122,8 @@ enum BindFlags {
 };
 
 static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
+/** Seconds between background dumps of the masternode and governance caches */
+static const int DUMP_CACHES_INTERVAL = 5 * 60;
 CClientUIInterface uiInterface; // Declared but not defined in ui_interface.h
 
 //////////////////////////////////////////////////////////////////////////////
@@ -187,6 +191,91 @@ static CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 static boost::scoped_ptr<ECCVerifyHandle> globalVerifyHandle;
 
+/**
+ * Store the data caches into their dat files. Governance and payment votes
+ * only append what changed to their journals, the small caches are rewritten.
+ */
+static void DumpCacheData()
+{
+    CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
+    flatdb1.Dump(mnodeman);
+    CJournaledFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+    flatdb2.Dump(mnpayments);
+    CJournaledFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+    flatdb3.Dump(governance);
+    CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
+    flatdb4.Dump(netfulfilledman);
+}
+
+/** One step of loading the data caches, run next to the others on its own thread */
+struct CCacheLoadTask
+{
+    std::string strError;
+    boost::function<bool()> func;
+    //! the cache is dropped without masternodes, so failing to load it doesn't matter then
+    bool fNeedsMasternodes;
+    bool fResult;
+
+    CCacheLoadTask(const std::string& strErrorIn, const boost::function<bool()>& funcIn, bool fNeedsMasternodesIn = false)
+        : strError(strErrorIn), func(funcIn), fNeedsMasternodes(fNeedsMasternodesIn), fResult(false) {}
+};
+
+static void RunCacheLoadTask(CCacheLoadTask* pTask)
+{
+    try {
+        pTask->fResult = pTask->func();
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "RunCacheLoadTask()");
+        pTask->fResult = false;
+    }
+}
+
+/** Run the tasks concurrently */
+static void RunCacheLoadTasks(std::vector<CCacheLoadTask>& vTasks)
+{
+    boost::thread_group group;
+    for (size_t i = 0; i < vTasks.size(); i++)
+        group.create_thread(boost::bind(&RunCacheLoadTask, &vTasks[i]));
+    group.join_all();
+}
+
+/** Returns the error of the first task that failed, ignoring the ones that need masternodes if there are none */
+static bool CheckCacheLoadTasks(const std::vector<CCacheLoadTask>& vTasks, bool fHaveMasternodes, std::string& strErrorRet)
+{
+    for (size_t i = 0; i < vTasks.size(); i++) {
+        if (!vTasks[i].fResult && (fHaveMasternodes || !vTasks[i].fNeedsMasternodes)) {
+            strErrorRet = vTasks[i].strError;
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename DB, typename T>
+static bool FinishCacheLoad(DB* pflatdb, T* pobj)
+{
+    pflatdb->FinishLoad(*pobj);
+    return true;
+}
+
+static bool FinishGovernanceLoad(CJournaledFlatDB<CGovernanceManager>* pflatdb)
+{
+    pflatdb->FinishLoad(governance);
+    governance.InitOnLoad();
+    return true;
+}
+
+/** Wall clock time of the AppInit2 stages, logged as each one ends to track cold start time */
+static int64_t nStartupTime = 0;
+static int64_t nStartupStageTime = 0;
+
+static void LogStartupStage(const std::string& strStage)
+{
+    int64_t nNow = GetTimeMillis();
+    LogPrintf("Startup stage %-32s %15dms\n", strStage, nNow - nStartupStageTime);
+    nStartupStageTime = nNow;
+}
+
 void Interrupt(boost::thread_group& threadGroup)
 {
     InterruptHTTPServer();
@@ -225,15 +314,14 @@ void PrepareShutdown()
     GenerateBitcoins(false, 0, Params());
     StopNode();
 
+    // don't overwrite the dump with what little made it into the mempool if loading was cut short
+    if (fDumpMempoolLater && GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        DumpMempool();
+
     // STORE DATA CACHES INTO SERIALIZED DAT FILES
-    CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
-    flatdb1.Dump(mnodeman);
-    CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
-    flatdb2.Dump(mnpayments);
-    CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-    flatdb3.Dump(governance);
-    CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
-    flatdb4.Dump(netfulfilledman);
+    DumpCacheData();
+    delete pgovernancevotedb;
+    pgovernancevotedb = NULL;
 
     UnregisterNodeSignals(GetNodeSignals());
 
@@ -261,6 +349,8 @@ void PrepareShutdown()
         pcoinsdbview = NULL;
         delete pblocktree;
         pblocktree = NULL;
+        delete paddressindex;
+        paddressindex = NULL;
     }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
@@ -398,8 +488,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
+    strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-parmsgcheck=<n>", strprintf(_("Set the number of threads verifying masternode message signatures, and as many hashing received headers, besides the message handler (0 to %d, default: %d)"),
+        MAX_MSGCHECK_THREADS, DEFAULT_MSGCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
@@ -442,6 +535,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    std::string strSocketEventsModes = GetSocketEventsModeName(SOCKETEVENTS_SELECT);
+#ifdef HAVE_SYS_EPOLL_H
+    strSocketEventsModes += ", " + GetSocketEventsModeName(SOCKETEVENTS_EPOLL);
+#endif
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("How to wait for network socket events, one of: %s (default: %s)"), strSocketEventsModes, GetSocketEventsModeName(DEFAULT_SOCKETEVENTS)));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -511,6 +609,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
 #ifdef ENABLE_WALLET
+        strUsage += HelpMessageOpt("-checkwalletbalances", strprintf("Compare the cached wallet balances against a full recount of the wallet on every query (default: %u)", DEFAULT_CHECK_WALLET_BALANCES));
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf("Flush wallet database activity from memory to disk log every <n> megabytes (default: %u)", DEFAULT_WALLET_DBLOGSIZE));
 #endif
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
@@ -547,6 +646,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", DEFAULT_LIMITFREERELAY));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", DEFAULT_RELAYPRIORITY));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxmsgsigcachesize=<n>", strprintf("Limit size of masternode message signature cache to <n> MiB (default: %u)", DEFAULT_MAX_MSG_SIG_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)"),
         CURRENCY_UNIT, FormatMoney(DEFAULT_MIN_RELAY_TX_FEE)));
@@ -609,7 +709,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
     if (showDebug) {
-        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of each lane of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
@@ -759,6 +859,21 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
     }
 }
 
+bool IsMempoolLoaded()
+{
+    return fDumpMempoolLater;
+}
+
+void ThreadLoadMempool()
+{
+    RenameThread("linc-loadmempl");
+    // saved transactions may spend outputs of blocks which are still being imported
+    while (fImporting || fReindex)
+        MilliSleep(100);
+    LoadMempool();
+    fDumpMempoolLater = !ShutdownRequested();
+}
+
 /** Sanity checks
  *  Ensure that LINC Core is running in a usable environment with all
  *  necessary library support.
@@ -914,6 +1029,8 @@ void InitLogging()
 bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 {
     // ********************************************************* Step 1: setup
+    nStartupTime = nStartupStageTime = GetTimeMillis();
+
 #ifdef _MSC_VER
     // Turn off Microsoft heap dump noise
     _CrtSetReportMode(_CRT_WARN, _CRTDBG_MODE_FILE);
@@ -985,13 +1102,19 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 #endif
     }
 
+    std::string strSocketEvents = GetArg("-socketevents", GetSocketEventsModeName(DEFAULT_SOCKETEVENTS));
+    if (!ParseSocketEventsMode(strSocketEvents, nSocketEventsMode))
+        return InitError(strprintf(_("Unknown or unsupported -socketevents mode '%s'"), strSocketEvents));
+
     // Make sure enough file descriptors are available
     int nBind = std::max((int)mapArgs.count("-bind") + (int)mapArgs.count("-whitebind"), 1);
     int nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    // (select() can't wait on descriptors from FD_SETSIZE up, epoll can)
+    if (nSocketEventsMode == SOCKETEVENTS_SELECT)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1047,6 +1170,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // the message checks have their own threads, kept apart from the script checks
+    nMessageCheckThreads = std::max(0, std::min((int)GetArg("-parmsgcheck", DEFAULT_MSGCHECK_THREADS), MAX_MSGCHECK_THREADS));
+
     fServer = GetBoolArg("-server", false);
 
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
@@ -1140,6 +1266,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     nTxConfirmTarget = GetArg("-txconfirmtarget", DEFAULT_TX_CONFIRM_TARGET);
     bSpendZeroConfChange = GetBoolArg("-spendzeroconfchange", DEFAULT_SPEND_ZEROCONF_CHANGE);
     fSendFreeTransactions = GetBoolArg("-sendfreetransactions", DEFAULT_SEND_FREE_TRANSACTIONS);
+    fCheckWalletBalances = GetBoolArg("-checkwalletbalances", DEFAULT_CHECK_WALLET_BALANCES);
 
     std::string strWalletFile = GetArg("-wallet", "wallet.dat");
 #endif // ENABLE_WALLET
@@ -1224,6 +1351,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+    LogPrintf("Using %u threads for message signature and header hash verification\n", nMessageCheckThreads);
+    for (int i=0; i<nMessageCheckThreads; i++) {
+        threadGroup.create_thread(&ThreadMessageSigCheck);
+        threadGroup.create_thread(&ThreadHeaderHashCheck);
+    }
+
     if (mapArgs.count("-sporkkey")) // spork priv key
     {
         if (!sporkManager.SetPrivKey(GetArg("-sporkkey", "")))
@@ -1284,6 +1417,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     } // (!fDisableWallet)
 #endif // ENABLE_WALLET
+    LogStartupStage("setup");
+
     // ********************************************************* Step 6: network initialization
 
     RegisterNodeSignals(GetNodeSignals());
@@ -1419,6 +1554,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         CNode::SetMaxOutboundTarget(GetArg("-maxuploadtarget", DEFAULT_MAX_UPLOAD_TARGET)*1024*1024);
     }
 
+    LogStartupStage("network initialization");
+
     // ********************************************************* Step 7: load block chain
 
     fReindex = GetBoolArg("-reindex", false);
@@ -1458,11 +1595,17 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nBlockTreeDBCache > (1 << 21) && !GetBoolArg("-txindex", DEFAULT_TXINDEX))
         nBlockTreeDBCache = (1 << 21); // block tree db cache shouldn't be larger than 2 MiB
     nTotalCache -= nBlockTreeDBCache;
+    bool fAnyAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) || GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+    int64_t nAddressIndexDBCache = 1 << 20; // only holds the marker flag when no index is enabled
+    if (fAnyAddressIndex)
+        nAddressIndexDBCache = std::min(nTotalCache / 8, nMaxAddressIndexDbCache << 20);
+    nTotalCache -= nAddressIndexDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for address index database\n", nAddressIndexDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
@@ -1481,8 +1624,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pcoinsdbview;
                 delete pcoinscatcher;
                 delete pblocktree;
+                delete paddressindex;
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
+                paddressindex = new CAddressIndexDB(nAddressIndexDBCache, false, fReindex);
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
@@ -1516,6 +1661,21 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // Databases from before the indexes had their own database keep them in the block tree
+                bool fIndexesMoved = false;
+                if ((fAddressIndex || fSpentIndex || fTimestampIndex) && !(paddressindex->ReadFlag("indexes", fIndexesMoved) && fIndexesMoved)) {
+                    strLoadError = _("You need to rebuild the database using -reindex to move the address, timestamp and spent indexes into their own database");
+                    break;
+                }
+
+                {
+                    LOCK(cs_main);
+                    if (!CheckAddressIndexTip()) {
+                        strLoadError = _("The address index doesn't match the active chain, you need to rebuild the database using -reindex");
+                        break;
+                    }
+                }
+
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1590,6 +1750,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         mempool.ReadFeeEstimates(est_filein);
     fFeeEstimatesInitialized = true;
 
+    LogStartupStage("load block chain");
+
     // ********************************************************* Step 8: load wallet
 #ifdef ENABLE_WALLET
     if (fDisableWallet) {
@@ -1754,6 +1916,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("No wallet support compiled in!\n");
 #endif // !ENABLE_WALLET
 
+    LogStartupStage("load wallet");
+
     // ********************************************************* Step 9: data directory maintenance
 
     // if pruning, unset the service bit and perform the initial blockstore prune
@@ -1791,6 +1955,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             MilliSleep(10);
     }
 
+    LogStartupStage("data directory maintenance");
+
     // ********************************************************* Step 11a: setup PrivateSend
     fMasterNode = GetBoolArg("-masternode", false);
 
@@ -1869,38 +2035,61 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     darkSendPool.InitDenominations();
 
+    LogStartupStage("setup PrivateSend");
+
     // ********************************************************* Step 11b: Load cache data
 
     // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
 
-    uiInterface.InitMessage(_("Loading masternode cache..."));
+    // The files are read and verified concurrently. Cleaning up depends on the
+    // masternode list, so that comes first and the rest is finished in parallel.
+    uiInterface.InitMessage(_("Loading masternode, payment, governance and fulfilled requests caches..."));
+    // governance.dat only holds the objects, their votes are in here
+    pgovernancevotedb = new CGovernanceVoteDB(GOVERNANCE_VOTE_DB_CACHE);
     CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
-    if(!flatdb1.Load(mnodeman)) {
-        return InitError("Failed to load masternode cache from mncache.dat");
-    }
-
+    CJournaledFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+    CJournaledFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+    CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
+    std::string strCacheError;
+
+    std::vector<CCacheLoadTask> vReadTasks;
+    vReadTasks.push_back(CCacheLoadTask("Failed to load masternode cache from mncache.dat",
+        boost::bind(&CFlatDB<CMasternodeMan>::ReadSnapshot, &flatdb1, boost::ref(mnodeman))));
+    vReadTasks.push_back(CCacheLoadTask("Failed to load masternode payments cache from mnpayments.dat",
+        boost::bind(&CJournaledFlatDB<CMasternodePayments>::ReadSnapshot, &flatdb2, boost::ref(mnpayments)), true));
+    vReadTasks.push_back(CCacheLoadTask("Failed to load governance cache from governance.dat",
+        boost::bind(&CJournaledFlatDB<CGovernanceManager>::ReadSnapshot, &flatdb3, boost::ref(governance)), true));
+    vReadTasks.push_back(CCacheLoadTask("Failed to load fulfilled requests cache from netfulfilled.dat",
+        boost::bind(&CFlatDB<CNetFulfilledRequestManager>::ReadSnapshot, &flatdb4, boost::ref(netfulfilledman))));
+    RunCacheLoadTasks(vReadTasks);
+    if (vReadTasks[0].fResult)
+        flatdb1.FinishLoad(mnodeman);
+    // payments and governance are dropped without masternodes, a broken file of theirs is no reason to stop then
+    if (!CheckCacheLoadTasks(vReadTasks, mnodeman.size() > 0, strCacheError))
+        return InitError(strCacheError);
+    LogStartupStage("read caches");
+
+    std::vector<CCacheLoadTask> vFinishTasks;
     if(mnodeman.size()) {
-        uiInterface.InitMessage(_("Loading masternode payment cache..."));
-        CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
-        if(!flatdb2.Load(mnpayments)) {
-            return InitError("Failed to load masternode payments cache from mnpayments.dat");
-        }
-
-        uiInterface.InitMessage(_("Loading governance cache..."));
-        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-        if(!flatdb3.Load(governance)) {
-            return InitError("Failed to load governance cache from governance.dat");
-        }
-        governance.InitOnLoad();
+        vFinishTasks.push_back(CCacheLoadTask("Failed to load masternode payments cache from mnpayments.dat",
+            boost::bind(&FinishCacheLoad<CJournaledFlatDB<CMasternodePayments>, CMasternodePayments>, &flatdb2, &mnpayments)));
+        vFinishTasks.push_back(CCacheLoadTask("Failed to load governance cache from governance.dat",
+            boost::bind(&FinishGovernanceLoad, &flatdb3)));
     } else {
         uiInterface.InitMessage(_("Masternode cache is empty, skipping payments and governance cache..."));
+        // their snapshots and journals go as well, or the next dump would append to them
+        flatdb2.Reset(mnpayments);
+        flatdb3.Reset(governance);
     }
+    vFinishTasks.push_back(CCacheLoadTask("Failed to load fulfilled requests cache from netfulfilled.dat",
+        boost::bind(&FinishCacheLoad<CFlatDB<CNetFulfilledRequestManager>, CNetFulfilledRequestManager>, &flatdb4, &netfulfilledman)));
+    RunCacheLoadTasks(vFinishTasks);
+    if (!CheckCacheLoadTasks(vFinishTasks, true, strCacheError))
+        return InitError(strCacheError);
+    LogStartupStage("clean and index caches");
 
-    uiInterface.InitMessage(_("Loading fulfilled requests cache..."));
-    CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
-    if(!flatdb4.Load(netfulfilledman)) {
-        return InitError("Failed to load fulfilled requests cache from netfulfilled.dat");
-    }
+    // a crash now only loses what changed since the last dump
+    scheduler.scheduleEvery(&DumpCacheData, DUMP_CACHES_INTERVAL);
 
     // ********************************************************* Step 11c: update block tip in LINC modules
 
@@ -1917,6 +2106,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     threadGroup.create_thread(boost::bind(&ThreadCheckDarkSendPool));
 
+    // ********************************************************* Step 11e: load mempool
+
+    // InstantSend votes of the saved mempool need the masternode list, so this waits for the caches
+    if (GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        threadGroup.create_thread(&ThreadLoadMempool);
+    else
+        fDumpMempoolLater = true; // nothing to load, savemempool may write right away
+
     // ********************************************************* Step 12: start node
 
     if (!CheckDiskSpace())
@@ -1939,6 +2136,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (GetBoolArg("-listenonion", DEFAULT_LISTEN_ONION))
         StartTorControl(threadGroup, scheduler);
 
+    StartMessageWorkQueues(threadGroup);
     StartNode(threadGroup, scheduler);
 
     // Monitor the chain, and alert if we get blocks much quicker or slower than expected
@@ -1957,6 +2155,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Generate coins in the background
     GenerateBitcoins(GetBoolArg("-gen", DEFAULT_GENERATE), GetArg("-genproclimit", DEFAULT_GENERATE_THREADS), chainparams);
 
+    LogStartupStage("start node");
+
     // ********************************************************* Step 13: finished
 
     SetRPCWarmupFinished();
@@ -1974,5 +2174,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     threadGroup.create_thread(boost::bind(&ThreadSendAlert));
 
+    LogStartupStage("finish");
+    LogPrintf("Startup finished %15dms\n", GetTimeMillis() - nStartupTime);
+
     return !fRequestShutdown;
 }
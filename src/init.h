@@ -20,6 +20,8 @@ extern CWallet* pwalletMain;
 
 void StartShutdown();
 bool ShutdownRequested();
+/** Whether the saved mempool has been loaded completely, until then it must not be overwritten */
+bool IsMempoolLoaded();
 /** Interrupt threads */
 void Interrupt(boost::thread_group& threadGroup);
 void Shutdown();
@@ -831,6 +831,61 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
     }
 }
 
+void CInstantSend::GetLockState(std::vector<CTxLockRequest>& vecLockRequestsRet, std::vector<CTxLockVote>& vecLockVotesRet)
+{
+    LOCK(cs_instantsend);
+
+    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.begin();
+    while(itLockCandidate != mapTxLockCandidates.end()) {
+        if(mempool.exists(itLockCandidate->first)) {
+            vecLockRequestsRet.push_back(itLockCandidate->second.txLockRequest);
+            std::map<COutPoint, COutPointLock>::iterator itOutpointLock = itLockCandidate->second.mapOutPointLocks.begin();
+            while(itOutpointLock != itLockCandidate->second.mapOutPointLocks.end()) {
+                std::vector<CTxLockVote> vVotes = itOutpointLock->second.GetVotes();
+                vecLockVotesRet.insert(vecLockVotesRet.end(), vVotes.begin(), vVotes.end());
+                ++itOutpointLock;
+            }
+        }
+        ++itLockCandidate;
+    }
+}
+
+void CInstantSend::RestoreLockState(const std::vector<CTxLockRequest>& vecLockRequests, std::vector<CTxLockVote>& vecLockVotes)
+{
+    if(fLiteMode) return;
+
+    // votes are checked one by one below, get their signatures into the cache all at once
+    std::vector<CSignedMessageCheck> vChecks;
+    BOOST_FOREACH(const CTxLockVote& vote, vecLockVotes) {
+        masternode_info_t infoMn = mnodeman.GetMasternodeInfo(CTxIn(vote.GetMasternodeOutpoint()));
+        if(infoMn.fInfoValid) {
+            vChecks.push_back(CSignedMessageCheck(infoMn.pubKeyMasternode, vote.GetSignature(), vote.GetSignatureMessage()));
+        }
+    }
+    darkSendSigner.VerifyMessageBatch(vChecks);
+
+    LOCK2(cs_main, cs_instantsend);
+
+    int nRestored = 0;
+    BOOST_FOREACH(const CTxLockRequest& txLockRequest, vecLockRequests) {
+        uint256 txHash = txLockRequest.GetHash();
+        // no votes of our own here, we already voted before the restart if we had to
+        if(!mempool.exists(txHash) || !CreateTxLockCandidate(txLockRequest)) continue;
+        mapLockRequestAccepted.insert(std::make_pair(txHash, txLockRequest));
+        nRestored++;
+    }
+
+    BOOST_FOREACH(CTxLockVote& vote, vecLockVotes) {
+        uint256 nVoteHash = vote.GetHash();
+        if(mapTxLockVotes.count(nVoteHash)) continue;
+        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
+        ProcessTxLockVote(NULL, vote);
+    }
+
+    LogPrintf("CInstantSend::RestoreLockState -- restored %d of %d lock candidates, %d votes\n",
+            nRestored, vecLockRequests.size(), vecLockVotes.size());
+}
+
 //
 // CTxLockRequest
 //
@@ -1010,10 +1065,15 @@ uint256 CTxLockVote::GetHash() const
     return ss.GetHash();
 }
 
+std::string CTxLockVote::GetSignatureMessage() const
+{
+    return txHash.ToString() + outpoint.ToStringShort();
+}
+
 bool CTxLockVote::CheckSignature() const
 {
     std::string strError;
-    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
+    std::string strMessage = GetSignatureMessage();
 
     masternode_info_t infoMn = mnodeman.GetMasternodeInfo(CTxIn(outpointMasternode));
 
@@ -1033,7 +1093,7 @@ bool CTxLockVote::CheckSignature() const
 bool CTxLockVote::Sign()
 {
     std::string strError;
-    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
+    std::string strMessage = GetSignatureMessage();
 
     if(!darkSendSigner.SignMessage(strMessage, vchMasternodeSignature, activeMasternode.keyMasternode)) {
         LogPrintf("CTxLockVote::Sign -- SignMessage() failed\n");
@@ -106,6 +106,11 @@ public:
 
     void UpdatedBlockTip(const CBlockIndex *pindex);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+
+    // lock requests and votes of candidates still in the mempool, to be saved with it
+    void GetLockState(std::vector<CTxLockRequest>& vecLockRequestsRet, std::vector<CTxLockVote>& vecLockVotesRet);
+    // recreate lock candidates for saved transactions which made it back into the mempool
+    void RestoreLockState(const std::vector<CTxLockRequest>& vecLockRequests, std::vector<CTxLockVote>& vecLockVotes);
 };
 
 class CTxLockRequest : public CTransaction
@@ -179,12 +184,14 @@ public:
     uint256 GetTxHash() const { return txHash; }
     COutPoint GetOutpoint() const { return outpoint; }
     COutPoint GetMasternodeOutpoint() const { return outpointMasternode; }
+    const std::vector<unsigned char>& GetSignature() const { return vchMasternodeSignature; }
     int64_t GetTimeCreated() const { return nTimeCreated; }
 
     bool IsValid(CNode* pnode) const;
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
     bool IsExpired(int nHeight) const;
 
+    std::string GetSignatureMessage() const;
     bool Sign();
     bool CheckSignature() const;
 
@@ -16,9 +16,11 @@
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "crypto/neoscrypt.h"
 #include "hash.h"
 #include "init.h"
 #include "merkleblock.h"
+#include "messageworkqueue.h"
 #include "net.h"
 #include "policy/policy.h"
 #include "pow.h"
@@ -74,6 +76,7 @@ int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nMessageCheckThreads = 0;
 bool fImporting = false;
 bool fReindex = false;
 bool fTxIndex = true;
@@ -308,6 +311,80 @@ CNodeState *State(NodeId pnode) {
     return &it->second;
 }
 
+// Misbehavior reported by the message work queues, which don't hold cs_main.
+// Added to the node state by ApplyPendingMisbehavior().
+CCriticalSection cs_mapPendingMisbehavior;
+std::map<NodeId, int> mapPendingMisbehavior;
+// Nodes with fShouldBan set, so ProcessMessages() can see it without cs_main.
+std::set<NodeId> setPendingBan;
+
+// Requires cs_main.
+void ApplyPendingMisbehavior(NodeId pnode)
+{
+    int howmuch;
+    {
+        LOCK(cs_mapPendingMisbehavior);
+        std::map<NodeId, int>::iterator it = mapPendingMisbehavior.find(pnode);
+        if (it == mapPendingMisbehavior.end())
+            return;
+        howmuch = it->second;
+        mapPendingMisbehavior.erase(it);
+    }
+
+    CNodeState *state = State(pnode);
+    if (state == NULL)
+        return;
+
+    state->nMisbehavior += howmuch;
+    int banscore = GetArg("-banscore", DEFAULT_BANSCORE_THRESHOLD);
+    if (state->nMisbehavior >= banscore && state->nMisbehavior - howmuch < banscore)
+    {
+        LogPrintf("%s: %s (%d -> %d) BAN THRESHOLD EXCEEDED\n", __func__, state->name, state->nMisbehavior-howmuch, state->nMisbehavior);
+        state->fShouldBan = true;
+        LOCK(cs_mapPendingMisbehavior);
+        setPendingBan.insert(pnode);
+    } else
+        LogPrintf("%s: %s (%d -> %d)\n", __func__, state->name, state->nMisbehavior-howmuch, state->nMisbehavior);
+}
+
+// Requires cs_main. Drops misbehavior reported after the node was finalized,
+// ApplyPendingMisbehavior() is never called for it again.
+void SweepPendingMisbehavior()
+{
+    LOCK(cs_mapPendingMisbehavior);
+    std::map<NodeId, int>::iterator it = mapPendingMisbehavior.begin();
+    while (it != mapPendingMisbehavior.end()) {
+        if (mapNodeState.count(it->first))
+            ++it;
+        else
+            mapPendingMisbehavior.erase(it++);
+    }
+    std::set<NodeId>::iterator itBan = setPendingBan.begin();
+    while (itBan != setPendingBan.end()) {
+        if (mapNodeState.count(*itBan))
+            ++itBan;
+        else
+            setPendingBan.erase(itBan++);
+    }
+}
+
+// Doesn't require cs_main, only takes it when the work queues reported misbehavior
+// for the node that wasn't applied yet. Tells whether SendMessages() is going to ban it.
+bool IsBanPending(NodeId pnode)
+{
+    {
+        LOCK(cs_mapPendingMisbehavior);
+        if (setPendingBan.count(pnode))
+            return true;
+        if (!mapPendingMisbehavior.count(pnode))
+            return false;
+    }
+    LOCK(cs_main);
+    ApplyPendingMisbehavior(pnode);
+    CNodeState *state = State(pnode);
+    return state != NULL && state->fShouldBan;
+}
+
 int GetHeight()
 {
     LOCK(cs_main);
@@ -333,6 +410,7 @@ void InitializeNode(NodeId nodeid, const CNode *pnode) {
 
 void FinalizeNode(NodeId nodeid) {
     LOCK(cs_main);
+    ApplyPendingMisbehavior(nodeid);
     CNodeState *state = State(nodeid);
 
     if (state->fSyncStarted)
@@ -351,6 +429,8 @@ void FinalizeNode(NodeId nodeid) {
     assert(nPeersWithValidatedDownloads >= 0);
 
     mapNodeState.erase(nodeid);
+    // also catches reports for nodes finalized earlier that came in late
+    SweepPendingMisbehavior();
 
     if (mapNodeState.empty()) {
         // Do a consistency check after the last peer is removed.
@@ -562,6 +642,7 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
 
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
     LOCK(cs_main);
+    ApplyPendingMisbehavior(nodeid);
     CNodeState *state = State(nodeid);
     if (state == NULL)
         return false;
@@ -610,6 +691,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
+CAddressIndexDB *paddressindex = NULL;
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -1063,7 +1145,7 @@ std::string FormatStateMessage(const CValidationState &state)
 }
 
 bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
-                              bool* pfMissingInputs, bool fOverrideMempoolLimit, bool fRejectAbsurdFee,
+                              bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, bool fRejectAbsurdFee,
                               std::vector<uint256>& vHashTxnToUncache, bool fDryRun)
 {
     AssertLockHeld(cs_main);
@@ -1253,7 +1335,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
             }
         }
 
-        CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height(), pool.HasNoInputsOf(tx), inChainInputValue, fSpendsCoinbase, nSigOps, lp);
+        CTxMemPoolEntry entry(tx, nFees, nAcceptTime, dPriority, chainActive.Height(), pool.HasNoInputsOf(tx), inChainInputValue, fSpendsCoinbase, nSigOps, lp);
         unsigned int nSize = entry.GetTxSize();
 
         // Check that the transaction doesn't have an excessive number of
@@ -1354,20 +1436,6 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
                 // Save these to avoid repeated lookups
                 setIterConflicting.insert(mi);
 
-                // If this entry is "dirty", then we don't have descendant
-                // state for this transaction, which means we probably have
-                // lots of in-mempool descendants.
-                // Don't allow replacements of dirty transactions, to ensure
-                // that we don't spend too much time walking descendants.
-                // This should be rare.
-                if (mi->IsDirty()) {
-                    return state.DoS(0,
-                            error("AcceptToMemoryPool: rejecting replacement %s; cannot replace tx %s with untracked descendants",
-                                hash.ToString(),
-                                mi->GetTx().GetHash().ToString()),
-                            REJECT_NONSTANDARD, "too many potential replacements");
-                }
-
                 // Don't allow the replacement to reduce the feerate of the
                 // mempool.
                 //
@@ -1502,7 +1570,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
                     FormatMoney(nModifiedFees - nConflictingFees),
                     (int)nSize - (int)nConflictingSize);
         }
-        pool.RemoveStaged(allConflicting);
+        pool.RemoveStaged(allConflicting, false);
 
         // Store transaction in memory
         pool.addUnchecked(hash, entry, setAncestors, !IsInitialBlockDownload());
@@ -1530,11 +1598,11 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
     return true;
 }
 
-bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
-                        bool* pfMissingInputs, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool fDryRun)
+bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
+                                bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool fDryRun)
 {
     std::vector<uint256> vHashTxToUncache;
-    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, fOverrideMempoolLimit, fRejectAbsurdFee, vHashTxToUncache, fDryRun);
+    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, fOverrideMempoolLimit, fRejectAbsurdFee, vHashTxToUncache, fDryRun);
     if (!res || fDryRun) {
         if(!res) LogPrint("mempool", "%s: %s %s\n", __func__, tx.GetHash().ToString(), state.GetRejectReason());
         BOOST_FOREACH(const uint256& hashTx, vHashTxToUncache)
@@ -1543,12 +1611,18 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     return res;
 }
 
+bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
+                        bool* pfMissingInputs, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool fDryRun)
+{
+    return AcceptToMemoryPoolWithTime(pool, state, tx, fLimitFree, pfMissingInputs, GetTime(), fOverrideMempoolLimit, fRejectAbsurdFee, fDryRun);
+}
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes)
 {
     if (!fTimestampIndex)
         return error("Timestamp index not enabled");
 
-    if (!pblocktree->ReadTimestampIndex(high, low, hashes))
+    if (!paddressindex->ReadTimestampIndex(high, low, hashes))
         return error("Unable to get hashes for timestamps");
 
     return true;
@@ -1562,19 +1636,20 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value))
+    if (!paddressindex->ReadSpentIndex(key, value))
         return false;
 
     return true;
 }
 
 bool GetAddressIndex(uint160 addressHash, int type,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end,
+                     const CAddressIndexKey *pkeyAfter, unsigned int nLimit)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!paddressindex->ReadAddressIndex(addressHash, type, addressIndex, start, end, pkeyAfter, nLimit))
         return error("unable to get txids for address");
 
     return true;
@@ -1586,12 +1661,55 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!paddressindex->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalance &balance)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!paddressindex->ReadAddressBalance(addressHash, type, balance))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
+/**
+ * Whether the address balances already include pindex. The index is flushed
+ * on its own, so after an unclean shutdown it can be ahead of the chainstate
+ * and blocks get connected a second time.
+ */
+static bool AddressIndexContains(const CBlockIndex* pindex)
+{
+    uint256 hashTip;
+    if (!paddressindex->ReadAddressIndexTip(hashTip))
+        return false;
+    BlockMap::iterator mi = mapBlockIndex.find(hashTip);
+    if (mi == mapBlockIndex.end())
+        return false;
+    return mi->second->GetAncestor(pindex->nHeight) == pindex;
+}
+
+bool CheckAddressIndexTip()
+{
+    AssertLockHeld(cs_main);
+    uint256 hashTip;
+    if (!fAddressIndex || !paddressindex->ReadAddressIndexTip(hashTip))
+        return true;
+    BlockMap::iterator mi = mapBlockIndex.find(hashTip);
+    if (mi == mapBlockIndex.end())
+        return false;
+    CBlockIndex* pindexTip = mi->second;
+    if (chainActive.Contains(pindexTip))
+        return true;
+    // left ahead of the chainstate by an unclean shutdown
+    return chainActive.Tip() && pindexTip->GetAncestor(chainActive.Height()) == chainActive.Tip();
+}
+
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::Params& consensusParams, uint256 &hashBlock, bool fAllowSlow)
 {
@@ -1684,7 +1802,7 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+static bool DeserializeBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
@@ -1701,6 +1819,14 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
 
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    if (!DeserializeBlockFromDisk(block, pos))
+        return false;
+
     // Check the header
     if (!CheckProofOfWork(block.GetHash(), block.nBits, consensusParams))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
@@ -1710,11 +1836,20 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
+    if (!DeserializeBlockFromDisk(block, pindex->GetBlockPos()))
         return false;
-    if (block.GetHash() != pindex->GetBlockHash())
-        return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
+
+    // The header was hashed when it was added to the index, so instead of running
+    // NeoScrypt again make sure we read the very same header and reuse the indexed hash
+    CBlockHeader header = pindex->GetBlockHeader();
+    if (block.nVersion != header.nVersion || block.hashPrevBlock != header.hashPrevBlock ||
+        block.hashMerkleRoot != header.hashMerkleRoot || block.nTime != header.nTime ||
+        block.nBits != header.nBits || block.nNonce != header.nNonce)
+        return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): block header doesn't match index for %s at %s",
                 pindex->ToString(), pindex->GetBlockPos().ToString());
+    if (!CheckProofOfWork(pindex->GetBlockHash(), block.nBits, consensusParams))
+        return error("ReadBlockFromDisk: Errors in block header at %s", pindex->GetBlockPos().ToString());
+    block.SetKnownHash(pindex->GetBlockHash());
     return true;
 }
 
@@ -1974,24 +2109,14 @@ void CheckForkWarningConditionsOnNewFork(CBlockIndex* pindexNewForkTip)
     CheckForkWarningConditions();
 }
 
-// Requires cs_main.
+// Doesn't require cs_main, may be called by any thread.
 void Misbehaving(NodeId pnode, int howmuch)
 {
     if (howmuch == 0)
         return;
 
-    CNodeState *state = State(pnode);
-    if (state == NULL)
-        return;
-
-    state->nMisbehavior += howmuch;
-    int banscore = GetArg("-banscore", DEFAULT_BANSCORE_THRESHOLD);
-    if (state->nMisbehavior >= banscore && state->nMisbehavior - howmuch < banscore)
-    {
-        LogPrintf("%s: %s (%d -> %d) BAN THRESHOLD EXCEEDED\n", __func__, state->name, state->nMisbehavior-howmuch, state->nMisbehavior);
-        state->fShouldBan = true;
-    } else
-        LogPrintf("%s: %s (%d -> %d)\n", __func__, state->name, state->nMisbehavior-howmuch, state->nMisbehavior);
+    LOCK(cs_mapPendingMisbehavior);
+    mapPendingMisbehavior[pnode] += howmuch;
 }
 
 void static InvalidChainFound(CBlockIndex* pindexNew)
@@ -2079,6 +2204,11 @@ bool CScriptCheck::operator()() {
     return true;
 }
 
+bool CHeaderHashCheck::operator()() {
+    CBlockHeader::ComputeHashes(vpHeaders);
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -2433,11 +2563,13 @@ bool DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockI
         return true;
     }
 
+    mnpayments.DisconnectCoinbasePayees(pindex);
+
     if (fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
+        if (!paddressindex->EraseAddressIndex(addressIndex, pindex->pprev->GetBlockHash(), AddressIndexContains(pindex))) {
             return AbortNode(state, "Failed to delete address index");
         }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
+        if (!paddressindex->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             return AbortNode(state, "Failed to write address unspent index");
         }
     }
@@ -2477,6 +2609,44 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CHeaderHashCheck> headerhashcheckqueue(16);
+// CCheckQueueControl needs the queue to itself
+static CCriticalSection cs_headerhashcheckqueue;
+
+void ThreadHeaderHashCheck() {
+    RenameThread("linc-hdrhash");
+    headerhashcheckqueue.Thread();
+}
+
+/**
+ * Memoize the hashes of a received headers batch, split into runs as wide as the
+ * NeoScrypt engine and spread over the header hash checking threads. Must be called
+ * without cs_main so other threads can go on while the headers are hashed.
+ */
+static void ComputeHeaderHashes(const std::vector<CBlockHeader>& headers)
+{
+    std::vector<const CBlockHeader*> vpHeaders;
+    vpHeaders.reserve(headers.size());
+    BOOST_FOREACH(const CBlockHeader& header, headers)
+        vpHeaders.push_back(&header);
+
+    const unsigned int nRun = neoscrypt_simd_lanes();
+    if (!nMessageCheckThreads || vpHeaders.size() <= nRun) {
+        CBlockHeader::ComputeHashes(vpHeaders);
+        return;
+    }
+
+    std::vector<CHeaderHashCheck> vChecks;
+    vChecks.reserve((vpHeaders.size() + nRun - 1) / nRun);
+    for (unsigned int i = 0; i < vpHeaders.size(); i += nRun)
+        vChecks.push_back(CHeaderHashCheck(vpHeaders.begin() + i, vpHeaders.begin() + std::min<size_t>(i + nRun, vpHeaders.size())));
+
+    LOCK(cs_headerhashcheckqueue);
+    CCheckQueueControl<CHeaderHashCheck> control(&headerhashcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -2931,23 +3101,25 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             return AbortNode(state, "Failed to write transaction index");
 
     if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
+        if (!paddressindex->WriteAddressIndex(addressIndex, pindex->GetBlockHash(), !AddressIndexContains(pindex))) {
             return AbortNode(state, "Failed to write address index");
         }
 
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
+        if (!paddressindex->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             return AbortNode(state, "Failed to write address unspent index");
         }
     }
 
     if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
+        if (!paddressindex->UpdateSpentIndex(spentIndex))
             return AbortNode(state, "Failed to write transaction index");
 
     if (fTimestampIndex)
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
+        if (!paddressindex->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
             return AbortNode(state, "Failed to write timestamp index");
 
+    mnpayments.ConnectCoinbasePayees(block, pindex);
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -4745,6 +4917,9 @@ bool InitBlockIndex(const CChainParams& chainparams)
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
+    // Mark the address index database as holding the indexes of this block tree
+    paddressindex->WriteFlag("indexes", true);
+
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -4774,10 +4949,86 @@ bool InitBlockIndex(const CChainParams& chainparams)
     return true;
 }
 
+/** Map of disk positions for blocks with unknown parent (only used for reindex) */
+static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+
+/** Process one block read by LoadExternalBlockFile, returns false if importing has to stop */
+static bool LoadExternalBlock(const CChainParams& chainparams, CBlock& block, CDiskBlockPos *dbp, int& nLoaded)
+{
+    // detect out of order blocks, and store them for later
+    uint256 hash = block.GetHash();
+    if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+        LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                block.hashPrevBlock.ToString());
+        if (dbp)
+            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+        return true;
+    }
+
+    // process in case the block isn't known yet
+    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+        CValidationState state;
+        if (ProcessNewBlock(state, chainparams, NULL, &block, true, dbp))
+            nLoaded++;
+        if (state.IsError())
+            return false;
+    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+        LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+    }
+
+    // Recursively process earlier encountered successors of this block
+    deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+            if (ReadBlockFromDisk(block, it->second, chainparams.GetConsensus()))
+            {
+                LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
+                        head.ToString());
+                CValidationState dummy;
+                if (ProcessNewBlock(dummy, chainparams, NULL, &block, true, &it->second))
+                {
+                    nLoaded++;
+                    queue.push_back(block.GetHash());
+                }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+        }
+    }
+    return true;
+}
+
+/**
+ * Process the blocks LoadExternalBlockFile read ahead, after hashing all their
+ * headers in one SIMD batch. Returns false if importing has to stop.
+ */
+static bool LoadExternalBlocks(const CChainParams& chainparams, std::vector<CBlock>& vBlocks, std::vector<CDiskBlockPos>& vPos, bool fHavePos, int& nLoaded)
+{
+    std::vector<const CBlockHeader*> vpHeaders;
+    for (unsigned int i = 0; i < vBlocks.size(); i++)
+        vpHeaders.push_back(&vBlocks[i]);
+    CBlockHeader::ComputeHashes(vpHeaders);
+
+    bool fContinue = true;
+    for (unsigned int i = 0; i < vBlocks.size() && fContinue; i++) {
+        try {
+            fContinue = LoadExternalBlock(chainparams, vBlocks[i], fHavePos ? &vPos[i] : NULL, nLoaded);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+    vBlocks.clear();
+    vPos.clear();
+    return fContinue;
+}
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
@@ -4785,6 +5036,12 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
+        // Blocks are read ahead in batches as wide as the NeoScrypt engine
+        const unsigned int nBatchSize = neoscrypt_simd_lanes();
+        std::vector<CBlock> vBlocks;
+        std::vector<CDiskBlockPos> vPos;
+        vBlocks.reserve(nBatchSize);
+        bool fContinue = true;
         while (!blkdat.eof()) {
             boost::this_thread::interruption_point();
 
@@ -4815,59 +5072,21 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                     dbp->nPos = nBlockPos;
                 blkdat.SetLimit(nBlockPos + nSize);
                 blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
+                vBlocks.resize(vBlocks.size() + 1);
+                blkdat >> vBlocks.back();
                 nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
-                }
-
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    CValidationState state;
-                    if (ProcessNewBlock(state, chainparams, NULL, &block, true, dbp))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
-
-                // Recursively process earlier encountered successors of this block
-                deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
-                                    head.ToString());
-                            CValidationState dummy;
-                            if (ProcessNewBlock(dummy, chainparams, NULL, &block, true, &it->second))
-                            {
-                                nLoaded++;
-                                queue.push_back(block.GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                    }
-                }
+                vPos.push_back(dbp ? *dbp : CDiskBlockPos());
             } catch (const std::exception& e) {
+                vBlocks.resize(vPos.size());
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+                continue;
             }
+
+            if (vBlocks.size() >= nBatchSize && !(fContinue = LoadExternalBlocks(chainparams, vBlocks, vPos, dbp != NULL, nLoaded)))
+                break;
         }
+        if (fContinue && !vBlocks.empty())
+            LoadExternalBlocks(chainparams, vBlocks, vPos, dbp != NULL, nLoaded);
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
@@ -5498,6 +5717,66 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
     }
 }
 
+static void ProcessPrivateSendMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    darkSendPool.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+static void ProcessMasternodeMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    mnodeman.ProcessMessage(pfrom, strCommand, vRecv);
+    mnpayments.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+static void ProcessInstantSendMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    instantsend.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+static void ProcessGovernanceMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    governance.ProcessMessage(pfrom, strCommand, vRecv);
+}
+
+static CMessageWorkQueue privateSendQueue("msg-ps", &ProcessPrivateSendMessage);
+static CMessageWorkQueue masternodeQueue("msg-mn", &ProcessMasternodeMessage);
+static CMessageWorkQueue instantSendQueue("msg-is", &ProcessInstantSendMessage);
+static CMessageWorkQueue governanceQueue("msg-gov", &ProcessGovernanceMessage);
+
+/** Work queue of each command, filled by StartMessageWorkQueues() before the network starts */
+static std::map<std::string, CMessageWorkQueue*> mapMessageWorkQueues;
+
+static CMessageWorkQueue* GetMessageWorkQueue(const std::string& strCommand)
+{
+    std::map<std::string, CMessageWorkQueue*>::const_iterator it = mapMessageWorkQueues.find(strCommand);
+    return it == mapMessageWorkQueues.end() ? NULL : it->second;
+}
+
+void StartMessageWorkQueues(boost::thread_group& threadGroup)
+{
+    if (fLiteMode || !mapMessageWorkQueues.empty()) return;
+
+    // DSTX is relayed like a transaction and stays in ProcessMessage()
+    const char* vPrivateSend[] = {NetMsgType::DSACCEPT, NetMsgType::DSVIN, NetMsgType::DSQUEUE, NetMsgType::DSSTATUSUPDATE,
+                                  NetMsgType::DSFINALTX, NetMsgType::DSSIGNFINALTX, NetMsgType::DSCOMPLETE};
+    const char* vMasternode[] = {NetMsgType::MNANNOUNCE, NetMsgType::MNPING, NetMsgType::DSEG, NetMsgType::MNVERIFY,
+                                 NetMsgType::MASTERNODEPAYMENTSYNC, NetMsgType::MASTERNODEPAYMENTVOTE};
+    const char* vGovernance[] = {NetMsgType::MNGOVERNANCESYNC, NetMsgType::MNGOVERNANCEOBJECT, NetMsgType::MNGOVERNANCEOBJECTVOTE};
+
+    BOOST_FOREACH(const char* pszCommand, vPrivateSend)
+        mapMessageWorkQueues[pszCommand] = &privateSendQueue;
+    BOOST_FOREACH(const char* pszCommand, vMasternode)
+        mapMessageWorkQueues[pszCommand] = &masternodeQueue;
+    mapMessageWorkQueues[NetMsgType::TXLOCKVOTE] = &instantSendQueue;
+    BOOST_FOREACH(const char* pszCommand, vGovernance)
+        mapMessageWorkQueues[pszCommand] = &governanceQueue;
+
+    threadGroup.create_thread(boost::bind(&CMessageWorkQueue::Thread, &privateSendQueue));
+    threadGroup.create_thread(boost::bind(&CMessageWorkQueue::Thread, &masternodeQueue));
+    threadGroup.create_thread(boost::bind(&CMessageWorkQueue::Thread, &instantSendQueue));
+    threadGroup.create_thread(boost::bind(&CMessageWorkQueue::Thread, &governanceQueue));
+}
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
     const CChainParams& chainparams = Params();
@@ -6190,6 +6469,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // Hash all headers in parallel before taking cs_main, CheckBlockHeader
+        // then only compares the memoized hashes against their targets
+        ComputeHeaderHashes(headers);
+
         LOCK(cs_main);
 
         if (nCount == 0) {
@@ -6550,7 +6833,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             }
         }
 
-        if (found)
+        CMessageWorkQueue* pqueue = found ? GetMessageWorkQueue(strCommand) : NULL;
+        if (pqueue)
+        {
+            // ProcessMessages() made sure the queue has room for this peer
+            pqueue->Push(pfrom, strCommand, vRecv);
+        }
+        else if (found)
         {
             //probably one the extensions
             darkSendPool.ProcessMessage(pfrom, strCommand, vRecv);
@@ -6571,6 +6860,73 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     return true;
 }
 
+/**
+ * Verify signatures of all masternode, InstantSend, governance and mixing queue messages
+ * waiting in the receive queue of a peer at once, spread over the message check threads.
+ * Valid signatures end up in the message signature cache, so processing these messages
+ * one by one later doesn't need to recover any keys. Invalid or malformed messages are
+ * ignored here and rejected by ProcessMessage() as usual.
+ * Only called by ProcessMessages(), which holds cs_vRecvMsg.
+ */
+static void PreverifyMessageSignatures(CNode* pfrom)
+{
+    if(fLiteMode || !nMessageCheckThreads) return;
+
+    std::vector<CSignedMessageCheck> vChecks;
+
+    BOOST_FOREACH(CNetMessage& msg, pfrom->vRecvMsg) {
+        if(!msg.complete()) break;
+        if(msg.fSigsPreverified) continue;
+        msg.fSigsPreverified = true;
+
+        std::string strCommand = msg.hdr.GetCommand();
+        try {
+            // read in place, ProcessMessage() still needs the whole message
+            CDataStreamView vRecv(msg.vRecv);
+            if(strCommand == NetMsgType::MNANNOUNCE) {
+                CMasternodeBroadcast mnb;
+                vRecv >> mnb;
+                vChecks.push_back(CSignedMessageCheck(mnb.pubKeyCollateralAddress, mnb.vchSig, mnb.GetSignatureMessage()));
+                if(mnb.lastPing != CMasternodePing()) {
+                    vChecks.push_back(CSignedMessageCheck(mnb.pubKeyMasternode, mnb.lastPing.vchSig, mnb.lastPing.GetSignatureMessage()));
+                }
+            } else if(strCommand == NetMsgType::MNPING) {
+                CMasternodePing mnp;
+                vRecv >> mnp;
+                masternode_info_t infoMn = mnodeman.GetMasternodeInfo(mnp.vin);
+                if(infoMn.fInfoValid) {
+                    vChecks.push_back(CSignedMessageCheck(infoMn.pubKeyMasternode, mnp.vchSig, mnp.GetSignatureMessage()));
+                }
+            } else if(strCommand == NetMsgType::TXLOCKVOTE) {
+                CTxLockVote vote;
+                vRecv >> vote;
+                masternode_info_t infoMn = mnodeman.GetMasternodeInfo(CTxIn(vote.GetMasternodeOutpoint()));
+                if(infoMn.fInfoValid) {
+                    vChecks.push_back(CSignedMessageCheck(infoMn.pubKeyMasternode, vote.GetSignature(), vote.GetSignatureMessage()));
+                }
+            } else if(strCommand == NetMsgType::MNGOVERNANCEOBJECTVOTE) {
+                CGovernanceVote vote;
+                vRecv >> vote;
+                masternode_info_t infoMn = mnodeman.GetMasternodeInfo(vote.GetVinMasternode());
+                if(infoMn.fInfoValid) {
+                    vChecks.push_back(CSignedMessageCheck(infoMn.pubKeyMasternode, vote.GetSignature(), vote.GetSignatureMessage()));
+                }
+            } else if(strCommand == NetMsgType::DSQUEUE) {
+                CDarksendQueue dsq;
+                vRecv >> dsq;
+                masternode_info_t infoMn = mnodeman.GetMasternodeInfo(dsq.vin);
+                if(infoMn.fInfoValid) {
+                    vChecks.push_back(CSignedMessageCheck(infoMn.pubKeyMasternode, dsq.vchSig, dsq.GetSignatureMessage()));
+                }
+            }
+        } catch (const std::exception&) {
+            // malformed, let ProcessMessage() deal with it
+        }
+    }
+
+    darkSendSigner.VerifyMessageBatch(vChecks);
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool ProcessMessages(CNode* pfrom)
 {
@@ -6594,6 +6950,15 @@ bool ProcessMessages(CNode* pfrom)
     // this maintains the order of responses
     if (!pfrom->vRecvGetData.empty()) return fOk;
 
+    PreverifyMessageSignatures(pfrom);
+
+    pfrom->fPauseProcess = false;
+
+    // misbehavior from the work queues may have earned a ban since the last
+    // SendMessages(), don't take another message from the peer before that
+    if (IsBanPending(pfrom->GetId()))
+        return fOk;
+
     std::deque<CNetMessage>::iterator it = pfrom->vRecvMsg.begin();
     while (!pfrom->fDisconnect && it != pfrom->vRecvMsg.end()) {
         // Don't bother if send buffer is too full to respond anyway
@@ -6612,6 +6977,13 @@ bool ProcessMessages(CNode* pfrom)
         if (!msg.complete())
             break;
 
+        // keep the message until its work queue has room for it, see CMessageWorkQueue
+        CMessageWorkQueue* pqueue = GetMessageWorkQueue(msg.hdr.GetCommand());
+        if (pqueue && !pqueue->HasRoom(pfrom->GetId())) {
+            pfrom->fPauseProcess = true;
+            break;
+        }
+
         // at this point, any failure means we can delete the current message
         it++;
 
@@ -6767,6 +7139,7 @@ bool SendMessages(CNode* pto)
                 pto->PushMessage(NetMsgType::ADDR, vAddr);
         }
 
+        ApplyPendingMisbehavior(pto->GetId());
         CNodeState &state = *State(pto->GetId());
         if (state.fShouldBan) {
             if (pto->fWhitelisted)
@@ -6781,6 +7154,8 @@ bool SendMessages(CNode* pto)
                 }
             }
             state.fShouldBan = false;
+            LOCK(cs_mapPendingMisbehavior);
+            setPendingBan.erase(pto->GetId());
         }
 
         BOOST_FOREACH(const CBlockReject& reject, state.rejects)
@@ -7074,6 +7449,173 @@ ThresholdState VersionBitsTipState(const Consensus::Params& params, Consensus::D
     return VersionBitsState(chainActive.Tip(), params, pos, versionbitscache);
 }
 
+static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+
+/**
+ * Accept a batch of dumped transactions back into the mempool. The scripts of the
+ * whole batch are verified on the script check threads first, which leaves their
+ * signatures in the signature cache, so AcceptToMemoryPool() going through the
+ * transactions one by one afterwards doesn't have to do any ECDSA work.
+ */
+static void LoadMempoolBatch(const std::vector<std::pair<CTransaction, int64_t> >& vTxs, int64_t nExpiryTime,
+                             int& nAcceptedRet, int& nFailedRet, int& nExpiredRet)
+{
+    LOCK(cs_main);
+
+    if (nScriptCheckThreads) {
+        std::vector<CScriptCheck> vChecks;
+        {
+            CCoinsView dummy;
+            CCoinsViewCache view(&dummy);
+            LOCK(mempool.cs);
+            CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
+            view.SetBackend(viewMemPool);
+            for (size_t i = 0; i < vTxs.size(); i++) {
+                const CTransaction& tx = vTxs[i].first;
+                if (vTxs[i].second < nExpiryTime || !view.HaveInputs(tx))
+                    continue;
+                for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                    vChecks.push_back(CScriptCheck());
+                    CScriptCheck check(*view.AccessCoins(tx.vin[j].prevout.hash), tx, j, STANDARD_SCRIPT_VERIFY_FLAGS, true);
+                    check.swap(vChecks.back());
+                }
+                // later transactions of the batch may spend this one
+                view.ModifyNewCoins(tx.GetHash())->FromTx(tx, MEMPOOL_HEIGHT);
+            }
+            view.SetBackend(dummy);
+        }
+
+        // failures are reported by AcceptToMemoryPool() below
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    for (size_t i = 0; i < vTxs.size(); i++) {
+        if (vTxs[i].second < nExpiryTime) {
+            nExpiredRet++;
+            continue;
+        }
+        CValidationState state;
+        if (AcceptToMemoryPoolWithTime(mempool, state, vTxs[i].first, true, NULL, vTxs[i].second)) {
+            nAcceptedRet++;
+        } else {
+            nFailedRet++;
+        }
+    }
+}
+
+bool LoadMempool()
+{
+    int64_t nStart = GetTimeMicros();
+    int64_t nExpiryTime = GetTime() - GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
+    int nAccepted = 0;
+    int nFailed = 0;
+    int nExpired = 0;
+
+    FILE* filestr = fopen((GetDataDir() / "mempool.dat").string().c_str(), "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open mempool file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    try {
+        uint64_t nVersion;
+        file >> nVersion;
+        if (nVersion != MEMPOOL_DUMP_VERSION) {
+            return error("%s: Unknown mempool file version %d", __func__, nVersion);
+        }
+
+        // deltas come first so the transactions are accepted with their modified fees
+        std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+        file >> mapDeltas;
+        for (std::map<uint256, std::pair<double, CAmount> >::const_iterator it = mapDeltas.begin(); it != mapDeltas.end(); ++it) {
+            mempool.PrioritiseTransaction(it->first, it->first.ToString(), it->second.first, it->second.second);
+        }
+
+        uint64_t nTxs;
+        file >> nTxs;
+        std::vector<std::pair<CTransaction, int64_t> > vTxs;
+        while (nTxs) {
+            vTxs.resize(std::min<uint64_t>(nTxs, MEMPOOL_LOAD_BATCH_SIZE));
+            for (size_t i = 0; i < vTxs.size(); i++) {
+                file >> vTxs[i].first;
+                file >> vTxs[i].second;
+            }
+            nTxs -= vTxs.size();
+            LoadMempoolBatch(vTxs, nExpiryTime, nAccepted, nFailed, nExpired);
+            if (ShutdownRequested())
+                return false;
+        }
+
+        std::vector<CTxLockRequest> vecLockRequests;
+        std::vector<CTxLockVote> vecLockVotes;
+        file >> vecLockRequests;
+        file >> vecLockVotes;
+        instantsend.RestoreLockState(vecLockRequests, vecLockVotes);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    LogPrintf("Imported mempool transactions from disk: %i successes, %i failed, %i expired, %.2fms\n",
+              nAccepted, nFailed, nExpired, 0.001 * (GetTimeMicros() - nStart));
+    return true;
+}
+
+bool DumpMempool()
+{
+    int64_t nStart = GetTimeMicros();
+
+    std::vector<CTxMemPoolEntry> vEntries;
+    std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    std::vector<CTxLockRequest> vecLockRequests;
+    std::vector<CTxLockVote> vecLockVotes;
+
+    mempool.queryEntries(vEntries);
+    {
+        LOCK(mempool.cs);
+        mapDeltas = mempool.mapDeltas;
+    }
+    instantsend.GetLockState(vecLockRequests, vecLockVotes);
+
+    int64_t nMid = GetTimeMicros();
+
+    try {
+        boost::filesystem::path pathMempool = GetDataDir() / "mempool.dat";
+        boost::filesystem::path pathTmp = GetDataDir() / "mempool.dat.new";
+        FILE* filestr = fopen(pathTmp.string().c_str(), "wb");
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        if (file.IsNull()) {
+            return error("%s: Failed to open %s", __func__, pathTmp.string());
+        }
+
+        file << MEMPOOL_DUMP_VERSION;
+        file << mapDeltas;
+        file << (uint64_t)vEntries.size();
+        BOOST_FOREACH(const CTxMemPoolEntry& entry, vEntries) {
+            file << entry.GetTx();
+            file << entry.GetTime();
+        }
+        file << vecLockRequests;
+        file << vecLockVotes;
+
+        FileCommit(file.Get());
+        file.fclose();
+        if (!RenameOver(pathTmp, pathMempool)) {
+            return error("%s: Rename-into-place failed", __func__);
+        }
+    } catch (const std::exception& e) {
+        return error("%s: %s", __func__, e.what());
+    }
+
+    LogPrintf("Dumped mempool: %d transactions, %d lock requests, %d lock votes, %.2fms to copy, %.2fms to dump\n",
+              vEntries.size(), vecLockRequests.size(), vecLockVotes.size(),
+              0.001 * (nMid - nStart), 0.001 * (GetTimeMicros() - nMid));
+    return true;
+}
+
 class CMainCleanup
 {
 public:
@@ -34,6 +34,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CAddressIndexDB;
 class CBloomFilter;
 class CChainParams;
 class CInv;
@@ -42,6 +43,10 @@ class CTxMemPool;
 class CValidationInterface;
 class CValidationState;
 
+namespace boost {
+class thread_group;
+} // namespace boost
+
 struct CNodeStateStats;
 struct LockPoints;
 
@@ -68,6 +73,10 @@ static const unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
 static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 101;
 /** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
 static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 72;
+/** Default for -persistmempool, save the mempool on shutdown and load it on startup */
+static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Number of dumped transactions accepted back into the mempool under one cs_main lock */
+static const unsigned int MEMPOOL_LOAD_BATCH_SIZE = 1000;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
@@ -79,6 +88,10 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of threads checking network message signatures or header hashes */
+static const int MAX_MSGCHECK_THREADS = 8;
+/** -parmsgcheck default (number of threads checking network message signatures, and header hashes) */
+static const int DEFAULT_MSGCHECK_THREADS = 2;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -147,7 +160,11 @@ extern CConditionVariable cvBlockChange;
 extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
+extern int nMessageCheckThreads;
 extern bool fTxIndex;
+extern bool fAddressIndex;
+extern bool fTimestampIndex;
+extern bool fSpentIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
@@ -231,8 +248,12 @@ bool ProcessMessages(CNode* pfrom);
  * @param[in]   pto             The node which we are sending messages to.
  */
 bool SendMessages(CNode* pto);
+/** Start the worker threads handling masternode, governance, InstantSend and PrivateSend messages */
+void StartMessageWorkQueues(boost::thread_group& threadGroup);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header hash checking thread */
+void ThreadHeaderHashCheck();
 
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
@@ -298,6 +319,16 @@ void PruneAndFlush();
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
                         bool* pfMissingInputs, bool fOverrideMempoolLimit=false, bool fRejectAbsurdFee=false, bool fDryRun=false);
 
+/** (try to) add transaction to memory pool with a specified acceptance time **/
+bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
+                                bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit=false, bool fRejectAbsurdFee=false, bool fDryRun=false);
+
+/** Dump the mempool, its fee deltas and InstantSend lock state to disk. */
+bool DumpMempool();
+
+/** Load the mempool from disk. */
+bool LoadMempool();
+
 int GetUTXOHeight(const COutPoint& outpoint);
 int GetInputAge(const CTxIn &txin);
 int GetInputAgeIX(const uint256 &nTXHash, const CTxIn &txin);
@@ -551,6 +582,36 @@ struct CAddressIndexIteratorKey {
     }
 };
 
+/** Running totals of one address, kept up to date as blocks are connected and disconnected */
+struct CAddressBalance {
+    CAmount balance;
+    CAmount received;
+    unsigned int txCount;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(txCount);
+    }
+
+    CAddressBalance() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txCount = 0;
+    }
+
+    bool IsNull() const {
+        return txCount == 0;
+    }
+};
+
 struct CAddressIndexIteratorHeightKey {
     unsigned int type;
     uint160 hashBytes;
@@ -719,13 +780,42 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure memoizing the NeoScrypt hashes of a run of received headers
+ * Note that this stores pointers to the headers
+ */
+class CHeaderHashCheck
+{
+private:
+    std::vector<const CBlockHeader*> vpHeaders;
+
+public:
+    CHeaderHashCheck() {}
+    CHeaderHashCheck(std::vector<const CBlockHeader*>::const_iterator begin, std::vector<const CBlockHeader*>::const_iterator end) :
+        vpHeaders(begin, end) { }
+
+    bool operator()();
+
+    void swap(CHeaderHashCheck &check) {
+        vpHeaders.swap(check.vpHeaders);
+    }
+};
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0,
+                     const CAddressIndexKey *pkeyAfter = NULL, unsigned int nLimit = 0);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalance &balance);
+/**
+ * Whether the block the address balances are valid for is on the active chain
+ * or ahead of its tip. A tip on a stale branch would leave that branch counted
+ * in the balances, as its blocks are never disconnected again.
+ */
+bool CheckAddressIndexTip();
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
@@ -862,6 +952,9 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/** Global variable that points to the address, spent and timestamp indexes (protected by cs_main) */
+extern CAddressIndexDB *paddressindex;
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
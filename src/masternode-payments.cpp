@@ -21,6 +21,7 @@ CMasternodePayments mnpayments;
 CCriticalSection cs_vecPayees;
 CCriticalSection cs_mapMasternodeBlocks;
 CCriticalSection cs_mapMasternodePaymentVotes;
+CCriticalSection cs_mapCoinbasePayees;
 
 /**
 * IsBlockValueValid
@@ -343,7 +344,10 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, std::string& strCommand,
 
         uint256 nHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(nHash);
+        }
 
         {
             LOCK(cs_mapMasternodePaymentVotes);
@@ -483,10 +487,22 @@ bool CMasternodePayments::AddPaymentVote(const CMasternodePaymentVote& vote)
     }
 
     mapMasternodeBlocks[vote.nBlockHeight].AddPayee(vote);
+    journal.Add(MNPAYMENTS_JOURNAL_VOTE, vote);
 
     return true;
 }
 
+void CMasternodePayments::ApplyJournalRecord(const CFlatDBJournalRecord& record)
+{
+    if(record.nType != MNPAYMENTS_JOURNAL_VOTE) return;
+
+    CMasternodePaymentVote vote;
+    CDataStream ss(record.vchData, SER_DISK, CLIENT_VERSION);
+    ss >> vote;
+    // already known votes and votes for blocks we don't have are skipped
+    AddPaymentVote(vote);
+}
+
 bool CMasternodePayments::HasVerifiedPaymentVote(uint256 hashIn)
 {
     LOCK(cs_mapMasternodePaymentVotes);
@@ -631,6 +647,65 @@ bool CMasternodePayments::IsTransactionValid(const CTransaction& txNew, int nBlo
     return true;
 }
 
+static void GetMasternodePaymentOutputs(const CTransaction& txCoinbase, int nBlockHeight, std::vector<CScript>& vecPayeesRet)
+{
+    CAmount nMasternodePayment = GetMasternodePayment(nBlockHeight, txCoinbase.GetValueOut());
+
+    vecPayeesRet.clear();
+    BOOST_FOREACH(const CTxOut& txout, txCoinbase.vout) {
+        if(txout.nValue == nMasternodePayment) {
+            vecPayeesRet.push_back(txout.scriptPubKey);
+        }
+    }
+}
+
+void CMasternodePayments::ConnectCoinbasePayees(const CBlock& block, const CBlockIndex* pindex)
+{
+    if(fLiteMode) return;
+
+    // older blocks are never scanned, see CMasternodeMan::UpdateLastPaid
+    int nFirstHeight = pindex->nHeight - GetStorageLimit();
+
+    LOCK(cs_mapCoinbasePayees);
+
+    std::pair<uint256, std::vector<CScript> >& payees = mapCoinbasePayees[pindex->nHeight];
+    payees.first = pindex->GetBlockHash();
+    GetMasternodePaymentOutputs(block.vtx[0], pindex->nHeight, payees.second);
+
+    mapCoinbasePayees.erase(mapCoinbasePayees.begin(), mapCoinbasePayees.lower_bound(nFirstHeight));
+}
+
+void CMasternodePayments::DisconnectCoinbasePayees(const CBlockIndex* pindex)
+{
+    LOCK(cs_mapCoinbasePayees);
+    mapCoinbasePayees.erase(pindex->nHeight);
+}
+
+bool CMasternodePayments::GetCoinbasePayees(const CBlockIndex* pindex, std::vector<CScript>& vecPayeesRet)
+{
+    {
+        LOCK(cs_mapCoinbasePayees);
+        std::map<int, std::pair<uint256, std::vector<CScript> > >::iterator it = mapCoinbasePayees.find(pindex->nHeight);
+        if(it != mapCoinbasePayees.end() && it->second.first == pindex->GetBlockHash()) {
+            vecPayeesRet = it->second.second;
+            return true;
+        }
+    }
+
+    // connected before this node started or on another branch, read it once
+    CBlock block;
+    if(!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) // shouldn't really happen
+        return false;
+    GetMasternodePaymentOutputs(block.vtx[0], pindex->nHeight, vecPayeesRet);
+
+    LOCK(cs_mapCoinbasePayees);
+    std::map<int, std::pair<uint256, std::vector<CScript> > >::iterator it = mapCoinbasePayees.find(pindex->nHeight);
+    if(it == mapCoinbasePayees.end()) {
+        mapCoinbasePayees.insert(std::make_pair(pindex->nHeight, std::make_pair(pindex->GetBlockHash(), vecPayeesRet)));
+    }
+    return true;
+}
+
 void CMasternodePayments::CheckAndRemove()
 {
     if(!pCurrentBlockIndex) return;
@@ -8,6 +8,7 @@
 
 #include "util.h"
 #include "core_io.h"
+#include "flat-database.h"
 #include "key.h"
 #include "main.h"
 #include "masternode.h"
@@ -20,6 +21,9 @@ class CMasternodeBlockPayees;
 static const int MNPAYMENTS_SIGNATURES_REQUIRED         = 6;
 static const int MNPAYMENTS_SIGNATURES_TOTAL            = 10;
 
+//! journal record type of a payment vote, see CJournaledFlatDB
+static const unsigned char MNPAYMENTS_JOURNAL_VOTE = 1;
+
 //! minimum peer version that can receive and send masternode payment messages,
 //  vote for masternode and be elected as a payment winner
 // V1 - Last protocol version before update
@@ -29,7 +33,8 @@ static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION_2 = 70210;
 
 extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapMasternodeBlocks;
-extern CCriticalSection cs_mapMasternodePayeeVotes;
+extern CCriticalSection cs_mapMasternodePaymentVotes;
+extern CCriticalSection cs_mapCoinbasePayees;
 
 extern CMasternodePayments mnpayments;
 
@@ -176,6 +181,13 @@ private:
     // Keep track of current block index
     const CBlockIndex *pCurrentBlockIndex;
 
+    /// Payment votes added since the last dump, see CJournaledFlatDB
+    CFlatDBJournal journal;
+
+    /// Block hash and outputs paying the masternode amount of the coinbase of each active chain block
+    /// within the storage limit, so last paid blocks are found without reading blocks from disk
+    std::map<int, std::pair<uint256, std::vector<CScript> > > mapCoinbasePayees;
+
 public:
     std::map<uint256, CMasternodePaymentVote> mapMasternodePaymentVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
@@ -187,6 +199,8 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        // dumps run on the scheduler thread while votes keep coming in
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
         READWRITE(mapMasternodePaymentVotes);
         READWRITE(mapMasternodeBlocks);
     }
@@ -201,7 +215,17 @@ public:
     void RequestLowDataPaymentBlocks(CNode* pnode);
     void CheckAndRemove();
 
+    /// Journal support for CJournaledFlatDB
+    bool TakeJournal(std::vector<CFlatDBJournalRecord>& vecRecordsRet) { return journal.Take(vecRecordsRet); }
+    void RestoreJournal(std::vector<CFlatDBJournalRecord>& vecRecords, bool fComplete) { journal.Restore(vecRecords, fComplete); }
+    void ApplyJournalRecord(const CFlatDBJournalRecord& record);
+
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
+    /// Keep mapCoinbasePayees in line with the active chain, called by ConnectBlock() and DisconnectBlock()
+    void ConnectCoinbasePayees(const CBlock& block, const CBlockIndex* pindex);
+    void DisconnectCoinbasePayees(const CBlockIndex* pindex);
+    /// Outputs of the coinbase of pindex that could be masternode payments
+    bool GetCoinbasePayees(const CBlockIndex* pindex, std::vector<CScript>& vecPayeesRet);
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight);
     bool IsScheduled(CMasternode& mn, int nNotBlockHeight);
 
@@ -29,10 +29,15 @@ struct CompareLastPaidBlock
 
 struct CompareScoreMN
 {
-    bool operator()(const std::pair<int64_t, CMasternode*>& t1,
-                    const std::pair<int64_t, CMasternode*>& t2) const
+    const std::vector<CMasternode>& vMasternodes;
+
+    CompareScoreMN(const std::vector<CMasternode>& vMasternodesIn) : vMasternodes(vMasternodesIn) {}
+
+    // best score first
+    bool operator()(const std::pair<int64_t, int>& t1,
+                    const std::pair<int64_t, int>& t2) const
     {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
+        return (t1.first != t2.first) ? (t1.first > t2.first) : (vMasternodes[t2.second].vin < vMasternodes[t1.second].vin);
     }
 };
 
@@ -97,6 +102,57 @@ void CMasternodeIndex::RebuildIndex()
     }
 }
 
+CMasternodeLookupIndex::COutPointHasher::COutPointHasher() : salt(GetRandHash()) {}
+
+CMasternodeLookupIndex::CKeyIDHasher::CKeyIDHasher() : salt(GetRandHash()) {}
+
+CMasternodeLookupIndex::CMasternodeLookupIndex()
+    : mapByOutpoint(),
+      mapByPubKeyMasternode(),
+      mapByCollateralKeyID()
+{}
+
+void CMasternodeLookupIndex::Add(const CMasternode& mn, int nPos)
+{
+    // insert() never overwrites, so the first entry with a given key wins
+    mapByOutpoint.insert(std::make_pair(mn.vin.prevout, nPos));
+    mapByPubKeyMasternode.insert(std::make_pair(mn.pubKeyMasternode.GetID(), nPos));
+    mapByCollateralKeyID.insert(std::make_pair(mn.pubKeyCollateralAddress.GetID(), nPos));
+}
+
+void CMasternodeLookupIndex::Rebuild(const std::vector<CMasternode>& vMasternodes)
+{
+    Clear();
+    for(size_t i = 0; i < vMasternodes.size(); ++i) {
+        Add(vMasternodes[i], i);
+    }
+}
+
+void CMasternodeLookupIndex::Clear()
+{
+    mapByOutpoint.clear();
+    mapByPubKeyMasternode.clear();
+    mapByCollateralKeyID.clear();
+}
+
+int CMasternodeLookupIndex::FindByOutpoint(const COutPoint& outpoint) const
+{
+    outpoint_m_t::const_iterator it = mapByOutpoint.find(outpoint);
+    return it == mapByOutpoint.end() ? -1 : it->second;
+}
+
+int CMasternodeLookupIndex::FindByPubKeyMasternode(const CKeyID& keyID) const
+{
+    keyid_m_t::const_iterator it = mapByPubKeyMasternode.find(keyID);
+    return it == mapByPubKeyMasternode.end() ? -1 : it->second;
+}
+
+int CMasternodeLookupIndex::FindByCollateralKeyID(const CKeyID& keyID) const
+{
+    keyid_m_t::const_iterator it = mapByCollateralKeyID.find(keyID);
+    return it == mapByCollateralKeyID.end() ? -1 : it->second;
+}
+
 CMasternodeMan::CMasternodeMan()
 : cs(),
   vMasternodes(),
@@ -110,10 +166,15 @@ CMasternodeMan::CMasternodeMan()
   nLastIndexRebuildTime(0),
   indexMasternodes(),
   indexMasternodesOld(),
+  indexLookup(),
+  mapScoreCache(),
   fIndexRebuilt(false),
   fMasternodesAdded(false),
   fMasternodesRemoved(false),
   vecDirtyGovernanceObjectHashes(),
+  mapLastChanged(),
+  mapRemovedTime(),
+  nRemovedHistoryStart(GetAdjustedTime()),
   nLastWatchdogVoteTime(0),
   mapSeenMasternodeBroadcast(),
   mapSeenMasternodePing(),
@@ -129,6 +190,10 @@ bool CMasternodeMan::Add(CMasternode &mn)
         LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
         vMasternodes.push_back(mn);
         indexMasternodes.AddMasternodeVIN(mn.vin);
+        indexLookup.Add(mn, vMasternodes.size() - 1);
+        mapScoreCache.clear();
+        mapRemovedTime.erase(mn.vin.prevout);
+        UpdateLastChanged(mn);
         fMasternodesAdded = true;
         return true;
     }
@@ -173,6 +238,7 @@ void CMasternodeMan::Check()
 
     BOOST_FOREACH(CMasternode& mn, vMasternodes) {
         mn.Check();
+        UpdateLastChanged(mn);
     }
 }
 
@@ -194,6 +260,7 @@ void CMasternodeMan::CheckAndRemove()
         std::vector<std::pair<int, CMasternode> > vecMasternodeRanks;
         // ask for up to MNB_RECOVERY_MAX_ASK_ENTRIES masternode entries at a time
         int nAskForMnbRecovery = MNB_RECOVERY_MAX_ASK_ENTRIES;
+        bool fErased = false;
         while(it != vMasternodes.end()) {
             CMasternodeBroadcast mnb = CMasternodeBroadcast(*it);
             uint256 hash = mnb.GetHash();
@@ -207,8 +274,11 @@ void CMasternodeMan::CheckAndRemove()
 
                 // and finally remove it from the list
                 it->FlagGovernanceItemsAsDirty();
+                mapLastChanged.erase(it->vin.prevout);
+                mapRemovedTime[it->vin.prevout] = GetAdjustedTime();
                 it = vMasternodes.erase(it);
                 fMasternodesRemoved = true;
+                fErased = true;
             } else {
                 bool fAsk = pCurrentBlockIndex &&
                             (nAskForMnbRecovery > 0) &&
@@ -245,6 +315,25 @@ void CMasternodeMan::CheckAndRemove()
             }
         }
 
+        // erasing shifted positions of the remaining masternodes, reindex them
+        // before CheckMnbAndUpdateMasternodeList() below calls Find()
+        if(fErased) {
+            indexLookup.Rebuild(vMasternodes);
+            mapScoreCache.clear();
+        }
+
+        // forget removals no delta query is expected to ask for anymore
+        int64_t nRemovedForget = GetAdjustedTime() - REMOVED_HISTORY_SECONDS;
+        nRemovedHistoryStart = std::max(nRemovedHistoryStart, nRemovedForget);
+        std::map<COutPoint, int64_t>::iterator itRemoved = mapRemovedTime.begin();
+        while(itRemoved != mapRemovedTime.end()) {
+            if(itRemoved->second < nRemovedForget) {
+                mapRemovedTime.erase(itRemoved++);
+            } else {
+                ++itRemoved;
+            }
+        }
+
         // proces replies for MASTERNODE_NEW_START_REQUIRED masternodes
         LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- mMnbRecoveryGoodReplies size=%d\n", (int)mMnbRecoveryGoodReplies.size());
         std::map<uint256, std::vector<CMasternodeBroadcast> >::iterator itMnbReplies = mMnbRecoveryGoodReplies.begin();
@@ -377,6 +466,47 @@ void CMasternodeMan::Clear()
     nLastWatchdogVoteTime = 0;
     indexMasternodes.Clear();
     indexMasternodesOld.Clear();
+    indexLookup.Clear();
+    mapScoreCache.clear();
+    mapLastChanged.clear();
+    mapRemovedTime.clear();
+    nRemovedHistoryStart = GetAdjustedTime();
+}
+
+int64_t CMasternodeMan::UpdateLastChanged(const CMasternode& mn)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << mn.nActiveState << mn.addr << mn.pubKeyMasternode << mn.sigTime << mn.lastPing.sigTime << mn.nTimeLastPaid << mn.nProtocolVersion;
+    uint256 hashState = ss.GetHash();
+
+    std::pair<uint256, int64_t>& lastChanged = mapLastChanged[mn.vin.prevout];
+    if(lastChanged.second == 0 || lastChanged.first != hashState) {
+        lastChanged.first = hashState;
+        lastChanged.second = GetAdjustedTime();
+    }
+    return lastChanged.second;
+}
+
+bool CMasternodeMan::GetMasternodesChangedSince(int64_t nTime, std::vector<masternode_info_t>& vecChanged, std::vector<COutPoint>& vecRemoved)
+{
+    LOCK(cs);
+
+    bool fComplete = nTime >= nRemovedHistoryStart;
+
+    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
+        if(UpdateLastChanged(mn) >= nTime || !fComplete) {
+            vecChanged.push_back(mn.GetInfo());
+        }
+    }
+
+    if(!fComplete) return false;
+
+    for(std::map<COutPoint, int64_t>::iterator it = mapRemovedTime.begin(); it != mapRemovedTime.end(); ++it) {
+        if(it->second >= nTime) {
+            vecRemoved.push_back(it->first);
+        }
+    }
+    return true;
 }
 
 int CMasternodeMan::CountMasternodes(int nProtocolVersion)
@@ -447,38 +577,32 @@ void CMasternodeMan::DsegUpdate(CNode* pnode)
 
 CMasternode* CMasternodeMan::Find(const CScript &payee)
 {
+    // masternodes are only ever paid to P2PKH scripts of their collateral key
+    if(!payee.IsPayToPublicKeyHash()) return NULL;
+
     LOCK(cs);
 
-    BOOST_FOREACH(CMasternode& mn, vMasternodes)
-    {
-        if(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()) == payee)
-            return &mn;
-    }
-    return NULL;
+    int nPos = indexLookup.FindByCollateralKeyID(CKeyID(uint160(std::vector<unsigned char>(payee.begin() + 3, payee.begin() + 23))));
+    if(nPos < 0) return NULL;
+    return &vMasternodes[nPos];
 }
 
 CMasternode* CMasternodeMan::Find(const CTxIn &vin)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CMasternode& mn, vMasternodes)
-    {
-        if(mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return NULL;
+    int nPos = indexLookup.FindByOutpoint(vin.prevout);
+    if(nPos < 0) return NULL;
+    return &vMasternodes[nPos];
 }
 
 CMasternode* CMasternodeMan::Find(const CPubKey &pubKeyMasternode)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CMasternode& mn, vMasternodes)
-    {
-        if(mn.pubKeyMasternode == pubKeyMasternode)
-            return &mn;
-    }
-    return NULL;
+    int nPos = indexLookup.FindByPubKeyMasternode(pubKeyMasternode.GetID());
+    if(nPos < 0 || vMasternodes[nPos].pubKeyMasternode != pubKeyMasternode) return NULL;
+    return &vMasternodes[nPos];
 }
 
 bool CMasternodeMan::Get(const CPubKey& pubKeyMasternode, CMasternode& masternode)
@@ -605,8 +729,9 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
     int nTenthNetwork = nMnCount/10;
     int nCountTenth = 0;
     arith_uint256 nHighest = 0;
+    arith_uint256 hashBlockScore = CMasternode::GetBlockScoreHash(blockHash);
     BOOST_FOREACH (PAIRTYPE(int, CMasternode*)& s, vecMasternodeLastPaid){
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
+        arith_uint256 nScore = s.second->CalculateScore(blockHash, hashBlockScore);
         if(nScore > nHighest){
             nHighest = nScore;
             pBestMasternode = s.second;
@@ -660,18 +785,49 @@ CMasternode* CMasternodeMan::FindRandomNotInVec(const std::vector<CTxIn> &vecToE
     return NULL;
 }
 
-int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+const CMasternodeMan::score_pair_vec_t& CMasternodeMan::GetScores(const uint256& blockHash)
 {
-    std::vector<std::pair<int64_t, CMasternode*> > vecMasternodeScores;
+    AssertLockHeld(cs);
+
+    std::map<uint256, score_pair_vec_t>::iterator it = mapScoreCache.find(blockHash);
+    if(it != mapScoreCache.end()) {
+        return it->second;
+    }
+
+    if(mapScoreCache.size() >= MAX_SCORE_CACHE_ENTRIES) {
+        mapScoreCache.clear();
+    }
+
+    score_pair_vec_t& vecMasternodeScores = mapScoreCache[blockHash];
+    vecMasternodeScores.reserve(vMasternodes.size());
+
+    arith_uint256 hashBlockScore = CMasternode::GetBlockScoreHash(blockHash);
+    for(size_t i = 0; i < vMasternodes.size(); ++i) {
+        int64_t nScore = vMasternodes[i].CalculateScore(blockHash, hashBlockScore).GetCompact(false);
+        vecMasternodeScores.push_back(std::make_pair(nScore, i));
+    }
+
+    sort(vecMasternodeScores.begin(), vecMasternodeScores.end(), CompareScoreMN(vMasternodes));
+
+    return vecMasternodeScores;
+}
 
+int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+{
     //make sure we know about this block
     uint256 blockHash = uint256();
     if(!GetBlockHash(blockHash, nBlockHeight)) return -1;
 
     LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
+    // no need to rank anything if we don't know this masternode at all
+    if(!Find(vin)) return -1;
+
+    const score_pair_vec_t& vecMasternodeScores = GetScores(blockHash);
+
+    int nRank = 0;
+    BOOST_FOREACH (const PAIRTYPE(int64_t, int)& scorePair, vecMasternodeScores) {
+        CMasternode& mn = vMasternodes[scorePair.second];
         if(mn.nProtocolVersion < nMinProtocol) continue;
         if(fOnlyActive) {
             if(!mn.IsEnabled()) continue;
@@ -679,17 +835,8 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int nBlockHeight, int nM
         else {
             if(!mn.IsValidForPayment()) continue;
         }
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
-
-    int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CMasternode*)& scorePair, vecMasternodeScores) {
         nRank++;
-        if(scorePair.second->vin.prevout == vin.prevout) return nRank;
+        if(mn.vin.prevout == vin.prevout) return nRank;
     }
 
     return -1;
@@ -697,7 +844,6 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int nBlockHeight, int nM
 
 std::vector<std::pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int nBlockHeight, int nMinProtocol)
 {
-    std::vector<std::pair<int64_t, CMasternode*> > vecMasternodeScores;
     std::vector<std::pair<int, CMasternode> > vecMasternodeRanks;
 
     //make sure we know about this block
@@ -706,22 +852,14 @@ std::vector<std::pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int
 
     LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
-
-        if(mn.nProtocolVersion < nMinProtocol || !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
+    const score_pair_vec_t& vecMasternodeScores = GetScores(blockHash);
 
     int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CMasternode*)& s, vecMasternodeScores) {
+    BOOST_FOREACH (const PAIRTYPE(int64_t, int)& s, vecMasternodeScores) {
+        CMasternode& mn = vMasternodes[s.second];
+        if(mn.nProtocolVersion < nMinProtocol || !mn.IsEnabled()) continue;
         nRank++;
-        vecMasternodeRanks.push_back(std::make_pair(nRank, *s.second));
+        vecMasternodeRanks.push_back(std::make_pair(nRank, mn));
     }
 
     return vecMasternodeRanks;
@@ -729,8 +867,6 @@ std::vector<std::pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int
 
 CMasternode* CMasternodeMan::GetMasternodeByRank(int nRank, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CMasternode*> > vecMasternodeScores;
-
     LOCK(cs);
 
     uint256 blockHash;
@@ -739,24 +875,16 @@ CMasternode* CMasternodeMan::GetMasternodeByRank(int nRank, int nBlockHeight, in
         return NULL;
     }
 
-    // Fill scores
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
+    const score_pair_vec_t& vecMasternodeScores = GetScores(blockHash);
 
+    int rank = 0;
+    BOOST_FOREACH (const PAIRTYPE(int64_t, int)& s, vecMasternodeScores){
+        CMasternode& mn = vMasternodes[s.second];
         if(mn.nProtocolVersion < nMinProtocol) continue;
         if(fOnlyActive && !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
-
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CMasternode*)& s, vecMasternodeScores){
         rank++;
         if(rank == nRank) {
-            return s.second;
+            return &mn;
         }
     }
 
@@ -816,7 +944,10 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         CMasternodeBroadcast mnb;
         vRecv >> mnb;
 
-        pfrom->setAskFor.erase(mnb.GetHash());
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(mnb.GetHash());
+        }
 
         LogPrint("masternode", "MNANNOUNCE -- Masternode announce, masternode=%s\n", mnb.vin.prevout.ToStringShort());
 
@@ -839,7 +970,10 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
         uint256 nHash = mnp.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(nHash);
+        }
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s\n", mnp.vin.prevout.ToStringShort());
 
@@ -1398,10 +1532,14 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb)
         }
     } else {
         CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
+        CPubKey pubKeyMasternodeOld = pmn->pubKeyMasternode;
         if(pmn->UpdateFromNewBroadcast(mnb)) {
             masternodeSync.AddedMasternodeList();
             mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
         }
+        if(pmn->pubKeyMasternode != pubKeyMasternodeOld) {
+            indexLookup.Rebuild(vMasternodes);
+        }
     }
 }
 
@@ -1458,7 +1596,13 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
     CMasternode* pmn = Find(mnb.vin);
     if(pmn) {
         CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-        if(!mnb.Update(pmn, nDos)) {
+        CPubKey pubKeyMasternodeOld = pmn->pubKeyMasternode;
+        bool fUpdated = mnb.Update(pmn, nDos);
+        // masternode key could have been replaced even if Update() failed later on
+        if(pmn->pubKeyMasternode != pubKeyMasternodeOld) {
+            indexLookup.Rebuild(vMasternodes);
+        }
+        if(!fUpdated) {
             LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.vin.prevout.ToStringShort());
             return false;
         }
@@ -1496,7 +1640,7 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
 
 void CMasternodeMan::UpdateLastPaid()
 {
-    LOCK(cs);
+    LOCK2(cs, cs_mapMasternodeBlocks);
 
     if(fLiteMode) return;
     if(!pCurrentBlockIndex) return;
@@ -1509,8 +1653,31 @@ void CMasternodeMan::UpdateLastPaid()
     // LogPrint("mnpayments", "CMasternodeMan::UpdateLastPaid -- nHeight=%d, nMaxBlocksToScanBack=%d, IsFirstRun=%s\n",
     //                         pCurrentBlockIndex->nHeight, nMaxBlocksToScanBack, IsFirstRun ? "true" : "false");
 
+    // masternodes whose last payment wasn't found yet, by payee; several may share a collateral address
+    std::map<CScript, std::vector<CMasternode*> > mapPending;
     BOOST_FOREACH(CMasternode& mn, vMasternodes) {
-        mn.UpdateLastPaid(pCurrentBlockIndex, nMaxBlocksToScanBack);
+        mapPending[GetScriptForDestination(mn.pubKeyCollateralAddress.GetID())].push_back(&mn);
+    }
+
+    // one walk back over the chain for the whole list, each masternode takes the latest block
+    // paying it that also has enough votes for it, unless it already knows that block or a later one
+    const CBlockIndex* pindex = pCurrentBlockIndex;
+    std::vector<CScript> vecPayees;
+    for (int i = 0; pindex && i < nMaxBlocksToScanBack && !mapPending.empty(); i++, pindex = pindex->pprev) {
+        std::map<int, CMasternodeBlockPayees>::iterator itBlock = mnpayments.mapMasternodeBlocks.find(pindex->nHeight);
+        if(itBlock == mnpayments.mapMasternodeBlocks.end()) continue;
+        if(!mnpayments.GetCoinbasePayees(pindex, vecPayees)) continue;
+
+        BOOST_FOREACH(const CScript& payee, vecPayees) {
+            std::map<CScript, std::vector<CMasternode*> >::iterator it = mapPending.find(payee);
+            if(it == mapPending.end() || !itBlock->second.HasPayeeWithVotes(payee, 2)) continue;
+            BOOST_FOREACH(CMasternode* pmn, it->second) {
+                if(pindex->nHeight > pmn->nBlockLastPaid) {
+                    pmn->SetLastPaid(pindex);
+                }
+            }
+            mapPending.erase(it);
+        }
     }
 
     // every time is like the first time if winners list is not synced
@@ -1588,6 +1755,7 @@ void CMasternodeMan::CheckMasternode(const CTxIn& vin, bool fForce)
         return;
     }
     pMN->Check(fForce);
+    UpdateLastChanged(*pMN);
 }
 
 void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForce)
@@ -1598,6 +1766,7 @@ void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForc
         return;
     }
     pMN->Check(fForce);
+    UpdateLastChanged(*pMN);
 }
 
 int CMasternodeMan::GetMasternodeState(const CTxIn& vin)
@@ -1649,6 +1818,10 @@ void CMasternodeMan::SetMasternodeLastPing(const CTxIn& vin, const CMasternodePi
 
 void CMasternodeMan::UpdatedBlockTip(const CBlockIndex *pindex)
 {
+    {
+        LOCK(cs);
+        mapScoreCache.clear();
+    }
     pCurrentBlockIndex = pindex;
     LogPrint("masternode", "CMasternodeMan::UpdatedBlockTip -- pCurrentBlockIndex->nHeight=%d\n", pCurrentBlockIndex->nHeight);
 
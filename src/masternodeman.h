@@ -9,6 +9,8 @@
 #include "masternode.h"
 #include "sync.h"
 
+#include <boost/unordered_map.hpp>
+
 using namespace std;
 
 class CMasternodeMan;
@@ -79,6 +81,78 @@ private:
 
 };
 
+/**
+ * Secondary hash indexes into CMasternodeMan::vMasternodes.
+ *
+ * Maps collateral outpoints, masternode key ids and collateral (payee) key ids
+ * to the position of the corresponding entry in the masternode vector.
+ * Positions are only valid until an entry is erased from the vector or a
+ * masternode key is replaced, so the owner must call Rebuild() in both cases.
+ * When several entries share a key, the first one in vector order is indexed.
+ *
+ * The index is never serialized, it is rebuilt from the vector on load.
+ */
+class CMasternodeLookupIndex
+{
+private:
+    /** Salted hashers, keys can be chosen by a network adversary */
+    class COutPointHasher
+    {
+    private:
+        uint256 salt;
+
+    public:
+        COutPointHasher();
+
+        size_t operator()(const COutPoint& outpoint) const {
+            return outpoint.hash.GetHash(salt) ^ outpoint.n;
+        }
+    };
+
+    class CKeyIDHasher
+    {
+    private:
+        uint256 salt;
+
+    public:
+        CKeyIDHasher();
+
+        size_t operator()(const CKeyID& keyID) const {
+            uint256 hash;
+            memcpy(hash.begin(), keyID.begin(), keyID.size());
+            return hash.GetHash(salt);
+        }
+    };
+
+public: // Types
+    typedef boost::unordered_map<COutPoint, int, COutPointHasher> outpoint_m_t;
+
+    typedef boost::unordered_map<CKeyID, int, CKeyIDHasher> keyid_m_t;
+
+private:
+    outpoint_m_t         mapByOutpoint;
+
+    keyid_m_t            mapByPubKeyMasternode;
+
+    keyid_m_t            mapByCollateralKeyID;
+
+public:
+    CMasternodeLookupIndex();
+
+    /// Index masternode stored at position nPos
+    void Add(const CMasternode& mn, int nPos);
+
+    /// Reindex all masternodes from scratch
+    void Rebuild(const std::vector<CMasternode>& vMasternodes);
+
+    void Clear();
+
+    /// Find position of a masternode, -1 if not found
+    int FindByOutpoint(const COutPoint& outpoint) const;
+    int FindByPubKeyMasternode(const CKeyID& keyID) const;
+    int FindByCollateralKeyID(const CKeyID& keyID) const;
+};
+
 class CMasternodeMan
 {
 public:
@@ -111,6 +185,13 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    static const int MAX_SCORE_CACHE_ENTRIES        = 16;
+
+    static const int REMOVED_HISTORY_SECONDS        = 24 * 60 * 60;
+
+    /// Masternode scores paired with positions in vMasternodes
+    typedef std::vector<std::pair<int64_t, int> > score_pair_vec_t;
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -140,6 +221,14 @@ private:
 
     CMasternodeIndex indexMasternodesOld;
 
+    /// Hash indexes used by Find(), must be kept in sync with vMasternodes
+    CMasternodeLookupIndex indexLookup;
+
+    /// Scores of all masternodes sorted from best to worst for recently used block hashes.
+    /// Cleared on tip change and whenever masternodes are added or removed, rank filters
+    /// are applied on lookup so entries stay valid when masternode states change.
+    std::map<uint256, score_pair_vec_t> mapScoreCache;
+
     /// Set when index has been rebuilt, clear when read
     bool fIndexRebuilt;
 
@@ -151,10 +240,25 @@ private:
 
     std::vector<uint256> vecDirtyGovernanceObjectHashes;
 
+    /// Fingerprint of what clients see of every masternode and when it last changed,
+    /// local time, so delta queries do not depend on the clocks of the masternodes
+    std::map<COutPoint, std::pair<uint256, int64_t> > mapLastChanged;
+
+    /// Masternodes removed within the last REMOVED_HISTORY_SECONDS and when
+    std::map<COutPoint, int64_t> mapRemovedTime;
+    /// mapRemovedTime holds every removal since this time, it is not saved in mncache.dat
+    int64_t nRemovedHistoryStart;
+
     int64_t nLastWatchdogVoteTime;
 
     friend class CMasternodeSync;
 
+    /// Get (cached) scores for blockHash, must be called while holding cs
+    const score_pair_vec_t& GetScores(const uint256& blockHash);
+
+    /// Note the time if mn changed since it was last looked at, returns that time, must be called while holding cs
+    int64_t UpdateLastChanged(const CMasternode& mn);
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
@@ -181,6 +285,10 @@ public:
         }
 
         READWRITE(vMasternodes);
+        if(ser_action.ForRead()) {
+            indexLookup.Rebuild(vMasternodes);
+            mapScoreCache.clear();
+        }
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
@@ -215,6 +323,13 @@ public:
     /// Clear Masternode vector
     void Clear();
 
+    /// Masternodes that were added or changed status, address, broadcast, ping or
+    /// last payment at or after nTime, and those removed since then. Times are local
+    /// adjusted time. Returns false if removals from before nTime have been forgotten
+    /// (after REMOVED_HISTORY_SECONDS or a restart); vecChanged then holds all
+    /// masternodes and the caller has to replace its list with it.
+    bool GetMasternodesChangedSince(int64_t nTime, std::vector<masternode_info_t>& vecChanged, std::vector<COutPoint>& vecRemoved);
+
     /// Count Masternodes filtered by nProtocolVersion.
     /// Masternode nProtocolVersion should match or be above the one specified in param here.
     int CountMasternodes(int nProtocolVersion = -1);
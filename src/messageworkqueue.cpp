@@ -0,0 +1,114 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messageworkqueue.h"
+
+#include "consensus/validation.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+#include <boost/thread.hpp>
+
+CMessageWorkQueue::CMessageWorkQueue(const std::string& strNameIn, HandlerFunction handlerIn, size_t nMaxPerPeerIn, size_t nMaxTotalIn) :
+    strName(strNameIn),
+    handler(handlerIn),
+    nMaxPerPeer(nMaxPerPeerIn),
+    nMaxTotal(nMaxTotalIn)
+{}
+
+bool CMessageWorkQueue::HasRoom(NodeId nodeid) const
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if(queue.size() >= nMaxTotal) return false;
+    std::map<NodeId, size_t>::const_iterator it = mapPeerMessages.find(nodeid);
+    return it == mapPeerMessages.end() || it->second < nMaxPerPeer;
+}
+
+void CMessageWorkQueue::Push(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
+{
+    // move the unread part of the message instead of copying it
+    CSerializeData data;
+    size_t nUnread = vRecv.size();
+    vRecv.swap(data);
+    data.erase(data.begin(), data.end() - nUnread);
+
+    pfrom->AddRef();
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        queue.push_back(CWorkItem());
+        CWorkItem& item = queue.back();
+        item.pfrom = pfrom;
+        item.strCommand = strCommand;
+        item.vRecv.SetType(vRecv.GetType());
+        item.vRecv.SetVersion(vRecv.GetVersion());
+        item.vRecv.swap(data);
+        mapPeerMessages[pfrom->GetId()]++;
+    }
+    condWork.notify_one();
+}
+
+size_t CMessageWorkQueue::Size() const
+{
+    boost::lock_guard<boost::mutex> lock(mutex);
+    return queue.size();
+}
+
+void CMessageWorkQueue::Handle(CWorkItem& item)
+{
+    // messages of a peer we are disconnecting from are dropped, like in ProcessMessages()
+    if(item.pfrom->fDisconnect) return;
+
+    try {
+        handler(item.pfrom, item.strCommand, item.vRecv);
+    } catch (const std::ios_base::failure& e) {
+        item.pfrom->PushMessage(NetMsgType::REJECT, item.strCommand, REJECT_MALFORMED, std::string("error parsing message"));
+        LogPrintf("CMessageWorkQueue::Handle -- %s: exception '%s' processing %s, peer=%d\n",
+                  strName, e.what(), SanitizeString(item.strCommand), item.pfrom->id);
+    } catch (const boost::thread_interrupted&) {
+        throw;
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "CMessageWorkQueue::Handle()");
+    } catch (...) {
+        PrintExceptionContinue(NULL, "CMessageWorkQueue::Handle()");
+    }
+}
+
+void CMessageWorkQueue::Thread()
+{
+    RenameThread(("linc-" + strName).c_str());
+
+    while(true) {
+        CWorkItem item;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while(queue.empty()) {
+                condWork.wait(lock);
+            }
+            CWorkItem& front = queue.front();
+            CSerializeData data;
+            front.vRecv.swap(data);
+            item.pfrom = front.pfrom;
+            item.strCommand.swap(front.strCommand);
+            item.vRecv.SetType(front.vRecv.GetType());
+            item.vRecv.SetVersion(front.vRecv.GetVersion());
+            item.vRecv.swap(data);
+            queue.pop_front();
+        }
+
+        Handle(item);
+
+        bool fWasFull = false;
+        {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            std::map<NodeId, size_t>::iterator it = mapPeerMessages.find(item.pfrom->GetId());
+            fWasFull = it->second >= nMaxPerPeer || queue.size() + 1 >= nMaxTotal;
+            if(--it->second == 0) mapPeerMessages.erase(it);
+        }
+        item.pfrom->Release();
+
+        // ProcessMessages() may have stopped at a message for this queue
+        if(fWasFull) WakeMessageHandler();
+        boost::this_thread::interruption_point();
+    }
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MESSAGEWORKQUEUE_H
+#define MESSAGEWORKQUEUE_H
+
+#include "net.h"
+#include "streams.h"
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/** Messages a single peer may have waiting in one work queue */
+static const size_t MAX_WORK_QUEUE_MESSAGES_PER_PEER = 100;
+/** Messages all peers together may have waiting in one work queue */
+static const size_t MAX_WORK_QUEUE_MESSAGES = 5000;
+
+/**
+ * Messages of one subsystem, handled in the order they arrived by a worker thread of
+ * its own, so a slow subsystem doesn't hold up block and transaction relay in the
+ * message handler. The backlog is bounded per peer and in total: ProcessMessages()
+ * leaves the messages of a peer without room in its receive queue, so they are still
+ * handled in order and TCP flow control slows the peer down.
+ */
+class CMessageWorkQueue
+{
+public:
+    typedef void (*HandlerFunction)(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
+
+    CMessageWorkQueue(const std::string& strNameIn, HandlerFunction handlerIn,
+                      size_t nMaxPerPeerIn = MAX_WORK_QUEUE_MESSAGES_PER_PEER, size_t nMaxTotalIn = MAX_WORK_QUEUE_MESSAGES);
+
+    const std::string& GetName() const { return strName; }
+
+    bool HasRoom(NodeId nodeid) const;
+    //! Queue a message, taking the data out of vRecv and a reference to pfrom. Requires HasRoom().
+    void Push(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv);
+    size_t Size() const;
+
+    //! Worker thread, runs until interrupted
+    void Thread();
+
+private:
+    struct CWorkItem
+    {
+        CNode* pfrom;
+        std::string strCommand;
+        CDataStream vRecv;
+
+        CWorkItem() : pfrom(NULL), vRecv(SER_NETWORK, INIT_PROTO_VERSION) {}
+    };
+
+    const std::string strName;
+    const HandlerFunction handler;
+    const size_t nMaxPerPeer;
+    const size_t nMaxTotal;
+
+    mutable boost::mutex mutex;
+    boost::condition_variable condWork;
+    std::deque<CWorkItem> queue;
+    std::map<NodeId, size_t> mapPeerMessages;
+
+    void Handle(CWorkItem& item);
+};
+
+#endif
@@ -15,6 +15,7 @@
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "crypto/neoscrypt.h"
 #include "hash.h"
 #include "main.h"
 #include "net.h"
@@ -30,6 +31,8 @@
 #include "masternode-sync.h"
 #include "validationinterface.h"
 
+#include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <queue>
@@ -44,22 +47,17 @@ using namespace std;
 //
 // Unconfirmed transactions in the memory pool often depend on other
 // transactions in the memory pool. When we select transactions from the
-// pool, we select by highest priority or fee rate, so we might consider
-// transactions that depend on transactions that aren't yet in the block.
+// pool, we select by highest priority or by the fee rate of a transaction
+// together with its unconfirmed ancestors (its "package"), so a parent that
+// pays little still gets in when its children pay for it.
 
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
 
-class ScoreCompare
-{
-public:
-    ScoreCompare() {}
-
-    bool operator()(const CTxMemPool::txiter a, const CTxMemPool::txiter b)
-    {
-        return CompareTxMemPoolEntryByScore()(*b,*a); // Convert to less than
-    }
-};
+// Templates handed out by CreateNewBlockIncremental are assembled from
+// scratch at least this often (in seconds), so transactions that became final
+// or were only considered for the priority space are picked up again
+static const int64_t BLOCK_TEMPLATE_REASSEMBLE_INTERVAL = 30;
 
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
@@ -76,13 +74,128 @@ int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParam
     return nNewTime - nOldTime;
 }
 
-CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& scriptPubKeyIn)
+BlockAssembler::BlockAssembler(const CChainParams& _chainparams)
+    : chainparams(_chainparams)
 {
-    // Create new block
-    auto_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate());
+    // Largest block you're willing to create:
+    nBlockMaxSize = GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
+    // Limit to between 1K and MAX_BLOCK_SIZE-1K for sanity:
+    nBlockMaxSize = std::max((unsigned int)1000, std::min((unsigned int)(MAX_BLOCK_SIZE-1000), nBlockMaxSize));
+
+    // Minimum block size you want to create; block will be filled with free transactions
+    // until there are no more or the block reaches this size:
+    nBlockMinSize = GetArg("-blockminsize", DEFAULT_BLOCK_MIN_SIZE);
+    nBlockMinSize = std::min(nBlockMaxSize, nBlockMinSize);
+}
+
+void BlockAssembler::resetBlock()
+{
+    inBlock.clear();
+
+    // Reserve space for coinbase tx
+    nBlockSize = 1000;
+    nBlockSigOps = 100;
+
+    // These counters do not include coinbase tx
+    nBlockTx = 0;
+    nFees = 0;
+
+    lastFewTxs = 0;
+    blockFinished = false;
+
+    minPackageFeeRate = CFeeRate(MAX_MONEY);
+    fPackageSkipped = false;
+}
+
+CBlockTemplate* BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn)
+{
+    resetBlock();
+
+    pblocktemplate.reset(new CBlockTemplate());
+
     if(!pblocktemplate.get())
         return NULL;
-    CBlock *pblock = &pblocktemplate->block; // pointer for convenience
+    pblock = &pblocktemplate->block; // pointer for convenience
+
+    LOCK2(cs_main, mempool.cs);
+    startBlock();
+
+    addPriorityTxs();
+    addPackageTxs();
+
+    finishBlock(scriptPubKeyIn, "CreateNewBlock");
+
+    return pblocktemplate.release();
+}
+
+CBlockTemplate* BlockAssembler::UpdateBlock(const CScript& scriptPubKeyIn, const std::vector<uint256>& vPrevTxHashes,
+                                            const std::set<uint256>& setAdded, const CFeeRate& prevMinPackageFeeRate, bool fPrevPackageSkipped)
+{
+    resetBlock();
+
+    pblocktemplate.reset(new CBlockTemplate());
+
+    if(!pblocktemplate.get())
+        return NULL;
+    pblock = &pblocktemplate->block; // pointer for convenience
+
+    LOCK2(cs_main, mempool.cs);
+    startBlock();
+
+    // Keep what is left of the previous template, in its order. Only whole
+    // packages leave the mempool while the tip stays the same, but check it:
+    // every kept transaction needs its in-mempool parents before it.
+    BOOST_FOREACH(const uint256& hash, vPrevTxHashes) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end())
+            continue;
+        BOOST_FOREACH(CTxMemPool::txiter parent, mempool.GetMemPoolParents(it)) {
+            if (!inBlock.count(parent))
+                return NULL;
+        }
+        AddToBlock(it);
+    }
+    // Space freed by dropped transactions could take packages that did not fit before
+    if (nBlockTx < vPrevTxHashes.size() && fPrevPackageSkipped)
+        return NULL;
+
+    minPackageFeeRate = prevMinPackageFeeRate;
+    fPackageSkipped = fPrevPackageSkipped;
+    if (!addNewPackageTxs(setAdded, prevMinPackageFeeRate))
+        return NULL;
+
+    finishBlock(scriptPubKeyIn, "UpdateBlock");
+
+    return pblocktemplate.release();
+}
+
+void BlockAssembler::startBlock()
+{
+    CBlockIndex* pindexPrev = chainActive.Tip();
+    nHeight = pindexPrev->nHeight + 1;
+
+    // Add dummy coinbase tx as first transaction
+    pblock->vtx.push_back(CTransaction());
+    pblocktemplate->vTxFees.push_back(-1); // updated at end
+    pblocktemplate->vTxSigOps.push_back(-1); // updated at end
+
+    pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
+    // -regtest only: allow overriding block.nVersion with
+    // -blockversion=N to test forking scenarios
+    if (chainparams.MineBlocksOnDemand())
+        pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
+
+    pblock->nTime = GetAdjustedTime();
+    const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
+
+    nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                       ? nMedianTimePast
+                       : pblock->GetBlockTime();
+}
+
+void BlockAssembler::finishBlock(const CScript& scriptPubKeyIn, const char* pszCaller)
+{
+    CBlockIndex* pindexPrev = chainActive.Tip();
 
     // Create coinbase tx
     CMutableTransaction txNew;
@@ -91,261 +204,618 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& s
     txNew.vout.resize(1);
     txNew.vout[0].scriptPubKey = scriptPubKeyIn;
 
-    // Largest block you're willing to create:
-    unsigned int nBlockMaxSize = GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
-    // Limit to between 1K and MAX_BLOCK_SIZE-1K for sanity:
-    nBlockMaxSize = std::max((unsigned int)1000, std::min((unsigned int)(MAX_BLOCK_SIZE-1000), nBlockMaxSize));
+    // NOTE: unlike in bitcoin, we need to pass PREVIOUS block height here
+    CAmount nBlockSubsidy = GetBlockSubsidy(pindexPrev->nBits, pindexPrev->nHeight, Params().GetConsensus());
+    CAmount blockReward = nFees + nBlockSubsidy;
+
+    // Compute regular coinbase transaction.
+    txNew.vout[0].nValue = blockReward;
+    txNew.vin[0].scriptSig = CScript() << nHeight << OP_0;
+
+    // dpm
+    if (nHeight == 1 && blockReward >= 25000 * COIN) {
+        CBitcoinAddress dpmAddress(Params().GetConsensus().devFundPaymentsAddress);
+        CScript dpmPayee = GetScriptForDestination(dpmAddress.Get());
+        CAmount dpmPayment = 25000 * COIN;
+        txNew.vout[0].nValue -= dpmPayment;
+        CTxOut txoutDpmRet = CTxOut(dpmPayment, dpmPayee);
+        txNew.vout.push_back(txoutDpmRet);
+
+        LogPrintf("CreateNewBlock(): dpm payment %lld to %s\n", dpmPayment, dpmAddress.ToString());
+        LogPrintf("CreateNewBlock(): nBlockHeight %d blockReward %lld txoutDpmRet %s txNew %s",
+                                          nHeight, blockReward, txoutDpmRet.ToString(), txNew.ToString());
+    }
+    // end dpm
+
+    /** HF */
+    if (nHeight == HF_ACTIVATION_BLOCK && blockReward >= 20000 * COIN) {
+        CBitcoinAddress VfundAddress("LRhmhx9xWsf4VS5Cd4hijCe4RWYdPFzkkc");
+        CScript VfundPayee = GetScriptForDestination(VfundAddress.Get());
+        CAmount VfundPayment = 20000 * COIN;
+        txNew.vout[0].nValue -= VfundPayment;
+        CTxOut txoutVfundRet = CTxOut(VfundPayment, VfundPayee);
+        txNew.vout.push_back(txoutVfundRet);
+
+        LogPrintf("CreateNewBlock(): VFund payment %lld to %s\n", VfundPayment, VfundAddress.ToString());
+        LogPrintf("CreateNewBlock(): nBlockHeight %d blockReward %lld txoutVfundRet %s txNew %s",
+                                          nHeight, blockReward, txoutVfundRet.ToString(), txNew.ToString());
+    }
 
-    // How much of the block should be dedicated to high-priority transactions,
-    // included regardless of the fees they pay
-    unsigned int nBlockPrioritySize = GetArg("-blockprioritysize", DEFAULT_BLOCK_PRIORITY_SIZE);
-    nBlockPrioritySize = std::min(nBlockMaxSize, nBlockPrioritySize);
+    // dev fund
+    FillDevFundBlockPayee(txNew, nHeight, blockReward, pblock->txoutDevFund);
 
-    // Minimum block size you want to create; block will be filled with free transactions
-    // until there are no more or the block reaches this size:
-    unsigned int nBlockMinSize = GetArg("-blockminsize", DEFAULT_BLOCK_MIN_SIZE);
-    nBlockMinSize = std::min(nBlockMaxSize, nBlockMinSize);
+    // Update coinbase transaction with additional info about masternode and governance payments,
+    // get some info back to pass to getblocktemplate
+    FillBlockPayments(txNew, nHeight, blockReward, pblock->txoutMasternode, pblock->voutSuperblock);
+    // LogPrintf("CreateNewBlock -- nBlockHeight %d blockReward %lld txoutMasternode %s txNew %s",
+    //             nHeight, blockReward, pblock->txoutMasternode.ToString(), txNew.ToString());
 
-    // Collect memory pool transactions into the block
-    CTxMemPool::setEntries inBlock;
-    CTxMemPool::setEntries waitSet;
+    nLastBlockTx = nBlockTx;
+    nLastBlockSize = nBlockSize;
+    LogPrintf("%s(): total size %u txs: %u fees: %ld sigops %d\n", pszCaller, nBlockSize, nBlockTx, nFees, nBlockSigOps);
 
-    // This vector will be sorted into a priority queue:
-    vector<TxCoinAgePriority> vecPriority;
-    TxCoinAgePriorityCompare pricomparer;
-    std::map<CTxMemPool::txiter, double, CTxMemPool::CompareIteratorByHash> waitPriMap;
-    typedef std::map<CTxMemPool::txiter, double, CTxMemPool::CompareIteratorByHash>::iterator waitPriIter;
-    double actualPriority = -1;
+    // Update block coinbase
+    pblock->vtx[0] = txNew;
+    pblocktemplate->vTxFees[0] = -nFees;
 
-    std::priority_queue<CTxMemPool::txiter, std::vector<CTxMemPool::txiter>, ScoreCompare> clearedTxs;
-    bool fPrintPriority = GetBoolArg("-printpriority", DEFAULT_PRINTPRIORITY);
-    uint64_t nBlockSize = 1000;
-    uint64_t nBlockTx = 0;
-    unsigned int nBlockSigOps = 100;
-    int lastFewTxs = 0;
-    CAmount nFees = 0;
+    // Fill in header
+    pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
+    UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
+    pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
+    pblock->nNonce         = 0;
+    pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
+
+    CValidationState state;
+    if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
+        throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
+    }
+}
 
+bool BlockAssembler::isStillDependent(CTxMemPool::txiter iter)
+{
+    BOOST_FOREACH(CTxMemPool::txiter parent, mempool.GetMemPoolParents(iter))
     {
-        LOCK2(cs_main, mempool.cs);
-        CBlockIndex* pindexPrev = chainActive.Tip();
-        const int nHeight = pindexPrev->nHeight + 1;
-        pblock->nTime = GetAdjustedTime();
-        const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
-
-        // Add our coinbase tx as first transaction
-        pblock->vtx.push_back(txNew);
-        pblocktemplate->vTxFees.push_back(-1); // updated at end
-        pblocktemplate->vTxSigOps.push_back(-1); // updated at end
-        pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
-        // -regtest only: allow overriding block.nVersion with
-        // -blockversion=N to test forking scenarios
-        if (chainparams.MineBlocksOnDemand())
-            pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
-
-        int64_t nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
-                                ? nMedianTimePast
-                                : pblock->GetBlockTime();
-
-
-        bool fPriorityBlock = nBlockPrioritySize > 0;
-        if (fPriorityBlock) {
-            vecPriority.reserve(mempool.mapTx.size());
-            for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
-                 mi != mempool.mapTx.end(); ++mi)
-            {
-                double dPriority = mi->GetPriority(nHeight);
-                CAmount dummy;
-                mempool.ApplyDeltas(mi->GetTx().GetHash(), dPriority, dummy);
-                vecPriority.push_back(TxCoinAgePriority(dPriority, mi));
-            }
-            std::make_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
+        if (!inBlock.count(parent)) {
+            return true;
         }
+    }
+    return false;
+}
 
-        CTxMemPool::indexed_transaction_set::nth_index<3>::type::iterator mi = mempool.mapTx.get<3>().begin();
-        CTxMemPool::txiter iter;
+void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
+{
+    for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
+        // Only test txs not already in the block
+        if (inBlock.count(*iit)) {
+            testSet.erase(iit++);
+        }
+        else {
+            iit++;
+        }
+    }
+}
 
-        while (mi != mempool.mapTx.get<3>().end() || !clearedTxs.empty())
-        {
-            bool priorityTx = false;
-            if (fPriorityBlock && !vecPriority.empty()) { // add a tx from priority queue to fill the blockprioritysize
-                priorityTx = true;
-                iter = vecPriority.front().second;
-                actualPriority = vecPriority.front().first;
-                std::pop_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
-                vecPriority.pop_back();
-            }
-            else if (clearedTxs.empty()) { // add tx with next highest score
-                iter = mempool.mapTx.project<0>(mi);
-                mi++;
-            }
-            else {  // try to add a previously postponed child tx
-                iter = clearedTxs.top();
-                clearedTxs.pop();
-            }
+bool BlockAssembler::TestPackage(uint64_t packageSize, unsigned int packageSigOps)
+{
+    if (nBlockSize + packageSize >= nBlockMaxSize)
+        return false;
+    if (nBlockSigOps + packageSigOps >= MAX_BLOCK_SIGOPS)
+        return false;
+    return true;
+}
 
-            if (inBlock.count(iter))
-                continue; // could have been added to the priorityBlock
+// Block size and sigops have already been tested.  Check that all transactions
+// are final.
+bool BlockAssembler::TestPackageFinality(const CTxMemPool::setEntries& package)
+{
+    BOOST_FOREACH (const CTxMemPool::txiter it, package) {
+        if (!IsFinalTx(it->GetTx(), nHeight, nLockTimeCutoff))
+            return false;
+    }
+    return true;
+}
 
-            const CTransaction& tx = iter->GetTx();
+bool BlockAssembler::TestForBlock(CTxMemPool::txiter iter)
+{
+    if (nBlockSize + iter->GetTxSize() >= nBlockMaxSize) {
+        // If the block is so close to full that no more txs will fit
+        // or if we've tried more than 50 times to fill remaining space
+        // then flag that the block is finished
+        if (nBlockSize >  nBlockMaxSize - 100 || lastFewTxs > 50) {
+             blockFinished = true;
+             return false;
+        }
+        // Once we're within 1000 bytes of a full block, only look at 50 more txs
+        // to try to fill the remaining space.
+        if (nBlockSize > nBlockMaxSize - 1000) {
+            lastFewTxs++;
+        }
+        return false;
+    }
 
-            bool fOrphan = false;
-            BOOST_FOREACH(CTxMemPool::txiter parent, mempool.GetMemPoolParents(iter))
-            {
-                if (!inBlock.count(parent)) {
-                    fOrphan = true;
-                    break;
-                }
-            }
-            if (fOrphan) {
-                if (priorityTx)
-                    waitPriMap.insert(std::make_pair(iter,actualPriority));
-                else
-                    waitSet.insert(iter);
+    if (nBlockSigOps + iter->GetSigOpCount() >= MAX_BLOCK_SIGOPS) {
+        // If the block has room for no more sig ops then
+        // flag that the block is finished
+        if (nBlockSigOps > MAX_BLOCK_SIGOPS - 2) {
+            blockFinished = true;
+            return false;
+        }
+        // Otherwise attempt to find another tx with fewer sigops
+        // to put in the block.
+        return false;
+    }
+
+    // Must check that lock times are still valid
+    // This can be removed once MTP is always enforced
+    // as long as reorgs keep the mempool consistent.
+    if (!IsFinalTx(iter->GetTx(), nHeight, nLockTimeCutoff))
+        return false;
+
+    return true;
+}
+
+void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
+{
+    pblock->vtx.push_back(iter->GetTx());
+    pblocktemplate->vTxFees.push_back(iter->GetFee());
+    pblocktemplate->vTxSigOps.push_back(iter->GetSigOpCount());
+    nBlockSize += iter->GetTxSize();
+    ++nBlockTx;
+    nBlockSigOps += iter->GetSigOpCount();
+    nFees += iter->GetFee();
+    inBlock.insert(iter);
+
+    bool fPrintPriority = GetBoolArg("-printpriority", DEFAULT_PRINTPRIORITY);
+    if (fPrintPriority) {
+        double dPriority = iter->GetPriority(nHeight);
+        CAmount dummy;
+        mempool.ApplyDeltas(iter->GetTx().GetHash(), dPriority, dummy);
+        LogPrintf("priority %.1f fee %s txid %s\n",
+                  dPriority,
+                  CFeeRate(iter->GetModifiedFee(), iter->GetTxSize()).ToString(),
+                  iter->GetTx().GetHash().ToString());
+    }
+}
+
+void BlockAssembler::UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded,
+        indexed_modified_transaction_set &mapModifiedTx)
+{
+    BOOST_FOREACH(const CTxMemPool::txiter it, alreadyAdded) {
+        CTxMemPool::setEntries descendants;
+        mempool.CalculateDescendants(it, descendants);
+        // Insert all descendants (not yet in block) into the modified set
+        BOOST_FOREACH(CTxMemPool::txiter desc, descendants) {
+            if (alreadyAdded.count(desc))
                 continue;
+            modtxiter mit = mapModifiedTx.find(desc);
+            if (mit == mapModifiedTx.end()) {
+                CTxMemPoolModifiedEntry modEntry(desc);
+                modEntry.nSizeWithAncestors -= it->GetTxSize();
+                modEntry.nModFeesWithAncestors -= it->GetModifiedFee();
+                modEntry.nSigOpCountWithAncestors -= it->GetSigOpCount();
+                mapModifiedTx.insert(modEntry);
+            } else {
+                mapModifiedTx.modify(mit, update_for_parent_inclusion(it));
+            }
+        }
+    }
+}
+
+// Skip entries in mapTx that are already in a block or are present
+// in mapModifiedTx (which implies that the mapTx ancestor state is
+// stale due to ancestor inclusion in the block)
+// Also skip transactions that we've already failed to add. This can happen if
+// we consider a transaction in mapModifiedTx and it fails: we can then
+// potentially consider it again while walking mapTx.  It's currently
+// guaranteed to fail again, but as a belt-and-suspenders check we put it in
+// failedTx and avoid re-evaluation, since the re-evaluation would be using
+// cached size/sigops/fee values that are not actually correct.
+bool BlockAssembler::SkipMapTxEntry(CTxMemPool::txiter it, indexed_modified_transaction_set &mapModifiedTx, CTxMemPool::setEntries &failedTx)
+{
+    assert (it != mempool.mapTx.end());
+    if (mapModifiedTx.count(it) || inBlock.count(it) || failedTx.count(it))
+        return true;
+    return false;
+}
+
+void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, CTxMemPool::txiter entry, std::vector<CTxMemPool::txiter>& sortedEntries)
+{
+    // Sort package by ancestor count
+    // If a transaction A depends on transaction B, then A's ancestor count
+    // must be greater than B's.  So this is sufficient to validly order the
+    // transactions for block inclusion.
+    sortedEntries.clear();
+    sortedEntries.insert(sortedEntries.begin(), package.begin(), package.end());
+    std::sort(sortedEntries.begin(), sortedEntries.end(), CompareTxIterByAncestorCount());
+}
+
+void BlockAssembler::addPackage(const CTxMemPool::setEntries& package, CTxMemPool::txiter entry, CAmount packageFees, uint64_t packageSize)
+{
+    std::vector<CTxMemPool::txiter> sortedEntries;
+    SortForBlock(package, entry, sortedEntries);
+
+    for (size_t i=0; i<sortedEntries.size(); ++i) {
+        AddToBlock(sortedEntries[i]);
+    }
+
+    CFeeRate packageFeeRate(packageFees, packageSize);
+    if (packageFeeRate < minPackageFeeRate)
+        minPackageFeeRate = packageFeeRate;
+}
+
+// This transaction selection algorithm orders the mempool based
+// on feerate of a transaction including all unconfirmed ancestors.
+// Since we don't remove transactions from the mempool as we select them
+// for block inclusion, we need an alternate method of updating the feerate
+// of a transaction with its not-yet-selected ancestors as we go.
+// This is accomplished by walking the in-mempool descendants of selected
+// transactions and storing a temporary modified state in mapModifiedTxs.
+// Each time through the loop, we compare the best transaction in
+// mapModifiedTxs with the next transaction in the mempool to decide what
+// transaction package to work on next.
+void BlockAssembler::addPackageTxs()
+{
+    // mapModifiedTx will store sorted packages after they are modified
+    // because some of their txs are already in the block
+    indexed_modified_transaction_set mapModifiedTx;
+    // Keep track of entries that failed inclusion, to avoid duplicate work
+    CTxMemPool::setEntries failedTx;
+
+    // Start by adding all descendants of previously added txs to mapModifiedTx
+    // and modifying them for their already included ancestors
+    UpdatePackagesForAdded(inBlock, mapModifiedTx);
+
+    CTxMemPool::indexed_transaction_set::nth_index<4>::type::iterator mi = mempool.mapTx.get<4>().begin();
+    CTxMemPool::txiter iter;
+    int lastFewPackages = 0;
+
+    while (mi != mempool.mapTx.get<4>().end() || !mapModifiedTx.empty())
+    {
+        // First try to find a new transaction in mapTx to evaluate.
+        if (mi != mempool.mapTx.get<4>().end() &&
+                SkipMapTxEntry(mempool.mapTx.project<0>(mi), mapModifiedTx, failedTx)) {
+            ++mi;
+            continue;
+        }
+
+        // Now that mi is not stale, determine which transaction to evaluate:
+        // the next entry from mapTx, or the best from mapModifiedTx?
+        bool fUsingModified = false;
+
+        modtxscoreiter modit = mapModifiedTx.get<1>().begin();
+        if (mi == mempool.mapTx.get<4>().end()) {
+            // We're out of entries in mapTx; use the entry from mapModifiedTx
+            iter = modit->iter;
+            fUsingModified = true;
+        } else {
+            // Try to compare the mapTx entry to the mapModifiedTx entry
+            iter = mempool.mapTx.project<0>(mi);
+            if (modit != mapModifiedTx.get<1>().end() &&
+                    CompareModifiedEntry()(*modit, CTxMemPoolModifiedEntry(iter))) {
+                // The best entry in mapModifiedTx has higher score
+                // than the one from mapTx.
+                // Switch which transaction (package) to consider
+                iter = modit->iter;
+                fUsingModified = true;
+            } else {
+                // Either no entry in mapModifiedTx, or it's worse than mapTx.
+                // Increment mi for the next loop iteration.
+                ++mi;
             }
+        }
+
+        // We skip mapTx entries that are inBlock, and mapModifiedTx shouldn't
+        // contain anything that is inBlock.
+        assert(!inBlock.count(iter));
+
+        uint64_t packageSize = iter->GetSizeWithAncestors();
+        CAmount packageFees = iter->GetModFeesWithAncestors();
+        unsigned int packageSigOps = iter->GetSigOpCountWithAncestors();
+        if (fUsingModified) {
+            packageSize = modit->nSizeWithAncestors;
+            packageFees = modit->nModFeesWithAncestors;
+            packageSigOps = modit->nSigOpCountWithAncestors;
+        }
 
-            unsigned int nTxSize = iter->GetTxSize();
-            if (fPriorityBlock &&
-                (nBlockSize + nTxSize >= nBlockPrioritySize || !AllowFree(actualPriority))) {
-                fPriorityBlock = false;
-                waitPriMap.clear();
+        if (packageFees < ::minRelayTxFee.GetFee(packageSize) && nBlockSize >= nBlockMinSize) {
+            // Everything else we might consider has a lower fee rate
+            return;
+        }
+
+        if (!TestPackage(packageSize, packageSigOps)) {
+            if (fUsingModified) {
+                // Since we always look at the best entry in mapModifiedTx,
+                // we must erase failed entries so that we can consider the
+                // next best entry on the next loop iteration
+                mapModifiedTx.get<1>().erase(modit);
+                failedTx.insert(iter);
             }
-            if (!priorityTx &&
-                (iter->GetModifiedFee() < ::minRelayTxFee.GetFee(nTxSize) && nBlockSize >= nBlockMinSize)) {
-                break;
+            fPackageSkipped = true;
+            // Once we're within 1000 bytes of a full block, only look at 50 more packages
+            // to try to fill the remaining space.
+            if (nBlockSize > nBlockMaxSize - 1000 && ++lastFewPackages > 50) {
+                return;
             }
-            if (nBlockSize + nTxSize >= nBlockMaxSize) {
-                if (nBlockSize >  nBlockMaxSize - 100 || lastFewTxs > 50) {
-                    break;
-                }
-                // Once we're within 1000 bytes of a full block, only look at 50 more txs
-                // to try to fill the remaining space.
-                if (nBlockSize > nBlockMaxSize - 1000) {
-                    lastFewTxs++;
-                }
-                continue;
+            continue;
+        }
+
+        CTxMemPool::setEntries ancestors;
+        uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+        std::string dummy;
+        mempool.CalculateMemPoolAncestors(*iter, ancestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+
+        onlyUnconfirmed(ancestors);
+        ancestors.insert(iter);
+
+        // Test if all tx's are Final
+        if (!TestPackageFinality(ancestors)) {
+            if (fUsingModified) {
+                mapModifiedTx.get<1>().erase(modit);
+                failedTx.insert(iter);
             }
+            continue;
+        }
 
-            if (!IsFinalTx(tx, nHeight, nLockTimeCutoff))
-                continue;
+        // Package can be added. Sort the entries in a valid order.
+        addPackage(ancestors, iter, packageFees, packageSize);
+        BOOST_FOREACH(CTxMemPool::txiter it, ancestors) {
+            // Erase from the modified set, if present
+            mapModifiedTx.erase(it);
+        }
 
-            unsigned int nTxSigOps = iter->GetSigOpCount();
-            if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS) {
-                if (nBlockSigOps > MAX_BLOCK_SIGOPS - 2) {
-                    break;
-                }
-                continue;
+        // Update transactions that depend on each of these
+        UpdatePackagesForAdded(ancestors, mapModifiedTx);
+    }
+}
+
+bool BlockAssembler::addNewPackageTxs(const std::set<uint256>& setAdded, const CFeeRate& prevMinPackageFeeRate)
+{
+    // Only packages of the new transactions are considered, each one with the
+    // ancestor state of what is not in the block yet
+    indexed_modified_transaction_set mapCandidates;
+    uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::string dummy;
+    BOOST_FOREACH(const uint256& hash, setAdded) {
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end() || inBlock.count(it))
+            continue;
+        CTxMemPoolModifiedEntry modEntry(it);
+        CTxMemPool::setEntries ancestors;
+        mempool.CalculateMemPoolAncestors(*it, ancestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+        BOOST_FOREACH(CTxMemPool::txiter ancestor, ancestors) {
+            if (inBlock.count(ancestor)) {
+                modEntry.nSizeWithAncestors -= ancestor->GetTxSize();
+                modEntry.nModFeesWithAncestors -= ancestor->GetModifiedFee();
+                modEntry.nSigOpCountWithAncestors -= ancestor->GetSigOpCount();
             }
+        }
+        mapCandidates.insert(modEntry);
+    }
 
-            CAmount nTxFees = iter->GetFee();
-            // Added
-            pblock->vtx.push_back(tx);
-            pblocktemplate->vTxFees.push_back(nTxFees);
-            pblocktemplate->vTxSigOps.push_back(nTxSigOps);
-            nBlockSize += nTxSize;
-            ++nBlockTx;
-            nBlockSigOps += nTxSigOps;
-            nFees += nTxFees;
-
-            if (fPrintPriority)
-            {
-                double dPriority = iter->GetPriority(nHeight);
-                CAmount dummy;
-                mempool.ApplyDeltas(tx.GetHash(), dPriority, dummy);
-                LogPrintf("priority %.1f fee %s txid %s\n",
-                          dPriority , CFeeRate(iter->GetModifiedFee(), nTxSize).ToString(), tx.GetHash().ToString());
+    while (!mapCandidates.empty())
+    {
+        modtxscoreiter modit = mapCandidates.get<1>().begin();
+        CTxMemPool::txiter iter = modit->iter;
+        uint64_t packageSize = modit->nSizeWithAncestors;
+        CAmount packageFees = modit->nModFeesWithAncestors;
+        unsigned int packageSigOps = modit->nSigOpCountWithAncestors;
+        mapCandidates.get<1>().erase(modit);
+
+        if (packageFees < ::minRelayTxFee.GetFee(packageSize) && nBlockSize >= nBlockMinSize) {
+            // Everything else we might consider has a lower fee rate
+            break;
+        }
+
+        if (!TestPackage(packageSize, packageSigOps)) {
+            // Assembling from scratch would have taken this package ahead of
+            // some that are in the template
+            if (prevMinPackageFeeRate < CFeeRate(packageFees, packageSize))
+                return false;
+            fPackageSkipped = true;
+            continue;
+        }
+
+        CTxMemPool::setEntries ancestors;
+        mempool.CalculateMemPoolAncestors(*iter, ancestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+
+        onlyUnconfirmed(ancestors);
+        ancestors.insert(iter);
+
+        if (!TestPackageFinality(ancestors))
+            continue;
+
+        addPackage(ancestors, iter, packageFees, packageSize);
+
+        // Candidates in or depending on the package need less to be mined now
+        BOOST_FOREACH(CTxMemPool::txiter it, ancestors) {
+            mapCandidates.erase(it);
+        }
+        BOOST_FOREACH(CTxMemPool::txiter it, ancestors) {
+            CTxMemPool::setEntries descendants;
+            mempool.CalculateDescendants(it, descendants);
+            BOOST_FOREACH(CTxMemPool::txiter desc, descendants) {
+                modtxiter mit = mapCandidates.find(desc);
+                if (mit != mapCandidates.end())
+                    mapCandidates.modify(mit, update_for_parent_inclusion(it));
             }
+        }
+    }
+    return true;
+}
+
+void BlockAssembler::addPriorityTxs()
+{
+    // How much of the block should be dedicated to high-priority transactions,
+    // included regardless of the fees they pay
+    unsigned int nBlockPrioritySize = GetArg("-blockprioritysize", DEFAULT_BLOCK_PRIORITY_SIZE);
+    nBlockPrioritySize = std::min(nBlockMaxSize, nBlockPrioritySize);
 
-            inBlock.insert(iter);
+    if (nBlockPrioritySize == 0) {
+        return;
+    }
 
-            // Add transactions that depend on this one to the priority queue
+    // This vector will be sorted into a priority queue:
+    vector<TxCoinAgePriority> vecPriority;
+    TxCoinAgePriorityCompare pricomparer;
+    std::map<CTxMemPool::txiter, double, CTxMemPool::CompareIteratorByHash> waitPriMap;
+    typedef std::map<CTxMemPool::txiter, double, CTxMemPool::CompareIteratorByHash>::iterator waitPriIter;
+    double actualPriority = -1;
+
+    vecPriority.reserve(mempool.mapTx.size());
+    for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
+         mi != mempool.mapTx.end(); ++mi)
+    {
+        double dPriority = mi->GetPriority(nHeight);
+        CAmount dummy;
+        mempool.ApplyDeltas(mi->GetTx().GetHash(), dPriority, dummy);
+        vecPriority.push_back(TxCoinAgePriority(dPriority, mi));
+    }
+    std::make_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
+
+    CTxMemPool::txiter iter;
+    while (!vecPriority.empty() && !blockFinished) { // add a tx from priority queue to fill the blockprioritysize
+        iter = vecPriority.front().second;
+        actualPriority = vecPriority.front().first;
+        std::pop_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
+        vecPriority.pop_back();
+
+        // If tx already in block, skip
+        if (inBlock.count(iter)) {
+            assert(false); // shouldn't happen for priority txs
+            continue;
+        }
+
+        // If tx is dependent on other mempool txs which haven't yet been included
+        // then put it in the waitSet
+        if (isStillDependent(iter)) {
+            waitPriMap.insert(std::make_pair(iter, actualPriority));
+            continue;
+        }
+
+        // If this tx fits in the block add it, otherwise keep looping
+        if (TestForBlock(iter)) {
+            AddToBlock(iter);
+
+            // If now that this txs is added we've surpassed our desired priority size
+            // or have dropped below the AllowFreeThreshold, then we're done adding priority txs
+            if (nBlockSize >= nBlockPrioritySize || !AllowFree(actualPriority)) {
+                break;
+            }
+
+            // This tx was successfully added, so
+            // add transactions that depend on this one to the priority queue to try again
             BOOST_FOREACH(CTxMemPool::txiter child, mempool.GetMemPoolChildren(iter))
             {
-                if (fPriorityBlock) {
-                    waitPriIter wpiter = waitPriMap.find(child);
-                    if (wpiter != waitPriMap.end()) {
-                        vecPriority.push_back(TxCoinAgePriority(wpiter->second,child));
-                        std::push_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
-                        waitPriMap.erase(wpiter);
-                    }
-                }
-                else {
-                    if (waitSet.count(child)) {
-                        clearedTxs.push(child);
-                        waitSet.erase(child);
-                    }
+                waitPriIter wpiter = waitPriMap.find(child);
+                if (wpiter != waitPriMap.end()) {
+                    vecPriority.push_back(TxCoinAgePriority(wpiter->second,child));
+                    std::push_heap(vecPriority.begin(), vecPriority.end(), pricomparer);
+                    waitPriMap.erase(wpiter);
                 }
             }
         }
+    }
+}
 
-        // NOTE: unlike in bitcoin, we need to pass PREVIOUS block height here
-        CAmount nBlockSubsidy = GetBlockSubsidy(pindexPrev->nBits, pindexPrev->nHeight, Params().GetConsensus());
-        CAmount blockReward = nFees + nBlockSubsidy;
-
-        // Compute regular coinbase transaction.
-        txNew.vout[0].nValue = blockReward;
-        txNew.vin[0].scriptSig = CScript() << nHeight << OP_0;
-
-        // dpm
-        if (nHeight == 1 && blockReward >= 25000 * COIN) {
-            CBitcoinAddress dpmAddress(Params().GetConsensus().devFundPaymentsAddress);
-            CScript dpmPayee = GetScriptForDestination(dpmAddress.Get());
-            CAmount dpmPayment = 25000 * COIN;
-            txNew.vout[0].nValue -= dpmPayment;
-            CTxOut txoutDpmRet = CTxOut(dpmPayment, dpmPayee);
-            txNew.vout.push_back(txoutDpmRet);
-
-            LogPrintf("CreateNewBlock(): dpm payment %lld to %s\n", dpmPayment, dpmAddress.ToString());
-            LogPrintf("CreateNewBlock(): nBlockHeight %d blockReward %lld txoutDpmRet %s txNew %s",
-                                              nHeight, blockReward, txoutDpmRet.ToString(), txNew.ToString());
-        }
-        // end dpm
-
-        /** HF */
-        if (nHeight == HF_ACTIVATION_BLOCK && blockReward >= 20000 * COIN) {
-            CBitcoinAddress VfundAddress("LRhmhx9xWsf4VS5Cd4hijCe4RWYdPFzkkc");
-            CScript VfundPayee = GetScriptForDestination(VfundAddress.Get());
-            CAmount VfundPayment = 20000 * COIN;
-            txNew.vout[0].nValue -= VfundPayment;
-            CTxOut txoutVfundRet = CTxOut(VfundPayment, VfundPayee);
-            txNew.vout.push_back(txoutVfundRet);
-
-            LogPrintf("CreateNewBlock(): VFund payment %lld to %s\n", VfundPayment, VfundAddress.ToString());
-            LogPrintf("CreateNewBlock(): nBlockHeight %d blockReward %lld txoutVfundRet %s txNew %s",
-                                              nHeight, blockReward, txoutVfundRet.ToString(), txNew.ToString());
+CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const CScript& scriptPubKeyIn)
+{
+    return BlockAssembler(chainparams).CreateNewBlock(scriptPubKeyIn);
+}
+
+/**
+ * The last template of CreateNewBlockIncremental, with the transactions added
+ * to the mempool since it was made. The mempool notifications arrive with
+ * mempool.cs held, so lock order is mempool.cs before cs.
+ */
+class CBlockTemplateCache
+{
+private:
+    CCriticalSection cs;
+    std::set<uint256> setAdded;
+    bool fPrioritised;
+    bool fConnected;
+
+    // What is needed to patch the last template, guarded by cs_main
+    uint256 hashPrevBlock;
+    CScript scriptPubKey;
+    int64_t nTimeAssembled;
+    std::vector<uint256> vTxHashes;
+    CFeeRate minPackageFeeRate;
+    bool fPackageSkipped;
+
+    void EntryAdded(const CTxMemPoolEntry& entry)
+    {
+        LOCK(cs);
+        setAdded.insert(entry.GetTx().GetHash());
+    }
+
+    void EntryRemoved(const CTxMemPoolEntry& entry)
+    {
+        // template transactions that are gone are noticed when patching
+        LOCK(cs);
+        setAdded.erase(entry.GetTx().GetHash());
+    }
+
+    void EntryPrioritised(const CTxMemPoolEntry& entry)
+    {
+        LOCK(cs);
+        fPrioritised = true;
+    }
+
+public:
+    CBlockTemplateCache() : fPrioritised(false), fConnected(false), nTimeAssembled(0), fPackageSkipped(false) {}
+
+    CBlockTemplate* Get(const CChainParams& chainparams, const CScript& scriptPubKeyIn)
+    {
+        LOCK2(cs_main, mempool.cs);
+        std::set<uint256> setAddedSince;
+        bool fPrioritisedSince;
+        {
+            LOCK(cs);
+            if (!fConnected) {
+                mempool.NotifyEntryAdded.connect(boost::bind(&CBlockTemplateCache::EntryAdded, this, _1));
+                mempool.NotifyEntryRemoved.connect(boost::bind(&CBlockTemplateCache::EntryRemoved, this, _1));
+                mempool.NotifyEntryPrioritised.connect(boost::bind(&CBlockTemplateCache::EntryPrioritised, this, _1));
+                fConnected = true;
+            }
+            setAddedSince.swap(setAdded);
+            fPrioritisedSince = fPrioritised;
+            fPrioritised = false;
         }
 
-        // dev fund
-        FillDevFundBlockPayee(txNew, nHeight, blockReward, pblock->txoutDevFund);
-
-        // Update coinbase transaction with additional info about masternode and governance payments,
-        // get some info back to pass to getblocktemplate
-        FillBlockPayments(txNew, nHeight, blockReward, pblock->txoutMasternode, pblock->voutSuperblock);
-        // LogPrintf("CreateNewBlock -- nBlockHeight %d blockReward %lld txoutMasternode %s txNew %s",
-        //             nHeight, blockReward, pblock->txoutMasternode.ToString(), txNew.ToString());
-
-        nLastBlockTx = nBlockTx;
-        nLastBlockSize = nBlockSize;
-        LogPrintf("CreateNewBlock(): total size %u txs: %u fees: %ld sigops %d\n", nBlockSize, nBlockTx, nFees, nBlockSigOps);
-
-        // Update block coinbase
-        pblock->vtx[0] = txNew;
-        pblocktemplate->vTxFees[0] = -nFees;
-
-        // Fill in header
-        pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
-        UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
-        pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
-        pblock->nNonce         = 0;
-        pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
-
-        CValidationState state;
-        if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
-            throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
+        bool fPatch = !fPrioritisedSince && !hashPrevBlock.IsNull() &&
+                      hashPrevBlock == chainActive.Tip()->GetBlockHash() && scriptPubKey == scriptPubKeyIn &&
+                      GetTime() - nTimeAssembled < BLOCK_TEMPLATE_REASSEMBLE_INTERVAL;
+        // Nothing to patch from if this fails half way
+        hashPrevBlock.SetNull();
+
+        BlockAssembler assembler(chainparams);
+        CBlockTemplate* pblocktemplate = NULL;
+        if (fPatch)
+            pblocktemplate = assembler.UpdateBlock(scriptPubKeyIn, vTxHashes, setAddedSince, minPackageFeeRate, fPackageSkipped);
+        if (!pblocktemplate) {
+            pblocktemplate = assembler.CreateNewBlock(scriptPubKeyIn);
+            if (!pblocktemplate)
+                return NULL;
+            nTimeAssembled = GetTime();
         }
+
+        hashPrevBlock = pblocktemplate->block.hashPrevBlock;
+        scriptPubKey = scriptPubKeyIn;
+        vTxHashes.clear();
+        for (unsigned int i = 1; i < pblocktemplate->block.vtx.size(); i++)
+            vTxHashes.push_back(pblocktemplate->block.vtx[i].GetHash());
+        minPackageFeeRate = assembler.GetMinPackageFeeRate();
+        fPackageSkipped = assembler.IsPackageSkipped();
+        return pblocktemplate;
     }
+};
 
-    return pblocktemplate.release();
+static CBlockTemplateCache blockTemplateCache;
+
+CBlockTemplate* CreateNewBlockIncremental(const CChainParams& chainparams, const CScript& scriptPubKeyIn)
+{
+    return blockTemplateCache.Get(chainparams, scriptPubKeyIn);
 }
 
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
@@ -489,6 +959,12 @@ void static BitcoinMiner(const CChainParams& chainparams)
             //
             int64_t nStart = GetTime();
             arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
+            // Nonces are tried in batches as wide as the NeoScrypt engine
+            const unsigned int nLanes = neoscrypt_simd_lanes();
+            std::vector<CBlockHeader> vHeaders(nLanes);
+            std::vector<const CBlockHeader*> vpHeaders(nLanes);
+            for (unsigned int i = 0; i < nLanes; i++)
+                vpHeaders[i] = &vHeaders[i];
             while (true)
             {
                 unsigned int nHashesDone = 0;
@@ -496,9 +972,21 @@ void static BitcoinMiner(const CChainParams& chainparams)
                 uint256 hash;
                 while (true)
                 {
-                    hash = pblock->GetHash();
-                    if (UintToArith256(hash) <= hashTarget)
+                    for (unsigned int i = 0; i < nLanes; i++) {
+                        vHeaders[i] = pblock->GetBlockHeader();
+                        vHeaders[i].nNonce = pblock->nNonce + i;
+                    }
+                    CBlockHeader::ComputeHashes(vpHeaders);
+
+                    unsigned int nLane = 0;
+                    while (nLane < nLanes && UintToArith256(vHeaders[nLane].GetHash()) > hashTarget)
+                        nLane++;
+                    if (nLane < nLanes)
                     {
+                        pblock->nNonce = vHeaders[nLane].nNonce;
+                        hash = vHeaders[nLane].GetHash();
+                        pblock->SetKnownHash(hash);
+
                         // Found a solution
                         SetThreadPriority(THREAD_PRIORITY_NORMAL);
                         LogPrintf("LINCMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
@@ -513,9 +1001,9 @@ void static BitcoinMiner(const CChainParams& chainparams)
 
                         break;
                     }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if ((pblock->nNonce & 0xFF) == 0)
+                    pblock->nNonce += nLanes;
+                    nHashesDone += nLanes;
+                    if ((pblock->nNonce & 0xFF) < nLanes)
                         break;
                 }
 
@@ -34,6 +34,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -70,6 +74,13 @@ namespace {
     const int MAX_OUTBOUND_CONNECTIONS = 8;
     const int MAX_OUTBOUND_MASTERNODE_CONNECTIONS = 20;
 
+    // Longest the epoll socket handler waits for events, and how often it looks for nodes to disconnect
+    const int SOCKET_EVENTS_TIMEOUT = 50;
+    // How soon it tries again when a node it has events for was locked by another thread
+    const int SOCKET_EVENTS_RETRY_TIMEOUT = 10;
+    // Events taken from the kernel per epoll_wait() call
+    const int SOCKET_EVENTS_MAX = 1024;
+
     struct ListenSocket {
         SOCKET socket;
         bool whitelisted;
@@ -114,14 +125,100 @@ CCriticalSection cs_vAddedNodes;
 NodeId nLastNodeId = 0;
 CCriticalSection cs_nLastNodeId;
 
+// defined before the nodes are cleaned up at shutdown, so it outlives their messages
+CNetMessageBufferPool netMessageBufferPool;
+const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
+
 static CSemaphore *semOutbound = NULL;
 static CSemaphore *semMasternodeOutbound = NULL;
 boost::condition_variable messageHandlerCondition;
+// Set by WakeMessageHandler() so a wakeup during a message handler pass isn't lost
+static boost::mutex mutexMsgProc;
+static bool fMsgProcWake = false;
+
+SocketEventsMode nSocketEventsMode = DEFAULT_SOCKETEVENTS;
+#ifdef HAVE_SYS_EPOLL_H
+static int hEpoll = -1;
+// Wakes the epoll socket handler before its timeout, registered together with the listen sockets
+static int hWakeupPipe[2] = {-1, -1};
+// Nodes whose socket reported readiness that hasn't been used up yet. Edge triggered events
+// aren't repeated, so these are kept until recv()/send() would block. Only ThreadSocketHandler
+// touches them.
+static std::set<CNode*> setNodesRecvReady;
+static std::set<CNode*> setNodesSendReady;
+#endif
 
 // Signals for message handling
 static CNodeSignals g_signals;
 CNodeSignals& GetNodeSignals() { return g_signals; }
 
+void WakeMessageHandler()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutexMsgProc);
+        fMsgProcWake = true;
+    }
+    messageHandlerCondition.notify_one();
+}
+
+static void WakeSocketHandler()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (hWakeupPipe[1] != -1) {
+        char c = 0;
+        // a full pipe already has a wakeup pending
+        if (write(hWakeupPipe[1], &c, 1) != 1 && errno != EAGAIN)
+            LogPrint("net", "%s: write() failed: %s\n", __func__, NetworkErrorString(errno));
+    }
+#endif
+}
+
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& modeRet)
+{
+    if (strMode == "select") {
+        modeRet = SOCKETEVENTS_SELECT;
+        return true;
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    if (strMode == "epoll") {
+        modeRet = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string GetSocketEventsModeName(SocketEventsMode mode)
+{
+    switch (mode) {
+        case SOCKETEVENTS_SELECT: return "select";
+        case SOCKETEVENTS_EPOLL: return "epoll";
+    }
+    return "unknown";
+}
+
+// select() can't wait on descriptors past FD_SETSIZE, epoll can
+static bool IsSocketSupported(SOCKET hSocket)
+{
+    return nSocketEventsMode != SOCKETEVENTS_SELECT || IsSelectableSocket(hSocket);
+}
+
+// Start reporting readiness of a new node's socket, requires LOCK(cs_vNodes)
+static void AddNodeSocketEvents(CNode* pnode)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (hEpoll == -1)
+        return;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+        LogPrintf("epoll_ctl() for peer=%d failed: %s\n", pnode->id, NetworkErrorString(errno));
+        pnode->fDisconnect = true;
+    }
+#endif
+}
+
 void AddOneShot(const std::string& strDest)
 {
     LOCK(cs_vOneShots);
@@ -422,7 +519,7 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest, bool fConnectToMas
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!IsSocketSupported(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -441,6 +538,7 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest, bool fConnectToMas
 
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        AddNodeSocketEvents(pnode);
 
         return pnode;
     } else if (!proxyConnectionFailed) {
@@ -703,13 +801,106 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
 
         if (msg.complete()) {
             msg.nTime = GetTimeMicros();
-            messageHandlerCondition.notify_one();
+            WakeMessageHandler();
         }
     }
 
     return true;
 }
 
+CNetMessageBufferPool::CNetMessageBufferPool() : nFreeBytes(0)
+{
+    for (size_t nSize = MIN_BUFFER_SIZE; nSize <= MAX_BUFFER_SIZE; nSize *= 2)
+        vFree.push_back(std::deque<CSerializeData>());
+}
+
+CNetMessageBufferStats& CNetMessageBufferPool::GetCommandStats(const std::string& strCommand, bool fSend)
+{
+    AssertLockHeld(cs);
+    // peers can send any command, only known ones get their own counters
+    if (setKnownCommands.empty()) {
+        const std::vector<std::string>& vAllMessages = getAllNetMessageTypes();
+        setKnownCommands.insert(vAllMessages.begin(), vAllMessages.end());
+    }
+    const std::string& strCounter = setKnownCommands.count(strCommand) ? strCommand : NET_MESSAGE_COMMAND_OTHER;
+    return fSend ? mapSendStats[strCounter] : mapRecvStats[strCounter];
+}
+
+void CNetMessageBufferPool::Get(CSerializeData& data, size_t nReserve, size_t nMessageSize, const std::string& strCommand, bool fSend)
+{
+    data.clear();
+
+    LOCK(cs);
+    CNetMessageBufferStats& stats = GetCommandStats(strCommand, fSend);
+    stats.nMessages++;
+    stats.nBytes += nMessageSize;
+
+    // smallest class that fits
+    size_t nClass = 0;
+    size_t nClassSize = MIN_BUFFER_SIZE;
+    while (nClassSize < nReserve && nClass < vFree.size()) {
+        nClass++;
+        nClassSize *= 2;
+    }
+
+    if (nClass < vFree.size() && !vFree[nClass].empty()) {
+        data.swap(vFree[nClass].back());
+        vFree[nClass].pop_back();
+        nFreeBytes -= data.capacity();
+        return;
+    }
+
+    stats.nAllocations++;
+    data.reserve(nClass < vFree.size() ? nClassSize : nReserve);
+}
+
+void CNetMessageBufferPool::CountAllocation(const std::string& strCommand, bool fSend)
+{
+    LOCK(cs);
+    GetCommandStats(strCommand, fSend).nAllocations++;
+}
+
+void CNetMessageBufferPool::Put(CSerializeData& data)
+{
+    size_t nCapacity = data.capacity();
+    if (nCapacity < MIN_BUFFER_SIZE || nCapacity > MAX_BUFFER_SIZE * 2 - 1) {
+        CSerializeData().swap(data);
+        return;
+    }
+    data.clear();
+
+    LOCK(cs);
+    // largest class it can serve
+    size_t nClass = 0;
+    size_t nClassSize = MIN_BUFFER_SIZE;
+    while (nClassSize * 2 <= nCapacity && nClass + 1 < vFree.size()) {
+        nClass++;
+        nClassSize *= 2;
+    }
+
+    std::deque<CSerializeData>& vFreeClass = vFree[nClass];
+    if (vFreeClass.size() >= std::max((size_t)2, MAX_FREE_BYTES_PER_CLASS / nClassSize)) {
+        CSerializeData().swap(data);
+        return;
+    }
+    vFreeClass.push_back(CSerializeData());
+    vFreeClass.back().swap(data);
+    nFreeBytes += nCapacity;
+}
+
+size_t CNetMessageBufferPool::GetFreeBytes() const
+{
+    LOCK(cs);
+    return nFreeBytes;
+}
+
+void CNetMessageBufferPool::GetStats(std::map<std::string, CNetMessageBufferStats>& mapRecvRet, std::map<std::string, CNetMessageBufferStats>& mapSendRet) const
+{
+    LOCK(cs);
+    mapRecvRet = mapRecvStats;
+    mapSendRet = mapSendStats;
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -738,6 +929,12 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
     // switch state to reading message data
     in_data = true;
 
+    // Take a buffer for up to 256 KiB from the pool, readData() grows it further if needed
+    CSerializeData data;
+    netMessageBufferPool.Get(data, std::min(hdr.nMessageSize, (unsigned int)256 * 1024), hdr.nMessageSize, hdr.GetCommand(), false);
+    vRecv.swap(data);
+    netMessageBufferPool.Put(data);
+
     return nCopy;
 }
 
@@ -748,7 +945,10 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
     if (vRecv.size() < nDataPos + nCopy) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
+        size_t nCapacityBefore = vRecv.capacity();
         vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        if (vRecv.capacity() != nCapacityBefore)
+            netMessageBufferPool.CountAllocation(hdr.GetCommand(), false);
     }
 
     memcpy(&vRecv[nDataPos], pch, nCopy);
@@ -768,6 +968,7 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode *pnode)
 {
+    size_t nSendSizeBefore = pnode->nSendSize;
     std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end()) {
@@ -806,7 +1007,13 @@ void SocketSendData(CNode *pnode)
         assert(pnode->nSendOffset == 0);
         assert(pnode->nSendSize == 0);
     }
+    for (std::deque<CSerializeData>::iterator itSent = pnode->vSendMsg.begin(); itSent != it; ++itSent)
+        netMessageBufferPool.Put(*itSent);
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+
+    // the message handler skips peers with a full send buffer
+    if (nSendSizeBefore >= SendBufferSize() && pnode->nSendSize < SendBufferSize())
+        WakeMessageHandler();
 }
 
 static list<CNode*> vNodesDisconnected;
@@ -941,9 +1148,16 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     int nInbound = 0;
     int nMaxInbound = nMaxConnections - MAX_OUTBOUND_CONNECTIONS;
 
-    if (hSocket != INVALID_SOCKET)
-        if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
-            LogPrintf("Warning: Unknown socket family\n");
+    if (hSocket == INVALID_SOCKET)
+    {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK)
+            LogPrintf("socket error accept failed: %s\n", NetworkErrorString(nErr));
+        return;
+    }
+
+    if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
+        LogPrintf("Warning: Unknown socket family\n");
 
     bool whitelisted = hListenSocket.whitelisted || CNode::IsWhitelistedRange(addr);
     {
@@ -953,15 +1167,7 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
                 nInbound++;
     }
 
-    if (hSocket == INVALID_SOCKET)
-    {
-        int nErr = WSAGetLastError();
-        if (nErr != WSAEWOULDBLOCK)
-            LogPrintf("socket error accept failed: %s\n", NetworkErrorString(nErr));
-        return;
-    }
-
-    if (!IsSelectableSocket(hSocket))
+    if (!IsSocketSupported(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1009,78 +1215,303 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        AddNodeSocketEvents(pnode);
     }
 }
 
-void ThreadSocketHandler()
+static void DisconnectNodes()
+{
+    {
+        LOCK(cs_vNodes);
+        // Disconnect unused nodes
+        vector<CNode*> vNodesCopy = vNodes;
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+        {
+            if (pnode->fDisconnect ||
+                (pnode->GetRefCount() <= 0 && pnode->vRecvMsg.empty() && pnode->nSendSize == 0 && pnode->ssSend.empty()))
+            {
+                LogPrintf("ThreadSocketHandler -- removing node: peer=%d addr=%s nRefCount=%d fNetworkNode=%d fInbound=%d fMasternode=%d\n",
+                          pnode->id, pnode->addr.ToString(), pnode->GetRefCount(), pnode->fNetworkNode, pnode->fInbound, pnode->fMasternode);
+
+                // remove from vNodes
+                vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+
+                // release outbound grant (if any)
+                pnode->grantOutbound.Release();
+                pnode->grantMasternodeOutbound.Release();
+
+                // close socket and cleanup
+                pnode->CloseSocketDisconnect();
+
+                // hold in disconnected pool until all refs are released
+                if (pnode->fNetworkNode || pnode->fInbound)
+                    pnode->Release();
+                if (pnode->fMasternode)
+                    pnode->Release();
+                vNodesDisconnected.push_back(pnode);
+#ifdef HAVE_SYS_EPOLL_H
+                // its socket is closed, no more events are reported for it
+                setNodesRecvReady.erase(pnode);
+                setNodesSendReady.erase(pnode);
+#endif
+            }
+        }
+    }
+    {
+        // Delete disconnected nodes
+        list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
+        BOOST_FOREACH(CNode* pnode, vNodesDisconnectedCopy)
+        {
+            // wait until threads are done using it
+            if (pnode->GetRefCount() <= 0)
+            {
+                bool fDelete = false;
+                {
+                    TRY_LOCK(pnode->cs_vSend, lockSend);
+                    if (lockSend)
+                    {
+                        TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+                        if (lockRecv)
+                        {
+                            TRY_LOCK(pnode->cs_inventory, lockInv);
+                            if (lockInv)
+                                fDelete = true;
+                        }
+                    }
+                }
+                if (fDelete)
+                {
+                    vNodesDisconnected.remove(pnode);
+                    delete pnode;
+                }
+            }
+        }
+    }
+}
+
+// requires LOCK(cs_vRecvMsg)
+static bool IsRecvFlooded(CNode *pnode)
+{
+    return !pnode->vRecvMsg.empty() && pnode->vRecvMsg.front().complete() && pnode->GetTotalRecvSize() > ReceiveFloodSize();
+}
+
+// Read once from the socket, returns whether anything was read. Requires LOCK(cs_vRecvMsg)
+static bool SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0)
+    {
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
+            pnode->CloseSocketDisconnect();
+        pnode->nLastRecv = GetTime();
+        pnode->nRecvBytes += nBytes;
+        pnode->RecordBytesRecv(nBytes);
+        return true;
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
+static void InactivityCheck(CNode *pnode)
+{
+    int64_t nTime = GetTime();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+    }
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static void ThreadSocketHandlerEpoll()
 {
     unsigned int nPrevNodeCount = 0;
+    int64_t nLastDisconnectCheck = 0;
+    int64_t nLastInactivityCheck = 0;
+    int nTimeout = 0;
+    std::vector<struct epoll_event> vEvents(SOCKET_EVENTS_MAX);
     while (true)
     {
-        //
-        // Disconnect nodes
-        //
+        // This loop runs once per batch of events instead of once per 50ms,
+        // so the work that looks at every node is done on a timer
+        int64_t nNow = GetTimeMillis();
+        if (nNow - nLastDisconnectCheck >= SOCKET_EVENTS_TIMEOUT)
         {
-            LOCK(cs_vNodes);
-            // Disconnect unused nodes
-            vector<CNode*> vNodesCopy = vNodes;
+            DisconnectNodes();
+            if(vNodes.size() != nPrevNodeCount) {
+                nPrevNodeCount = vNodes.size();
+                uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
+            }
+            nLastDisconnectCheck = nNow;
+        }
+        if (nNow - nLastInactivityCheck >= 1000)
+        {
+            vector<CNode*> vNodesCopy = CopyNodeVector();
             BOOST_FOREACH(CNode* pnode, vNodesCopy)
             {
-                if (pnode->fDisconnect ||
-                    (pnode->GetRefCount() <= 0 && pnode->vRecvMsg.empty() && pnode->nSendSize == 0 && pnode->ssSend.empty()))
-                {
-                    LogPrintf("ThreadSocketHandler -- removing node: peer=%d addr=%s nRefCount=%d fNetworkNode=%d fInbound=%d fMasternode=%d\n",
-                              pnode->id, pnode->addr.ToString(), pnode->GetRefCount(), pnode->fNetworkNode, pnode->fInbound, pnode->fMasternode);
+                InactivityCheck(pnode);
+                // a send() interrupted by a signal leaves data queued without a readiness edge to come
+                TRY_LOCK(pnode->cs_vSend, lockSend);
+                if (lockSend && !pnode->vSendMsg.empty())
+                    setNodesSendReady.insert(pnode);
+            }
+            ReleaseNodeVector(vNodesCopy);
+            nLastInactivityCheck = nNow;
+        }
 
-                    // remove from vNodes
-                    vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+        int nEvents = epoll_wait(hEpoll, &vEvents[0], vEvents.size(), nTimeout);
+        boost::this_thread::interruption_point();
+        if (nEvents < 0)
+        {
+            if (errno != EINTR)
+            {
+                LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+                MilliSleep(SOCKET_EVENTS_TIMEOUT);
+            }
+            nEvents = 0;
+        }
 
-                    // release outbound grant (if any)
-                    pnode->grantOutbound.Release();
-                    pnode->grantMasternodeOutbound.Release();
+        bool fAccept = false;
+        for (int i = 0; i < nEvents; i++)
+        {
+            CNode* pnode = (CNode*)vEvents[i].data.ptr;
+            if (pnode == NULL) {
+                // a listen socket or the wakeup pipe, both level triggered
+                fAccept = true;
+                continue;
+            }
+            if (vEvents[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                setNodesRecvReady.insert(pnode);
+            if (vEvents[i].events & EPOLLOUT)
+                setNodesSendReady.insert(pnode);
+        }
 
-                    // close socket and cleanup
-                    pnode->CloseSocketDisconnect();
+        //
+        // Accept new connections
+        //
+        if (fAccept)
+        {
+            char pchBuf[64];
+            while (read(hWakeupPipe[0], pchBuf, sizeof(pchBuf)) > 0) {}
+            BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+                if (hListenSocket.socket != INVALID_SOCKET)
+                    AcceptConnection(hListenSocket);
+        }
 
-                    // hold in disconnected pool until all refs are released
-                    if (pnode->fNetworkNode || pnode->fInbound)
-                        pnode->Release();
-                    if (pnode->fMasternode)
-                        pnode->Release();
-                    vNodesDisconnected.push_back(pnode);
+        //
+        // Receive, one read per node and pass so busy peers don't starve the others
+        //
+        bool fMoreData = false;
+        bool fRetry = false;
+        std::set<CNode*>::iterator it = setNodesRecvReady.begin();
+        while (it != setNodesRecvReady.end())
+        {
+            CNode* pnode = *it;
+            bool fDrained = true;
+            if (pnode->hSocket != INVALID_SOCKET)
+            {
+                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+                if (!lockRecv) {
+                    fDrained = false;
+                    fRetry = true;
+                } else if (IsRecvFlooded(pnode)) {
+                    // ThreadMessageHandler wakes us up once it made room
+                    pnode->fPauseRecv = true;
+                    fDrained = false;
+                } else if (SocketRecvData(pnode)) {
+                    pnode->fPauseRecv = false;
+                    fDrained = false;
+                    fMoreData = true;
                 }
             }
+            if (fDrained)
+                setNodesRecvReady.erase(it++);
+            else
+                ++it;
         }
+
+        //
+        // Send
+        //
+        it = setNodesSendReady.begin();
+        while (it != setNodesSendReady.end())
         {
-            // Delete disconnected nodes
-            list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
-            BOOST_FOREACH(CNode* pnode, vNodesDisconnectedCopy)
-            {
-                // wait until threads are done using it
-                if (pnode->GetRefCount() <= 0)
-                {
-                    bool fDelete = false;
-                    {
-                        TRY_LOCK(pnode->cs_vSend, lockSend);
-                        if (lockSend)
-                        {
-                            TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                            if (lockRecv)
-                            {
-                                TRY_LOCK(pnode->cs_inventory, lockInv);
-                                if (lockInv)
-                                    fDelete = true;
-                            }
-                        }
-                    }
-                    if (fDelete)
-                    {
-                        vNodesDisconnected.remove(pnode);
-                        delete pnode;
-                    }
-                }
+            CNode* pnode = *it;
+            TRY_LOCK(pnode->cs_vSend, lockSend);
+            if (!lockSend) {
+                fRetry = true;
+                ++it;
+                continue;
             }
+            // whatever is left over waits for the next EPOLLOUT, the socket buffer is full again
+            if (pnode->hSocket != INVALID_SOCKET && !pnode->vSendMsg.empty())
+                SocketSendData(pnode);
+            setNodesSendReady.erase(it++);
         }
+
+        if (fMoreData)
+            nTimeout = 0;
+        else if (fRetry)
+            nTimeout = SOCKET_EVENTS_RETRY_TIMEOUT;
+        else
+            nTimeout = SOCKET_EVENTS_TIMEOUT;
+    }
+}
+#endif
+
+void ThreadSocketHandler()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (hEpoll != -1) {
+        ThreadSocketHandlerEpoll();
+        return;
+    }
+#endif
+
+    unsigned int nPrevNodeCount = 0;
+    while (true)
+    {
+        //
+        // Disconnect nodes
+        //
+        DisconnectNodes();
         if(vNodes.size() != nPrevNodeCount) {
             nPrevNodeCount = vNodes.size();
             uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
@@ -1142,9 +1573,7 @@ void ThreadSocketHandler()
                 }
                 {
                     TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (
-                        pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
+                    if (lockRecv && !IsRecvFlooded(pnode))
                         FD_SET(pnode->hSocket, &fdsetRecv);
                 }
             }
@@ -1196,39 +1625,7 @@ void ThreadSocketHandler()
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv)
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0)
-                        {
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
-                                pnode->CloseSocketDisconnect();
-                            pnode->nLastRecv = GetTime();
-                            pnode->nRecvBytes += nBytes;
-                            pnode->RecordBytesRecv(nBytes);
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-                                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
+                    SocketRecvData(pnode);
             }
 
             //
@@ -1246,30 +1643,7 @@ void ThreadSocketHandler()
             //
             // Inactivity checking
             //
-            int64_t nTime = GetTime();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-            }
+            InactivityCheck(pnode);
         }
         ReleaseNodeVector(vNodesCopy);
     }
@@ -1740,12 +2114,14 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant *grantOu
 
 void ThreadMessageHandler()
 {
-    boost::mutex condition_mutex;
-    boost::unique_lock<boost::mutex> lock(condition_mutex);
-
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true)
     {
+        {
+            boost::lock_guard<boost::mutex> lock(mutexMsgProc);
+            fMsgProcWake = false;
+        }
+
         vector<CNode*> vNodesCopy = CopyNodeVector();
 
         bool fSleep = true;
@@ -1763,7 +2139,13 @@ void ThreadMessageHandler()
                     if (!g_signals.ProcessMessages(pnode))
                         pnode->fDisconnect = true;
 
-                    if (pnode->nSendSize < SendBufferSize())
+                    if (pnode->fPauseRecv && !IsRecvFlooded(pnode)) {
+                        pnode->fPauseRecv = false;
+                        WakeSocketHandler();
+                    }
+
+                    // the work queue wakes us when it has room again
+                    if (pnode->nSendSize < SendBufferSize() && !pnode->fPauseProcess)
                     {
                         if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
                         {
@@ -1785,8 +2167,11 @@ void ThreadMessageHandler()
 
         ReleaseNodeVector(vNodesCopy);
 
-        if (fSleep)
-            messageHandlerCondition.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100));
+        if (fSleep) {
+            boost::unique_lock<boost::mutex> lock(mutexMsgProc);
+            if (!fMsgProcWake)
+                messageHandlerCondition.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100));
+        }
     }
 }
 
@@ -1944,6 +2329,56 @@ void static Discover(boost::thread_group& threadGroup)
 #endif
 }
 
+static void CloseSocketEvents()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (hEpoll != -1)
+        close(hEpoll);
+    for (int i = 0; i < 2; i++)
+        if (hWakeupPipe[i] != -1)
+            close(hWakeupPipe[i]);
+    hEpoll = -1;
+    hWakeupPipe[0] = hWakeupPipe[1] = -1;
+    setNodesRecvReady.clear();
+    setNodesSendReady.clear();
+#endif
+}
+
+void InitSocketEvents()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (nSocketEventsMode == SOCKETEVENTS_EPOLL && hEpoll == -1) {
+        hEpoll = epoll_create1(EPOLL_CLOEXEC);
+        bool fSuccess = hEpoll != -1 && pipe(hWakeupPipe) == 0 &&
+            fcntl(hWakeupPipe[0], F_SETFL, O_NONBLOCK) != -1 && fcntl(hWakeupPipe[1], F_SETFL, O_NONBLOCK) != -1;
+
+        // level triggered, so accepting one connection per event is enough
+        std::vector<int> vListen;
+        if (hWakeupPipe[0] != -1)
+            vListen.push_back(hWakeupPipe[0]);
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+            vListen.push_back(hListenSocket.socket);
+        for (size_t i = 0; fSuccess && i < vListen.size(); i++) {
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = NULL;
+            fSuccess = epoll_ctl(hEpoll, EPOLL_CTL_ADD, vListen[i], &event) == 0;
+        }
+
+        if (!fSuccess) {
+            LogPrintf("InitSocketEvents -- setting up epoll failed: %s, falling back to select\n", NetworkErrorString(errno));
+            CloseSocketEvents();
+            nSocketEventsMode = SOCKETEVENTS_SELECT;
+        } else {
+            LOCK(cs_vNodes);
+            BOOST_FOREACH(CNode* pnode, vNodes)
+                AddNodeSocketEvents(pnode);
+        }
+    }
+#endif
+    LogPrintf("Using %s for socket events\n", GetSocketEventsModeName(nSocketEventsMode));
+}
+
 void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
 {
     uiInterface.InitMessage(_("Loading addresses..."));
@@ -1998,6 +2433,7 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     MapPort(GetBoolArg("-upnp", DEFAULT_UPNP));
 
     // Send and receive from sockets, accept connections
+    InitSocketEvents();
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "net", &ThreadSocketHandler));
 
     // Initiate outbound connections from -addnode
@@ -2044,6 +2480,8 @@ public:
 
     ~CNetCleanup()
     {
+        CloseSocketEvents();
+
         // Close sockets
         BOOST_FOREACH(CNode* pnode, vNodes)
             if (pnode->hSocket != INVALID_SOCKET)
@@ -2419,6 +2857,8 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     fNetworkNode = fNetworkNodeIn;
     fSuccessfullyConnected = false;
     fDisconnect = false;
+    fPauseRecv = false;
+    fPauseProcess = false;
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
@@ -2564,7 +3004,10 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
 
     LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
 
+    const char* pszCommand = &ssSend[MESSAGE_START_SIZE];
+    std::string strCommand(pszCommand, std::find(pszCommand, pszCommand + CMessageHeader::COMMAND_SIZE, '\0'));
     std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
+    netMessageBufferPool.Get(*it, ssSend.size(), ssSend.size(), strCommand, true);
     ssSend.GetAndClear(*it);
     nSendSize += (*it).size();
 
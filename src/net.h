@@ -79,6 +79,24 @@ static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Defaul
 unsigned int ReceiveFloodSize();
 unsigned int SendBufferSize();
 
+/** How ThreadSocketHandler waits for sockets to become ready (-socketevents) */
+enum SocketEventsMode
+{
+    SOCKETEVENTS_SELECT,
+    //! Edge triggered readiness of only the sockets that changed, no FD_SETSIZE limit
+    SOCKETEVENTS_EPOLL,
+};
+#ifdef HAVE_SYS_EPOLL_H
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+extern SocketEventsMode nSocketEventsMode;
+
+/** Parse a -socketevents value, fails for modes this build doesn't support */
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& modeRet);
+std::string GetSocketEventsModeName(SocketEventsMode mode);
+
 void AddOneShot(const std::string& strDest);
 void AddressCurrentlyConnected(const CService& addr);
 CNode* FindNode(const CNetAddr& ip);
@@ -95,6 +113,11 @@ bool BindListenPort(const CService &bindAddr, std::string& strError, bool fWhite
 void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler);
 bool StopNode();
 void SocketSendData(CNode *pnode);
+/** Set up -socketevents for the listen sockets bound so far, falling back to select on failure */
+void InitSocketEvents();
+void ThreadSocketHandler();
+/** Make ThreadMessageHandler look at all nodes again without waiting for its timeout */
+void WakeMessageHandler();
 
 typedef int NodeId;
 
@@ -214,6 +237,60 @@ public:
 
 
 
+/** Message and buffer allocation counts of one network command */
+struct CNetMessageBufferStats
+{
+    uint64_t nMessages;
+    uint64_t nBytes;
+    //! messages for which no pooled buffer was available
+    uint64_t nAllocations;
+
+    CNetMessageBufferStats() : nMessages(0), nBytes(0), nAllocations(0) {}
+};
+
+/**
+ * Pool of network message buffers in power of two size classes. Received
+ * messages and messages queued for sending take their buffer from the pool
+ * and give it back once processed or sent, instead of allocating (and
+ * zeroing on free) a buffer per message.
+ */
+class CNetMessageBufferPool
+{
+public:
+    static const size_t MIN_BUFFER_SIZE = 256;
+    //! Larger buffers are allocated and freed as usual
+    static const size_t MAX_BUFFER_SIZE = 1024 * 1024;
+    //! Each size class keeps at most this many bytes of free buffers, or two buffers
+    static const size_t MAX_FREE_BYTES_PER_CLASS = 512 * 1024;
+
+    CNetMessageBufferPool();
+
+    //! Give data an empty buffer that holds at least nReserve bytes and count a message of nMessageSize bytes of strCommand
+    void Get(CSerializeData& data, size_t nReserve, size_t nMessageSize, const std::string& strCommand, bool fSend);
+    //! Count a buffer of strCommand that had to be grown outside the pool
+    void CountAllocation(const std::string& strCommand, bool fSend);
+    //! Take the buffer of data back, leaving data empty
+    void Put(CSerializeData& data);
+
+    size_t GetFreeBytes() const;
+    void GetStats(std::map<std::string, CNetMessageBufferStats>& mapRecvRet, std::map<std::string, CNetMessageBufferStats>& mapSendRet) const;
+
+private:
+    //! Counters of strCommand, requires cs
+    CNetMessageBufferStats& GetCommandStats(const std::string& strCommand, bool fSend);
+
+    mutable CCriticalSection cs;
+    std::set<std::string> setKnownCommands;
+    std::vector<std::deque<CSerializeData> > vFree;
+    size_t nFreeBytes;
+    std::map<std::string, CNetMessageBufferStats> mapRecvStats;
+    std::map<std::string, CNetMessageBufferStats> mapSendStats;
+};
+
+extern CNetMessageBufferPool netMessageBufferPool;
+//! Counter name for commands that aren't part of the protocol
+extern const std::string NET_MESSAGE_COMMAND_OTHER;
+
 class CNetMessage {
 public:
     bool in_data;                   // parsing header (false) or data (true)
@@ -227,12 +304,22 @@ public:
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
+    bool fSigsPreverified;          // signatures were already queued for batch verification
+
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
+        fSigsPreverified = false;
+    }
+
+    ~CNetMessage()
+    {
+        CSerializeData data;
+        vRecv.swap(data);
+        netMessageBufferPool.Put(data);
     }
 
     bool complete() const
@@ -356,6 +443,10 @@ public:
     bool fNetworkNode;
     bool fSuccessfullyConnected;
     bool fDisconnect;
+    // Reading from the socket stopped until the message handler drains vRecvMsg (epoll only), guarded by cs_vRecvMsg
+    bool fPauseRecv;
+    // ProcessMessages stopped at a message whose work queue is full, guarded by cs_vRecvMsg
+    bool fPauseProcess;
     // We use fRelayTxes for two purposes -
     // a) it allows us to not relay tx invs before receiving the peer's version message
     // b) the peer may tell us in its version message that we should not relay tx invs
@@ -10,15 +10,126 @@
 #include "utilstrencodings.h"
 #include "crypto/common.h"
 #include "crypto/neoscrypt.h"
+#include "crypto/sha256.h"
+
+#include <string.h>
+
+#include <boost/thread/mutex.hpp>
+
+/**
+ * The memoized hashes are guarded by a small set of mutexes shared by all
+ * headers, picked by address, which keeps a lock out of every header.
+ */
+static const size_t HASH_MEMO_LOCKS = 16;
+static boost::mutex csHashMemo[HASH_MEMO_LOCKS];
+
+static boost::mutex& HashMemoLock(const CBlockHeader* pheader)
+{
+    return csHashMemo[((size_t)pheader / sizeof(CBlockHeader)) % HASH_MEMO_LOCKS];
+}
+
+CBlockHeader::CBlockHeader(const CBlockHeader& other)
+{
+    *this = other;
+}
+
+CBlockHeader& CBlockHeader::operator=(const CBlockHeader& other)
+{
+    if (this == &other)
+        return *this;
+    nVersion = other.nVersion;
+    hashPrevBlock = other.hashPrevBlock;
+    hashMerkleRoot = other.hashMerkleRoot;
+    nTime = other.nTime;
+    nBits = other.nBits;
+    nNonce = other.nNonce;
+
+    uint256 fingerprint, hash;
+    bool fCached;
+    {
+        boost::mutex::scoped_lock lock(HashMemoLock(&other));
+        fCached = other.fHashCached;
+        fingerprint = other.hashHeaderCached;
+        hash = other.hashCached;
+    }
+    boost::mutex::scoped_lock lock(HashMemoLock(this));
+    fHashCached = fCached;
+    hashHeaderCached = fingerprint;
+    hashCached = hash;
+    return *this;
+}
+
+uint256 CBlockHeader::GetFingerprint() const
+{
+    uint256 fingerprint;
+    CSHA256().Write((const unsigned char*)&nVersion, HEADER_SIZE).Finalize(fingerprint.begin());
+    return fingerprint;
+}
+
+bool CBlockHeader::GetCachedHash(const uint256& fingerprint, uint256& hashRet) const
+{
+    boost::mutex::scoped_lock lock(HashMemoLock(this));
+    if (!fHashCached || hashHeaderCached != fingerprint)
+        return false;
+    hashRet = hashCached;
+    return true;
+}
+
+void CBlockHeader::SetCachedHash(const uint256& fingerprint, const uint256& hash) const
+{
+    boost::mutex::scoped_lock lock(HashMemoLock(this));
+    hashHeaderCached = fingerprint;
+    hashCached = hash;
+    fHashCached = true;
+}
 
 uint256 CBlockHeader::GetHash() const
 {
+    uint256 fingerprint = GetFingerprint();
     uint256 thash;
+    if (GetCachedHash(fingerprint, thash))
+        return thash;
+
     unsigned int profile = 0x0;
     neoscrypt((unsigned char *) &nVersion, (unsigned char *) &thash, profile);
+    SetCachedHash(fingerprint, thash);
     return thash;
 }
 
+void CBlockHeader::SetKnownHash(const uint256& hash) const
+{
+    SetCachedHash(GetFingerprint(), hash);
+}
+
+void CBlockHeader::ComputeHashes(const std::vector<const CBlockHeader*>& vpHeaders)
+{
+    std::vector<const CBlockHeader*> vpToHash;
+    std::vector<uint256> vFingerprints;
+    for (unsigned int i = 0; i < vpHeaders.size(); i++) {
+        uint256 fingerprint = vpHeaders[i]->GetFingerprint();
+        uint256 hash;
+        if (!vpHeaders[i]->GetCachedHash(fingerprint, hash)) {
+            vpToHash.push_back(vpHeaders[i]);
+            vFingerprints.push_back(fingerprint);
+        }
+    }
+    if (vpToHash.empty())
+        return;
+
+    std::vector<unsigned char> vInput(vpToHash.size() * HEADER_SIZE);
+    std::vector<unsigned char> vOutput(vpToHash.size() * 32);
+    for (unsigned int i = 0; i < vpToHash.size(); i++)
+        memcpy(&vInput[i * HEADER_SIZE], &vpToHash[i]->nVersion, HEADER_SIZE);
+
+    neoscrypt_multi(&vInput[0], &vOutput[0], vpToHash.size());
+
+    for (unsigned int i = 0; i < vpToHash.size(); i++) {
+        uint256 hash;
+        memcpy(hash.begin(), &vOutput[i * 32], 32);
+        vpToHash[i]->SetCachedHash(vFingerprints[i], hash);
+    }
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
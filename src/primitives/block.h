@@ -20,6 +20,9 @@
 class CBlockHeader
 {
 public:
+    //! Size of the serialized header, which is what GetHash() runs NeoScrypt over
+    static const size_t HEADER_SIZE = 80;
+
     // header
     int32_t nVersion;
     uint256 hashPrevBlock;
@@ -33,6 +36,10 @@ public:
         SetNull();
     }
 
+    //! Copies the memoized hash under its lock, as another thread may be filling it in
+    CBlockHeader(const CBlockHeader& other);
+    CBlockHeader& operator=(const CBlockHeader& other);
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -54,6 +61,7 @@ public:
         nTime = 0;
         nBits = 0;
         nNonce = 0;
+        fHashCached = false;
     }
 
     bool IsNull() const
@@ -61,12 +69,43 @@ public:
         return (nBits == 0);
     }
 
+    /**
+     * NeoScrypt hash of the header. The result is memoized together with a
+     * SHA256 fingerprint of the header bytes it was computed from, so repeated
+     * calls on an unmodified header are cheap while any change to a header
+     * field is picked up. The memo is guarded by a lock, so const calls from
+     * several threads are safe; changing the fields still needs exclusive access.
+     */
     uint256 GetHash() const;
 
+    /**
+     * Memoize a hash that is already known to belong to the current header
+     * fields (e.g. the one stored in the block index), so that the next
+     * GetHash() call doesn't have to run NeoScrypt at all.
+     */
+    void SetKnownHash(const uint256& hash) const;
+
+    /**
+     * Hash several headers at once with the multi-lane NeoScrypt engine and
+     * memoize the results, so that the following GetHash() calls are cheap.
+     * Headers that already have a valid memoized hash are skipped.
+     */
+    static void ComputeHashes(const std::vector<const CBlockHeader*>& vpHeaders);
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
     }
+
+private:
+    uint256 GetFingerprint() const;
+    bool GetCachedHash(const uint256& fingerprint, uint256& hashRet) const;
+    void SetCachedHash(const uint256& fingerprint, const uint256& hash) const;
+
+    // memory only
+    mutable uint256 hashCached;
+    mutable uint256 hashHeaderCached;
+    mutable bool fHashCached;
 };
 
 
@@ -113,13 +152,8 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
+        // copy the memoized hash along with the header fields
+        CBlockHeader block(*this);
         return block;
     }
 
@@ -8,12 +8,15 @@
 #include "masternode-sync.h"
 #include "masternodeconfig.h"
 #include "masternodeman.h"
+#include "masternodetablemodel.h"
 #include "sync.h"
 #include "wallet/wallet.h"
 #include "walletmodel.h"
 
 #include <QTimer>
 #include <QMessageBox>
+#include <QSortFilterProxyModel>
+#include <QThread>
 
 MasternodeList::MasternodeList(const PlatformStyle *platformStyle, QWidget *parent) :
     QWidget(parent),
@@ -39,11 +42,25 @@ MasternodeList::MasternodeList(const PlatformStyle *platformStyle, QWidget *pare
     ui->tableWidgetMyMasternodes->setColumnWidth(4, columnActiveWidth);
     ui->tableWidgetMyMasternodes->setColumnWidth(5, columnLastSeenWidth);
 
-    ui->tableWidgetMasternodes->setColumnWidth(0, columnAddressWidth);
-    ui->tableWidgetMasternodes->setColumnWidth(1, columnProtocolWidth);
-    ui->tableWidgetMasternodes->setColumnWidth(2, columnStatusWidth);
-    ui->tableWidgetMasternodes->setColumnWidth(3, columnActiveWidth);
-    ui->tableWidgetMasternodes->setColumnWidth(4, columnLastSeenWidth);
+    masternodeModel = new MasternodeTableModel(this);
+    masternodeProxyModel = new QSortFilterProxyModel(this);
+    masternodeProxyModel->setSourceModel(masternodeModel);
+    masternodeProxyModel->setDynamicSortFilter(true);
+    masternodeProxyModel->setSortRole(MasternodeTableModel::SortRole);
+    // match the filter against all columns
+    masternodeProxyModel->setFilterKeyColumn(-1);
+    ui->tableViewMasternodes->setModel(masternodeProxyModel);
+    ui->tableViewMasternodes->sortByColumn(MasternodeTableModel::Address, Qt::AscendingOrder);
+
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::Address, columnAddressWidth);
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::Protocol, columnProtocolWidth);
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::Status, columnStatusWidth);
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::Active, columnActiveWidth);
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::LastSeen, columnLastSeenWidth);
+
+    connect(masternodeProxyModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(updateNodeCount()));
+    connect(masternodeProxyModel, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(updateNodeCount()));
+    connect(masternodeProxyModel, SIGNAL(modelReset()), this, SLOT(updateNodeCount()));
 
     ui->tableWidgetMyMasternodes->setContextMenuPolicy(Qt::CustomContextMenu);
 
@@ -58,16 +75,43 @@ MasternodeList::MasternodeList(const PlatformStyle *platformStyle, QWidget *pare
     connect(timer, SIGNAL(timeout()), this, SLOT(updateMyNodeList()));
     timer->start(1000);
 
-    fFilterUpdated = false;
-    nTimeFilterUpdated = GetTime();
-    updateNodeList();
+    startWorker();
+
+    ui->countLabel->setText("Updating...");
+    nTimeListUpdated = GetTime();
+    Q_EMIT nodeListRequested();
 }
 
 MasternodeList::~MasternodeList()
 {
+    Q_EMIT stopWorker();
     delete ui;
 }
 
+void MasternodeList::startWorker()
+{
+    qRegisterMetaType<MasternodeTableUpdate>("MasternodeTableUpdate");
+
+    QThread *thread = new QThread;
+    MasternodeTableWorker *worker = new MasternodeTableWorker();
+    worker->moveToThread(thread);
+
+    // Changes collected by the worker go to the model
+    connect(worker, SIGNAL(updated(MasternodeTableUpdate)), masternodeModel, SLOT(applyUpdate(MasternodeTableUpdate)));
+    // Requests from this object must go to the worker
+    connect(this, SIGNAL(nodeListRequested()), worker, SLOT(update()));
+
+    // On stopWorker signal
+    // - queue worker for deletion (in worker thread)
+    // - quit the Qt event loop in the worker thread
+    connect(this, SIGNAL(stopWorker()), worker, SLOT(deleteLater()));
+    connect(this, SIGNAL(stopWorker()), thread, SLOT(quit()));
+    // Queue the thread for deletion (in this thread) when it is finished
+    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+
+    thread->start();
+}
+
 void MasternodeList::setClientModel(ClientModel *model)
 {
     this->clientModel = model;
@@ -218,7 +262,6 @@ void MasternodeList::updateMyNodeList(bool fForce)
     if(nSecondsTillUpdate > 0 && !fForce) return;
     nTimeMyListUpdated = GetTime();
 
-    ui->tableWidgetMasternodes->setSortingEnabled(false);
     BOOST_FOREACH(CMasternodeConfig::CMasternodeEntry mne, masternodeConfig.getEntries()) {
         int32_t nOutputIndex = 0;
         if(!ParseInt32(mne.getOutputIndex(), &nOutputIndex)) {
@@ -231,7 +274,6 @@ void MasternodeList::updateMyNodeList(bool fForce)
 
         updateMyMasternodeInfo(QString::fromStdString(mne.getAlias()), QString::fromStdString(mne.getIp()), infoMn);
     }
-    ui->tableWidgetMasternodes->setSortingEnabled(true);
 
     // reset "timer"
     ui->secondsLabel->setText("0");
@@ -239,73 +281,23 @@ void MasternodeList::updateMyNodeList(bool fForce)
 
 void MasternodeList::updateNodeList()
 {
-    TRY_LOCK(cs_mnlist, fLockAcquired);
-    if(!fLockAcquired) {
-        return;
-    }
-
-    static int64_t nTimeListUpdated = GetTime();
-
-    // to prevent high cpu usage update only once in MASTERNODELIST_UPDATE_SECONDS seconds
-    // or MASTERNODELIST_FILTER_COOLDOWN_SECONDS seconds after filter was last changed
-    int64_t nSecondsToWait = fFilterUpdated
-                            ? nTimeFilterUpdated - GetTime() + MASTERNODELIST_FILTER_COOLDOWN_SECONDS
-                            : nTimeListUpdated - GetTime() + MASTERNODELIST_UPDATE_SECONDS;
-
-    if(fFilterUpdated) ui->countLabel->setText(QString::fromStdString(strprintf("Please wait... %d", nSecondsToWait)));
-    if(nSecondsToWait > 0) return;
+    // to prevent high cpu usage update only once in MASTERNODELIST_UPDATE_SECONDS seconds,
+    // the worker only sends what changed since its last update
+    if(GetTime() - nTimeListUpdated < MASTERNODELIST_UPDATE_SECONDS) return;
 
     nTimeListUpdated = GetTime();
-    fFilterUpdated = false;
-
-    QString strToFilter;
-    ui->countLabel->setText("Updating...");
-    ui->tableWidgetMasternodes->setSortingEnabled(false);
-    ui->tableWidgetMasternodes->clearContents();
-    ui->tableWidgetMasternodes->setRowCount(0);
-    std::vector<CMasternode> vMasternodes = mnodeman.GetFullMasternodeVector();
-
-    BOOST_FOREACH(CMasternode& mn, vMasternodes)
-    {
-        // populate list
-        // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
-        QTableWidgetItem *addressItem = new QTableWidgetItem(QString::fromStdString(mn.addr.ToString()));
-        QTableWidgetItem *protocolItem = new QTableWidgetItem(QString::number(mn.nProtocolVersion));
-        QTableWidgetItem *statusItem = new QTableWidgetItem(QString::fromStdString(mn.GetStatus()));
-        QTableWidgetItem *activeSecondsItem = new QTableWidgetItem(QString::fromStdString(DurationToDHMS(mn.lastPing.sigTime - mn.sigTime)));
-        QTableWidgetItem *lastSeenItem = new QTableWidgetItem(QString::fromStdString(DateTimeStrFormat("%Y-%m-%d %H:%M", mn.lastPing.sigTime + QDateTime::currentDateTime().offsetFromUtc())));
-        QTableWidgetItem *pubkeyItem = new QTableWidgetItem(QString::fromStdString(CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString()));
-
-        if (strCurrentFilter != "")
-        {
-            strToFilter =   addressItem->text() + " " +
-                            protocolItem->text() + " " +
-                            statusItem->text() + " " +
-                            activeSecondsItem->text() + " " +
-                            lastSeenItem->text() + " " +
-                            pubkeyItem->text();
-            if (!strToFilter.contains(strCurrentFilter)) continue;
-        }
-
-        ui->tableWidgetMasternodes->insertRow(0);
-        ui->tableWidgetMasternodes->setItem(0, 0, addressItem);
-        ui->tableWidgetMasternodes->setItem(0, 1, protocolItem);
-        ui->tableWidgetMasternodes->setItem(0, 2, statusItem);
-        ui->tableWidgetMasternodes->setItem(0, 3, activeSecondsItem);
-        ui->tableWidgetMasternodes->setItem(0, 4, lastSeenItem);
-        ui->tableWidgetMasternodes->setItem(0, 5, pubkeyItem);
-    }
+    Q_EMIT nodeListRequested();
+}
 
-    ui->countLabel->setText(QString::number(ui->tableWidgetMasternodes->rowCount()));
-    ui->tableWidgetMasternodes->setSortingEnabled(true);
+void MasternodeList::updateNodeCount()
+{
+    ui->countLabel->setText(QString::number(masternodeProxyModel->rowCount()));
 }
 
 void MasternodeList::on_filterLineEdit_textChanged(const QString &strFilterIn)
 {
-    strCurrentFilter = strFilterIn;
-    nTimeFilterUpdated = GetTime();
-    fFilterUpdated = true;
-    ui->countLabel->setText(QString::fromStdString(strprintf("Please wait... %d", MASTERNODELIST_FILTER_COOLDOWN_SECONDS)));
+    masternodeProxyModel->setFilterFixedString(strFilterIn);
+    updateNodeCount();
 }
 
 void MasternodeList::on_startButton_clicked()
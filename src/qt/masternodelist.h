@@ -12,17 +12,18 @@
 
 #define MY_MASTERNODELIST_UPDATE_SECONDS                 60
 #define MASTERNODELIST_UPDATE_SECONDS                    15
-#define MASTERNODELIST_FILTER_COOLDOWN_SECONDS            3
 
 namespace Ui {
     class MasternodeList;
 }
 
 class ClientModel;
+class MasternodeTableModel;
 class WalletModel;
 
 QT_BEGIN_NAMESPACE
 class QModelIndex;
+class QSortFilterProxyModel;
 QT_END_NAMESPACE
 
 /** Masternode Manager page widget */
@@ -41,8 +42,7 @@ public:
 
 private:
     QMenu *contextMenu;
-    int64_t nTimeFilterUpdated;
-    bool fFilterUpdated;
+    int64_t nTimeListUpdated;
 
 public Q_SLOTS:
     void updateMyMasternodeInfo(QString strAlias, QString strAddr, masternode_info_t& infoMn);
@@ -50,6 +50,10 @@ public Q_SLOTS:
     void updateNodeList();
 
 Q_SIGNALS:
+    /** Ask the worker for masternode list changes */
+    void nodeListRequested();
+    /** Stop the worker thread */
+    void stopWorker();
 
 private:
     QTimer *timer;
@@ -57,17 +61,18 @@ private:
     ClientModel *clientModel;
     WalletModel *walletModel;
 
-    // Protects tableWidgetMasternodes
-    CCriticalSection cs_mnlist;
+    MasternodeTableModel *masternodeModel;
+    QSortFilterProxyModel *masternodeProxyModel;
 
     // Protects tableWidgetMyMasternodes
     CCriticalSection cs_mymnlist;
 
-    QString strCurrentFilter;
+    void startWorker();
 
 private Q_SLOTS:
     void showContextMenu(const QPoint &);
     void on_filterLineEdit_textChanged(const QString &strFilterIn);
+    void updateNodeCount();
     void on_startButton_clicked();
     void on_startAllButton_clicked();
     void on_startMissingButton_clicked();
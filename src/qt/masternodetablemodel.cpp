@@ -0,0 +1,228 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternodetablemodel.h"
+
+#include "base58.h"
+#include "masternodeman.h"
+#include "timedata.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <map>
+
+#include <QDateTime>
+
+static MasternodeTableEntry FormatMasternode(const masternode_info_t& infoMn, int nUtcOffset)
+{
+    MasternodeTableEntry entry;
+    entry.outpoint = infoMn.vin.prevout;
+    entry.strAddress = QString::fromStdString(infoMn.addr.ToString());
+    entry.nProtocolVersion = infoMn.nProtocolVersion;
+    entry.strStatus = QString::fromStdString(CMasternode::StateToString(infoMn.nActiveState));
+    entry.nActiveSeconds = infoMn.nTimeLastPing - infoMn.sigTime;
+    entry.strActive = QString::fromStdString(DurationToDHMS(entry.nActiveSeconds));
+    entry.nLastSeen = infoMn.nTimeLastPing;
+    entry.strLastSeen = QString::fromStdString(DateTimeStrFormat("%Y-%m-%d %H:%M", infoMn.nTimeLastPing + nUtcOffset));
+    entry.strPayee = QString::fromStdString(CBitcoinAddress(infoMn.pubKeyCollateralAddress.GetID()).ToString());
+    return entry;
+}
+
+MasternodeTableWorker::MasternodeTableWorker() :
+    QObject(),
+    nTimeLastUpdate(0)
+{
+}
+
+void MasternodeTableWorker::update()
+{
+    int64_t nNow = GetAdjustedTime();
+    std::vector<masternode_info_t> vecInfo;
+    std::vector<COutPoint> vecRemoved;
+    // a first update or one after forgotten removals gets the whole list
+    MasternodeTableUpdate update;
+    update.fReset = !mnodeman.GetMasternodesChangedSince(nTimeLastUpdate, vecInfo, vecRemoved);
+    nTimeLastUpdate = nNow;
+
+    if(update.fReset) {
+        setKnown.clear();
+    } else {
+        for(size_t i = 0; i < vecRemoved.size(); ++i) {
+            if(setKnown.erase(vecRemoved[i])) {
+                update.vecRemoved.push_back(vecRemoved[i]);
+            }
+        }
+    }
+
+    int nUtcOffset = QDateTime::currentDateTime().offsetFromUtc();
+    update.vecChanged.reserve(vecInfo.size());
+    for(size_t i = 0; i < vecInfo.size(); ++i) {
+        setKnown.insert(vecInfo[i].vin.prevout);
+        update.vecChanged.push_back(FormatMasternode(vecInfo[i], nUtcOffset));
+    }
+
+    if(update.fReset || !update.vecChanged.empty() || !update.vecRemoved.empty()) {
+        Q_EMIT updated(update);
+    }
+}
+
+// private implementation
+class MasternodeTablePriv
+{
+public:
+    /** Local cache of the masternode list */
+    std::vector<MasternodeTableEntry> vecEntries;
+    /** Row of every masternode in vecEntries */
+    std::map<COutPoint, int> mapRows;
+
+    /** Update mapRows for the rows from nFirst on */
+    void reindex(int nFirst)
+    {
+        for(int i = nFirst; i < (int)vecEntries.size(); ++i) {
+            mapRows[vecEntries[i].outpoint] = i;
+        }
+    }
+
+    int size() const
+    {
+        return vecEntries.size();
+    }
+
+    int row(const COutPoint& outpoint) const
+    {
+        std::map<COutPoint, int>::const_iterator it = mapRows.find(outpoint);
+        return it == mapRows.end() ? -1 : it->second;
+    }
+};
+
+MasternodeTableModel::MasternodeTableModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    columns << tr("Address") << tr("Protocol") << tr("Status") << tr("Active") << tr("Last Seen") << tr("Payee");
+    priv = new MasternodeTablePriv();
+}
+
+MasternodeTableModel::~MasternodeTableModel()
+{
+    delete priv;
+}
+
+int MasternodeTableModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return priv->size();
+}
+
+int MasternodeTableModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return columns.length();
+}
+
+QVariant MasternodeTableModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= priv->size())
+        return QVariant();
+
+    const MasternodeTableEntry& rec = priv->vecEntries[index.row()];
+
+    if(role == Qt::DisplayRole || role == SortRole) {
+        switch(index.column())
+        {
+        case Address:
+            return rec.strAddress;
+        case Protocol:
+            return rec.nProtocolVersion;
+        case Status:
+            return rec.strStatus;
+        case Active:
+            if(role == SortRole)
+                return qlonglong(rec.nActiveSeconds);
+            return rec.strActive;
+        case LastSeen:
+            if(role == SortRole)
+                return qlonglong(rec.nLastSeen);
+            return rec.strLastSeen;
+        case Payee:
+            return rec.strPayee;
+        }
+    }
+
+    return QVariant();
+}
+
+QVariant MasternodeTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation == Qt::Horizontal)
+    {
+        if(role == Qt::DisplayRole && section < columns.size())
+        {
+            return columns[section];
+        }
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags MasternodeTableModel::flags(const QModelIndex &index) const
+{
+    if(!index.isValid())
+        return 0;
+
+    Qt::ItemFlags retval = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    return retval;
+}
+
+void MasternodeTableModel::applyUpdate(const MasternodeTableUpdate &update)
+{
+    if(update.fReset) {
+        beginResetModel();
+        priv->vecEntries = update.vecChanged;
+        priv->mapRows.clear();
+        priv->reindex(0);
+        endResetModel();
+        return;
+    }
+
+    // remove from the bottom up, so rows still to be removed don't move
+    std::vector<int> vecRows;
+    for(size_t i = 0; i < update.vecRemoved.size(); ++i) {
+        int nRow = priv->row(update.vecRemoved[i]);
+        if(nRow >= 0) vecRows.push_back(nRow);
+    }
+    std::sort(vecRows.rbegin(), vecRows.rend());
+    for(size_t i = 0; i < vecRows.size(); ++i) {
+        beginRemoveRows(QModelIndex(), vecRows[i], vecRows[i]);
+        priv->mapRows.erase(priv->vecEntries[vecRows[i]].outpoint);
+        priv->vecEntries.erase(priv->vecEntries.begin() + vecRows[i]);
+        endRemoveRows();
+    }
+    if(!vecRows.empty()) priv->reindex(vecRows.back());
+
+    int nFirstChanged = -1;
+    int nLastChanged = -1;
+    std::vector<const MasternodeTableEntry*> vecAdded;
+    for(size_t i = 0; i < update.vecChanged.size(); ++i) {
+        int nRow = priv->row(update.vecChanged[i].outpoint);
+        if(nRow < 0) {
+            vecAdded.push_back(&update.vecChanged[i]);
+            continue;
+        }
+        priv->vecEntries[nRow] = update.vecChanged[i];
+        if(nFirstChanged < 0 || nRow < nFirstChanged) nFirstChanged = nRow;
+        if(nRow > nLastChanged) nLastChanged = nRow;
+    }
+    if(nFirstChanged >= 0) {
+        Q_EMIT dataChanged(index(nFirstChanged, 0), index(nLastChanged, columns.size() - 1));
+    }
+
+    if(!vecAdded.empty()) {
+        int nFirst = priv->size();
+        beginInsertRows(QModelIndex(), nFirst, nFirst + vecAdded.size() - 1);
+        for(size_t i = 0; i < vecAdded.size(); ++i) {
+            priv->vecEntries.push_back(*vecAdded[i]);
+        }
+        priv->reindex(nFirst);
+        endInsertRows();
+    }
+}
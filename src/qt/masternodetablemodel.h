@@ -0,0 +1,115 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODETABLEMODEL_H
+#define MASTERNODETABLEMODEL_H
+
+#include "primitives/transaction.h"
+
+#include <set>
+#include <vector>
+
+#include <QAbstractTableModel>
+#include <QMetaType>
+#include <QObject>
+#include <QStringList>
+
+class MasternodeTablePriv;
+
+/** A masternode of the list, formatted for display */
+struct MasternodeTableEntry
+{
+    COutPoint outpoint;
+    QString strAddress;
+    int nProtocolVersion;
+    QString strStatus;
+    int64_t nActiveSeconds;
+    QString strActive;
+    int64_t nLastSeen;
+    QString strLastSeen;
+    QString strPayee;
+};
+
+/** Masternodes added or changed and removed since the previous update */
+struct MasternodeTableUpdate
+{
+    /** Changed holds the full list, anything not in it is gone */
+    bool fReset;
+    std::vector<MasternodeTableEntry> vecChanged;
+    std::vector<COutPoint> vecRemoved;
+
+    MasternodeTableUpdate() : fReset(false) {}
+};
+
+Q_DECLARE_METATYPE(MasternodeTableUpdate)
+
+/**
+   Collects masternode list changes in the background, so formatting a big
+   list doesn't block the GUI thread. Lives in its own QThread.
+ */
+class MasternodeTableWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    MasternodeTableWorker();
+
+public Q_SLOTS:
+    void update();
+
+Q_SIGNALS:
+    void updated(const MasternodeTableUpdate &update);
+
+private:
+    /** Adjusted time of the previous update, changes since then are sent */
+    int64_t nTimeLastUpdate;
+    /** Masternodes the model holds */
+    std::set<COutPoint> setKnown;
+};
+
+/**
+   Qt model of the masternode list, similar to the "masternode list" RPC call.
+   Rows are changed in place from MasternodeTableWorker updates, sorting and
+   filtering are left to a proxy model.
+ */
+class MasternodeTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit MasternodeTableModel(QObject *parent = 0);
+    ~MasternodeTableModel();
+
+    enum ColumnIndex {
+        Address = 0,
+        Protocol = 1,
+        Status = 2,
+        Active = 3,
+        LastSeen = 4,
+        Payee = 5
+    };
+
+    enum RoleIndex {
+        /** Value to sort by, numeric for the numeric columns */
+        SortRole = Qt::UserRole
+    };
+
+    /** @name Methods overridden from QAbstractTableModel
+        @{*/
+    int rowCount(const QModelIndex &parent) const;
+    int columnCount(const QModelIndex &parent) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    /*@}*/
+
+public Q_SLOTS:
+    void applyUpdate(const MasternodeTableUpdate &update);
+
+private:
+    QStringList columns;
+    MasternodeTablePriv *priv;
+};
+
+#endif // MASTERNODETABLEMODEL_H
@@ -3,13 +3,18 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "governance.h"
+#include "governance-object.h"
+#include "masternodeman.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
 #include "httpserver.h"
 #include "rpcserver.h"
+#include "script/script.h"
 #include "streams.h"
 #include "sync.h"
 #include "txmempool.h"
@@ -58,6 +63,119 @@ struct CCoin {
     }
 };
 
+struct CRestMasternode {
+    COutPoint outpoint;
+    CService addr;
+    CPubKey pubKeyCollateralAddress;
+    CPubKey pubKeyMasternode;
+    int32_t nProtocolVersion;
+    int32_t nActiveState;
+    int64_t sigTime;
+    int64_t nTimeLastPing;
+    int64_t nTimeLastPaid;
+
+    CRestMasternode() : nProtocolVersion(0), nActiveState(0), sigTime(0), nTimeLastPing(0), nTimeLastPaid(0) {}
+
+    CRestMasternode(const masternode_info_t& info)
+        : outpoint(info.vin.prevout),
+          addr(info.addr),
+          pubKeyCollateralAddress(info.pubKeyCollateralAddress),
+          pubKeyMasternode(info.pubKeyMasternode),
+          nProtocolVersion(info.nProtocolVersion),
+          nActiveState(info.nActiveState),
+          sigTime(info.sigTime),
+          nTimeLastPing(info.nTimeLastPing),
+          nTimeLastPaid(info.nTimeLastPaid)
+    {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(outpoint);
+        READWRITE(addr);
+        READWRITE(pubKeyCollateralAddress);
+        READWRITE(pubKeyMasternode);
+        READWRITE(nProtocolVersion);
+        READWRITE(nActiveState);
+        READWRITE(sigTime);
+        READWRITE(nTimeLastPing);
+        READWRITE(nTimeLastPaid);
+    }
+};
+
+/** Governance object and its funding vote counts, copied so it is serialized without holding governance.cs */
+struct CRestGovernanceObject {
+    uint256 nHash;
+    uint256 nHashParent;
+    int nRevision;
+    int64_t nTime;
+    uint256 nCollateralHash;
+    std::string strData;
+    int nObjectType;
+    CTxIn vinMasternode;
+    std::vector<unsigned char> vchSig;
+    int64_t nDeletionTime;
+    int32_t nAbsoluteYesCount;
+    int32_t nYesCount;
+    int32_t nNoCount;
+    int32_t nAbstainCount;
+    bool fCachedValid;
+    bool fCachedFunding;
+    bool fCachedDelete;
+    bool fCachedEndorsed;
+
+    CRestGovernanceObject() : nRevision(0), nTime(0), nObjectType(0), nDeletionTime(0), nAbsoluteYesCount(0), nYesCount(0),
+                              nNoCount(0), nAbstainCount(0), fCachedValid(false), fCachedFunding(false), fCachedDelete(false),
+                              fCachedEndorsed(false) {}
+
+    CRestGovernanceObject(const CGovernanceObject& govobj)
+        : nHash(govobj.GetHash()),
+          nHashParent(govobj.GetParentHash()),
+          nRevision(govobj.GetRevision()),
+          nTime(govobj.GetCreationTime()),
+          nCollateralHash(govobj.GetCollateralHash()),
+          strData(govobj.GetDataString()),
+          nObjectType(govobj.GetObjectType()),
+          vinMasternode(govobj.GetMasternodeVin()),
+          vchSig(govobj.GetSignature()),
+          nDeletionTime(govobj.GetDeletionTime()),
+          nAbsoluteYesCount(govobj.GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING)),
+          nYesCount(govobj.GetYesCount(VOTE_SIGNAL_FUNDING)),
+          nNoCount(govobj.GetNoCount(VOTE_SIGNAL_FUNDING)),
+          nAbstainCount(govobj.GetAbstainCount(VOTE_SIGNAL_FUNDING)),
+          fCachedValid(govobj.IsSetCachedValid()),
+          fCachedFunding(govobj.IsSetCachedFunding()),
+          fCachedDelete(govobj.IsSetCachedDelete()),
+          fCachedEndorsed(govobj.IsSetCachedEndorsed())
+    {}
+
+    ADD_SERIALIZE_METHODS;
+
+    /** Same layout as the network serialization of CGovernanceObject, followed by the counts and flags */
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(nHashParent);
+        READWRITE(nRevision);
+        READWRITE(nTime);
+        READWRITE(nCollateralHash);
+        READWRITE(LIMITED_STRING(strData, MAX_GOVERNANCE_OBJECT_DATA_SIZE));
+        READWRITE(nObjectType);
+        READWRITE(vinMasternode);
+        READWRITE(vchSig);
+        READWRITE(nAbsoluteYesCount);
+        READWRITE(nYesCount);
+        READWRITE(nNoCount);
+        READWRITE(nAbstainCount);
+        READWRITE(fCachedValid);
+        READWRITE(fCachedFunding);
+        READWRITE(fCachedDelete);
+        READWRITE(fCachedEndorsed);
+    }
+};
+
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
 extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
 extern UniValue mempoolInfoToJSON();
@@ -118,6 +236,36 @@ static bool ParseHashStr(const string& strReq, uint256& v)
     return true;
 }
 
+/**
+ * Parse the optional "/since/<n>" part of a delta query. Values below
+ * LOCKTIME_THRESHOLD are block heights and are mapped to that block's time,
+ * anything else is a unix time. No since part means everything (0).
+ */
+static bool ParseChangedSince(const std::string& param, int64_t& nSince)
+{
+    nSince = 0;
+    if (param.empty())
+        return true;
+
+    const std::string strPrefix = "/since/";
+    if (param.compare(0, strPrefix.size(), strPrefix) != 0)
+        return false;
+
+    int64_t n;
+    if (!ParseInt64(param.substr(strPrefix.size()), &n) || n < 0)
+        return false;
+
+    if (n < LOCKTIME_THRESHOLD) {
+        LOCK(cs_main);
+        if (n > chainActive.Height())
+            return false;
+        nSince = chainActive[n]->GetBlockTime();
+    } else {
+        nSince = n;
+    }
+    return true;
+}
+
 static bool CheckWarmup(HTTPRequest* req)
 {
     std::string statusmessage;
@@ -596,24 +744,197 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool rest_masternodes(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    int64_t nSince;
+    if (!ParseChangedSince(param, nSince))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/masternodes[/since/<height or time>].<ext>");
+
+    // Take the reply time before looking, so it can be used as the next since value
+    const int64_t nNow = GetAdjustedTime();
+    std::vector<masternode_info_t> vecChanged;
+    std::vector<COutPoint> vecRemoved;
+    // removals that old are forgotten, the reply then lists every masternode
+    const bool fFullResync = !mnodeman.GetMasternodesChangedSince(nSince, vecChanged, vecRemoved);
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        std::vector<CRestMasternode> vMasternodes;
+        vMasternodes.reserve(vecChanged.size());
+        BOOST_FOREACH(const masternode_info_t& info, vecChanged)
+            vMasternodes.push_back(CRestMasternode(info));
+
+        CDataStream ssMasternodes(SER_NETWORK, PROTOCOL_VERSION);
+        ssMasternodes << nNow << fFullResync << vMasternodes << vecRemoved;
+
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssMasternodes.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssMasternodes.begin(), ssMasternodes.end()) + "\n");
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue objMasternodes(UniValue::VOBJ);
+        objMasternodes.push_back(Pair("time", nNow));
+        objMasternodes.push_back(Pair("fullresync", fFullResync));
+
+        UniValue arrChanged(UniValue::VARR);
+        BOOST_FOREACH(const masternode_info_t& info, vecChanged) {
+            UniValue objMn(UniValue::VOBJ);
+            objMn.push_back(Pair("outpoint", info.vin.prevout.ToStringShort()));
+            objMn.push_back(Pair("address", info.addr.ToString()));
+            objMn.push_back(Pair("payee", CBitcoinAddress(info.pubKeyCollateralAddress.GetID()).ToString()));
+            objMn.push_back(Pair("status", CMasternode::StateToString(info.nActiveState)));
+            objMn.push_back(Pair("protocol", info.nProtocolVersion));
+            objMn.push_back(Pair("lastseen", info.nTimeLastPing));
+            objMn.push_back(Pair("activeseconds", info.nTimeLastPing - info.sigTime));
+            objMn.push_back(Pair("lastpaidtime", info.nTimeLastPaid));
+            arrChanged.push_back(objMn);
+        }
+        objMasternodes.push_back(Pair("masternodes", arrChanged));
+
+        UniValue arrRemoved(UniValue::VARR);
+        BOOST_FOREACH(const COutPoint& outpoint, vecRemoved)
+            arrRemoved.push_back(outpoint.ToStringShort());
+        objMasternodes.push_back(Pair("removed", arrRemoved));
+
+        string strJSON = objMasternodes.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_governance_objects(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    int64_t nSince;
+    if (!ParseChangedSince(param, nSince))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/governance/objects[/since/<height or time>].<ext>");
+
+    // Take the reply time before looking, so it can be used as the next since value
+    const int64_t nNow = GetAdjustedTime();
+    std::vector<uint256> vecErased;
+    // erasures that old are forgotten, the reply then lists every object
+    const bool fFullResync = !governance.GetObjectsErasedSince(nSince, vecErased);
+    if (fFullResync)
+        nSince = 0;
+    std::vector<CRestGovernanceObject> vObjects;
+    {
+        LOCK(governance.cs);
+        std::vector<CGovernanceObject*> objs = governance.GetAllNewerThan(0);
+        BOOST_FOREACH(CGovernanceObject* pGovObj, objs)
+            if (pGovObj->GetLastChangeTime() >= nSince)
+                vObjects.push_back(CRestGovernanceObject(*pGovObj));
+    }
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssObjects(SER_NETWORK, PROTOCOL_VERSION);
+        ssObjects << nNow << fFullResync << vObjects << vecErased;
+
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssObjects.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssObjects.begin(), ssObjects.end()) + "\n");
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue objResult(UniValue::VOBJ);
+        objResult.push_back(Pair("time", nNow));
+        objResult.push_back(Pair("fullresync", fFullResync));
+
+        UniValue arrObjects(UniValue::VARR);
+        BOOST_FOREACH(const CRestGovernanceObject& obj, vObjects) {
+            UniValue bObj(UniValue::VOBJ);
+            bObj.push_back(Pair("Hash", obj.nHash.ToString()));
+            bObj.push_back(Pair("DataHex", obj.strData));
+            bObj.push_back(Pair("CollateralHash", obj.nCollateralHash.ToString()));
+            bObj.push_back(Pair("ObjectType", obj.nObjectType));
+            bObj.push_back(Pair("CreationTime", obj.nTime));
+            bObj.push_back(Pair("DeletionTime", obj.nDeletionTime));
+            if (obj.vinMasternode != CTxIn())
+                bObj.push_back(Pair("SigningMasternode", obj.vinMasternode.prevout.ToStringShort()));
+            bObj.push_back(Pair("AbsoluteYesCount", obj.nAbsoluteYesCount));
+            bObj.push_back(Pair("YesCount", obj.nYesCount));
+            bObj.push_back(Pair("NoCount", obj.nNoCount));
+            bObj.push_back(Pair("AbstainCount", obj.nAbstainCount));
+            bObj.push_back(Pair("fCachedValid", obj.fCachedValid));
+            bObj.push_back(Pair("fCachedFunding", obj.fCachedFunding));
+            bObj.push_back(Pair("fCachedDelete", obj.fCachedDelete));
+            bObj.push_back(Pair("fCachedEndorsed", obj.fCachedEndorsed));
+            arrObjects.push_back(bObj);
+        }
+        objResult.push_back(Pair("objects", arrObjects));
+
+        UniValue arrRemoved(UniValue::VARR);
+        BOOST_FOREACH(const uint256& nHash, vecErased)
+            arrRemoved.push_back(nHash.ToString());
+        objResult.push_back(Pair("removed", arrRemoved));
+
+        string strJSON = objResult.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
+    HTTPWorkLane lane;
 } uri_prefixes[] = {
-      {"/rest/tx/", rest_tx},
-      {"/rest/block/notxdetails/", rest_block_notxdetails},
-      {"/rest/block/", rest_block_extended},
-      {"/rest/chaininfo", rest_chaininfo},
-      {"/rest/mempool/info", rest_mempool_info},
-      {"/rest/mempool/contents", rest_mempool_contents},
-      {"/rest/headers/", rest_headers},
-      {"/rest/getutxos", rest_getutxos},
+      {"/rest/tx/", rest_tx, HTTP_LANE_CHEAP},
+      {"/rest/block/notxdetails/", rest_block_notxdetails, HTTP_LANE_EXPENSIVE},
+      {"/rest/block/", rest_block_extended, HTTP_LANE_EXPENSIVE},
+      {"/rest/chaininfo", rest_chaininfo, HTTP_LANE_CHEAP},
+      {"/rest/mempool/info", rest_mempool_info, HTTP_LANE_CHEAP},
+      {"/rest/mempool/contents", rest_mempool_contents, HTTP_LANE_EXPENSIVE},
+      {"/rest/headers/", rest_headers, HTTP_LANE_CHEAP},
+      {"/rest/getutxos", rest_getutxos, HTTP_LANE_EXPENSIVE},
+      {"/rest/masternodes", rest_masternodes, HTTP_LANE_EXPENSIVE},
+      {"/rest/governance/objects", rest_governance_objects, HTTP_LANE_EXPENSIVE},
 };
 
 bool StartREST()
 {
     for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
-        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler);
+        RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler, uri_prefixes[i].lane);
     return true;
 }
 
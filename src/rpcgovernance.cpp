@@ -9,6 +9,7 @@
 #include "darksend.h"
 #include "governance.h"
 #include "governance-vote.h"
+#include "governance-votedb.h"
 #include "governance-classes.h"
 #include "init.h"
 #include "main.h"
@@ -848,6 +849,9 @@ UniValue getgovernanceinfo(const UniValue& params, bool fHelp)
             "  \"superblockcycle\": xxxxx,               (numeric) the number of blocks between superblocks\n"
             "  \"lastsuperblock\": xxxxx,                (numeric) the block number of the last superblock\n"
             "  \"nextsuperblock\": xxxxx,                (numeric) the block number of the next superblock\n"
+            "  \"votes\": xxxxx,                         (numeric) the number of votes stored\n"
+            "  \"votesinmemory\": xxxxx,                 (numeric) the number of recent votes also kept in memory\n"
+            "  \"votememoryusage\": xxxxx,               (numeric) memory used by the vote indexes and the votes kept in memory, in bytes\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getgovernanceinfo", "")
@@ -888,6 +892,9 @@ UniValue getgovernanceinfo(const UniValue& params, bool fHelp)
     obj.push_back(Pair("superblockcycle", Params().GetConsensus().nSuperblockCycle));
     obj.push_back(Pair("lastsuperblock", nLastSuperblock));
     obj.push_back(Pair("nextsuperblock", nNextSuperblock));
+    obj.push_back(Pair("votes", governance.GetVoteCount()));
+    obj.push_back(Pair("votesinmemory", pgovernancevotedb->GetMemoryVoteCount()));
+    obj.push_back(Pair("votememoryusage", (int64_t)governance.GetVoteMemoryUsage()));
 
     return obj;
 }
@@ -7,6 +7,7 @@
 
 #include "base58.h"
 #include "clientversion.h"
+#include "httpserver.h"
 #include "init.h"
 #include "main.h"
 #include "net.h"
@@ -140,6 +141,56 @@ UniValue debug(const UniValue& params, bool fHelp)
     return "Debug mode: " + (fDebug ? strMode : "off");
 }
 
+UniValue getrpcqueueinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpcqueueinfo\n"
+            "\nReturns the state of the HTTP work queue lanes. Calls marked expensive\n"
+            "are queued apart from cheap ones and never occupy all -rpcthreads.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"lane\": {                  (string) \"cheap\" or \"expensive\"\n"
+            "    \"depth\": n,              (numeric) Requests waiting for a worker\n"
+            "    \"maxdepth\": n,           (numeric) Waiting requests beyond which new ones are rejected (-rpcworkqueue)\n"
+            "    \"running\": n,            (numeric) Requests being handled\n"
+            "    \"processed\": n,          (numeric) Requests handled since startup\n"
+            "    \"rejected\": n,           (numeric) Requests rejected because the lane was full\n"
+            "    \"avgwait\": x.xxx,        (numeric) Average time in ms a request waited for a worker\n"
+            "    \"maxwait\": x.xxx,        (numeric) Longest wait in ms\n"
+            "    \"avgtime\": x.xxx,        (numeric) Average time in ms it took to handle a request\n"
+            "    \"maxtime\": x.xxx         (numeric) Longest handling time in ms\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcqueueinfo", "")
+            + HelpExampleRpc("getrpcqueueinfo", "")
+        );
+
+    std::vector<HTTPWorkLaneStats> stats;
+    if (!GetHTTPWorkQueueStats(stats))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "HTTP server is not running");
+
+    UniValue result(UniValue::VOBJ);
+    for (int lane = 0; lane < HTTP_LANE_COUNT; lane++) {
+        const HTTPWorkLaneStats& laneStats = stats[lane];
+        double nProcessed = std::max(laneStats.nProcessed, (uint64_t)1);
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("depth", (uint64_t)laneStats.nDepth));
+        obj.push_back(Pair("maxdepth", (uint64_t)laneStats.nMaxDepth));
+        obj.push_back(Pair("running", laneStats.nRunning));
+        obj.push_back(Pair("processed", laneStats.nProcessed));
+        obj.push_back(Pair("rejected", laneStats.nRejected));
+        obj.push_back(Pair("avgwait", laneStats.nWaitMicros / nProcessed * 0.001));
+        obj.push_back(Pair("maxwait", laneStats.nMaxWaitMicros * 0.001));
+        obj.push_back(Pair("avgtime", laneStats.nRunMicros / nProcessed * 0.001));
+        obj.push_back(Pair("maxtime", laneStats.nMaxRunMicros * 0.001));
+        result.push_back(Pair(HTTPWorkLaneName((HTTPWorkLane)lane), obj));
+    }
+
+    return result;
+}
+
 UniValue mnsync(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -570,6 +621,92 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+bool addressIndexSort(std::pair<uint160, int> a, std::pair<uint160, int> b) {
+    if (a.second != b.second)
+        return a.second < b.second;
+    return a.first < b.first;
+}
+
+/** Read the limit and cursor options of a paged history query, returns false if no paging was asked for */
+bool getAddressIndexPaging(const UniValue& params, unsigned int &limit, bool &hasCursor, CAddressIndexKey &cursor)
+{
+    if (!params[0].isObject())
+        return false;
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+
+    if (limitValue.isNull()) {
+        if (!cursorValue.isNull()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "A cursor can only be used together with a limit");
+        }
+        return false;
+    }
+    if (!limitValue.isNum() || limitValue.get_int() <= 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be a positive number");
+    }
+    limit = limitValue.get_int();
+
+    hasCursor = false;
+    if (!cursorValue.isNull()) {
+        if (!cursorValue.isStr() || !IsHex(cursorValue.get_str())) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        std::vector<unsigned char> data(ParseHex(cursorValue.get_str()));
+        if (data.size() != ::GetSerializeSize(cursor, SER_DISK, CLIENT_VERSION)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        CDataStream ssCursor(data, SER_DISK, CLIENT_VERSION);
+        ssCursor >> cursor;
+        hasCursor = true;
+    }
+
+    return true;
+}
+
+/** The cursor handed out for a page is the index key of its last entry */
+std::string getAddressIndexCursor(const CAddressIndexKey &key)
+{
+    CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+    ssCursor << key;
+    return HexStr(ssCursor.begin(), ssCursor.end());
+}
+
+/**
+ * Read a page of at most limit history entries. The addresses are walked one after the
+ * other in index order, resuming behind the cursor, so no more than a page is ever
+ * loaded from the database.
+ */
+void getAddressIndexPage(std::vector<std::pair<uint160, int> > addresses, int start, int end,
+                         const CAddressIndexKey *cursor, unsigned int limit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex)
+{
+    std::sort(addresses.begin(), addresses.end(), addressIndexSort);
+    addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
+
+    bool cursorFound = (cursor == NULL);
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        const CAddressIndexKey *keyAfter = NULL;
+        if (!cursorFound) {
+            if ((*it).second != (int)cursor->type || (*it).first != cursor->hashBytes) {
+                continue;
+            }
+            cursorFound = true;
+            keyAfter = cursor;
+        }
+        if (addressIndex.size() == limit) {
+            break;
+        }
+        if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end, keyAfter, limit - addressIndex.size())) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+    }
+
+    if (!cursorFound) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not belong to any of the addresses");
+    }
+}
+
 UniValue getaddressmempool(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -723,8 +860,11 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many deltas, with a cursor for the next page\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
             "}\n"
-            "\nResult:\n"
+            "\nResult (without limit, with limit the array is the \"deltas\" field of an object that\n"
+            "also holds a \"cursor\" string while more deltas may follow; pages go address by address):\n"
             "[\n"
             "  {\n"
             "    \"satoshis\"  (number) The difference of satoshis\n"
@@ -760,16 +900,25 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    unsigned int limit = 0;
+    bool hasCursor = false;
+    CAddressIndexKey cursor;
+    bool paged = getAddressIndexPaging(params, limit, hasCursor, cursor);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    if (paged) {
+        getAddressIndexPage(addresses, start, end, hasCursor ? &cursor : NULL, limit, addressIndex);
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -792,6 +941,15 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         result.push_back(delta);
     }
 
+    if (paged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("deltas", result));
+        if (addressIndex.size() == limit) {
+            page.push_back(Pair("cursor", getAddressIndexCursor(addressIndex.back().first)));
+        }
+        return page;
+    }
+
     return result;
 }
 
@@ -813,6 +971,7 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
             "{\n"
             "  \"balance\"  (string) The current balance in satoshis\n"
             "  \"received\"  (string) The total number of satoshis received (including change)\n"
+            "  \"txcount\"  (number) The number of transactions that involve the address(es), counted per address\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"LbcHCb2X9EHUtyfiburZHS5Vj4EoRCbu4G\"]}'")
@@ -825,27 +984,24 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
     CAmount balance = 0;
     CAmount received = 0;
+    unsigned int txCount = 0;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        CAddressBalance addressBalance;
+        if (!GetAddressBalance((*it).first, (*it).second, addressBalance)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-        balance += it->second;
+        balance += addressBalance.balance;
+        received += addressBalance.received;
+        txCount += addressBalance.txCount;
     }
 
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("balance", balance));
     result.push_back(Pair("received", received));
+    result.push_back(Pair("txcount", (int64_t)txCount));
 
     return result;
 
@@ -866,8 +1022,11 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Scan at most this many index entries, with a cursor for the next page\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
             "}\n"
-            "\nResult:\n"
+            "\nResult (without limit, with limit the array is the \"txids\" field of an object that\n"
+            "also holds a \"cursor\" string while more txids may follow; pages go address by address):\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
@@ -894,6 +1053,44 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
         }
     }
 
+    unsigned int limit = 0;
+    bool hasCursor = false;
+    CAddressIndexKey cursor;
+    if (getAddressIndexPaging(params, limit, hasCursor, cursor)) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        getAddressIndexPage(addresses, start, end, hasCursor ? &cursor : NULL, limit, addressIndex);
+
+        // Entries of one transaction are adjacent in the index, leave a transaction that
+        // may continue on the next page to that page unless it is all this page holds
+        bool more = (addressIndex.size() == limit);
+        if (more) {
+            size_t size = addressIndex.size();
+            while (size > 0 && addressIndex[size - 1].first.txhash == addressIndex.back().first.txhash &&
+                   addressIndex[size - 1].first.hashBytes == addressIndex.back().first.hashBytes) {
+                size--;
+            }
+            if (size > 0) {
+                addressIndex.resize(size);
+            }
+        }
+
+        UniValue txids(UniValue::VARR);
+        for (size_t i = 0; i < addressIndex.size(); i++) {
+            if (i > 0 && addressIndex[i].first.txhash == addressIndex[i - 1].first.txhash &&
+                addressIndex[i].first.hashBytes == addressIndex[i - 1].first.hashBytes) {
+                continue;
+            }
+            txids.push_back(addressIndex[i].first.txhash.GetHex());
+        }
+
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("txids", txids));
+        if (more) {
+            page.push_back(Pair("cursor", getAddressIndexCursor(addressIndex.back().first)));
+        }
+        return page;
+    }
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -361,6 +361,19 @@ UniValue getaddednodeinfo(const UniValue& params, bool fHelp)
     return ret;
 }
 
+static UniValue NetMessageBufferStatsToJSON(const std::map<std::string, CNetMessageBufferStats>& mapStats)
+{
+    UniValue ret(UniValue::VOBJ);
+    for (std::map<std::string, CNetMessageBufferStats>::const_iterator it = mapStats.begin(); it != mapStats.end(); ++it) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("count", it->second.nMessages));
+        obj.push_back(Pair("bytes", it->second.nBytes));
+        obj.push_back(Pair("allocations", it->second.nAllocations));
+        ret.push_back(Pair(it->first, obj));
+    }
+    return ret;
+}
+
 UniValue getnettotals(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 0)
@@ -381,6 +394,18 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
             "    \"serve_historical_blocks\": true|false,  (boolean) True if serving historical blocks\n"
             "    \"bytes_left_in_cycle\": t,               (numeric) Bytes left in current time cycle\n"
             "    \"time_left_in_cycle\": t                 (numeric) Seconds left in current time cycle\n"
+            "  },\n"
+            "  \"messagebuffers\":\n"
+            "  {\n"
+            "    \"freebytes\": n,                  (numeric) Bytes of message buffers pooled for reuse\n"
+            "    \"received\": {                    (json object) Received messages per command\n"
+            "      \"command\": {\n"
+            "        \"count\": n,                  (numeric) Number of messages\n"
+            "        \"bytes\": n,                  (numeric) Total payload size\n"
+            "        \"allocations\": n             (numeric) Buffers allocated or grown outside the pool\n"
+            "      }, ...\n"
+            "    },\n"
+            "    \"sent\": { ... }                  (json object) Sent messages per command, same fields\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -401,6 +426,14 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     outboundLimit.push_back(Pair("bytes_left_in_cycle", CNode::GetOutboundTargetBytesLeft()));
     outboundLimit.push_back(Pair("time_left_in_cycle", CNode::GetMaxOutboundTimeLeftInCycle()));
     obj.push_back(Pair("uploadtarget", outboundLimit));
+
+    std::map<std::string, CNetMessageBufferStats> mapRecvStats, mapSendStats;
+    netMessageBufferPool.GetStats(mapRecvStats, mapSendStats);
+    UniValue messageBuffers(UniValue::VOBJ);
+    messageBuffers.push_back(Pair("freebytes", (uint64_t)netMessageBufferPool.GetFreeBytes()));
+    messageBuffers.push_back(Pair("received", NetMessageBufferStatsToJSON(mapRecvStats)));
+    messageBuffers.push_back(Pair("sent", NetMessageBufferStatsToJSON(mapSendStats)));
+    obj.push_back(Pair("messagebuffers", messageBuffers));
     return obj;
 }
 
@@ -255,153 +255,155 @@ UniValue stop(const UniValue& params, bool fHelp)
  * Call Table
  */
 static const CRPCCommand vRPCCommands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode expensive
+  //  --------------------- ------------------------  -----------------------  ---------- ---------
     /* Overall control/query calls */
-    { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
-    { "control",            "debug",                  &debug,                  true  },
-    { "control",            "help",                   &help,                   true  },
-    { "control",            "stop",                   &stop,                   true  },
+    { "control",            "getinfo",                &getinfo,                true,      false }, /* uses wallet if enabled */
+    { "control",            "debug",                  &debug,                  true,      false },
+    { "control",            "getrpcqueueinfo",        &getrpcqueueinfo,        true,      false },
+    { "control",            "help",                   &help,                   true,      false },
+    { "control",            "stop",                   &stop,                   true,      false },
 
     /* P2P networking */
-    { "network",            "getnetworkinfo",         &getnetworkinfo,         true  },
-    { "network",            "addnode",                &addnode,                true  },
-    { "network",            "disconnectnode",         &disconnectnode,         true  },
-    { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true  },
-    { "network",            "getconnectioncount",     &getconnectioncount,     true  },
-    { "network",            "getnettotals",           &getnettotals,           true  },
-    { "network",            "getpeerinfo",            &getpeerinfo,            true  },
-    { "network",            "ping",                   &ping,                   true  },
-    { "network",            "setban",                 &setban,                 true  },
-    { "network",            "listbanned",             &listbanned,             true  },
-    { "network",            "clearbanned",            &clearbanned,            true  },
+    { "network",            "getnetworkinfo",         &getnetworkinfo,         true,      false },
+    { "network",            "addnode",                &addnode,                true,      false },
+    { "network",            "disconnectnode",         &disconnectnode,         true,      false },
+    { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true,      false },
+    { "network",            "getconnectioncount",     &getconnectioncount,     true,      false },
+    { "network",            "getnettotals",           &getnettotals,           true,      false },
+    { "network",            "getpeerinfo",            &getpeerinfo,            true,      false },
+    { "network",            "ping",                   &ping,                   true,      false },
+    { "network",            "setban",                 &setban,                 true,      false },
+    { "network",            "listbanned",             &listbanned,             true,      false },
+    { "network",            "clearbanned",            &clearbanned,            true,      false },
 
     /* Block chain and UTXO */
-    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
-    { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
-    { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
-    { "blockchain",         "getblockhash",           &getblockhash,           true  },
-    { "blockchain",         "getblockheader",         &getblockheader,         true  },
-    { "blockchain",         "getblockheaders",        &getblockheaders,        true  },
-    { "blockchain",         "getchaintips",           &getchaintips,           true  },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
-    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
-    { "blockchain",         "gettxout",               &gettxout,               true  },
-    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
-    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
-    { "blockchain",         "verifychain",            &verifychain,            true  },
-    { "blockchain",         "getspentinfo",           &getspentinfo,           false },
+    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,      false },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,      false },
+    { "blockchain",         "getblockcount",          &getblockcount,          true,      false },
+    { "blockchain",         "getblock",               &getblock,               true,      true  },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         true,      false },
+    { "blockchain",         "getblockhash",           &getblockhash,           true,      false },
+    { "blockchain",         "getblockheader",         &getblockheader,         true,      false },
+    { "blockchain",         "getblockheaders",        &getblockheaders,        true,      false },
+    { "blockchain",         "getchaintips",           &getchaintips,           true,      false },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          true,      false },
+    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,      false },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,      true  },
+    { "blockchain",         "gettxout",               &gettxout,               true,      false },
+    { "blockchain",         "gettxoutproof",          &gettxoutproof,          true,      true  },
+    { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true,      false },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,      true  },
+    { "blockchain",         "savemempool",            &savemempool,            true,      true  },
+    { "blockchain",         "verifychain",            &verifychain,            true,      true  },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           false,     false },
 
     /* Mining */
-    { "mining",             "getblocktemplate",       &getblocktemplate,       true  },
-    { "mining",             "getmininginfo",          &getmininginfo,          true  },
-    { "mining",             "getnetworkhashps",       &getnetworkhashps,       true  },
-    { "mining",             "prioritisetransaction",  &prioritisetransaction,  true  },
-    { "mining",             "submitblock",            &submitblock,            true  },
+    { "mining",             "getblocktemplate",       &getblocktemplate,       true,      true  },
+    { "mining",             "getmininginfo",          &getmininginfo,          true,      false },
+    { "mining",             "getnetworkhashps",       &getnetworkhashps,       true,      false },
+    { "mining",             "prioritisetransaction",  &prioritisetransaction,  true,      false },
+    { "mining",             "submitblock",            &submitblock,            true,      false },
 
     /* Coin generation */
-    { "generating",         "getgenerate",            &getgenerate,            true  },
-    { "generating",         "setgenerate",            &setgenerate,            true  },
-    { "generating",         "generate",               &generate,               true  },
+    { "generating",         "getgenerate",            &getgenerate,            true,      false },
+    { "generating",         "setgenerate",            &setgenerate,            true,      false },
+    { "generating",         "generate",               &generate,               true,      true  },
 
     /* Raw transactions */
-    { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
-    { "rawtransactions",    "decodescript",           &decodescript,           true  },
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
-    { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
-    { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
+    { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true,      false },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,      false },
+    { "rawtransactions",    "decodescript",           &decodescript,           true,      false },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,      false },
+    { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false,     false },
+    { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false,     false }, /* uses wallet if enabled */
 #ifdef ENABLE_WALLET
-    { "rawtransactions",    "fundrawtransaction",     &fundrawtransaction,     false },
+    { "rawtransactions",    "fundrawtransaction",     &fundrawtransaction,     false,     false },
 #endif
 
     /* Address index */
-    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  },
-    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false },
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false },
-    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false },
-    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false },
+    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true,      true  },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false,     true  },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false,     true  },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false,     true  },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false,     false },
 
     /* Utility functions */
-    { "util",               "createmultisig",         &createmultisig,         true  },
-    { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
-    { "util",               "verifymessage",          &verifymessage,          true  },
-    { "util",               "estimatefee",            &estimatefee,            true  },
-    { "util",               "estimatepriority",       &estimatepriority,       true  },
-    { "util",               "estimatesmartfee",       &estimatesmartfee,       true  },
-    { "util",               "estimatesmartpriority",  &estimatesmartpriority,  true  },
+    { "util",               "createmultisig",         &createmultisig,         true,      false },
+    { "util",               "validateaddress",        &validateaddress,        true,      false }, /* uses wallet if enabled */
+    { "util",               "verifymessage",          &verifymessage,          true,      false },
+    { "util",               "estimatefee",            &estimatefee,            true,      false },
+    { "util",               "estimatepriority",       &estimatepriority,       true,      false },
+    { "util",               "estimatesmartfee",       &estimatesmartfee,       true,      false },
+    { "util",               "estimatesmartpriority",  &estimatesmartpriority,  true,      false },
 
     /* Not shown in help */
-    { "hidden",             "invalidateblock",        &invalidateblock,        true  },
-    { "hidden",             "reconsiderblock",        &reconsiderblock,        true  },
-    { "hidden",             "setmocktime",            &setmocktime,            true  },
+    { "hidden",             "invalidateblock",        &invalidateblock,        true,      false },
+    { "hidden",             "reconsiderblock",        &reconsiderblock,        true,      false },
+    { "hidden",             "setmocktime",            &setmocktime,            true,      false },
 #ifdef ENABLE_WALLET
-    { "hidden",             "resendwallettransactions", &resendwallettransactions, true},
+    { "hidden",             "resendwallettransactions", &resendwallettransactions, true,      false },
 #endif
 
     /* LINC features */
-    { "linc",               "masternode",             &masternode,             true  },
-    { "linc",               "masternodelist",         &masternodelist,         true  },
-    { "linc",               "masternodebroadcast",    &masternodebroadcast,    true  },
-    { "linc",               "gobject",                &gobject,                true  },
-    { "linc",               "getgovernanceinfo",      &getgovernanceinfo,      true  },
-    { "linc",               "getsuperblockbudget",    &getsuperblockbudget,    true  },
-    { "linc",               "voteraw",                &voteraw,                true  },
-    { "linc",               "mnsync",                 &mnsync,                 true  },
-    { "linc",               "spork",                  &spork,                  true  },
-    { "linc",               "getpoolinfo",            &getpoolinfo,            true  },
+    { "linc",               "masternode",             &masternode,             true,      false },
+    { "linc",               "masternodelist",         &masternodelist,         true,      true  },
+    { "linc",               "masternodebroadcast",    &masternodebroadcast,    true,      false },
+    { "linc",               "gobject",                &gobject,                true,      true  },
+    { "linc",               "getgovernanceinfo",      &getgovernanceinfo,      true,      false },
+    { "linc",               "getsuperblockbudget",    &getsuperblockbudget,    true,      false },
+    { "linc",               "voteraw",                &voteraw,                true,      false },
+    { "linc",               "mnsync",                 &mnsync,                 true,      false },
+    { "linc",               "spork",                  &spork,                  true,      false },
+    { "linc",               "getpoolinfo",            &getpoolinfo,            true,      false },
 #ifdef ENABLE_WALLET
-    { "linc",               "privatesend",            &privatesend,            false },
+    { "linc",               "privatesend",            &privatesend,            false,     false },
 
     /* Wallet */
-    { "wallet",             "keepass",                &keepass,                true },
-    { "wallet",             "instantsendtoaddress",   &instantsendtoaddress,   false },
-    { "wallet",             "addmultisigaddress",     &addmultisigaddress,     true  },
-    { "wallet",             "backupwallet",           &backupwallet,           true  },
-    { "wallet",             "dumpprivkey",            &dumpprivkey,            true  },
-    { "wallet",             "dumpwallet",             &dumpwallet,             true  },
-    { "wallet",             "encryptwallet",          &encryptwallet,          true  },
-    { "wallet",             "getaccountaddress",      &getaccountaddress,      true  },
-    { "wallet",             "getaccount",             &getaccount,             true  },
-    { "wallet",             "getaddressesbyaccount",  &getaddressesbyaccount,  true  },
-    { "wallet",             "getbalance",             &getbalance,             false },
-    { "wallet",             "getnewaddress",          &getnewaddress,          true  },
-    { "wallet",             "getrawchangeaddress",    &getrawchangeaddress,    true  },
-    { "wallet",             "getreceivedbyaccount",   &getreceivedbyaccount,   false },
-    { "wallet",             "getreceivedbyaddress",   &getreceivedbyaddress,   false },
-    { "wallet",             "gettransaction",         &gettransaction,         false },
-    { "wallet",             "abandontransaction",     &abandontransaction,     false },
-    { "wallet",             "getunconfirmedbalance",  &getunconfirmedbalance,  false },
-    { "wallet",             "getwalletinfo",          &getwalletinfo,          false },
-    { "wallet",             "importprivkey",          &importprivkey,          true  },
-    { "wallet",             "importwallet",           &importwallet,           true  },
-    { "wallet",             "importelectrumwallet",   &importelectrumwallet,   true  },
-    { "wallet",             "importaddress",          &importaddress,          true  },
-    { "wallet",             "importpubkey",           &importpubkey,           true  },
-    { "wallet",             "keypoolrefill",          &keypoolrefill,          true  },
-    { "wallet",             "listaccounts",           &listaccounts,           false },
-    { "wallet",             "listaddressgroupings",   &listaddressgroupings,   false },
-    { "wallet",             "listlockunspent",        &listlockunspent,        false },
-    { "wallet",             "listreceivedbyaccount",  &listreceivedbyaccount,  false },
-    { "wallet",             "listreceivedbyaddress",  &listreceivedbyaddress,  false },
-    { "wallet",             "listsinceblock",         &listsinceblock,         false },
-    { "wallet",             "listtransactions",       &listtransactions,       false },
-    { "wallet",             "listunspent",            &listunspent,            false },
-    { "wallet",             "lockunspent",            &lockunspent,            true  },
-    { "wallet",             "move",                   &movecmd,                false },
-    { "wallet",             "sendfrom",               &sendfrom,               false },
-    { "wallet",             "sendmany",               &sendmany,               false },
-    { "wallet",             "sendtoaddress",          &sendtoaddress,          false },
-    { "wallet",             "setaccount",             &setaccount,             true  },
-    { "wallet",             "settxfee",               &settxfee,               true  },
-    { "wallet",             "signmessage",            &signmessage,            true  },
-    { "wallet",             "walletlock",             &walletlock,             true  },
-    { "wallet",             "walletpassphrasechange", &walletpassphrasechange, true  },
-    { "wallet",             "walletpassphrase",       &walletpassphrase,       true  },
+    { "wallet",             "keepass",                &keepass,                true,      false },
+    { "wallet",             "instantsendtoaddress",   &instantsendtoaddress,   false,     false },
+    { "wallet",             "addmultisigaddress",     &addmultisigaddress,     true,      false },
+    { "wallet",             "backupwallet",           &backupwallet,           true,      false },
+    { "wallet",             "dumpprivkey",            &dumpprivkey,            true,      false },
+    { "wallet",             "dumpwallet",             &dumpwallet,             true,      true  },
+    { "wallet",             "encryptwallet",          &encryptwallet,          true,      false },
+    { "wallet",             "getaccountaddress",      &getaccountaddress,      true,      false },
+    { "wallet",             "getaccount",             &getaccount,             true,      false },
+    { "wallet",             "getaddressesbyaccount",  &getaddressesbyaccount,  true,      false },
+    { "wallet",             "getbalance",             &getbalance,             false,     false },
+    { "wallet",             "getnewaddress",          &getnewaddress,          true,      false },
+    { "wallet",             "getrawchangeaddress",    &getrawchangeaddress,    true,      false },
+    { "wallet",             "getreceivedbyaccount",   &getreceivedbyaccount,   false,     false },
+    { "wallet",             "getreceivedbyaddress",   &getreceivedbyaddress,   false,     false },
+    { "wallet",             "gettransaction",         &gettransaction,         false,     false },
+    { "wallet",             "abandontransaction",     &abandontransaction,     false,     false },
+    { "wallet",             "getunconfirmedbalance",  &getunconfirmedbalance,  false,     false },
+    { "wallet",             "getwalletinfo",          &getwalletinfo,          false,     false },
+    { "wallet",             "importprivkey",          &importprivkey,          true,      true  },
+    { "wallet",             "importwallet",           &importwallet,           true,      true  },
+    { "wallet",             "importelectrumwallet",   &importelectrumwallet,   true,      true  },
+    { "wallet",             "importaddress",          &importaddress,          true,      true  },
+    { "wallet",             "importpubkey",           &importpubkey,           true,      true  },
+    { "wallet",             "keypoolrefill",          &keypoolrefill,          true,      false },
+    { "wallet",             "listaccounts",           &listaccounts,           false,     false },
+    { "wallet",             "listaddressgroupings",   &listaddressgroupings,   false,     false },
+    { "wallet",             "listlockunspent",        &listlockunspent,        false,     false },
+    { "wallet",             "listreceivedbyaccount",  &listreceivedbyaccount,  false,     false },
+    { "wallet",             "listreceivedbyaddress",  &listreceivedbyaddress,  false,     false },
+    { "wallet",             "listsinceblock",         &listsinceblock,         false,     false },
+    { "wallet",             "listtransactions",       &listtransactions,       false,     false },
+    { "wallet",             "listunspent",            &listunspent,            false,     false },
+    { "wallet",             "lockunspent",            &lockunspent,            true,      false },
+    { "wallet",             "move",                   &movecmd,                false,     false },
+    { "wallet",             "sendfrom",               &sendfrom,               false,     false },
+    { "wallet",             "sendmany",               &sendmany,               false,     false },
+    { "wallet",             "sendtoaddress",          &sendtoaddress,          false,     false },
+    { "wallet",             "setaccount",             &setaccount,             true,      false },
+    { "wallet",             "settxfee",               &settxfee,               true,      false },
+    { "wallet",             "signmessage",            &signmessage,            true,      false },
+    { "wallet",             "walletlock",             &walletlock,             true,      false },
+    { "wallet",             "walletpassphrasechange", &walletpassphrasechange, true,      false },
+    { "wallet",             "walletpassphrase",       &walletpassphrase,       true,      false },
 #endif // ENABLE_WALLET
 };
 
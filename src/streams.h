@@ -116,6 +116,7 @@ public:
     bool empty() const                               { return vch.size() == nReadPos; }
     void resize(size_type n, value_type c=0)         { vch.resize(n + nReadPos, c); }
     void reserve(size_type n)                        { vch.reserve(n + nReadPos); }
+    size_type capacity() const                       { return vch.capacity() - nReadPos; }
     const_reference operator[](size_type pos) const  { return vch[pos + nReadPos]; }
     reference operator[](size_type pos)              { return vch[pos + nReadPos]; }
     void clear()                                     { vch.clear(); nReadPos = 0; }
@@ -297,6 +298,12 @@ public:
         clear();
     }
 
+    //! Exchange the whole buffer with data, e.g. to take one from a buffer pool or give it back
+    void swap(CSerializeData &data) {
+        vch.swap(data);
+        nReadPos = 0;
+    }
+
     /**
      * XOR the contents of this stream with a certain key.
      *
@@ -323,6 +330,63 @@ public:
 
 
 
+/**
+ * Read-only stream over bytes owned by someone else. Unlike reading from a
+ * CDataStream this neither consumes nor copies the data, so the same buffer
+ * can be deserialized more than once.
+ */
+class CDataStreamView
+{
+private:
+    const char* pbegin;
+    const char* pend;
+
+public:
+    int nType;
+    int nVersion;
+
+    CDataStreamView(const char* pbeginIn, const char* pendIn, int nTypeIn, int nVersionIn) :
+        pbegin(pbeginIn), pend(pendIn), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    explicit CDataStreamView(CDataStream& stream) :
+        pbegin(stream.empty() ? NULL : &stream[0]), pend(stream.empty() ? NULL : &stream[0] + stream.size()),
+        nType(stream.GetType()), nVersion(stream.GetVersion()) {}
+
+    size_t size() const { return pend - pbegin; }
+    bool empty() const  { return pbegin == pend; }
+    bool eof() const    { return empty(); }
+
+    int GetType() const    { return nType; }
+    int GetVersion() const { return nVersion; }
+
+    CDataStreamView& read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CDataStreamView::read(): end of data");
+        memcpy(pch, pbegin, nSize);
+        pbegin += nSize;
+        return (*this);
+    }
+
+    CDataStreamView& ignore(size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CDataStreamView::ignore(): end of data");
+        pbegin += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CDataStreamView& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+
+
 
 
 
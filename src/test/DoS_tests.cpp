@@ -9,8 +9,10 @@
 #include "main.h"
 #include "net.h"
 #include "pow.h"
+#include "protocol.h"
 #include "script/sign.h"
 #include "serialize.h"
+#include "streams.h"
 #include "util.h"
 
 #include "test/test_linc.h"
@@ -105,6 +107,27 @@ BOOST_AUTO_TEST_CASE(DoS_bantime)
     BOOST_CHECK(!CNode::IsBanned(addr));
 }
 
+BOOST_AUTO_TEST_CASE(DoS_pendingban)
+{
+    CNode::ClearBanned();
+    CAddress addr(ip(0xa0b0c001));
+    CNode dummyNode(INVALID_SOCKET, addr, "", true);
+    dummyNode.nVersion = 1;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CMessageHeader(Params().MessageStart(), NetMsgType::PING, 0);
+    LOCK(dummyNode.cs_vRecvMsg);
+    BOOST_CHECK(dummyNode.ReceiveMsgBytes(&ss[0], ss.size()));
+    BOOST_CHECK_EQUAL(dummyNode.vRecvMsg.size(), 1U);
+
+    // a ban reported by a work queue stops the peer's messages before SendMessages() runs
+    Misbehaving(dummyNode.GetId(), 100);
+    ProcessMessages(&dummyNode);
+    BOOST_CHECK_EQUAL(dummyNode.vRecvMsg.size(), 1U);
+    SendMessages(&dummyNode);
+    BOOST_CHECK(CNode::IsBanned(addr));
+}
+
 CTransaction RandomOrphan()
 {
     std::map<uint256, COrphanTx>::iterator it;
@@ -182,6 +182,18 @@ BOOST_AUTO_TEST_CASE(bloom_match)
     BOOST_CHECK_MESSAGE(!filter.IsRelevantAndUpdate(tx), "Simple Bloom filter matched COutPoint for an output we didn't care about");
 }
 
+BOOST_AUTO_TEST_CASE(bloom_unrestricted_size)
+{
+    // the protocol limits cap the size, the local constructor does not
+    BOOST_CHECK(CBloomFilter(100000, 0.0001, 0, BLOOM_UPDATE_NONE).IsWithinSizeConstraints());
+    CBloomFilter filter(100000, 0.0001, 0);
+    BOOST_CHECK(!filter.IsWithinSizeConstraints());
+
+    filter.insert(ParseHex("99108ad8ed9bb6274d3980bab5a85c048f0950c8"));
+    BOOST_CHECK(filter.contains(ParseHex("99108ad8ed9bb6274d3980bab5a85c048f0950c8")));
+    BOOST_CHECK(!filter.contains(ParseHex("19108ad8ed9bb6274d3980bab5a85c048f0950c8")));
+}
+
 BOOST_AUTO_TEST_CASE(merkle_block_1)
 {
     // Random real block (0000000000013b8ab2cd513b0261a14096412195a72a0c4827d229dcc7e0f7af)
@@ -8,6 +8,7 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/neoscrypt.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_linc.h"
@@ -248,4 +249,32 @@ BOOST_AUTO_TEST_CASE(hmac_sha512_testvectors) {
                    "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58");
 }
 
+BOOST_AUTO_TEST_CASE(neoscrypt_multi_matches_scalar) {
+    // Odd counts exercise the padded partial batches
+    for (unsigned int nCount = 0; nCount <= 11; nCount++) {
+        std::vector<unsigned char> vInput(nCount * 80 + 1), vExpected(nCount * 32 + 1), vOutput(nCount * 32 + 1);
+        GetRandBytes(&vInput[0], vInput.size());
+        for (unsigned int i = 0; i < nCount; i++)
+            neoscrypt(&vInput[i * 80], &vExpected[i * 32], 0);
+        neoscrypt_multi(&vInput[0], &vOutput[0], nCount);
+        BOOST_CHECK(memcmp(&vOutput[0], &vExpected[0], nCount * 32) == 0);
+    }
+
+#ifdef NEOSCRYPT_SIMD
+    std::vector<unsigned char> vInput(8 * 80), vExpected(8 * 32), vOutput(8 * 32);
+    std::vector<unsigned char> vScratchpad(NEOSCRYPT_NWAY_SCRATCHPAD_SIZE(8));
+    GetRandBytes(&vInput[0], vInput.size());
+    for (unsigned int i = 0; i < 8; i++)
+        neoscrypt(&vInput[i * 80], &vExpected[i * 32], 0);
+    if (cpu_vec_exts() & 0x00000020) {
+        neoscrypt_sse2_4way(&vInput[0], &vOutput[0], &vScratchpad[0]);
+        BOOST_CHECK(memcmp(&vOutput[0], &vExpected[0], 4 * 32) == 0);
+    }
+    if (cpu_vec_exts() & 0x00010000) {
+        neoscrypt_avx2_8way(&vInput[0], &vOutput[0], &vScratchpad[0]);
+        BOOST_CHECK(memcmp(&vOutput[0], &vExpected[0], 8 * 32) == 0);
+    }
+#endif
+}
+
 BOOST_AUTO_TEST_SUITE_END()
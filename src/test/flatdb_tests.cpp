@@ -0,0 +1,192 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flat-database.h"
+
+#include "test/test_linc.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(flatdb_tests, TestingSetup)
+
+/** Minimal journaled manager: a map whose every update is a journal record */
+class CTestCache
+{
+public:
+    std::map<int, int> mapValues;
+    CFlatDBJournal journal;
+
+    void Set(int nKey, int nValue)
+    {
+        mapValues[nKey] = nValue;
+        journal.Add(1, std::make_pair(nKey, nValue));
+    }
+
+    bool TakeJournal(std::vector<CFlatDBJournalRecord>& vecRecordsRet) { return journal.Take(vecRecordsRet); }
+    void RestoreJournal(std::vector<CFlatDBJournalRecord>& vecRecords, bool fComplete) { journal.Restore(vecRecords, fComplete); }
+
+    void ApplyJournalRecord(const CFlatDBJournalRecord& record)
+    {
+        std::pair<int, int> item;
+        CDataStream ss(record.vchData, SER_DISK, CLIENT_VERSION);
+        ss >> item;
+        Set(item.first, item.second);
+    }
+
+    void Clear() { mapValues.clear(); }
+    void CheckAndRemove() {}
+    std::string ToString() const { return strprintf("Values: %d", mapValues.size()); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(mapValues);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(flatdb_journal_replay)
+{
+    CJournaledFlatDB<CTestCache> flatdb("flatdbtest.dat", "magicTestCache");
+    boost::filesystem::path pathJournal = GetDataDir() / "flatdbtest.dat.journal";
+
+    // the first dump has nothing to append to and writes a snapshot
+    CTestCache cache;
+    cache.Set(1, 1);
+    BOOST_CHECK(flatdb.Dump(cache));
+    uint64_t nEmptyJournalSize = boost::filesystem::file_size(pathJournal);
+
+    // later dumps only append
+    cache.Set(2, 2);
+    cache.Set(1, 3);
+    BOOST_CHECK(flatdb.Dump(cache));
+    BOOST_CHECK(boost::filesystem::file_size(pathJournal) > nEmptyJournalSize);
+
+    CTestCache cacheLoaded;
+    BOOST_CHECK(flatdb.Load(cacheLoaded));
+    BOOST_CHECK(cacheLoaded.mapValues == cache.mapValues);
+
+    // replayed records are not appended a second time
+    uint64_t nJournalSize = boost::filesystem::file_size(pathJournal);
+    BOOST_CHECK(flatdb.Dump(cacheLoaded));
+    BOOST_CHECK_EQUAL(boost::filesystem::file_size(pathJournal), nJournalSize);
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_journal_incomplete_tail)
+{
+    CJournaledFlatDB<CTestCache> flatdb("flatdbtest.dat", "magicTestCache");
+    boost::filesystem::path pathJournal = GetDataDir() / "flatdbtest.dat.journal";
+
+    CTestCache cache;
+    cache.Set(1, 1);
+    BOOST_CHECK(flatdb.Dump(cache));
+    cache.Set(2, 2);
+    BOOST_CHECK(flatdb.Dump(cache));
+    uint64_t nJournalSize = boost::filesystem::file_size(pathJournal);
+
+    // a crash in the middle of an append leaves part of a record behind
+    FILE* file = fopen(pathJournal.string().c_str(), "ab");
+    BOOST_REQUIRE(file != NULL);
+    const char garbage[] = "\x01\x10partial";
+    fwrite(garbage, 1, sizeof(garbage), file);
+    fclose(file);
+
+    CTestCache cacheLoaded;
+    BOOST_CHECK(flatdb.Load(cacheLoaded));
+    BOOST_CHECK(cacheLoaded.mapValues == cache.mapValues);
+    BOOST_CHECK_EQUAL(boost::filesystem::file_size(pathJournal), nJournalSize);
+
+    // and records appended afterwards are found again
+    cacheLoaded.Set(3, 3);
+    BOOST_CHECK(flatdb.Dump(cacheLoaded));
+    CTestCache cacheReloaded;
+    BOOST_CHECK(flatdb.Load(cacheReloaded));
+    BOOST_CHECK(cacheReloaded.mapValues == cacheLoaded.mapValues);
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_journal_stale)
+{
+    CJournaledFlatDB<CTestCache> flatdb("flatdbtest.dat", "magicTestCache");
+    boost::filesystem::path pathJournal = GetDataDir() / "flatdbtest.dat.journal";
+
+    CTestCache cache;
+    cache.Set(1, 1);
+    BOOST_CHECK(flatdb.Dump(cache));
+    cache.Set(2, 2);
+    BOOST_CHECK(flatdb.Dump(cache));
+
+    // a snapshot written without starting a new journal
+    CTestCache cacheOther;
+    cacheOther.Set(5, 5);
+    CFlatDB<CTestCache> flatdbPlain("flatdbtest.dat", "magicTestCache");
+    BOOST_CHECK(flatdbPlain.Dump(cacheOther));
+
+    CTestCache cacheLoaded;
+    BOOST_CHECK(flatdb.Load(cacheLoaded));
+    BOOST_CHECK(cacheLoaded.mapValues == cacheOther.mapValues);
+    BOOST_CHECK(!boost::filesystem::exists(pathJournal));
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_journal_reset)
+{
+    CJournaledFlatDB<CTestCache> flatdb("flatdbtest.dat", "magicTestCache");
+
+    CTestCache cache;
+    cache.Set(1, 1);
+    BOOST_CHECK(flatdb.Dump(cache));
+    cache.Set(2, 2);
+    BOOST_CHECK(flatdb.Dump(cache));
+
+    // a cache dropped at load stays empty after the next dump and restart
+    CTestCache cacheLoaded;
+    BOOST_CHECK(flatdb.ReadSnapshot(cacheLoaded));
+    BOOST_CHECK(flatdb.Reset(cacheLoaded));
+    BOOST_CHECK(cacheLoaded.mapValues.empty());
+    cacheLoaded.Set(3, 3);
+    BOOST_CHECK(flatdb.Dump(cacheLoaded));
+
+    CTestCache cacheReloaded;
+    BOOST_CHECK(flatdb.Load(cacheReloaded));
+    BOOST_CHECK_EQUAL(cacheReloaded.mapValues.size(), 1U);
+    BOOST_CHECK_EQUAL(cacheReloaded.mapValues[3], 3);
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_journal_failed_write)
+{
+    CJournaledFlatDB<CTestCache> flatdb("flatdbtest.dat", "magicTestCache");
+    boost::filesystem::path pathTmp = GetDataDir() / "flatdbtest.dat.new";
+
+    // records that could not be written are put back in front of newer ones
+    CTestCache cache;
+    cache.Set(1, 1);
+    std::vector<CFlatDBJournalRecord> vecRecords;
+    BOOST_CHECK(cache.TakeJournal(vecRecords));
+    cache.Set(2, 2);
+    cache.RestoreJournal(vecRecords, true);
+    BOOST_CHECK(cache.TakeJournal(vecRecords));
+    BOOST_CHECK_EQUAL(vecRecords.size(), 2U);
+    CTestCache cacheReplayed;
+    for (size_t i = 0; i < vecRecords.size(); i++)
+        cacheReplayed.ApplyJournalRecord(vecRecords[i]);
+    BOOST_CHECK(cacheReplayed.mapValues == cache.mapValues);
+
+    // and an incomplete set still asks for a snapshot
+    cache.RestoreJournal(vecRecords, false);
+    BOOST_CHECK(!cache.TakeJournal(vecRecords));
+    BOOST_CHECK(vecRecords.empty());
+
+    // a snapshot that can't be written fails the dump and is asked for again
+    cache.Set(3, 3);
+    boost::filesystem::create_directory(pathTmp);
+    BOOST_CHECK(!flatdb.Dump(cache));
+    boost::filesystem::remove(pathTmp);
+    BOOST_CHECK(!cache.TakeJournal(vecRecords));
+
+    BOOST_CHECK(flatdb.Dump(cache));
+    CTestCache cacheLoaded;
+    BOOST_CHECK(flatdb.Load(cacheLoaded));
+    BOOST_CHECK(cacheLoaded.mapValues == cache.mapValues);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,111 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-object.h"
+#include "masternodeman.h"
+#include "random.h"
+#include "streams.h"
+
+#include "test/test_linc.h"
+
+#include <boost/test/unit_test.hpp>
+
+struct CGovernanceObjectTestAccess
+{
+    static void RestoreVote(CGovernanceObject& govobj, const CGovernanceVote& vote)
+    {
+        govobj.RestoreVote(vote);
+    }
+
+    static void ClearMasternodeVotes(CGovernanceObject& govobj)
+    {
+        govobj.ClearMasternodeVotes();
+    }
+
+    /// Whether the cached tallies are what counting the vote records gives
+    static bool TallyMatchesRecount(const CGovernanceObject& govobj)
+    {
+        for(int nSignal = VOTE_SIGNAL_FUNDING; nSignal <= MAX_SUPPORTED_VOTE_SIGNAL; ++nSignal) {
+            for(int nOutcome = VOTE_OUTCOME_YES; nOutcome <= VOTE_OUTCOME_ABSTAIN; ++nOutcome) {
+                int nCount = 0;
+                for(CGovernanceObject::vote_m_cit it = govobj.mapCurrentMNVotes.begin(); it != govobj.mapCurrentMNVotes.end(); ++it) {
+                    vote_instance_m_cit it2 = it->second.mapInstances.find(nSignal);
+                    if(it2 != it->second.mapInstances.end() && it2->second.eOutcome == nOutcome) {
+                        ++nCount;
+                    }
+                }
+                if(govobj.CountMatchingVotes(vote_signal_enum_t(nSignal), vote_outcome_enum_t(nOutcome)) != nCount) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(governance_tests, TestingSetup)
+
+static CTxIn AddMasternode(const CTxIn& vin)
+{
+    CMasternode mn(CService("10.0.0.1", 9999), vin, CPubKey(), CPubKey(), PROTOCOL_VERSION);
+    mnodeman.Add(mn);
+    return vin;
+}
+
+static CGovernanceVote MakeVote(const uint256& nParentHash, const CTxIn& vin, vote_signal_enum_t eSignal, vote_outcome_enum_t eOutcome, int64_t nTime)
+{
+    CGovernanceVote vote(vin, nParentHash, eSignal, eOutcome);
+    vote.SetTime(nTime);
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(governance_object_vote_tally)
+{
+    mnodeman.Clear();
+    CTxIn vin1 = AddMasternode(CTxIn(COutPoint(GetRandHash(), 0)));
+    CTxIn vin2 = AddMasternode(CTxIn(COutPoint(GetRandHash(), 0)));
+    CTxIn vin3 = AddMasternode(CTxIn(COutPoint(GetRandHash(), 0)));
+
+    CGovernanceObject govobj;
+    uint256 nParentHash = GetRandHash();
+    CGovernanceObjectTestAccess::RestoreVote(govobj, MakeVote(nParentHash, vin1, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000));
+    CGovernanceObjectTestAccess::RestoreVote(govobj, MakeVote(nParentHash, vin2, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 1000));
+    CGovernanceObjectTestAccess::RestoreVote(govobj, MakeVote(nParentHash, vin3, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000));
+    CGovernanceObjectTestAccess::RestoreVote(govobj, MakeVote(nParentHash, vin1, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_YES, 1000));
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_DELETE), 1);
+    BOOST_CHECK(CGovernanceObjectTestAccess::TallyMatchesRecount(govobj));
+
+    // a newer vote replaces the masternode's outcome, an older one is ignored
+    CGovernanceObjectTestAccess::RestoreVote(govobj, MakeVote(nParentHash, vin1, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 1001));
+    CGovernanceObjectTestAccess::RestoreVote(govobj, MakeVote(nParentHash, vin2, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 999));
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK(CGovernanceObjectTestAccess::TallyMatchesRecount(govobj));
+
+    // the tallies are recounted when read from disk
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << govobj;
+    CGovernanceObject govobjRead;
+    ss >> govobjRead;
+    BOOST_CHECK_EQUAL(govobjRead.GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobjRead.GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(govobjRead.GetYesCount(VOTE_SIGNAL_DELETE), 1);
+    BOOST_CHECK(CGovernanceObjectTestAccess::TallyMatchesRecount(govobjRead));
+
+    // votes of masternodes that are gone no longer count, vin3 had index 2
+    mnodeman.Clear();
+    AddMasternode(vin1);
+    AddMasternode(vin2);
+    CGovernanceObjectTestAccess::ClearMasternodeVotes(govobj);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 0);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_DELETE), 1);
+    BOOST_CHECK(CGovernanceObjectTestAccess::TallyMatchesRecount(govobj));
+
+    mnodeman.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
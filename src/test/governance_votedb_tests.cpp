@@ -0,0 +1,121 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-votedb.h"
+#include "random.h"
+#include "utilstrencodings.h"
+
+#include "test/test_linc.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_votedb_tests, TestingSetup)
+
+static CGovernanceVote MakeVote(const uint256& nParentHash, const COutPoint& outpoint, vote_signal_enum_t eSignal, int64_t nTime)
+{
+    CGovernanceVote vote(CTxIn(outpoint), nParentHash, eSignal, VOTE_OUTCOME_YES);
+    vote.SetTime(nTime);
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(governance_votedb_vote_file)
+{
+    uint256 nParent1 = GetRandHash();
+    uint256 nParent2 = GetRandHash();
+    COutPoint outpoint1(GetRandHash(), 0);
+    COutPoint outpoint2(GetRandHash(), 1);
+
+    CGovernanceObjectVoteFile file1, file2;
+    CGovernanceVote vote1 = MakeVote(nParent1, outpoint1, VOTE_SIGNAL_FUNDING, 1000);
+    CGovernanceVote vote2 = MakeVote(nParent1, outpoint1, VOTE_SIGNAL_DELETE, 1001);
+    CGovernanceVote vote3 = MakeVote(nParent1, outpoint2, VOTE_SIGNAL_FUNDING, 1002);
+    CGovernanceVote vote4 = MakeVote(nParent2, outpoint1, VOTE_SIGNAL_FUNDING, 1003);
+    file1.AddVote(vote1);
+    file1.AddVote(vote2);
+    file1.AddVote(vote3);
+    file2.AddVote(vote4);
+
+    BOOST_CHECK_EQUAL(file1.GetVoteCount(), 3);
+    BOOST_CHECK(file1.HasVote(vote2.GetHash()));
+    BOOST_CHECK(!file1.HasVote(vote4.GetHash()));
+    BOOST_CHECK_EQUAL(file1.GetVotes().size(), 3U);
+    BOOST_CHECK_EQUAL(file1.GetMasternodeOutpoints().size(), 2U);
+
+    CGovernanceVote voteRead;
+    BOOST_CHECK(file1.GetVote(vote3.GetHash(), voteRead));
+    BOOST_CHECK(voteRead.GetHash() == vote3.GetHash());
+
+    // indexed reads only see one object, or one masternode of it
+    std::vector<CGovernanceVote> vecVotes;
+    BOOST_CHECK(pgovernancevotedb->ReadVotes(nParent1, outpoint1, vecVotes));
+    BOOST_CHECK_EQUAL(vecVotes.size(), 2U);
+    vecVotes.clear();
+    BOOST_CHECK(pgovernancevotedb->ReadVotes(nParent2, vecVotes));
+    BOOST_CHECK_EQUAL(vecVotes.size(), 1U);
+
+    // votes of a masternode leave memory and disk
+    BOOST_CHECK(pgovernancevotedb->HasVote(CGovernanceVoteKey(vote1)));
+    file1.RemoveVotesFromMasternode(CTxIn(outpoint1));
+    BOOST_CHECK_EQUAL(file1.GetVoteCount(), 1);
+    BOOST_CHECK(!file1.GetVote(vote1.GetHash(), voteRead));
+    BOOST_CHECK(!pgovernancevotedb->HasVote(CGovernanceVoteKey(vote1)));
+    vecVotes.clear();
+    BOOST_CHECK(pgovernancevotedb->ReadVotes(nParent1, vecVotes));
+    BOOST_CHECK_EQUAL(vecVotes.size(), 1U);
+
+    // the index is rebuilt from the keys alone
+    std::vector<CGovernanceVoteKey> vecKeys;
+    BOOST_CHECK(pgovernancevotedb->ReadAllKeys(vecKeys));
+    BOOST_CHECK_EQUAL(vecKeys.size(), 2U);
+    CGovernanceObjectVoteFile fileLoaded;
+    for (size_t i = 0; i < vecKeys.size(); i++) {
+        if (vecKeys[i].nParentHash == nParent2)
+            fileLoaded.AddVoteKey(vecKeys[i]);
+    }
+    BOOST_CHECK(fileLoaded.HasVote(vote4.GetHash()));
+    BOOST_CHECK(fileLoaded.GetVote(vote4.GetHash(), voteRead));
+
+    // a deleted object takes all its votes along
+    file2.RemoveAllVotes();
+    vecVotes.clear();
+    BOOST_CHECK(pgovernancevotedb->ReadVotes(nParent2, vecVotes));
+    BOOST_CHECK(vecVotes.empty());
+
+    file1.RemoveAllVotes();
+    vecKeys.clear();
+    BOOST_CHECK(pgovernancevotedb->ReadAllKeys(vecKeys));
+    BOOST_CHECK(vecKeys.empty());
+    BOOST_CHECK_EQUAL(pgovernancevotedb->GetMemoryVoteCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(governance_votedb_verified_state)
+{
+    uint256 nParent = GetRandHash();
+    COutPoint outpoint1(GetRandHash(), 0);
+    COutPoint outpoint2(GetRandHash(), 1);
+    CKeyID keyID(uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314")));
+
+    CGovernanceObjectVoteFile file;
+    CGovernanceVote vote1 = MakeVote(nParent, outpoint1, VOTE_SIGNAL_FUNDING, 1000);
+    CGovernanceVote vote2 = MakeVote(nParent, outpoint2, VOTE_SIGNAL_FUNDING, 1001);
+    file.AddVote(vote1, keyID);
+    file.AddVote(vote2);
+
+    const CGovernanceObjectVoteFile::vote_m_t& mapVoteIndex = file.GetVoteIndex();
+    BOOST_CHECK(mapVoteIndex.find(vote1.GetHash())->second.keyIDVerified == keyID);
+    BOOST_CHECK(mapVoteIndex.find(vote2.GetHash())->second.keyIDVerified.IsNull());
+    BOOST_CHECK(mapVoteIndex.find(vote2.GetHash())->second.outpointMasternode == outpoint2);
+
+    file.SetVoteVerified(vote2.GetHash(), keyID);
+    BOOST_CHECK(mapVoteIndex.find(vote2.GetHash())->second.keyIDVerified == keyID);
+
+    // votes indexed after loading are not verified yet
+    CGovernanceObjectVoteFile fileLoaded;
+    fileLoaded.AddVoteKey(CGovernanceVoteKey(vote1));
+    BOOST_CHECK(fileLoaded.GetVoteIndex().find(vote1.GetHash())->second.keyIDVerified.IsNull());
+
+    file.RemoveAllVotes();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -317,6 +317,68 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     CheckSort<3>(pool, sortedOrder);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolAncestorStateTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    /* tx1 -> tx2 -> tx3, tx1 pays nothing */
+    CMutableTransaction tx1 = CMutableTransaction();
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx1.GetHash(), entry.Fee(0LL).SigOps(1).FromTx(tx1));
+
+    CMutableTransaction tx2 = CMutableTransaction();
+    tx2.vin.resize(1);
+    tx2.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+    tx2.vin[0].scriptSig = CScript() << OP_11;
+    tx2.vout.resize(1);
+    tx2.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx2.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx2.GetHash(), entry.Fee(20000LL).SigOps(2).FromTx(tx2));
+
+    CMutableTransaction tx3 = CMutableTransaction();
+    tx3.vin.resize(1);
+    tx3.vin[0].prevout = COutPoint(tx2.GetHash(), 0);
+    tx3.vin[0].scriptSig = CScript() << OP_11;
+    tx3.vout.resize(1);
+    tx3.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx3.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(tx3.GetHash(), entry.Fee(10000LL).SigOps(3).FromTx(tx3));
+
+    CTxMemPool::txiter it1 = pool.mapTx.find(tx1.GetHash());
+    CTxMemPool::txiter it2 = pool.mapTx.find(tx2.GetHash());
+    CTxMemPool::txiter it3 = pool.mapTx.find(tx3.GetHash());
+    BOOST_CHECK_EQUAL(it1->GetCountWithAncestors(), 1);
+    BOOST_CHECK_EQUAL(it3->GetCountWithAncestors(), 3);
+    BOOST_CHECK_EQUAL(it3->GetSizeWithAncestors(), it1->GetTxSize() + it2->GetTxSize() + it3->GetTxSize());
+    BOOST_CHECK_EQUAL(it3->GetModFeesWithAncestors(), 30000LL);
+    BOOST_CHECK_EQUAL(it3->GetSigOpCountWithAncestors(), 6);
+
+    // tx2 with its parent is the best package, tx1 on its own the worst
+    std::vector<std::string> sortedOrder;
+    sortedOrder.push_back(tx2.GetHash().ToString());
+    sortedOrder.push_back(tx3.GetHash().ToString());
+    sortedOrder.push_back(tx1.GetHash().ToString());
+    CheckSort<4>(pool, sortedOrder);
+
+    // fee deltas reach the ancestor state of the descendants
+    pool.PrioritiseTransaction(tx1.GetHash(), tx1.GetHash().ToString(), 0.0, 5000LL);
+    BOOST_CHECK_EQUAL(it1->GetModFeesWithAncestors(), 5000LL);
+    BOOST_CHECK_EQUAL(it3->GetModFeesWithAncestors(), 35000LL);
+
+    // when tx1 is mined its descendants no longer count it as an ancestor
+    std::list<CTransaction> removed;
+    pool.remove(tx1, removed, false);
+    BOOST_CHECK_EQUAL(pool.size(), 2);
+    BOOST_CHECK_EQUAL(it2->GetCountWithAncestors(), 1);
+    BOOST_CHECK_EQUAL(it2->GetModFeesWithAncestors(), 20000LL);
+    BOOST_CHECK_EQUAL(it3->GetCountWithAncestors(), 2);
+    BOOST_CHECK_EQUAL(it3->GetSizeWithAncestors(), it2->GetTxSize() + it3->GetTxSize());
+    BOOST_CHECK_EQUAL(it3->GetModFeesWithAncestors(), 30000LL);
+    BOOST_CHECK_EQUAL(it3->GetSigOpCountWithAncestors(), 5);
+}
 
 BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
 {
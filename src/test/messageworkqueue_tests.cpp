@@ -0,0 +1,76 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messageworkqueue.h"
+#include "protocol.h"
+
+#include "test/test_linc.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+static boost::mutex mutexHandled;
+static std::vector<std::pair<NodeId, int> > vHandled;
+
+static void RecordMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
+{
+    int n;
+    vRecv >> n;
+    boost::lock_guard<boost::mutex> lock(mutexHandled);
+    vHandled.push_back(std::make_pair(pfrom->GetId(), n));
+}
+
+static void PushInt(CMessageWorkQueue& queue, CNode& node, int n)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << n;
+    queue.Push(&node, NetMsgType::MNPING, ss);
+    // the data was moved into the queue
+    BOOST_CHECK(ss.empty());
+}
+
+BOOST_FIXTURE_TEST_SUITE(messageworkqueue_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(messageworkqueue_bounds_and_order)
+{
+    vHandled.clear();
+    CMessageWorkQueue queue("test", &RecordMessage, 2, 3);
+    CNode node1(INVALID_SOCKET, CAddress(), "", true);
+    CNode node2(INVALID_SOCKET, CAddress(), "", true);
+
+    // at most two messages per peer
+    BOOST_CHECK(queue.HasRoom(node1.GetId()));
+    PushInt(queue, node1, 1);
+    PushInt(queue, node1, 2);
+    BOOST_CHECK(!queue.HasRoom(node1.GetId()));
+    BOOST_CHECK(queue.HasRoom(node2.GetId()));
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 2);
+
+    // and three in total
+    PushInt(queue, node2, 3);
+    BOOST_CHECK(!queue.HasRoom(node2.GetId()));
+    BOOST_CHECK_EQUAL(queue.Size(), 3U);
+
+    // messages of a peer being disconnected are dropped
+    node2.fDisconnect = true;
+
+    boost::thread thread(boost::bind(&CMessageWorkQueue::Thread, &queue));
+    for (int i = 0; i < 1000 && (queue.Size() > 0 || node1.GetRefCount() > 0 || node2.GetRefCount() > 0); i++)
+        MilliSleep(10);
+    thread.interrupt();
+    thread.join();
+
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+    BOOST_CHECK(queue.HasRoom(node1.GetId()));
+    BOOST_CHECK(queue.HasRoom(node2.GetId()));
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 0);
+    BOOST_CHECK_EQUAL(node2.GetRefCount(), 0);
+
+    // handled in the order they arrived
+    BOOST_CHECK_EQUAL(vHandled.size(), 2U);
+    BOOST_CHECK(vHandled[0] == std::make_pair(node1.GetId(), 1));
+    BOOST_CHECK(vHandled[1] == std::make_pair(node1.GetId(), 2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
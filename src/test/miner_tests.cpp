@@ -384,6 +384,62 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     SetMockTime(0);
     mempool.clear();
 
+    // a parent paying nothing is mined because its child pays for both
+    mapArgs["-blockprioritysize"] = "0";
+    CMutableTransaction txParent, txChild, txOther;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_1;
+    txParent.vin[0].prevout.hash = txFirst[2]->GetHash();
+    txParent.vin[0].prevout.n = 0;
+    txParent.vout.resize(1);
+    txParent.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    txParent.vout[0].nValue = 50000000000LL;
+    mempool.addUnchecked(txParent.GetHash(), entry.Fee(0).Time(GetTime()).SpendsCoinbase(true).FromTx(txParent));
+    txChild.vin.resize(1);
+    txChild.vin[0].scriptSig = CScript() << OP_1;
+    txChild.vin[0].prevout.hash = txParent.GetHash();
+    txChild.vin[0].prevout.n = 0;
+    txChild.vout.resize(1);
+    txChild.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    txChild.vout[0].nValue = 50000000000LL - 2000000;
+    mempool.addUnchecked(txChild.GetHash(), entry.Fee(2000000).Time(GetTime()).SpendsCoinbase(false).FromTx(txChild));
+
+    BOOST_CHECK(pblocktemplate = CreateNewBlockIncremental(chainparams, scriptPubKey));
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 3);
+    BOOST_CHECK(pblocktemplate->block.vtx[1].GetHash() == txParent.GetHash());
+    BOOST_CHECK(pblocktemplate->block.vtx[2].GetHash() == txChild.GetHash());
+    delete pblocktemplate;
+
+    // a new transaction is appended to the previous template, even though a
+    // template assembled from scratch would put its better feerate first
+    txOther.vin.resize(1);
+    txOther.vin[0].scriptSig = CScript() << OP_1;
+    txOther.vin[0].prevout.hash = txFirst[3]->GetHash();
+    txOther.vin[0].prevout.n = 0;
+    txOther.vout.resize(1);
+    txOther.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    txOther.vout[0].nValue = 50000000000LL - 2000000;
+    mempool.addUnchecked(txOther.GetHash(), entry.Fee(2000000).Time(GetTime()).SpendsCoinbase(true).FromTx(txOther));
+    BOOST_CHECK(pblocktemplate = CreateNewBlockIncremental(chainparams, scriptPubKey));
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 4);
+    BOOST_CHECK(pblocktemplate->block.vtx[3].GetHash() == txOther.GetHash());
+    delete pblocktemplate;
+    BOOST_CHECK(pblocktemplate = CreateNewBlock(chainparams, scriptPubKey));
+    BOOST_CHECK(pblocktemplate->block.vtx[1].GetHash() == txOther.GetHash());
+    delete pblocktemplate;
+
+    // removed transactions are dropped from the template
+    std::list<CTransaction> removed;
+    mempool.remove(txParent, removed, true);
+    BOOST_CHECK_EQUAL(removed.size(), 2);
+    BOOST_CHECK(pblocktemplate = CreateNewBlockIncremental(chainparams, scriptPubKey));
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 2);
+    BOOST_CHECK(pblocktemplate->block.vtx[1].GetHash() == txOther.GetHash());
+    delete pblocktemplate;
+
+    mapArgs.erase("-blockprioritysize");
+    mempool.clear();
+
     BOOST_FOREACH(CTransaction *tx, txFirst)
         delete tx;
 
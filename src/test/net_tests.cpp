@@ -0,0 +1,59 @@
+// Copyright (c) 2018 The LINC Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "net.h"
+#include "protocol.h"
+
+#include "test/test_linc.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(net_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(net_message_buffer_pool)
+{
+    CNetMessageBufferPool pool;
+    std::map<std::string, CNetMessageBufferStats> mapRecv, mapSend;
+
+    // the first buffer of a size class is allocated, a returned one is reused
+    CSerializeData data;
+    pool.Get(data, 1000, 1000, NetMsgType::INV, false);
+    BOOST_CHECK(data.empty());
+    BOOST_CHECK(data.capacity() >= 1000);
+    data.resize(1000);
+    pool.Put(data);
+    BOOST_CHECK(data.empty());
+    BOOST_CHECK(pool.GetFreeBytes() >= 1000);
+    pool.Get(data, 900, 900, NetMsgType::INV, false);
+    BOOST_CHECK(data.empty());
+    BOOST_CHECK(data.capacity() >= 1000);
+    BOOST_CHECK_EQUAL(pool.GetFreeBytes(), 0U);
+
+    // commands outside the protocol share one counter
+    CSerializeData dataOther;
+    pool.Get(dataOther, 10, 10, "notacommand", true);
+
+    pool.GetStats(mapRecv, mapSend);
+    BOOST_CHECK_EQUAL(mapRecv[NetMsgType::INV].nMessages, 2U);
+    BOOST_CHECK_EQUAL(mapRecv[NetMsgType::INV].nBytes, 1900U);
+    BOOST_CHECK_EQUAL(mapRecv[NetMsgType::INV].nAllocations, 1U);
+    BOOST_CHECK(!mapSend.count("notacommand"));
+    BOOST_CHECK_EQUAL(mapSend[NET_MESSAGE_COMMAND_OTHER].nMessages, 1U);
+
+    // buffers past the largest size class aren't kept
+    CSerializeData dataLarge;
+    pool.Get(dataLarge, CNetMessageBufferPool::MAX_BUFFER_SIZE * 2, CNetMessageBufferPool::MAX_BUFFER_SIZE * 2, NetMsgType::BLOCK, false);
+    pool.Put(dataLarge);
+    BOOST_CHECK_EQUAL(pool.GetFreeBytes(), 0U);
+
+    // a message is counted at its full size, not the size of the buffer it started with
+    CSerializeData dataPartial;
+    pool.Get(dataPartial, 256 * 1024, 1000 * 1000, NetMsgType::TX, false);
+    pool.CountAllocation(NetMsgType::TX, false);
+    pool.GetStats(mapRecv, mapSend);
+    BOOST_CHECK_EQUAL(mapRecv[NetMsgType::TX].nBytes, 1000000U);
+    BOOST_CHECK_EQUAL(mapRecv[NetMsgType::TX].nAllocations, 2U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
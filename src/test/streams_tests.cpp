@@ -4,6 +4,7 @@
 
 #include "streams.h"
 #include "support/allocators/zeroafterfree.h"
+#include "version.h"
 #include "test/test_linc.h"
 
 #include <boost/assign/std/vector.hpp> // for 'operator+=()'
@@ -64,4 +65,30 @@ BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
             std::string(ds.begin(), ds.end()));  
 }         
 
+BOOST_AUTO_TEST_CASE(streams_dataview)
+{
+    CDataStream ds(SER_NETWORK, PROTOCOL_VERSION);
+    ds << (uint32_t)1 << std::string("view") << (uint8_t)2;
+    size_t nSize = ds.size();
+
+    // reading through a view leaves the stream alone, so it can be read twice
+    for (int i = 0; i < 2; i++) {
+        CDataStreamView view(ds);
+        uint32_t n1;
+        std::string str;
+        uint8_t n2;
+        view >> n1 >> str >> n2;
+        BOOST_CHECK_EQUAL(n1, 1U);
+        BOOST_CHECK_EQUAL(str, "view");
+        BOOST_CHECK_EQUAL(n2, 2);
+        BOOST_CHECK(view.empty());
+        BOOST_CHECK_EQUAL(ds.size(), nSize);
+    }
+
+    CDataStreamView view(ds);
+    view.ignore(nSize - 1);
+    uint16_t nTooLarge;
+    BOOST_CHECK_THROW(view >> nTooLarge, std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -26,6 +26,7 @@ static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_ADDRESSBALANCE = 'v';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
@@ -78,6 +79,9 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
+CAddressIndexDB::CAddressIndexDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "addressindex", nCacheSize, fMemory, fWipe) {
+}
+
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
     return Read(make_pair(DB_BLOCK_FILES, nFile), info);
 }
@@ -167,11 +171,11 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
+bool CAddressIndexDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
     return Read(make_pair(DB_SPENTINDEX, key), value);
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
+bool CAddressIndexDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
     CDBBatch batch(&GetObfuscateKey());
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
@@ -183,7 +187,7 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey,
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
+bool CAddressIndexDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
     CDBBatch batch(&GetObfuscateKey());
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
@@ -195,7 +199,7 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
+bool CAddressIndexDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
@@ -221,32 +225,88 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+/** Add (nSign = 1) or subtract (nSign = -1) the deltas of one block to the address aggregates */
+static void UpdateAddressBalances(CDBWrapper &db, CDBBatch &batch, const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, int nSign) {
+    typedef std::pair<unsigned int, uint160> AddressKey;
+    std::map<AddressKey, CAddressBalance> mapDeltas;
+    std::set<std::pair<AddressKey, uint256> > setAddressTxs;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        AddressKey key(it->first.type, it->first.hashBytes);
+        CAddressBalance &delta = mapDeltas[key];
+        delta.balance += it->second;
+        if (it->second > 0)
+            delta.received += it->second;
+        if (setAddressTxs.insert(make_pair(key, it->first.txhash)).second)
+            delta.txCount++;
+    }
+
+    for (std::map<AddressKey, CAddressBalance>::const_iterator it=mapDeltas.begin(); it!=mapDeltas.end(); it++) {
+        std::pair<char, CAddressIndexIteratorKey> key = make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(it->first.first, it->first.second));
+        CAddressBalance balance;
+        db.Read(key, balance);
+        balance.balance += nSign * it->second.balance;
+        balance.received += nSign * it->second.received;
+        balance.txCount += nSign * it->second.txCount;
+        if (balance.IsNull())
+            batch.Erase(key);
+        else
+            batch.Write(key, balance);
+    }
+}
+
+bool CAddressIndexDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect, const uint256 &hashBlock, bool fUpdateBalances) {
     CDBBatch batch(&GetObfuscateKey());
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    if (fUpdateBalances) {
+        UpdateAddressBalances(*this, batch, vect, 1);
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+    }
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+bool CAddressIndexDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect, const uint256 &hashPrevBlock, bool fUpdateBalances) {
     CDBBatch batch(&GetObfuscateKey());
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+    if (fUpdateBalances) {
+        UpdateAddressBalances(*this, batch, vect, -1);
+        batch.Write(DB_BEST_BLOCK, hashPrevBlock);
+    }
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
+bool CAddressIndexDB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalance &balance) {
+    if (!Read(make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), balance))
+        balance = CAddressBalance();
+    return true;
+}
+
+bool CAddressIndexDB::ReadAddressIndexTip(uint256 &hashBlock) {
+    return Read(DB_BEST_BLOCK, hashBlock);
+}
+
+bool CAddressIndexDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+                                    int start, int end, const CAddressIndexKey *pkeyAfter, unsigned int nLimit) {
 
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
-    if (start > 0 && end > 0) {
+    if (pkeyAfter) {
+        // Resume right behind the last entry of the previous page
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, *pkeyAfter));
+        std::pair<char,CAddressIndexKey> key;
+        if (pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX &&
+            SerializeHash(key.second) == SerializeHash(*pkeyAfter)) {
+            pcursor->Next();
+        }
+    } else if (start > 0 && end > 0) {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
     } else {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
     }
 
+    unsigned int nRead = 0;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char,CAddressIndexKey> key;
@@ -254,9 +314,13 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
             if (end > 0 && key.second.blockHeight > end) {
                 break;
             }
+            if (nLimit > 0 && nRead == nLimit) {
+                break;
+            }
             CAmount nValue;
             if (pcursor->GetValue(nValue)) {
                 addressIndex.push_back(make_pair(key.second, nValue));
+                nRead++;
                 pcursor->Next();
             } else {
                 return error("failed to get address index value");
@@ -269,13 +333,13 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+bool CAddressIndexDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
     CDBBatch batch(&GetObfuscateKey());
     batch.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
+bool CAddressIndexDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
 
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
@@ -295,18 +359,34 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
     return true;
 }
 
-bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
-    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
+static bool WriteDBFlag(CDBWrapper &db, const std::string &name, bool fValue) {
+    return db.Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
 
-bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
+static bool ReadDBFlag(CDBWrapper &db, const std::string &name, bool &fValue) {
     char ch;
-    if (!Read(std::make_pair(DB_FLAG, name), ch))
+    if (!db.Read(std::make_pair(DB_FLAG, name), ch))
         return false;
     fValue = ch == '1';
     return true;
 }
 
+bool CAddressIndexDB::WriteFlag(const std::string &name, bool fValue) {
+    return WriteDBFlag(*this, name, fValue);
+}
+
+bool CAddressIndexDB::ReadFlag(const std::string &name, bool &fValue) {
+    return ReadDBFlag(*this, name, fValue);
+}
+
+bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
+    return WriteDBFlag(*this, name, fValue);
+}
+
+bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
+    return ReadDBFlag(*this, name, fValue);
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts()
 {
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
@@ -26,6 +26,7 @@ struct CTimestampIndexKey;
 struct CTimestampIndexIteratorKey;
 struct CSpentIndexKey;
 struct CSpentIndexValue;
+struct CAddressBalance;
 class uint256;
 
 //! -dbcache default (MiB)
@@ -34,6 +35,8 @@ static const int64_t nDefaultDbCache = 100;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! max. address index database cache when any of the address, spent and timestamp indexes is enabled (MiB)
+static const int64_t nMaxAddressIndexDbCache = 256;
 
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
@@ -66,21 +69,53 @@ public:
     bool ReadReindexing(bool &fReindex);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
+    bool WriteFlag(const std::string &name, bool fValue);
+    bool ReadFlag(const std::string &name, bool &fValue);
+    bool LoadBlockIndexGuts();
+};
+
+/**
+ * Access to the address, address unspent, spent and timestamp indexes (addressindex/).
+ * Kept apart from the block database so that explorer style workloads get their own
+ * cache and LevelDB compaction. Besides the per output deltas it keeps running
+ * balance, received and transaction count aggregates for every address.
+ */
+class CAddressIndexDB : public CDBWrapper
+{
+public:
+    CAddressIndexDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+private:
+    CAddressIndexDB(const CAddressIndexDB&);
+    void operator=(const CAddressIndexDB&);
+public:
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
+    /**
+     * Write the deltas of a connected block. With fUpdateBalances they are also added
+     * to the address aggregates and hashBlock becomes the tip the aggregates are valid
+     * for; it is unset when a block the aggregates already contain is connected again.
+     */
+    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, const uint256 &hashBlock, bool fUpdateBalances);
+    /** Erase the deltas of a disconnected block, the reverse of WriteAddressIndex */
+    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, const uint256 &hashPrevBlock, bool fUpdateBalances);
+    /**
+     * Append the deltas of an address to addressIndex in key order. With pkeyAfter the
+     * scan resumes right behind that key, and nLimit (if not 0) caps the number of
+     * entries appended.
+     */
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
+                          int start = 0, int end = 0,
+                          const CAddressIndexKey *pkeyAfter = NULL, unsigned int nLimit = 0);
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalance &balance);
+    bool ReadAddressIndexTip(uint256 &hashBlock);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts();
 };
 
 #endif // BITCOIN_TXDB_H
@@ -4,6 +4,16 @@
 
 #include "wallet/wallet.h"
 
+#include "bloom.h"
+#include "chainparams.h"
+#include "consensus/consensus.h"
+#include "consensus/validation.h"
+#include "darksend.h"
+#include "init.h"
+#include "main.h"
+#include "random.h"
+#include "script/sign.h"
+
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -14,6 +24,14 @@
 #include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
 
+struct CWalletTestAccess {
+    static bool IsBalanceVolatile(const CWallet& wallet, const uint256& hash)
+    {
+        LOCK(wallet.cs_wallet);
+        return wallet.setBalanceVolatile.count(hash) > 0;
+    }
+};
+
 // how many times to run all the tests to have a chance to catch errors that only show up with particular random shuffles
 #define RUN_TESTS 100
 
@@ -361,4 +379,156 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     BOOST_CHECK_EQUAL(setCoinsRet.size(), 101);
 }
 
+static CWalletTx add_denominated_tx(const COutPoint& prevout, const CScript& scriptPubKey)
+{
+    CMutableTransaction tx;
+    tx.vin.push_back(CTxIn(prevout));
+    tx.vout.push_back(CTxOut(COIN + 1000, scriptPubKey));
+    CWalletTx wtx(pwalletMain, tx);
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+    BOOST_CHECK(pwalletMain->AddToWallet(wtx, false, &walletdb));
+    return wtx;
+}
+
+BOOST_AUTO_TEST_CASE(privatesend_rounds)
+{
+    darkSendPool.InitDenominations();
+    CScript scriptPubKey = GetScriptForDestination(pwalletMain->GenerateNewKey().GetID());
+
+    // a denomination from outside the wallet starts a chain, each mix adds a round
+    CWalletTx wtx1 = add_denominated_tx(COutPoint(GetRandHash(), 0), scriptPubKey);
+    CWalletTx wtx2 = add_denominated_tx(COutPoint(wtx1.GetHash(), 0), scriptPubKey);
+    CWalletTx wtx3 = add_denominated_tx(COutPoint(wtx2.GetHash(), 0), scriptPubKey);
+
+    LOCK(pwalletMain->cs_wallet);
+    BOOST_CHECK_EQUAL(pwalletMain->GetRealInputPrivateSendRounds(CTxIn(wtx1.GetHash(), 0), 0), 0);
+    BOOST_CHECK_EQUAL(pwalletMain->GetRealInputPrivateSendRounds(CTxIn(wtx2.GetHash(), 0), 0), 1);
+    BOOST_CHECK_EQUAL(pwalletMain->GetRealInputPrivateSendRounds(CTxIn(wtx3.GetHash(), 0), 0), 2);
+
+    // a parent added after its descendants updates their rounds
+    CMutableTransaction txParent;
+    txParent.vin.push_back(CTxIn(COutPoint(GetRandHash(), 0)));
+    txParent.vout.push_back(CTxOut(COIN + 1000, scriptPubKey));
+    CWalletTx wtx4 = add_denominated_tx(COutPoint(txParent.GetHash(), 0), scriptPubKey);
+    CWalletTx wtx5 = add_denominated_tx(COutPoint(wtx4.GetHash(), 0), scriptPubKey);
+    BOOST_CHECK_EQUAL(pwalletMain->GetRealInputPrivateSendRounds(CTxIn(wtx5.GetHash(), 0), 0), 1);
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+    BOOST_CHECK(pwalletMain->AddToWallet(CWalletTx(pwalletMain, txParent), false, &walletdb));
+    BOOST_CHECK_EQUAL(pwalletMain->GetRealInputPrivateSendRounds(CTxIn(wtx5.GetHash(), 0), 0), 2);
+}
+
+BOOST_AUTO_TEST_CASE(rescan_filter)
+{
+    CPubKey pubkey = pwalletMain->GenerateNewKey();
+    CKeyID keyid = pubkey.GetID();
+    CKey keyOther;
+    keyOther.MakeNewKey(true);
+    CKeyID keyidOther = keyOther.GetPubKey().GetID();
+
+    CBloomFilter filter;
+    BOOST_CHECK(pwalletMain->GetRescanFilter(filter));
+    BOOST_CHECK(filter.contains(std::vector<unsigned char>(keyid.begin(), keyid.end())));
+    BOOST_CHECK(filter.contains(std::vector<unsigned char>(pubkey.begin(), pubkey.end())));
+    BOOST_CHECK(!filter.contains(std::vector<unsigned char>(keyidOther.begin(), keyidOther.end())));
+
+    // watched scripts are matched by their data
+    CScript scriptWatched = GetScriptForDestination(keyidOther);
+    BOOST_CHECK(pwalletMain->AddWatchOnly(scriptWatched));
+    BOOST_CHECK(pwalletMain->GetRescanFilter(filter));
+    BOOST_CHECK(filter.contains(std::vector<unsigned char>(keyidOther.begin(), keyidOther.end())));
+
+    // but a script without any can't be filtered
+    BOOST_CHECK(pwalletMain->AddWatchOnly(CScript() << OP_TRUE));
+    BOOST_CHECK(!pwalletMain->GetRescanFilter(filter));
+    BOOST_CHECK(pwalletMain->RemoveWatchOnly(CScript() << OP_TRUE));
+    BOOST_CHECK(pwalletMain->RemoveWatchOnly(scriptWatched));
+}
+
+BOOST_FIXTURE_TEST_CASE(rescan_batches, TestChain100Setup)
+{
+    // more blocks than fit in one read-ahead batch
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    std::vector<uint256> vStaleHashes;
+    for (int i = 0; i < 150; i++) {
+        CBlock block = CreateAndProcessBlock(std::vector<CMutableTransaction>(), scriptPubKey);
+        if (i >= 140)
+            vStaleHashes.push_back(block.vtx[0].GetHash());
+    }
+
+    // replace the last ten blocks by a longer branch paying to the same key
+    CBlockIndex* pindexStale;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(chainActive.Height(), 250);
+        pindexStale = chainActive[241];
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params().GetConsensus(), pindexStale));
+    }
+    CScript scriptOther = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    for (int i = 0; i < 11; i++)
+        CreateAndProcessBlock(std::vector<CMutableTransaction>(), scriptOther);
+
+    CBlockIndex* pindexGenesis;
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+        pindexGenesis = chainActive.Genesis();
+        BOOST_CHECK(pwalletMain->AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey()));
+        pwalletMain->nTimeFirstKey = 1;
+    }
+
+    // a rescan starting on the stale branch continues after the fork
+    BOOST_CHECK_EQUAL(pwalletMain->ScanForWalletTransactions(pindexStale), 11);
+    {
+        LOCK(pwalletMain->cs_wallet);
+        BOOST_FOREACH(const uint256& hash, vStaleHashes)
+            BOOST_CHECK(!pwalletMain->mapWallet.count(hash));
+    }
+
+    // the rest of the chain is read in several batches
+    BOOST_CHECK_EQUAL(pwalletMain->ScanForWalletTransactions(pindexGenesis), 240);
+    LOCK(pwalletMain->cs_wallet);
+    BOOST_CHECK_EQUAL(pwalletMain->mapWallet.size(), 251U);
+}
+
+BOOST_FIXTURE_TEST_CASE(balance_volatile_conflicts, TestChain100Setup)
+{
+    CBasicKeyStore keystore;
+    BOOST_CHECK(keystore.AddKey(coinbaseKey));
+    CScript scriptCoinbase = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // a wallet payment and a double spend of the same coinbase output
+    CMutableTransaction txPayment;
+    txPayment.vin.push_back(CTxIn(coinbaseTxns[0].GetHash(), 0));
+    txPayment.vout.push_back(CTxOut(coinbaseTxns[0].vout[0].nValue, GetScriptForDestination(pwalletMain->GenerateNewKey().GetID())));
+    BOOST_CHECK(SignSignature(keystore, coinbaseTxns[0], txPayment, 0));
+    CMutableTransaction txDoubleSpend(txPayment);
+    txDoubleSpend.vout[0].scriptPubKey = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    txDoubleSpend.vin[0].scriptSig = CScript();
+    BOOST_CHECK(SignSignature(keystore, coinbaseTxns[0], txDoubleSpend, 0));
+
+    uint256 hashPayment = txPayment.GetHash();
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        BOOST_CHECK(pwalletMain->AddToWallet(CWalletTx(pwalletMain, txPayment), false, &walletdb));
+    }
+    pwalletMain->GetBalance();
+    BOOST_CHECK(CWalletTestAccess::IsBalanceVolatile(*pwalletMain, hashPayment));
+
+    // a freshly conflicted payment is still recounted on every query
+    CreateAndProcessBlock(std::vector<CMutableTransaction>(1, txDoubleSpend), scriptCoinbase);
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+        BOOST_CHECK_EQUAL(pwalletMain->mapWallet[hashPayment].GetDepthInMainChain(false), -1);
+    }
+    pwalletMain->GetBalance();
+    BOOST_CHECK(CWalletTestAccess::IsBalanceVolatile(*pwalletMain, hashPayment));
+
+    // until its conflict is buried as deep as a coinbase has to mature
+    for (int i = 0; i < COINBASE_MATURITY - 1; i++)
+        CreateAndProcessBlock(std::vector<CMutableTransaction>(), scriptCoinbase);
+    pwalletMain->GetBalance();
+    BOOST_CHECK(!CWalletTestAccess::IsBalanceVolatile(*pwalletMain, hashPayment));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 #include "wallet/wallet.h"
 
 #include "base58.h"
+#include "bloom.h"
 #include "checkpoints.h"
 #include "chain.h"
 #include "coincontrol.h"
@@ -48,6 +49,12 @@ CAmount maxTxFee = DEFAULT_TRANSACTION_MAXFEE;
 unsigned int nTxConfirmTarget = DEFAULT_TX_CONFIRM_TARGET;
 bool bSpendZeroConfChange = DEFAULT_SPEND_ZEROCONF_CHANGE;
 bool fSendFreeTransactions = DEFAULT_SEND_FREE_TRANSACTIONS;
+bool fCheckWalletBalances = DEFAULT_CHECK_WALLET_BALANCES;
+
+/** Number of blocks a rescan reads ahead of the wallet at a time */
+static const unsigned int RESCAN_BATCH_SIZE = 100;
+/** Maximum number of threads reading blocks ahead of a rescan */
+static const int MAX_RESCAN_READ_THREADS = 4;
 
 /** 
  * Fees smaller than this (in duffs) are considered zero fee (for transaction creation)
@@ -804,6 +811,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
             if (!wtx.WriteToDisk(pwalletdb))
                 return false;
 
+        if (fInsertedNew)
+            UpdatePrivateSendRounds(wtx, pwalletdb);
+
         // Break debit/credit balance caches:
         wtx.MarkDirty();
 
@@ -1047,8 +1057,6 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter) const
 // Recursively determine the rounds of a given input (How deep is the PrivateSend chain for a given input)
 int CWallet::GetRealInputPrivateSendRounds(CTxIn txin, int nRounds) const
 {
-    static std::map<uint256, CMutableTransaction> mDenomWtxes;
-
     if(nRounds >= 16) return 15; // 16 rounds max
 
     uint256 hash = txin.prevout.hash;
@@ -1057,17 +1065,12 @@ int CWallet::GetRealInputPrivateSendRounds(CTxIn txin, int nRounds) const
     const CWalletTx* wtx = GetWalletTx(hash);
     if(wtx != NULL)
     {
-        std::map<uint256, CMutableTransaction>::const_iterator mdwi = mDenomWtxes.find(hash);
-        if (mdwi == mDenomWtxes.end()) {
-            // not known yet, let's add it
-            LogPrint("privatesend", "GetRealInputPrivateSendRounds INSERTING %s\n", hash.ToString());
-            mDenomWtxes[hash] = CMutableTransaction(*wtx);
-        } else if(mDenomWtxes[hash].vout[nout].nRounds != -10) {
-            // found and it's not an initial value, just return it
-            return mDenomWtxes[hash].vout[nout].nRounds;
+        std::map<COutPoint, int>::const_iterator it = mapOutpointRounds.find(txin.prevout);
+        if(it != mapOutpointRounds.end()) {
+            // found, just return it
+            return it->second;
         }
 
-
         // bounds check
         if (nout >= wtx->vout.size()) {
             // should never actually hit this
@@ -1075,52 +1078,137 @@ int CWallet::GetRealInputPrivateSendRounds(CTxIn txin, int nRounds) const
             return -4;
         }
 
+        int nRoundsRet;
         if (IsCollateralAmount(wtx->vout[nout].nValue)) {
-            mDenomWtxes[hash].vout[nout].nRounds = -3;
-            LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
-        }
+            nRoundsRet = -3;
+        } else if (!IsDenominatedAmount(wtx->vout[nout].nValue)) { //NOT DENOM
+            //make sure the final output is non-denominate
+            nRoundsRet = -2;
+        } else {
+            bool fAllDenoms = true;
+            BOOST_FOREACH(const CTxOut& out, wtx->vout) {
+                fAllDenoms = fAllDenoms && IsDenominatedAmount(out.nValue);
+            }
 
-        //make sure the final output is non-denominate
-        if (!IsDenominatedAmount(wtx->vout[nout].nValue)) { //NOT DENOM
-            mDenomWtxes[hash].vout[nout].nRounds = -2;
-            LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+            if (!fAllDenoms) {
+                // this one is denominated but there is another non-denominated output found in the same tx
+                nRoundsRet = 0;
+            } else {
+                int nShortest = -10; // an initial value, should be no way to get this by calculations
+                bool fDenomFound = false;
+                // only denoms here so let's look up
+                BOOST_FOREACH(const CTxIn& txinNext, wtx->vin) {
+                    if (IsMine(txinNext)) {
+                        int n = GetRealInputPrivateSendRounds(txinNext, nRounds + 1);
+                        // denom found, find the shortest chain or initially assign nShortest with the first found value
+                        if(n >= 0 && (n < nShortest || nShortest == -10)) {
+                            nShortest = n;
+                            fDenomFound = true;
+                        }
+                    }
+                }
+                nRoundsRet = fDenomFound
+                        ? (nShortest >= 15 ? 16 : nShortest + 1) // good, we a +1 to the shortest one but only 16 rounds max allowed
+                        : 0;            // too bad, we are the fist one in that chain
+            }
         }
+        mapOutpointRounds[txin.prevout] = nRoundsRet;
+        LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, nRoundsRet);
+        return nRoundsRet;
+    }
+
+    return nRounds - 1;
+}
 
-        bool fAllDenoms = true;
-        BOOST_FOREACH(CTxOut out, wtx->vout) {
-            fAllDenoms = fAllDenoms && IsDenominatedAmount(out.nValue);
+bool CWallet::UpdateOutputPrivateSendRounds(const CWalletTx& wtx, CWalletDB* pwalletdb)
+{
+    AssertLockHeld(cs_wallet); // mapOutpointRounds
+
+    const uint256& hash = wtx.GetHash();
+    std::vector<int> vRounds(wtx.vout.size(), -10);
+    bool fChanged = false;
+    for (unsigned int i = 0; i < wtx.vout.size(); i++) {
+        if (!IsMine(wtx.vout[i]))
+            continue;
+        COutPoint outpoint(hash, i);
+        int nRoundsPrev = -10;
+        std::map<COutPoint, int>::iterator it = mapOutpointRounds.find(outpoint);
+        if (it != mapOutpointRounds.end()) {
+            nRoundsPrev = it->second;
+            mapOutpointRounds.erase(it);
         }
+        vRounds[i] = GetRealInputPrivateSendRounds(CTxIn(outpoint), 0);
+        fChanged = fChanged || vRounds[i] != nRoundsPrev;
+    }
+
+    if (fChanged && pwalletdb)
+        pwalletdb->WritePrivateSendRounds(hash, vRounds);
+    return fChanged;
+}
+
+void CWallet::UpdatePrivateSendRounds(const CWalletTx& wtxIn, CWalletDB* pwalletdb)
+{
+    AssertLockHeld(cs_wallet); // mapOutpointRounds, mapTxSpends
 
-        // this one is denominated but there is another non-denominated output found in the same tx
-        if (!fAllDenoms) {
-            mDenomWtxes[hash].vout[nout].nRounds = 0;
-            LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-            return mDenomWtxes[hash].vout[nout].nRounds;
+    // A transaction can arrive after wallet transactions spending it (e.g. during
+    // a rescan), so walk down to them for as long as the rounds keep changing.
+    std::vector<const CWalletTx*> vUpdated(1, &wtxIn);
+    for (size_t i = 0; i < vUpdated.size(); i++) {
+        const CWalletTx& wtx = *vUpdated[i];
+        if (!UpdateOutputPrivateSendRounds(wtx, pwalletdb))
+            continue;
+        MarkBalanceDirty(wtx);
+        for (unsigned int n = 0; n < wtx.vout.size(); n++) {
+            std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(COutPoint(wtx.GetHash(), n));
+            for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+                const CWalletTx* pwtxSpend = GetWalletTx(it->second);
+                if (pwtxSpend != NULL)
+                    vUpdated.push_back(pwtxSpend);
+            }
         }
+    }
 
-        int nShortest = -10; // an initial value, should be no way to get this by calculations
-        bool fDenomFound = false;
-        // only denoms here so let's look up
-        BOOST_FOREACH(CTxIn txinNext, wtx->vin) {
-            if (IsMine(txinNext)) {
-                int n = GetRealInputPrivateSendRounds(txinNext, nRounds + 1);
-                // denom found, find the shortest chain or initially assign nShortest with the first found value
-                if(n >= 0 && (n < nShortest || nShortest == -10)) {
-                    nShortest = n;
-                    fDenomFound = true;
-                }
+    // Nobody asks for the rounds of spent outputs, keep only the unspent ones in memory
+    BOOST_FOREACH(const CWalletTx* pwtx, vUpdated)
+        BOOST_FOREACH(const CTxIn& txin, pwtx->vin)
+            mapOutpointRounds.erase(txin.prevout);
+}
+
+void CWallet::LoadPrivateSendRounds(const uint256& hash, const std::vector<int>& vRounds)
+{
+    for (unsigned int i = 0; i < vRounds.size(); i++)
+        if (vRounds[i] != -10)
+            mapOutpointRounds[COutPoint(hash, i)] = vRounds[i];
+}
+
+void CWallet::SyncPrivateSendRounds(CWalletDB* pwalletdb)
+{
+    AssertLockHeld(cs_wallet); // mapOutpointRounds, mapWallet, mapTxSpends
+
+    // Wallets written before rounds were stored with the transactions have none,
+    // compute the missing ones once and store them.
+    int nComputed = 0;
+    for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
+        const CWalletTx& wtx = it->second;
+        for (unsigned int i = 0; i < wtx.vout.size(); i++) {
+            COutPoint outpoint(wtx.GetHash(), i);
+            if (!mapOutpointRounds.count(outpoint) && !mapTxSpends.count(outpoint) && IsMine(wtx.vout[i])) {
+                UpdateOutputPrivateSendRounds(wtx, pwalletdb);
+                nComputed++;
+                break;
             }
         }
-        mDenomWtxes[hash].vout[nout].nRounds = fDenomFound
-                ? (nShortest >= 15 ? 16 : nShortest + 1) // good, we a +1 to the shortest one but only 16 rounds max allowed
-                : 0;            // too bad, we are the fist one in that chain
-        LogPrint("privatesend", "GetRealInputPrivateSendRounds UPDATED   %s %3d %3d\n", hash.ToString(), nout, mDenomWtxes[hash].vout[nout].nRounds);
-        return mDenomWtxes[hash].vout[nout].nRounds;
     }
 
-    return nRounds - 1;
+    std::map<COutPoint, int>::iterator it = mapOutpointRounds.begin();
+    while (it != mapOutpointRounds.end()) {
+        if (!mapWallet.count(it->first.hash) || mapTxSpends.count(it->first))
+            mapOutpointRounds.erase(it++);
+        else
+            ++it;
+    }
+
+    LogPrintf("CWallet::SyncPrivateSendRounds -- computed rounds for %d transactions, %d unspent outputs indexed\n", nComputed, mapOutpointRounds.size());
 }
 
 // respect current settings
@@ -1381,15 +1469,161 @@ void CWalletTx::GetAccountAmounts(const string& strAccount, CAmount& nReceived,
 }
 
 
+void CWalletTx::MarkDirty()
+{
+    fCreditCached = false;
+    fAvailableCreditCached = false;
+    fImmatureCreditCached = false;
+    fAnonymizedCreditCached = false;
+    fDenomUnconfCreditCached = false;
+    fDenomConfCreditCached = false;
+    fWatchDebitCached = false;
+    fWatchCreditCached = false;
+    fAvailableWatchCreditCached = false;
+    fImmatureWatchCreditCached = false;
+    fDebitCached = false;
+    fChangeCached = false;
+
+    if (pwallet)
+        pwallet->MarkBalanceDirty(*this);
+}
+
 bool CWalletTx::WriteToDisk(CWalletDB *pwalletdb)
 {
     return pwalletdb->WriteTx(GetHash(), *this);
 }
 
+/** Blocks of a rescan read ahead of the wallet on worker threads */
+struct CRescanBatch
+{
+    std::vector<CBlockIndex*> vIndex;
+    std::vector<CBlock> vBlock;
+    std::vector<char> vfRead;
+    //! transactions with outputs that may belong to the wallet
+    std::vector<std::vector<bool> > vfMatch;
+
+    void Clear()
+    {
+        vIndex.clear();
+        vBlock.clear();
+        vfRead.clear();
+        vfMatch.clear();
+    }
+};
+
+static bool MatchesRescanFilter(const CBloomFilter& filter, const CTransaction& tx)
+{
+    BOOST_FOREACH(const CTxOut& txout, tx.vout) {
+        CScript::const_iterator pc = txout.scriptPubKey.begin();
+        std::vector<unsigned char> data;
+        while (pc < txout.scriptPubKey.end()) {
+            opcodetype opcode;
+            if (!txout.scriptPubKey.GetOp(pc, opcode, data))
+                break;
+            if (data.size() != 0 && filter.contains(data))
+                return true;
+        }
+    }
+    return false;
+}
+
+static void ReadRescanBatch(CRescanBatch* pbatch, const CBloomFilter* pfilter, size_t nOffset, size_t nStride)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    for (size_t i = nOffset; i < pbatch->vIndex.size(); i += nStride) {
+        const CBlock& block = pbatch->vBlock[i];
+        if (!ReadBlockFromDisk(pbatch->vBlock[i], pbatch->vIndex[i], consensusParams))
+            continue;
+        pbatch->vfRead[i] = true;
+        pbatch->vfMatch[i].resize(block.vtx.size());
+        for (size_t j = 0; j < block.vtx.size(); j++)
+            pbatch->vfMatch[i][j] = pfilter == NULL || MatchesRescanFilter(*pfilter, block.vtx[j]);
+    }
+}
+
+/** Add the transactions of a rescanned block that may belong to the wallet */
+static int ScanRescanBlock(CWallet* pwallet, const CBlock& block, const std::vector<bool>* pvfMatch, bool fUpdate)
+{
+    AssertLockHeld(pwallet->cs_wallet);
+    int ret = 0;
+    for (size_t j = 0; j < block.vtx.size(); j++)
+    {
+        const CTransaction& tx = block.vtx[j];
+        if (pvfMatch && !(*pvfMatch)[j] && !pwallet->mapWallet.count(tx.GetHash()) && !pwallet->IsSpentOrConflictedByTx(tx))
+            continue;
+        if (pwallet->AddToWalletIfInvolvingMe(tx, &block, fUpdate))
+            ret++;
+    }
+    return ret;
+}
+
+/** The block to rescan after pindexPrev, continuing on the active chain if it was reorganized under us */
+static CBlockIndex* NextRescanIndex(CBlockIndex* pindexPrev)
+{
+    AssertLockHeld(cs_main);
+    if (!chainActive.Contains(pindexPrev))
+        return chainActive.Next(chainActive.FindFork(pindexPrev));
+    return chainActive.Next(pindexPrev);
+}
+
+bool CWallet::GetRescanFilter(CBloomFilter& filter) const
+{
+    LOCK(cs_KeyStore);
+
+    std::set<CKeyID> setKeys;
+    GetKeys(setKeys);
+    unsigned int nElements = 2 * setKeys.size() + mapScripts.size() + 2 * setWatchOnly.size();
+    // never relayed, so not held to MAX_BLOOM_FILTER_SIZE: a capped filter
+    // would match nearly every block of a large wallet
+    filter = CBloomFilter(std::max(nElements, 1u), 0.0001, GetRand(std::numeric_limits<unsigned int>::max()));
+
+    BOOST_FOREACH(const CKeyID& keyid, setKeys) {
+        filter.insert(std::vector<unsigned char>(keyid.begin(), keyid.end()));
+        CPubKey pubkey;
+        if (GetPubKey(keyid, pubkey))
+            filter.insert(std::vector<unsigned char>(pubkey.begin(), pubkey.end()));
+    }
+    for (ScriptMap::const_iterator it = mapScripts.begin(); it != mapScripts.end(); ++it)
+        filter.insert(std::vector<unsigned char>(it->first.begin(), it->first.end()));
+    BOOST_FOREACH(const CScript& script, setWatchOnly) {
+        // a watched script without any data can't be told apart by the filter
+        bool fHasData = false;
+        CScript::const_iterator pc = script.begin();
+        std::vector<unsigned char> data;
+        opcodetype opcode;
+        while (pc < script.end() && script.GetOp(pc, opcode, data)) {
+            if (data.size() != 0) {
+                filter.insert(data);
+                fHasData = true;
+            }
+        }
+        if (!fHasData)
+            return false;
+    }
+    return true;
+}
+
+bool CWallet::IsSpentOrConflictedByTx(const CTransaction& tx) const
+{
+    AssertLockHeld(cs_wallet); // mapWallet, mapTxSpends
+    BOOST_FOREACH(const CTxIn& txin, tx.vin)
+        if (mapWallet.count(txin.prevout.hash) || mapTxSpends.count(txin.prevout))
+            return true;
+    return false;
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
+ *
+ * Blocks are read and checked against a filter of the wallet's keys and
+ * scripts on worker threads, one batch ahead of the batch being applied to
+ * the wallet. The locks are only held while a batch is applied, so the node
+ * keeps working during a long rescan. Blocks connected meanwhile are picked
+ * up by the next batch, and the last batch is followed up to the tip before
+ * the locks are released: from then on the wallet knows all its outputs and
+ * SyncTransaction sees their spends.
  */
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
@@ -1398,37 +1632,94 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
     const CChainParams& chainParams = Params();
 
     CBlockIndex* pindex = pindexStart;
+    double dProgressStart, dProgressTip;
     {
-        LOCK2(cs_main, cs_wallet);
+        LOCK(cs_main);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
             pindex = chainActive.Next(pindex);
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
-        while (pindex)
+        dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
+    }
+
+    CBloomFilter filter;
+    const CBloomFilter* pfilter = GetRescanFilter(filter) ? &filter : NULL;
+    int nThreads = std::max(1, std::min(MAX_RESCAN_READ_THREADS, GetNumCores()));
+
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+
+    CRescanBatch batches[2];
+    CRescanBatch* pbatchRead = &batches[0];
+    CRescanBatch* pbatchScan = &batches[1];
+    CBlockIndex* pindexLast = NULL; // last block taken into a batch
+    while (true)
+    {
         {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+            LOCK(cs_main);
+            if (pindexLast)
+                pindex = NextRescanIndex(pindexLast);
+            else if (pindex && !chainActive.Contains(pindex))
+                pindex = chainActive.Next(chainActive.FindFork(pindex));
+            while (pindex && pbatchRead->vIndex.size() < RESCAN_BATCH_SIZE) {
+                pbatchRead->vIndex.push_back(pindex);
+                pindexLast = pindex;
+                pindex = chainActive.Next(pindex);
+            }
+        }
+        if (pbatchRead->vIndex.empty() && pbatchScan->vIndex.empty())
+            break;
+
+        pbatchRead->vBlock.resize(pbatchRead->vIndex.size());
+        pbatchRead->vfRead.resize(pbatchRead->vIndex.size(), false);
+        pbatchRead->vfMatch.resize(pbatchRead->vIndex.size());
+        boost::thread_group threadGroup;
+        for (int i = 0; i < nThreads && !pbatchRead->vIndex.empty(); i++)
+            threadGroup.create_thread(boost::bind(&ReadRescanBatch, pbatchRead, pfilter, i, nThreads));
 
-            CBlock block;
-            ReadBlockFromDisk(block, pindex, Params().GetConsensus());
-            BOOST_FOREACH(CTransaction& tx, block.vtx)
+        try {
+            LOCK2(cs_main, cs_wallet);
+            for (size_t i = 0; i < pbatchScan->vIndex.size(); i++)
             {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
-                    ret++;
+                CBlockIndex* pindexScan = pbatchScan->vIndex[i];
+                // disconnected while it was read, the blocks that replaced it are synced as usual
+                if (!chainActive.Contains(pindexScan))
+                    continue;
+
+                if (pindexScan->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                    ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindexScan, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+
+                if (!pbatchScan->vfRead[i])
+                    continue;
+                ret += ScanRescanBlock(this, pbatchScan->vBlock[i], &pbatchScan->vfMatch[i], fUpdate);
+                if (GetTime() >= nNow + 60) {
+                    nNow = GetTime();
+                    LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindexScan->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindexScan));
+                }
             }
-            pindex = chainActive.Next(pindex);
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
+
+            // nothing left to read ahead, follow the blocks connected since
+            // the last batch was taken up to the tip
+            if (pbatchRead->vIndex.empty() && pindexLast) {
+                for (CBlockIndex* pindexTail = NextRescanIndex(pindexLast); pindexTail; pindexTail = chainActive.Next(pindexTail)) {
+                    CBlock block;
+                    if (ReadBlockFromDisk(block, pindexTail, chainParams.GetConsensus()))
+                        ret += ScanRescanBlock(this, block, NULL, fUpdate);
+                    pindexLast = pindexTail;
+                }
             }
+        } catch (...) {
+            threadGroup.join_all();
+            throw;
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+        threadGroup.join_all();
+
+        pbatchScan->Clear();
+        std::swap(pbatchRead, pbatchScan);
     }
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
 }
 
@@ -1841,20 +2132,146 @@ void CWallet::ResendWalletTransactions(int64_t nBestBlockTime)
  */
 
 
-CAmount CWallet::GetBalance() const
+CWalletBalance& CWalletBalance::operator+=(const CWalletBalance& b)
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
+    nTrusted += b.nTrusted;
+    nUntrustedPending += b.nUntrustedPending;
+    nImmature += b.nImmature;
+    nWatchOnlyTrusted += b.nWatchOnlyTrusted;
+    nWatchOnlyUntrustedPending += b.nWatchOnlyUntrustedPending;
+    nWatchOnlyImmature += b.nWatchOnlyImmature;
+    nAnonymized += b.nAnonymized;
+    nDenominatedConfirmed += b.nDenominatedConfirmed;
+    nDenominatedUnconfirmed += b.nDenominatedUnconfirmed;
+    return *this;
+}
+
+CWalletBalance& CWalletBalance::operator-=(const CWalletBalance& b)
+{
+    nTrusted -= b.nTrusted;
+    nUntrustedPending -= b.nUntrustedPending;
+    nImmature -= b.nImmature;
+    nWatchOnlyTrusted -= b.nWatchOnlyTrusted;
+    nWatchOnlyUntrustedPending -= b.nWatchOnlyUntrustedPending;
+    nWatchOnlyImmature -= b.nWatchOnlyImmature;
+    nAnonymized -= b.nAnonymized;
+    nDenominatedConfirmed -= b.nDenominatedConfirmed;
+    nDenominatedUnconfirmed -= b.nDenominatedUnconfirmed;
+    return *this;
+}
+
+bool operator==(const CWalletBalance& a, const CWalletBalance& b)
+{
+    return a.nTrusted == b.nTrusted &&
+           a.nUntrustedPending == b.nUntrustedPending &&
+           a.nImmature == b.nImmature &&
+           a.nWatchOnlyTrusted == b.nWatchOnlyTrusted &&
+           a.nWatchOnlyUntrustedPending == b.nWatchOnlyUntrustedPending &&
+           a.nWatchOnlyImmature == b.nWatchOnlyImmature &&
+           a.nAnonymized == b.nAnonymized &&
+           a.nDenominatedConfirmed == b.nDenominatedConfirmed &&
+           a.nDenominatedUnconfirmed == b.nDenominatedUnconfirmed;
+}
+
+std::string CWalletBalance::ToString() const
+{
+    return strprintf("CWalletBalance(trusted=%d, pending=%d, immature=%d, watchonly trusted=%d, watchonly pending=%d, watchonly immature=%d, anonymized=%d, denominated=%d, denominated unconfirmed=%d)",
+        nTrusted, nUntrustedPending, nImmature, nWatchOnlyTrusted, nWatchOnlyUntrustedPending, nWatchOnlyImmature,
+        nAnonymized, nDenominatedConfirmed, nDenominatedUnconfirmed);
+}
+
+void CWallet::MarkBalanceDirty(const CWalletTx& wtx) const
+{
+    LOCK(cs_wallet);
+    setBalanceDirty.insert(wtx.GetHash());
+    // what this transaction spends counts as available or not depending on its state
+    BOOST_FOREACH(const CTxIn& txin, wtx.vin)
+        if (mapWallet.count(txin.prevout.hash))
+            setBalanceDirty.insert(txin.prevout.hash);
+}
+
+CWalletBalance CWallet::GetTxBalance(const CWalletTx& wtx) const
+{
+    CWalletBalance balance;
+    if (wtx.IsTrusted()) {
+        balance.nTrusted = wtx.GetAvailableCredit();
+        balance.nWatchOnlyTrusted = wtx.GetAvailableWatchOnlyCredit();
+        if (!fLiteMode)
+            balance.nAnonymized = wtx.GetAnonymizedCredit();
+    } else if (wtx.GetDepthInMainChain() == 0 && wtx.InMempool()) {
+        balance.nUntrustedPending = wtx.GetAvailableCredit();
+        balance.nWatchOnlyUntrustedPending = wtx.GetAvailableWatchOnlyCredit();
+    }
+    balance.nImmature = wtx.GetImmatureCredit();
+    balance.nWatchOnlyImmature = wtx.GetImmatureWatchOnlyCredit();
+    if (!fLiteMode) {
+        balance.nDenominatedConfirmed = wtx.GetDenominatedCredit(false);
+        balance.nDenominatedUnconfirmed = wtx.GetDenominatedCredit(true);
+    }
+    return balance;
+}
+
+const CWalletBalance& CWallet::GetCachedBalance() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    if (nBalancePrivateSendRounds != nPrivateSendRounds) {
+        // anonymized credit depends on the setting, recount everything
         for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableCredit();
+            setBalanceDirty.insert(it->first);
+        nBalancePrivateSendRounds = nPrivateSendRounds;
+    }
+
+    BOOST_FOREACH(const uint256& hash, setBalanceVolatile) {
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+        if (it != mapWallet.end())
+            MarkBalanceDirty(it->second);
+    }
+    setBalanceVolatile.clear();
+
+    std::set<uint256> setDirty;
+    setDirty.swap(setBalanceDirty);
+    BOOST_FOREACH(const uint256& hash, setDirty) {
+        std::map<uint256, CWalletBalance>::iterator itBalance = mapTxBalances.find(hash);
+        if (itBalance != mapTxBalances.end()) {
+            balanceTotal -= itBalance->second;
+            mapTxBalances.erase(itBalance);
         }
+
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+        if (it == mapWallet.end())
+            continue;
+        const CWalletTx& wtx = it->second;
+        CWalletBalance balance = GetTxBalance(wtx);
+        if (!balance.IsNull()) {
+            balanceTotal += balance;
+            mapTxBalances.insert(std::make_pair(hash, balance));
+        }
+        // a conflict buried as deep as a coinbase has to be to mature is taken as final
+        int nDepth = wtx.GetDepthInMainChain(false);
+        if ((nDepth < 1 && nDepth > -COINBASE_MATURITY) || (nDepth >= 1 && wtx.GetBlocksToMaturity() > 0))
+            setBalanceVolatile.insert(hash);
     }
 
-    return nTotal;
+    if (fCheckWalletBalances) {
+        CWalletBalance balanceCheck;
+        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+            balanceCheck += GetTxBalance(it->second);
+        if (balanceCheck != balanceTotal) {
+            LogPrintf("CWallet::GetCachedBalance -- cached %s\n", balanceTotal.ToString());
+            LogPrintf("CWallet::GetCachedBalance -- expected %s\n", balanceCheck.ToString());
+        }
+        assert(balanceCheck == balanceTotal);
+    }
+
+    return balanceTotal;
+}
+
+CAmount CWallet::GetBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalance().nTrusted;
 }
 
 CAmount CWallet::GetAnonymizableBalance(bool fSkipDenominated) const
@@ -1881,19 +2298,8 @@ CAmount CWallet::GetAnonymizedBalance() const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAnonymizedCredit();
-        }
-    }
-
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalance().nAnonymized;
 }
 
 // Note: calculated including unconfirmed,
@@ -1991,92 +2397,38 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
 {
     if(fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-
-            nTotal += pcoin->GetDenominatedCredit(unconfirmed);
-        }
-    }
-
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return unconfirmed ? GetCachedBalance().nDenominatedUnconfirmed : GetCachedBalance().nDenominatedConfirmed;
 }
 
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalance().nUntrustedPending;
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalance().nImmature;
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalance().nWatchOnlyTrusted;
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && pcoin->InMempool())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalance().nWatchOnlyUntrustedPending;
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetCachedBalance().nWatchOnlyImmature;
 }
 
 void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const CCoinControl *coinControl, bool fIncludeZeroValue, AvailableCoinsType nCoinType, bool fUseInstantSend) const
@@ -3348,6 +3700,12 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
         return nLoadWalletRet;
     fFirstRunRet = !vchDefaultKey.IsValid();
 
+    {
+        LOCK(cs_wallet);
+        CWalletDB walletdb(strWalletFile);
+        SyncPrivateSendRounds(&walletdb);
+    }
+
     uiInterface.LoadWallet(this);
 
     return DB_LOAD_OK;
@@ -39,6 +39,7 @@ extern CAmount maxTxFee;
 extern unsigned int nTxConfirmTarget;
 extern bool bSpendZeroConfChange;
 extern bool fSendFreeTransactions;
+extern bool fCheckWalletBalances;
 
 extern bool fLargeWorkForkFound;
 extern bool fLargeWorkInvalidChainFound;
@@ -64,6 +65,8 @@ static const CAmount MIN_CHANGE = CENT;
 static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 //! Default for -sendfreetransactions
 static const bool DEFAULT_SEND_FREE_TRANSACTIONS = false;
+//! Default for -checkwalletbalances
+static const bool DEFAULT_CHECK_WALLET_BALANCES = false;
 //! -txconfirmtarget default
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 2;
 //! -maxtxfee will warn if called with a higher fee than this amount (in satoshis)
@@ -74,6 +77,7 @@ static const bool DEFAULT_WALLETBROADCAST = true;
 
 class CAccountingEntry;
 class CBlockIndex;
+class CBloomFilter;
 class CCoinControl;
 class COutput;
 class CReserveKey;
@@ -395,21 +399,8 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        fCreditCached = false;
-        fAvailableCreditCached = false;
-        fImmatureCreditCached = false;
-        fAnonymizedCreditCached = false;
-        fDenomUnconfCreditCached = false;
-        fDenomConfCreditCached = false;
-        fWatchDebitCached = false;
-        fWatchCreditCached = false;
-        fAvailableWatchCreditCached = false;
-        fImmatureWatchCreditCached = false;
-        fDebitCached = false;
-        fChangeCached = false;
-    }
+    //! make sure balances are recalculated, also the ones the wallet keeps a total of
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -456,6 +447,43 @@ public:
     std::set<uint256> GetConflicts() const;
 };
 
+/** Wallet balances, or the contribution of a single transaction to them */
+struct CWalletBalance
+{
+    CAmount nTrusted;
+    CAmount nUntrustedPending;
+    CAmount nImmature;
+    CAmount nWatchOnlyTrusted;
+    CAmount nWatchOnlyUntrustedPending;
+    CAmount nWatchOnlyImmature;
+    CAmount nAnonymized;
+    CAmount nDenominatedConfirmed;
+    CAmount nDenominatedUnconfirmed;
+
+    CWalletBalance()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        nTrusted = nUntrustedPending = nImmature = 0;
+        nWatchOnlyTrusted = nWatchOnlyUntrustedPending = nWatchOnlyImmature = 0;
+        nAnonymized = nDenominatedConfirmed = nDenominatedUnconfirmed = 0;
+    }
+
+    bool IsNull() const
+    {
+        return *this == CWalletBalance();
+    }
+
+    CWalletBalance& operator+=(const CWalletBalance& b);
+    CWalletBalance& operator-=(const CWalletBalance& b);
+    friend bool operator==(const CWalletBalance& a, const CWalletBalance& b);
+    friend bool operator!=(const CWalletBalance& a, const CWalletBalance& b) { return !(a == b); }
+
+    std::string ToString() const;
+};
 
 
 
@@ -516,6 +544,8 @@ public:
 class CWallet : public CCryptoKeyStore, public CValidationInterface
 {
 private:
+    friend struct CWalletTestAccess;
+
     /**
      * Select a set of coins such that nValueRet >= nTargetValue and at least
      * all coins from coinControl are selected; Never select unconfirmed coins
@@ -555,6 +585,35 @@ private:
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
+    /**
+     * Balance ledger: the contribution of every wallet transaction to the
+     * balances and their sum. Transactions are recounted after they were
+     * marked dirty. The ones whose contribution changes without the wallet
+     * being told (unconfirmed, conflicted or immature) are recounted, together
+     * with the transactions they spend from, on every query, until they are
+     * mature or conflicted by a block COINBASE_MATURITY deep.
+     */
+    mutable std::map<uint256, CWalletBalance> mapTxBalances;
+    mutable CWalletBalance balanceTotal;
+    mutable std::set<uint256> setBalanceDirty;
+    mutable std::set<uint256> setBalanceVolatile;
+    mutable int nBalancePrivateSendRounds;
+    CWalletBalance GetTxBalance(const CWalletTx& wtx) const;
+    const CWalletBalance& GetCachedBalance() const;
+
+    /**
+     * PrivateSend rounds of wallet outputs, computed when a transaction is added
+     * and stored in the wallet file next to it. Only unspent outputs are kept,
+     * rounds that are asked for again are recomputed on demand.
+     */
+    mutable std::map<COutPoint, int> mapOutpointRounds;
+    /* Recompute the rounds of the outputs of a transaction, returns true if any changed. */
+    bool UpdateOutputPrivateSendRounds(const CWalletTx& wtx, CWalletDB* pwalletdb);
+    /* Update the rounds of a new transaction and of its in-wallet descendants. */
+    void UpdatePrivateSendRounds(const CWalletTx& wtxIn, CWalletDB* pwalletdb);
+    /* Fill in missing rounds and drop those of spent outputs after loading. */
+    void SyncPrivateSendRounds(CWalletDB* pwalletdb);
+
 public:
     /*
      * Main wallet lock.
@@ -610,6 +669,7 @@ public:
         fAnonymizableTallyCachedNonDenom = false;
         vecAnonymizableTallyCached.clear();
         vecAnonymizableTallyCachedNonDenom.clear();
+        nBalancePrivateSendRounds = -1;
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -706,6 +766,8 @@ public:
     bool EraseDestData(const CTxDestination &dest, const std::string &key);
     //! Adds a destination data tuple to the store, without saving it to disk
     bool LoadDestData(const CTxDestination &dest, const std::string &key, const std::string &value);
+    //! Adds the stored PrivateSend rounds of the outputs of a transaction, without saving them to disk
+    void LoadPrivateSendRounds(const uint256& hash, const std::vector<int>& vRounds);
     //! Look up a destination data tuple in the store, return true if found false otherwise
     bool GetDestData(const CTxDestination &dest, const std::string &key, std::string *value) const;
 
@@ -728,9 +790,15 @@ public:
     int64_t IncOrderPosNext(CWalletDB *pwalletdb = NULL);
 
     void MarkDirty();
+    //! Recount the balance contribution of a transaction and of the ones it spends from
+    void MarkBalanceDirty(const CWalletTx& wtx) const;
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
+    //! Filter matching outputs that may belong to the wallet, false if some can't be matched
+    bool GetRescanFilter(CBloomFilter& filter) const;
+    //! Whether a transaction spends from the wallet or conflicts with a wallet transaction
+    bool IsSpentOrConflictedByTx(const CTransaction& tx) const;
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime);
@@ -68,6 +68,18 @@ bool CWalletDB::EraseTx(uint256 hash)
     return Erase(std::make_pair(std::string("tx"), hash));
 }
 
+bool CWalletDB::WritePrivateSendRounds(const uint256& hash, const std::vector<int>& vRounds)
+{
+    nWalletDBUpdated++;
+    return Write(std::make_pair(std::string("psrounds"), hash), vRounds);
+}
+
+bool CWalletDB::ErasePrivateSendRounds(const uint256& hash)
+{
+    nWalletDBUpdated++;
+    return Erase(std::make_pair(std::string("psrounds"), hash));
+}
+
 bool CWalletDB::WriteKey(const CPubKey& vchPubKey, const CPrivKey& vchPrivKey, const CKeyMetadata& keyMeta)
 {
     nWalletDBUpdated++;
@@ -600,6 +612,14 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
                 return false;
             }
         }
+        else if (strType == "psrounds")
+        {
+            uint256 hash;
+            ssKey >> hash;
+            std::vector<int> vRounds;
+            ssValue >> vRounds;
+            pwallet->LoadPrivateSendRounds(hash, vRounds);
+        }
     } catch (...)
     {
         return false;
@@ -800,7 +820,7 @@ DBErrors CWalletDB::ZapWalletTx(CWallet* pwallet, vector<CWalletTx>& vWtx)
 
     // erase each wallet TX
     BOOST_FOREACH (uint256& hash, vTxHash) {
-        if (!EraseTx(hash))
+        if (!EraseTx(hash) || !ErasePrivateSendRounds(hash))
             return DB_CORRUPT;
     }
 